@@ -6,27 +6,39 @@
 #include "usbVideo/VideoManagement.hpp"
 #include "usbAudio/AudioRecordService.hpp"
 #include "usbAudio/AudioPlaybackService.hpp"
+#include "usbAudio/LatencyProbe.hpp"
 #include "common/CommonFunction.hpp"
-#include "socket/ConcreteRTPSession.hpp"
+#include "socket/IRTPSession.hpp"
 
 namespace
 {
     std::atomic_bool keep_running{ true };
     constexpr int PipeFileRight = 0666;
+    // the latency sweep runs every period time with this many periods in the device buffer
+    constexpr unsigned int sweepBufferPeriods = 4;
+    constexpr unsigned int microsecondsPerMillisecond = 1000;
+    // a period time is stable while no marker is lost and p99 stays within this many periods of p50
+    constexpr double stableSpreadPeriods = 2.0;
+    // control messages followed by ip:port of an RTP listener
+    const std::string addListenerMessage = "add listener ";
+    const std::string removeListenerMessage = "remove listener ";
 } // namespace 
 namespace application
 {
     AppInstance::AppInstance(spdlog::logger& logger, const configuration::AppConfiguration& config, 
             const configuration::AppAddresses& appAddress)
-        : m_config{config}
+        : m_logger{ logger }
+        , m_config{config}
         , m_ioService{ std::make_unique<timerservice::IOService>() }
         , m_timerService{ std::make_unique<timerservice::DefaultTimerService>(*m_ioService) }
         , m_clientReceiver{ logger, config, appAddress, *m_timerService }
         , m_cameraProcess{ std::make_unique<usbVideo::CameraService>(logger, m_config) }
         , m_videoManagement{ std::make_unique<usbVideo::VideoManagement>(logger, m_config, *m_timerService) }
-        , m_rtpSession{ std::make_shared<endpoints::ConcreteRTPSession>(logger, m_config) }
-        , m_audioRecordService{std::make_unique<usbAudio::AudioRecordService>(logger, m_config, m_rtpSession)}
-        , m_audioPlayabckService{ std::make_unique<usbAudio::AudioPlaybackService>(logger, m_config, m_rtpSession) }
+        , m_rtpSession{ endpoints::createRTPTransport(logger, m_config) }
+        , m_latencyProbe{ audio::getLatencyProbe(m_config) ? std::make_shared<usbAudio::LatencyProbe>(logger,
+            static_cast<unsigned int>(std::max(audio::getLatencyProbeIntervalMs(m_config), 0))) : nullptr }
+        , m_audioRecordService{std::make_unique<usbAudio::AudioRecordService>(logger, m_config, m_rtpSession, m_latencyProbe)}
+        , m_audioPlayabckService{ std::make_unique<usbAudio::AudioPlaybackService>(logger, m_config, m_rtpSession, m_latencyProbe) }
     {
         initService(logger);
     }
@@ -125,34 +137,58 @@ namespace application
 
     void AppInstance::clientDataReceived()
     {
+        std::string dataMessage;
         while (keep_running)
         {
-            std::string dataMessage = m_clientReceiver.getDataMessage();
+            m_clientReceiver.getDataMessage(dataMessage);
 
             if (0 < dataMessage.length())
             {
                 if ("start talk" == dataMessage)
                 {
-                    if (m_audioRecordService)
+                    if (m_latencyProbe)
                     {
-                        m_audioRecordService->audioStartListening();
+                        m_latencyProbe->reset();
                     }
-
-                    if (m_audioPlayabckService)
+                    startTalk();
+                }
+                else if("stop talk" == dataMessage)
+                {
+                    stopTalk();
+                    if (m_latencyProbe)
                     {
-                        m_audioPlayabckService->audioStartPlaying();
+                        m_latencyProbe->report("talk");
                     }
+                    logNetworkStats();
                 }
-                else if("stop talk" == dataMessage)
+                else if ("network stats" == dataMessage)
                 {
-                    if (m_audioRecordService)
+                    logNetworkStats();
+                }
+                else if (0 == dataMessage.compare(0, addListenerMessage.size(), addListenerMessage))
+                {
+                    changeListener(dataMessage.substr(addListenerMessage.size()), true);
+                }
+                else if (0 == dataMessage.compare(0, removeListenerMessage.size(), removeListenerMessage))
+                {
+                    changeListener(dataMessage.substr(removeListenerMessage.size()), false);
+                }
+                else if ("latency sweep" == dataMessage)
+                {
+                    runLatencySweep();
+                }
+                else if ("snapshot" == dataMessage)
+                {
+                    if (m_cameraProcess)
                     {
-                        m_audioRecordService->audioStopListening();
+                        m_cameraProcess->requestSnapshot();
                     }
-
-                    if (m_audioPlayabckService)
+                }
+                else if ("burst" == dataMessage)
+                {
+                    if (m_cameraProcess)
                     {
-                        m_audioPlayabckService->audioStopPlaying();
+                        m_cameraProcess->requestBurst();
                     }
                 }
             }
@@ -163,6 +199,121 @@ namespace application
         }
     }
 
+    void AppInstance::startTalk()
+    {
+        if (m_audioRecordService)
+        {
+            m_audioRecordService->audioStartListening();
+        }
+
+        if (m_audioPlayabckService)
+        {
+            m_audioPlayabckService->audioStartPlaying();
+        }
+    }
+
+    void AppInstance::stopTalk()
+    {
+        if (m_audioRecordService)
+        {
+            m_audioRecordService->audioStopListening();
+        }
+
+        if (m_audioPlayabckService)
+        {
+            m_audioPlayabckService->audioStopPlaying();
+        }
+    }
+
+    void AppInstance::changeListener(const std::string& address, bool add)
+    {
+        std::string ipAddress;
+        int port = 0;
+        if (not m_rtpSession or not rtp::parseRTPAddress(address, ipAddress, port))
+        {
+            LOG_WARNING_MSG("Ignore listener {}, not ip:port.", address);
+            return;
+        }
+        // the session takes it from the next packet on, no restart
+        if (add)
+        {
+            m_rtpSession->addDestination(ipAddress, port);
+        }
+        else
+        {
+            m_rtpSession->removeDestination(ipAddress, port);
+        }
+    }
+
+    void AppInstance::logNetworkStats()
+    {
+        if (not m_rtpSession)
+        {
+            return;
+        }
+        // own reception from the local statistics, the far end view of the own stream from its reports
+        for (const configuration::RTPNetworkStats& stats : m_rtpSession->getNetworkStats())
+        {
+            LOG_INFO_MSG(m_logger, "RTP ssrc {:08x}: received {} lost {} ({:.1f}%) recovered {} jitter {:.1f} ms, "
+                "reports {} far end lost {} ({:.1f}%) jitter {:.1f} ms, round trip {:.1f} ms.",
+                stats.ssrc, stats.receivedPackets, stats.lostPackets, stats.fractionLost * 100.0, stats.recoveredPackets,
+                stats.jitterMs, stats.reports, stats.reportedLostPackets, stats.reportedFractionLost * 100.0, stats.reportedJitterMs,
+                stats.roundTripMs);
+        }
+    }
+
+    void AppInstance::runLatencySweep()
+    {
+        if (not m_latencyProbe or not m_audioRecordService or not m_audioPlayabckService)
+        {
+            LOG_WARNING_MSG("Latency sweep needs audio.latencyProbe and both audio services.");
+            return;
+        }
+
+        const std::size_t markers = static_cast<std::size_t>(std::max(audio::getLatencyProbeMarkers(m_config), 1));
+        // every marker gets its interval, plus a few for the start and the loss of some
+        const std::chrono::milliseconds timeout((markers + 5) * static_cast<unsigned int>(
+            std::max(audio::getLatencyProbeIntervalMs(m_config), 1)));
+        unsigned int lowestStablePeriodMs = 0;
+        stopTalk();
+        for (const unsigned int periodMs : audio::getLatencyProbeSweep(m_config))
+        {
+            const unsigned int periodTimeUs = periodMs * microsecondsPerMillisecond;
+            if (not m_audioRecordService->setPeriodTime(periodTimeUs, periodTimeUs * sweepBufferPeriods) or
+                not m_audioPlayabckService->setPeriodTime(periodTimeUs, periodTimeUs * sweepBufferPeriods))
+            {
+                LOG_WARNING_MSG("Latency sweep skips period time {} ms, the device refused it.", periodMs);
+                continue;
+            }
+
+            m_latencyProbe->reset();
+            startTalk();
+            m_latencyProbe->waitForMarkers(markers, timeout);
+            stopTalk();
+
+            const usbAudio::LatencyProbe::Summary summary = m_latencyProbe->report("period " + std::to_string(periodMs) + " ms");
+            const double spreadMs = summary.p99Ms[usbAudio::LatencyProbe::STAGE_TOTAL] - summary.p50Ms[usbAudio::LatencyProbe::STAGE_TOTAL];
+            const bool stable = markers <= summary.markers and 0 == summary.lostMarkers and spreadMs <= stableSpreadPeriods * periodMs;
+            LOG_INFO_MSG(m_logger, "Latency sweep period {} ms: total p50 {:.1f} ms, p99 {:.1f} ms, {}.", periodMs,
+                summary.p50Ms[usbAudio::LatencyProbe::STAGE_TOTAL], summary.p99Ms[usbAudio::LatencyProbe::STAGE_TOTAL],
+                stable ? "stable" : "unstable");
+            if (stable and (0 == lowestStablePeriodMs or periodMs < lowestStablePeriodMs))
+            {
+                lowestStablePeriodMs = periodMs;
+            }
+        }
+
+        // back to the configured device defaults
+        m_audioRecordService->setPeriodTime(0, 0);
+        m_audioPlayabckService->setPeriodTime(0, 0);
+        if (0 == lowestStablePeriodMs)
+        {
+            LOG_WARNING_MSG("Latency sweep found no stable period time.");
+            return;
+        }
+        LOG_INFO_MSG(m_logger, "Latency sweep lowest stable period time {} ms.", lowestStablePeriodMs);
+    }
+
     void AppInstance::loopFuction()
     {
         if (m_cameraProcess)
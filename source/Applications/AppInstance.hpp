@@ -25,6 +25,7 @@ namespace usbAudio
 {
     class IAudioRecordService;
     class IAudioPlaybackService;
+    class LatencyProbe;
 } // namespace usbAudio
 
 namespace endpoints
@@ -47,8 +48,14 @@ namespace application
         void initService(spdlog::logger& logger);
         void clientDataReceived();
         bool createPipeFile();
+        void startTalk();
+        void stopTalk();
+        void runLatencySweep();
+        void logNetworkStats();
+        void changeListener(const std::string& address, bool add);
 
     private:
+        spdlog::logger& m_logger;
         const configuration::AppConfiguration& m_config;
         std::unique_ptr<timerservice::IOService> m_ioService;
         std::unique_ptr<timerservice::TimerService> m_timerService{};
@@ -62,6 +69,8 @@ namespace application
         std::thread m_videoManagementThread;
 
         std::shared_ptr<endpoints::IRTPSession> m_rtpSession;
+        // null without audio.latencyProbe
+        std::shared_ptr<usbAudio::LatencyProbe> m_latencyProbe;
         std::unique_ptr<usbAudio::IAudioRecordService> m_audioRecordService;
         std::unique_ptr<usbAudio::IAudioPlaybackService> m_audioPlayabckService;
         std::thread m_audioRecordThread;
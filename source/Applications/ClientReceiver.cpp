@@ -11,7 +11,7 @@ namespace application
                                    const configuration::AppAddresses& appAddress, timerservice::TimerService& timerService)
         :m_logger{logger}
     {
-        configuration::TcpConfiguration tcpConfiguration;
+        configuration::TcpConfiguration tcpConfiguration = configuration::getTcpConfiguration(config);
         m_socketSysCall = std::make_unique<endpoints::SocketSysCall>();
         m_clientSocket = std::make_unique<endpoints::ClientSocket>(logger, *m_socketSysCall, tcpConfiguration,
                                                                    *this, config, appAddress, timerService);
@@ -23,24 +23,34 @@ namespace application
     }
 
 
-    void ClientReceiver::onDataMessage(const std::string& dataMessage)
+    void ClientReceiver::onDataMessage(boost::string_ref dataMessage)
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_receiveDatas.push(dataMessage);
-        LOG_DEBUG_MSG("data message : {}", dataMessage.c_str());
+        if (m_freeDatas.empty())
+        {
+            m_receiveDatas.emplace_back();
+        }
+        else
+        {
+            m_receiveDatas.push_back(std::move(m_freeDatas.back()));
+            m_freeDatas.pop_back();
+        }
+        m_receiveDatas.back().assign(dataMessage.data(), dataMessage.size());
+        LOG_DEBUG_MSG("data message : {}", m_receiveDatas.back().c_str());
 
         m_condition.notify_one();
     }
 
-    std::string ClientReceiver::getDataMessage()
+    void ClientReceiver::getDataMessage(std::string& dataMessage)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
         m_condition.wait(lock, [this]()
                         {
                             return !m_receiveDatas.empty();
                         });
-        std::string temp = m_receiveDatas.front();
-        m_receiveDatas.pop();
-        return temp;
+        // the queue is a few messages at most, moving them up does not allocate
+        std::swap(dataMessage, m_receiveDatas.front());
+        m_freeDatas.push_back(std::move(m_receiveDatas.front()));
+        m_receiveDatas.erase(m_receiveDatas.begin());
     }
 }
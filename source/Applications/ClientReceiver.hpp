@@ -4,7 +4,7 @@
 #pragma once
 #include <condition_variable>
 #include <mutex>
-#include <queue>
+#include <vector>
 #include "logger/LoggerFwd.hpp"
 #include "Configurations/Configurations.hpp"
 #include "socket/ClientSocket.hpp"
@@ -20,15 +20,18 @@ namespace application
         ClientReceiver(Logger& logger, const configuration::AppConfiguration& config,
                        const configuration::AppAddresses& appAddress, timerservice::TimerService& timerService);
 
-        void onDataMessage(const std::string& dataMessage);
-        std::string getDataMessage();
+        void onDataMessage(boost::string_ref dataMessage) override;
+        // waits for the next message, the string given in is reused for a later one
+        void getDataMessage(std::string& dataMessage);
         void receiveLoop();
 
     private:
         std::unique_ptr<endpoints::ISocketSysCall> m_socketSysCall;
         std::unique_ptr<endpoints::ClientSocket> m_clientSocket;
         Logger& m_logger;
-        std::queue<std::string> m_receiveDatas;
+        std::vector<std::string> m_receiveDatas;
+        // taken message strings keep their capacity for the next ones
+        std::vector<std::string> m_freeDatas;
 
         mutable std::mutex m_mutex;
         std::condition_variable m_condition;
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 #include <queue>
+#include "common/PacketBufferPool.hpp"
 
 #define LOG_CONFIG_PREFIX "log"
 #define VIDEO_CONFIG_PREFIX "video"
@@ -25,6 +26,15 @@ namespace configuration
     constexpr auto videoFPS           = VIDEO_CONFIG_PREFIX ".videoFPS";
     constexpr auto videoBitRate       = VIDEO_CONFIG_PREFIX ".videoBitRate";
     constexpr auto videoTimes         = VIDEO_CONFIG_PREFIX ".videoTimes";
+    constexpr auto videoDecodeThreads = VIDEO_CONFIG_PREFIX ".videoDecodeThreads";
+    constexpr auto enableThumbnails   = VIDEO_CONFIG_PREFIX ".enableThumbnails";
+    constexpr auto thumbnailInterval  = VIDEO_CONFIG_PREFIX ".thumbnailInterval";
+    constexpr auto thumbnailWidth     = VIDEO_CONFIG_PREFIX ".thumbnailWidth";
+    constexpr auto snapshotFormat     = VIDEO_CONFIG_PREFIX ".snapshotFormat";
+    constexpr auto snapshotQuality    = VIDEO_CONFIG_PREFIX ".snapshotQuality";
+    constexpr auto burstCount         = VIDEO_CONFIG_PREFIX ".burstCount";
+    constexpr auto captureMode        = VIDEO_CONFIG_PREFIX ".captureMode";
+    constexpr auto timelapseInterval  = VIDEO_CONFIG_PREFIX ".timelapseInterval";
     constexpr auto V4l2RequestBuffersCounter = V4L2_CONFIG_PREFIX ".V4l2RequestBuffersCounter";
     constexpr auto V4L2CaptureFormat         = V4L2_CONFIG_PREFIX ".V4L2CaptureFormat";
     constexpr auto captureWidth              = V4L2_CONFIG_PREFIX ".captureWidth";
@@ -34,6 +44,8 @@ namespace configuration
     constexpr auto chessBoardServerPort    = SOCKET_CONFIG_PREFIX ".chessBoardServerPort";
     constexpr auto kitokeiLocalAddress     = SOCKET_CONFIG_PREFIX ".kitokeiLocalAddress";
     constexpr auto kitokeiLocalPort        = SOCKET_CONFIG_PREFIX ".kitokeiLocalPort";
+    constexpr auto messageFraming          = SOCKET_CONFIG_PREFIX ".messageFraming";
+    constexpr auto maxMessageBytes         = SOCKET_CONFIG_PREFIX ".maxMessageBytes";
     constexpr auto audioName              = AUDIO_CONFIG_PREFIX ".audioName";
     constexpr auto enableWriteAudioToFile = AUDIO_CONFIG_PREFIX ".enableWriteAudioToFile";
     constexpr auto audioDevice            = AUDIO_CONFIG_PREFIX ".audioDevice";
@@ -43,10 +55,43 @@ namespace configuration
     constexpr auto playbackDevice         = AUDIO_CONFIG_PREFIX ".playbackDevice";
     constexpr auto readTestAudioFile      = AUDIO_CONFIG_PREFIX ".readTestAudioFile";
     constexpr auto audioFormat            = AUDIO_CONFIG_PREFIX ".audioFormat";
+    constexpr auto jitterMinDelay         = AUDIO_CONFIG_PREFIX ".jitterMinDelay";
+    constexpr auto jitterMaxDelay         = AUDIO_CONFIG_PREFIX ".jitterMaxDelay";
+    constexpr auto opusBitrate            = AUDIO_CONFIG_PREFIX ".opusBitrate";
+    constexpr auto opusFrameMs            = AUDIO_CONFIG_PREFIX ".opusFrameMs";
+    constexpr auto opusComplexity         = AUDIO_CONFIG_PREFIX ".opusComplexity";
+    constexpr auto opusPayloadType        = AUDIO_CONFIG_PREFIX ".opusPayloadType";
+    constexpr auto adaptiveBitrate        = AUDIO_CONFIG_PREFIX ".adaptiveBitrate";
+    constexpr auto opusMinBitrate         = AUDIO_CONFIG_PREFIX ".opusMinBitrate";
+    constexpr auto vadEnable              = AUDIO_CONFIG_PREFIX ".vadEnable";
+    constexpr auto vadThreshold           = AUDIO_CONFIG_PREFIX ".vadThreshold";
+    constexpr auto vadHangover            = AUDIO_CONFIG_PREFIX ".vadHangover";
+    constexpr auto comfortNoisePayloadType = AUDIO_CONFIG_PREFIX ".comfortNoisePayloadType";
+    constexpr auto mixerMaxSources        = AUDIO_CONFIG_PREFIX ".mixerMaxSources";
+    constexpr auto mixerSourceGain        = AUDIO_CONFIG_PREFIX ".mixerSourceGain";
+    constexpr auto deviceSampleRate       = AUDIO_CONFIG_PREFIX ".deviceSampleRate";
+    constexpr auto deviceChannel          = AUDIO_CONFIG_PREFIX ".deviceChannel";
+    constexpr auto wavBufferMs            = AUDIO_CONFIG_PREFIX ".wavBufferMs";
+    constexpr auto wavCheckpointMs        = AUDIO_CONFIG_PREFIX ".wavCheckpointMs";
+    constexpr auto latencyProfile         = AUDIO_CONFIG_PREFIX ".latencyProfile";
+    constexpr auto latencyProbe           = AUDIO_CONFIG_PREFIX ".latencyProbe";
+    constexpr auto latencyProbeIntervalMs = AUDIO_CONFIG_PREFIX ".latencyProbeIntervalMs";
+    constexpr auto latencyProbeMarkers    = AUDIO_CONFIG_PREFIX ".latencyProbeMarkers";
+    constexpr auto latencyProbeSweep      = AUDIO_CONFIG_PREFIX ".latencyProbeSweep";
+    constexpr auto fecMode                = AUDIO_CONFIG_PREFIX ".fecMode";
+    constexpr auto fecGroupSize           = AUDIO_CONFIG_PREFIX ".fecGroupSize";
+    constexpr auto redundancyDepth        = AUDIO_CONFIG_PREFIX ".redundancyDepth";
+    constexpr auto redPayloadType         = AUDIO_CONFIG_PREFIX ".redPayloadType";
+    constexpr auto fecPayloadType         = AUDIO_CONFIG_PREFIX ".fecPayloadType";
     constexpr auto localSendRTPPort    = RTP_CONFIG_PREFIX ".localSendRTPPort";
     constexpr auto remoteRTPPort       = RTP_CONFIG_PREFIX ".remoteRTPPort";
     constexpr auto remoteRTPIpAddress  = RTP_CONFIG_PREFIX ".remoteRTPIpAddress";
     constexpr auto localReceiveRTPPort = RTP_CONFIG_PREFIX ".localReceiveRTPPort";
+    constexpr auto rtpTransport        = RTP_CONFIG_PREFIX ".transport";
+    constexpr auto rtpDestinations     = RTP_CONFIG_PREFIX ".destinations";
+    constexpr auto multicastGroup      = RTP_CONFIG_PREFIX ".multicastGroup";
+    constexpr auto multicastTtl        = RTP_CONFIG_PREFIX ".multicastTtl";
+    constexpr auto destinationMaxKbps  = RTP_CONFIG_PREFIX ".destinationMaxKbps";
 
  /*****************socket struct**************************/
     struct AppAddresses
@@ -58,9 +103,22 @@ namespace configuration
 		unsigned int kitokeiLocalPort;
     };
 
-    struct TcpConfiguration
+    // how the control channel byte stream is cut into messages
+    enum class MessageFraming
     {
+        // every read is one message, as the server sent it in one piece
+        MESSAGE_FRAMING_READ,
+        // messages end with \n, a \r before it is dropped
+        MESSAGE_FRAMING_LINE,
+        // 4 byte big endian length, then the message
+        MESSAGE_FRAMING_LENGTH
+    };
 
+    struct TcpConfiguration
+    {
+        MessageFraming messageFraming{ MessageFraming::MESSAGE_FRAMING_READ };
+        // longest message before conversion, longer ones are dropped
+        std::size_t maxMessageBytes{ 4096 };
     };
 
  /*****************video struct**************************/
@@ -140,6 +198,18 @@ namespace configuration
         }
     };
 
+    /* device and packet geometry of audio.latencyProfile, the same for capture and playback.
+     * Zero times keep what the device offers and the 320 byte packets of PCM and G711. */
+    struct LatencyProfile
+    {
+        std::string name{"device"};
+        unsigned int periodTimeUs{0};
+        unsigned int bufferPeriods{0};
+        unsigned int packetTimeMs{0};
+        unsigned int availMinPeriods{1};   // periods the device collects before the event loop wakes up
+        unsigned int startThresholdPeriods{0}; // periods queued before the device starts, 0 for the whole buffer
+    };
+
     /* Do not change the sequence */
     enum class ALSAState
     {
@@ -170,6 +240,7 @@ namespace configuration
     struct ALSAAudioContext
     {
         std::function<void(std::string& data)> onDataInd; // record callback
+        std::function<void(std::uint8_t* data, size_t frames)> onDataReq; // playback callback, fills one period
         void* userCallbackPara{nullptr};   // save SpeechRecord point
         ALSAState alsaState;           // internal record state
         void* pcmHandle{nullptr};      // snd_pcm_t point
@@ -184,7 +255,12 @@ namespace configuration
         size_t       periodFrames{0}; // The number of frames generated by a channel 1 second
         size_t       bufferFrames{0};
         int          bitsPerFrame{0}; // bit data per frame = bit per sample * channel
+        bool         mmapAccess{false}; // device buffer mapped, otherwise readi/writei
+        unsigned int availMinPeriods{1};
+        unsigned int startThresholdPeriods{0}; // 0 for the whole buffer
+        size_t       startThresholdFrames{0}; // as the device accepted it
         std::vector<std::uint8_t> audioBuffer;
+        std::string  recordData; // handed to onDataInd every period, reused
     };
 
     enum class SpeechAudioSource
@@ -243,11 +319,37 @@ namespace configuration
 
     struct RTPSessionData
     {
-        std::vector<std::uint8_t> payloadDatas;
+        // shares the pooled receive buffer, no copy
+        common::PacketSlice payloadDatas;
         std::uint32_t timestamp;
         std::uint16_t sequenceNumber;
+        std::uint8_t payloadType;
+        bool marker;
+        std::uint32_t ssrc;
+    };
+    // kept by the receiver across polls, clear() keeps the capacity
+    using RTPSessionDatas = std::vector<RTPSessionData>;
+
+    // RTCP view of one SSRC: its packets as received here, its reports on the own stream
+    struct RTPNetworkStats
+    {
+        std::uint32_t ssrc{ 0 };
+        std::uint64_t receivedPackets{ 0 };
+        // cumulative, negative with duplicates
+        std::int64_t lostPackets{ 0 };
+        // 0..1 over the last report interval
+        double fractionLost{ 0.0 };
+        double jitterMs{ 0.0 };
+        // receiver reports of the SSRC on the own stream
+        std::uint64_t reports{ 0 };
+        double reportedFractionLost{ 0.0 };
+        std::int64_t reportedLostPackets{ 0 };
+        double reportedJitterMs{ 0.0 };
+        // from LSR and DLSR, 0 while unknown
+        double roundTripMs{ 0.0 };
+        // lost packets of the SSRC put back from redundancy or parity, counted in lostPackets too
+        std::uint64_t recoveredPackets{ 0 };
     };
-    using RTPSessionDatas = std::queue<RTPSessionData>;
 
 #pragma pack(push)
 #pragma pack(2)
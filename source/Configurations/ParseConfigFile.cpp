@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include "ParseConfigFile.hpp"
@@ -20,6 +21,15 @@ namespace
             (configuration::videoFPS,           value<int>()->default_value(25),                            "frame rate.")
             (configuration::videoBitRate,       value<int>()->default_value(400000),                        "video bit rate.")
             (configuration::videoTimes,         value<int>()->default_value(30),                            "each file times.")
+            (configuration::videoDecodeThreads, value<int>()->default_value(0),                             "decoder threads, 0 for one per core.")
+            (configuration::enableThumbnails,   value<bool>()->default_value(false),                        "thumbnails and contact sheet per video.")
+            (configuration::thumbnailInterval,  value<int>()->default_value(10),                            "seconds between thumbnails.")
+            (configuration::thumbnailWidth,     value<int>()->default_value(160),                           "thumbnail width.")
+            (configuration::snapshotFormat,     value<std::string>()->default_value("JPG"),                 "snapshot format, JPG or PNG.")
+            (configuration::snapshotQuality,    value<int>()->default_value(3),                             "snapshot JPEG qscale, 2 (best) .. 31.")
+            (configuration::burstCount,         value<int>()->default_value(5),                             "consecutive frames of a burst.")
+            (configuration::captureMode,        value<std::string>()->default_value("continuous"),          "continuous or timelapse recording.")
+            (configuration::timelapseInterval,  value<int>()->default_value(10),                            "seconds between timelapse frames.")
             (configuration::V4l2RequestBuffersCounter, value<int>()->default_value(4),             "request mmap buffer counters.")
             (configuration::V4L2CaptureFormat,         value<std::string>()->default_value("BMP"), "capture format set.")
             (configuration::captureWidth,              value<int>()->default_value(640),           "capture and video format width.")
@@ -29,6 +39,8 @@ namespace
             (configuration::chessBoardServerPort,    value<unsigned int>()->required(),           "chess board server ip port.")
 			(configuration::kitokeiLocalAddress,     value<std::string>()->default_value("127.0.0.1"), "chess board local ip address.")
 			(configuration::kitokeiLocalPort,        value<unsigned int>()->default_value(8081),       "chess board local ip port.")
+            (configuration::messageFraming,          value<std::string>()->default_value("read"),      "control message framing, read, line or length.")
+            (configuration::maxMessageBytes,         value<unsigned int>()->default_value(4096),       "longest control message in bytes.")
             (configuration::audioName,              value<std::string>()->default_value("chessName"), "audio file name.")
             (configuration::enableWriteAudioToFile, value<bool>()->default_value(true), "open write audio file.")
             (configuration::audioDevice,            value<std::string>()->required(), "open audio device.")
@@ -38,10 +50,43 @@ namespace
             (configuration::audioFormat,            value<std::string>()->default_value("PCM"), "audio format.")
             (configuration::playbackDevice,         value<std::string>()->required(), "playback audio device.")
             (configuration::readTestAudioFile,      value<std::string>()->default_value(""), "playback audio file")
+            (configuration::jitterMinDelay,         value<int>()->default_value(20), "minimum rtp playback delay in ms.")
+            (configuration::jitterMaxDelay,         value<int>()->default_value(300), "maximum rtp playback delay in ms.")
+            (configuration::opusBitrate,            value<int>()->default_value(24000), "opus encoder bitrate in bit/s.")
+            (configuration::opusFrameMs,            value<int>()->default_value(20), "opus frame size in ms, 10, 20, 40 or 60.")
+            (configuration::opusComplexity,         value<int>()->default_value(5), "opus encoder complexity 0-10.")
+            (configuration::opusPayloadType,        value<int>()->default_value(111), "opus dynamic rtp payload type.")
+            (configuration::adaptiveBitrate,        value<bool>()->default_value(true), "follow the rtcp loss reports with the opus bitrate.")
+            (configuration::opusMinBitrate,         value<int>()->default_value(12000), "lowest adaptive opus bitrate in bit/s.")
+            (configuration::vadEnable,              value<bool>()->default_value(false), "suppress silent talk packets.")
+            (configuration::vadThreshold,           value<int>()->default_value(9), "speech level over the noise floor in dB.")
+            (configuration::vadHangover,            value<int>()->default_value(300), "keep sending after speech in ms.")
+            (configuration::comfortNoisePayloadType, value<int>()->default_value(13), "comfort noise rtp payload type.")
+            (configuration::mixerMaxSources,        value<int>()->default_value(4), "remote talkers mixed into the playback.")
+            (configuration::mixerSourceGain,        value<int>()->default_value(100), "playback gain of each talker in percent.")
+            (configuration::deviceSampleRate,       value<int>()->default_value(0), "alsa device sample rate, 0 for sampleRate.")
+            (configuration::deviceChannel,          value<int>()->default_value(0), "alsa device channels, 0 for audioChannel.")
+            (configuration::wavBufferMs,            value<int>()->default_value(2000), "audio buffered for the wav file writer in ms.")
+            (configuration::wavCheckpointMs,        value<int>()->default_value(1000), "wav header update interval in ms.")
+            (configuration::latencyProfile,         value<std::string>()->default_value(""), "lowlatency, balanced or powersave device and packet geometry, empty for the device defaults.")
+            (configuration::latencyProbe,           value<bool>()->default_value(false), "inject marker tones to measure the talk loopback latency.")
+            (configuration::latencyProbeIntervalMs, value<int>()->default_value(1000), "latency marker interval in ms.")
+            (configuration::latencyProbeMarkers,    value<int>()->default_value(20), "latency markers measured per sweep step.")
+            (configuration::latencyProbeSweep,      value<std::string>()->default_value("40,20,10,5"), "period times in ms tried by the latency sweep.")
+            (configuration::fecMode,                value<std::string>()->default_value("none"), "rtp loss protection, none, red, xor or red+xor.")
+            (configuration::fecGroupSize,           value<int>()->default_value(4), "packets covered by one xor parity block, 2-16.")
+            (configuration::redundancyDepth,        value<int>()->default_value(1), "earlier payloads repeated in every red packet, 1-3.")
+            (configuration::redPayloadType,         value<int>()->default_value(121), "rfc 2198 redundant audio dynamic rtp payload type.")
+            (configuration::fecPayloadType,         value<int>()->default_value(122), "payload type of the xor parity block inside red.")
             (configuration::remoteRTPPort, value<int>()->required(), "remote rtp port")
             (configuration::remoteRTPIpAddress, value<std::string>()->required(), "remote rtp ip address")
             (configuration::localSendRTPPort, value<int>()->default_value(9002), "local rtp send port")
-            (configuration::localReceiveRTPPort, value<int>()->default_value(9004), "local rtp receive port");
+            (configuration::localReceiveRTPPort, value<int>()->default_value(9004), "local rtp receive port")
+            (configuration::rtpTransport, value<std::string>()->default_value("jrtplib"), "rtp transport, jrtplib or udp (batched sendmmsg/recvmmsg).")
+            (configuration::rtpDestinations, value<std::string>()->default_value(""), "more rtp listeners as ip:port,ip:port, multicast groups too.")
+            (configuration::multicastGroup, value<std::string>()->default_value(""), "ipv4 multicast group joined by the rtp receiver.")
+            (configuration::multicastTtl, value<int>()->default_value(1), "ttl of rtp packets sent to a multicast group.")
+            (configuration::destinationMaxKbps, value<int>()->default_value(0), "rate cap of every rtp destination in kbit/s, 0 for none (udp transport).");
 
         return description;
     }
@@ -118,4 +163,26 @@ namespace configuration
 							 cmdParams[kitokeiLocalPort].as<unsigned int>() };
     }
 
+    configuration::TcpConfiguration getTcpConfiguration(const boost::program_options::variables_map& cmdParams)
+    {
+        TcpConfiguration tcpConfiguration;
+        if (cmdParams.find(messageFraming) != cmdParams.end())
+        {
+            const std::string framing = cmdParams[messageFraming].as<std::string>();
+            if ("line" == framing)
+            {
+                tcpConfiguration.messageFraming = MessageFraming::MESSAGE_FRAMING_LINE;
+            }
+            else if ("length" == framing)
+            {
+                tcpConfiguration.messageFraming = MessageFraming::MESSAGE_FRAMING_LENGTH;
+            }
+        }
+        if (cmdParams.find(maxMessageBytes) != cmdParams.end())
+        {
+            tcpConfiguration.maxMessageBytes = std::max(cmdParams[maxMessageBytes].as<unsigned int>(), 16u);
+        }
+        return tcpConfiguration;
+    }
+
 }
\ No newline at end of file
@@ -12,4 +12,6 @@ namespace configuration
 
     AppConfiguration loadFromIniFile(const std::string& configFilename);
     AppAddresses getAppAddresses(const boost::program_options::variables_map& cmdParams);
+    // an unknown framing keeps one message per read
+    TcpConfiguration getTcpConfiguration(const boost::program_options::variables_map& cmdParams);
 }
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include "Transcoder/BatchTranscoder.hpp"
+#include "Transcoder/SegmentTranscoder.hpp"
+
+namespace
+{
+    const std::string progressFileName = "transcode.progress";
+    const std::string segmentExtension = ".mp4";
+    constexpr std::size_t hashChunkSize = 64 * 1024;
+
+    // FNV-1a over the whole file, cheap compared to decoding it
+    std::string hashFileContent(const std::string& fileName)
+    {
+        std::ifstream input(fileName, std::ios::binary);
+        if (not input)
+        {
+            return "";
+        }
+        std::uint64_t hash = 14695981039346656037ULL;
+        std::vector<char> chunk(hashChunkSize);
+        while (input)
+        {
+            input.read(&chunk[0], chunk.size());
+            auto readSize = input.gcount();
+            for (std::streamsize i = 0; i < readSize; ++i)
+            {
+                hash ^= static_cast<unsigned char>(chunk[i]);
+                hash *= 1099511628211ULL;
+            }
+        }
+        char hex[17] = { 0 };
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return hex;
+    }
+}// namespace
+
+namespace transcoder
+{
+    BatchTranscoder::BatchTranscoder(Logger& logger, const configuration::AppConfiguration& config, const BatchOptions& options)
+        : m_logger{logger}
+        , m_config{config}
+        , m_options{options}
+    {
+        if (0 == m_options.jobs)
+        {
+            m_options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (not m_options.outputDir.empty() and m_options.outputDir.back() != '/')
+        {
+            m_options.outputDir += '/';
+        }
+    }
+
+    BatchTranscoder::~BatchTranscoder()
+    {
+        if (m_progressFile)
+        {
+            fclose(m_progressFile);
+            m_progressFile = nullptr;
+        }
+    }
+
+    bool BatchTranscoder::collectSegments()
+    {
+        boost::system::error_code error;
+        if (not boost::filesystem::is_directory(m_options.inputDir, error))
+        {
+            LOG_ERROR_MSG("Input directory {} does not exist.", m_options.inputDir);
+            return false;
+        }
+        boost::filesystem::create_directories(m_options.outputDir, error);
+        if (error)
+        {
+            LOG_ERROR_MSG("Create output directory {} failed {}.", m_options.outputDir, error.message());
+            return false;
+        }
+
+        std::vector<std::string> segments;
+        for (const auto& entry : boost::filesystem::directory_iterator(m_options.inputDir))
+        {
+            if (boost::filesystem::is_regular_file(entry.status()) and
+                entry.path().extension().string() == segmentExtension)
+            {
+                segments.push_back(entry.path().string());
+            }
+        }
+        // oldest first, segment names carry their timestamp
+        std::sort(segments.begin(), segments.end());
+        for (const auto& segment : segments)
+        {
+            m_segments.push(segment);
+        }
+        return true;
+    }
+
+    void BatchTranscoder::loadProgress()
+    {
+        std::ifstream progress(m_options.outputDir + progressFileName);
+        std::string hash;
+        std::string segment;
+        while (progress >> hash and std::getline(progress, segment))
+        {
+            m_claimedHashes.insert(hash);
+        }
+        m_progressFile = fopen((m_options.outputDir + progressFileName).c_str(), "a");
+        if (nullptr == m_progressFile)
+        {
+            LOG_ERROR_MSG("Open progress file in {} failed, progress will not be kept.", m_options.outputDir);
+        }
+    }
+
+    void BatchTranscoder::recordProgress(const std::string& hash, const std::string& segment)
+    {
+        std::lock_guard<std::mutex> locker(m_jobMutex);
+        if (m_progressFile)
+        {
+            fprintf(m_progressFile, "%s %s\n", hash.c_str(), segment.c_str());
+            fflush(m_progressFile);
+        }
+    }
+
+    bool BatchTranscoder::popSegment(std::string& segment)
+    {
+        std::lock_guard<std::mutex> locker(m_jobMutex);
+        if (m_segments.empty())
+        {
+            return false;
+        }
+        segment = m_segments.front();
+        m_segments.pop();
+        return true;
+    }
+
+    void BatchTranscoder::transcodeWorker()
+    {
+        SegmentTranscoder segmentTranscoder(m_logger, m_config, m_options.encoder);
+        std::string segment;
+        while (popSegment(segment))
+        {
+            const std::string hash = hashFileContent(segment);
+            {
+                std::lock_guard<std::mutex> locker(m_jobMutex);
+                if (hash.empty() or not m_claimedHashes.insert(hash).second)
+                {
+                    m_skipped++;
+                    continue;
+                }
+            }
+
+            const std::string name = boost::filesystem::path(segment).filename().string();
+            TranscodeResult result;
+            if (not segmentTranscoder.transcode(segment, m_options.outputDir + name, result))
+            {
+                m_failed++;
+                // let a later run try it again
+                std::lock_guard<std::mutex> locker(m_jobMutex);
+                m_claimedHashes.erase(hash);
+                continue;
+            }
+            recordProgress(hash, name);
+            m_transcoded++;
+            m_frames += result.frames;
+            m_inputBytes += result.inputBytes;
+            m_outputBytes += result.outputBytes;
+            LOG_INFO_MSG(m_logger, "Transcoded {}, {} frames in {:.1f} s, {} -> {} bytes.", name, result.frames,
+                result.seconds, result.inputBytes, result.outputBytes);
+        }
+    }
+
+    bool BatchTranscoder::run()
+    {
+        if (not collectSegments())
+        {
+            return false;
+        }
+        loadProgress();
+        LOG_INFO_MSG(m_logger, "Transcode {} segments from {} to {} with {} workers, {} bps, preset {}.",
+            m_segments.size(), m_options.inputDir, m_options.outputDir, m_options.jobs,
+            m_options.encoder.bitRate, m_options.encoder.preset);
+
+        auto startTime = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < m_options.jobs; ++i)
+        {
+            workers.emplace_back(&BatchTranscoder::transcodeWorker, this);
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        double fps = seconds > 0 ? m_frames / seconds : 0.0;
+        double ratio = m_outputBytes > 0 ? static_cast<double>(m_inputBytes) / m_outputBytes : 0.0;
+        LOG_INFO_MSG(m_logger, "Transcoded {} segments, skipped {}, failed {}. {} frames in {:.1f} s, {:.1f} fps, "
+            "compression ratio {:.2f}.", m_transcoded.load(), m_skipped.load(), m_failed.load(), m_frames.load(),
+            seconds, fps, ratio);
+        return 0 == m_failed;
+    }
+} // namespace transcoder
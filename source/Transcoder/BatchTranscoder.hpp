@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+#include "Configurations/ParseConfigFile.hpp"
+#include "logger/Logger.hpp"
+#include "usbVideo/VideoEncoder.hpp"
+
+namespace transcoder
+{
+    struct BatchOptions
+    {
+        std::string inputDir;
+        std::string outputDir;
+        // 0 uses one worker per core
+        unsigned int jobs{ 0 };
+        usbVideo::VideoEncoderParameters encoder;
+    };
+
+    /*
+     * Transcodes every .mp4 segment of a directory, one segment per worker thread.
+     * Finished segments are appended to a progress file in the output directory keyed by
+     * the content hash of the input, so an interrupted run resumes where it stopped and a
+     * segment that was copied or renamed is not encoded twice.
+     */
+    class BatchTranscoder final
+    {
+    public:
+        BatchTranscoder(Logger& logger, const configuration::AppConfiguration& config, const BatchOptions& options);
+        ~BatchTranscoder();
+
+        // returns false if any segment failed
+        bool run();
+
+    private:
+        bool collectSegments();
+        void loadProgress();
+        void recordProgress(const std::string& hash, const std::string& segment);
+        bool popSegment(std::string& segment);
+        void transcodeWorker();
+
+    private:
+        Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
+        BatchOptions m_options;
+
+        std::mutex m_jobMutex;
+        std::queue<std::string> m_segments;
+        // hashes finished in earlier runs plus the ones claimed by a worker in this run
+        std::set<std::string> m_claimedHashes;
+        FILE* m_progressFile{ nullptr };
+
+        std::atomic<std::uint64_t> m_frames{ 0 };
+        std::atomic<std::uint64_t> m_inputBytes{ 0 };
+        std::atomic<std::uint64_t> m_outputBytes{ 0 };
+        std::atomic<unsigned int> m_transcoded{ 0 };
+        std::atomic<unsigned int> m_skipped{ 0 };
+        std::atomic<unsigned int> m_failed{ 0 };
+    };
+} // namespace transcoder
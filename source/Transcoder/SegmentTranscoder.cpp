@@ -0,0 +1,248 @@
+#include <chrono>
+#include <cstdio>
+#include <boost/filesystem.hpp>
+#include "Transcoder/SegmentTranscoder.hpp"
+#include "usbVideo/DecodeCameraStream.hpp"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/avutil.h>
+}
+
+namespace
+{
+    // If equal to 0, alignment will be chosen automatically for the current CPU.
+    constexpr int alignment = 0;
+    const std::string partialSuffix = ".part";
+
+    std::uint64_t getFileSize(const std::string& fileName)
+    {
+        boost::system::error_code error;
+        auto size = boost::filesystem::file_size(fileName, error);
+        return error ? 0 : size;
+    }
+}// namespace
+
+namespace transcoder
+{
+    SegmentTranscoder::SegmentTranscoder(Logger& logger, const configuration::AppConfiguration& config,
+        const usbVideo::VideoEncoderParameters& parameters)
+        : m_logger{logger}
+        , m_config{config}
+        , m_parameters{parameters}
+    {
+    }
+
+    SegmentTranscoder::~SegmentTranscoder()
+    {
+        closeOutput();
+        if (m_swsContext)
+        {
+            sws_freeContext(m_swsContext);
+            m_swsContext = nullptr;
+        }
+        av_frame_free(&m_scaledFrame);
+    }
+
+    bool SegmentTranscoder::transcode(const std::string& inputFile, const std::string& outputFile, TranscodeResult& result)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        usbVideo::DecodeCameraStream decoder(m_logger, m_config);
+        if (not decoder.openDecoder(inputFile))
+        {
+            LOG_ERROR_MSG("Open segment {} for transcoding failed.", inputFile);
+            return false;
+        }
+
+        const std::string partialFile = outputFile + partialSuffix;
+        const AVCodecContext* input = decoder.getCodecContext();
+        if (not openOutput(partialFile, input->width, input->height))
+        {
+            closeOutput();
+            return false;
+        }
+
+        bool succeed = true;
+        while (auto frame = decoder.decodeNextFrame())
+        {
+            AVFrame* encoderFrame = toEncoderFormat(frame.get());
+            if (nullptr == encoderFrame or not encodeFrame(encoderFrame))
+            {
+                succeed = false;
+                break;
+            }
+            result.frames++;
+        }
+        // a truncated or corrupt segment must not count as done, the batch retries it
+        if (succeed and not decoder.isEndOfStream())
+        {
+            LOG_ERROR_MSG("Decode {} failed after {} frames.", inputFile, result.frames);
+            succeed = false;
+        }
+        // drain the frames buffered by the encoder
+        succeed = encodeFrame(nullptr) and succeed;
+        if (av_write_trailer(m_formatContext) < 0)
+        {
+            succeed = false;
+        }
+        closeOutput();
+        decoder.closeInputFile();
+
+        if (not succeed)
+        {
+            LOG_ERROR_MSG("Transcode {} failed, keep partial output {}.", inputFile, partialFile);
+            return false;
+        }
+        if (std::rename(partialFile.c_str(), outputFile.c_str()) != 0)
+        {
+            LOG_ERROR_MSG("Rename {} to {} failed.", partialFile, outputFile);
+            return false;
+        }
+        result.inputBytes += getFileSize(inputFile);
+        result.outputBytes += getFileSize(outputFile);
+        result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return true;
+    }
+
+    bool SegmentTranscoder::openOutput(const std::string& outputFile, int width, int height)
+    {
+        m_parameters.width = width;
+        m_parameters.height = height;
+        m_pts = 0;
+        m_codecContext = usbVideo::createH264Encoder(m_parameters);
+        if (nullptr == m_codecContext)
+        {
+            return false;
+        }
+        // the muxer is picked from the extension, the .part suffix would hide it
+        int ret = avformat_alloc_output_context2(&m_formatContext, NULL, "mp4", outputFile.c_str());
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("alloc output context failed {}", ret);
+            return false;
+        }
+        m_stream = avformat_new_stream(m_formatContext, NULL);
+        if (nullptr == m_stream)
+        {
+            LOG_ERROR_MSG("create format stream failed.");
+            return false;
+        }
+        m_stream->time_base = m_codecContext->time_base;
+        ret = avcodec_parameters_from_context(m_stream->codecpar, m_codecContext);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("set parameters from context failed {}", ret);
+            return false;
+        }
+        ret = avio_open(&m_formatContext->pb, outputFile.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("avio open {} failed {}", outputFile, ret);
+            return false;
+        }
+        ret = avformat_write_header(m_formatContext, NULL);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("write header failed {}", ret);
+            return false;
+        }
+        return true;
+    }
+
+    AVFrame* SegmentTranscoder::toEncoderFormat(AVFrame* frame)
+    {
+        if (frame->format == m_codecContext->pix_fmt)
+        {
+            return frame;
+        }
+        m_swsContext = sws_getCachedContext(m_swsContext,
+            frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+            m_codecContext->width, m_codecContext->height, m_codecContext->pix_fmt,
+            SWS_BICUBIC, NULL, NULL, NULL);
+        if (m_scaledFrame and (m_scaledFrame->width != m_codecContext->width or
+            m_scaledFrame->height != m_codecContext->height))
+        {
+            av_frame_free(&m_scaledFrame);
+        }
+        if (nullptr == m_scaledFrame)
+        {
+            m_scaledFrame = av_frame_alloc();
+            m_scaledFrame->format = m_codecContext->pix_fmt;
+            m_scaledFrame->width = m_codecContext->width;
+            m_scaledFrame->height = m_codecContext->height;
+            av_frame_get_buffer(m_scaledFrame, alignment);
+        }
+        if (nullptr == m_swsContext or nullptr == m_scaledFrame->data[0])
+        {
+            LOG_ERROR_MSG("Prepare pixel format conversion failed.");
+            return nullptr;
+        }
+        sws_scale(m_swsContext, frame->data, frame->linesize, 0, frame->height,
+            m_scaledFrame->data, m_scaledFrame->linesize);
+        return m_scaledFrame;
+    }
+
+    bool SegmentTranscoder::encodeFrame(AVFrame* frame)
+    {
+        if (frame)
+        {
+            // live segments carry assessed timestamps, restamp at the target frame rate
+            frame->pts = m_pts++;
+            frame->pict_type = AV_PICTURE_TYPE_NONE;
+        }
+        int ret = avcodec_send_frame(m_codecContext, frame);
+        if (ret < 0 and ret != AVERROR_EOF)
+        {
+            LOG_ERROR_MSG("Send frame to encoder failed {}.", ret);
+            return false;
+        }
+
+        AVPacket* packet = av_packet_alloc();
+        while (packet)
+        {
+            ret = avcodec_receive_packet(m_codecContext, packet);
+            if (ret == AVERROR(EAGAIN) or ret == AVERROR_EOF)
+            {
+                ret = 0;
+                break;
+            }
+            if (ret < 0)
+            {
+                LOG_ERROR_MSG("Receive packet from encoder failed {}.", ret);
+                break;
+            }
+            av_packet_rescale_ts(packet, m_codecContext->time_base, m_stream->time_base);
+            packet->stream_index = m_stream->index;
+            ret = av_interleaved_write_frame(m_formatContext, packet);
+            if (ret < 0)
+            {
+                LOG_ERROR_MSG("Write packet failed {}.", ret);
+                break;
+            }
+        }
+        av_packet_free(&packet);
+        return ret >= 0;
+    }
+
+    void SegmentTranscoder::closeOutput()
+    {
+        if (m_formatContext && m_formatContext->pb)
+        {
+            avio_closep(&m_formatContext->pb);
+        }
+        if (m_formatContext)
+        {
+            avformat_free_context(m_formatContext);
+            m_formatContext = nullptr;
+            m_stream = nullptr;
+        }
+        if (m_codecContext)
+        {
+            avcodec_free_context(&m_codecContext);
+            m_codecContext = nullptr;
+        }
+    }
+} // namespace transcoder
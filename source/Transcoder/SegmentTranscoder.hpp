@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "Configurations/ParseConfigFile.hpp"
+#include "logger/Logger.hpp"
+#include "usbVideo/VideoEncoder.hpp"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct SwsContext;
+
+namespace transcoder
+{
+    struct TranscodeResult
+    {
+        std::uint64_t frames{ 0 };
+        std::uint64_t inputBytes{ 0 };
+        std::uint64_t outputBytes{ 0 };
+        double seconds{ 0.0 };
+    };
+
+    // Re-encodes one recorded segment: DecodeCameraStream in, the live H264 encoder setup out.
+    class SegmentTranscoder final
+    {
+    public:
+        SegmentTranscoder(Logger& logger, const configuration::AppConfiguration& config,
+            const usbVideo::VideoEncoderParameters& parameters);
+        ~SegmentTranscoder();
+
+        // output is written to outputFile + ".part" and renamed once complete
+        bool transcode(const std::string& inputFile, const std::string& outputFile, TranscodeResult& result);
+
+    private:
+        bool openOutput(const std::string& outputFile, int width, int height);
+        bool encodeFrame(AVFrame* frame);
+        AVFrame* toEncoderFormat(AVFrame* frame);
+        void closeOutput();
+
+    private:
+        Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
+        usbVideo::VideoEncoderParameters m_parameters;
+
+        AVCodecContext*  m_codecContext{ nullptr };
+        AVFormatContext* m_formatContext{ nullptr };
+        AVStream*        m_stream{ nullptr };
+        SwsContext*      m_swsContext{ nullptr };
+        AVFrame*         m_scaledFrame{ nullptr };
+        std::int64_t     m_pts{ 0 };
+    };
+} // namespace transcoder
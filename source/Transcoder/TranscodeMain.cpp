@@ -0,0 +1,65 @@
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+#include "Configurations/Configurations.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+#include "Transcoder/BatchTranscoder.hpp"
+#include "logger/Logger.hpp"
+
+namespace
+{
+    namespace po = boost::program_options;
+
+    po::options_description createTranscodeOptionsDescription()
+    {
+        po::options_description description("Kitokei transcoder");
+        description.add_options()
+            ("help,h", "show this help")
+            ("input,i",   po::value<std::string>()->required(),                  "directory of recorded segments")
+            ("output,o",  po::value<std::string>()->required(),                  "directory for transcoded segments")
+            ("bitRate,b", po::value<int>()->default_value(200000),               "target video bit rate")
+            ("preset,p",  po::value<std::string>()->default_value("slow"),       "x264 preset")
+            ("fps,f",     po::value<int>()->default_value(25),                   "frame rate of the recordings")
+            ("jobs,j",    po::value<unsigned int>()->default_value(0),           "parallel segments, 0 for one per core")
+            ("log,l",     po::value<std::string>()->default_value(""),           "log file, empty logs to stdout")
+            // each worker decodes one segment, parallelism comes from the job queue
+            (configuration::videoDecodeThreads, po::value<int>()->default_value(1), "decoder threads per segment");
+        return description;
+    }
+}// namespace
+
+int main(int argc, char* argv[])
+{
+    auto description = createTranscodeOptionsDescription();
+    configuration::AppConfiguration config;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, description), config);
+        if (config.count("help") != 0u)
+        {
+            std::cout << description << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(config);
+    }
+    catch (const po::error& e)
+    {
+        std::cerr << e.what() << std::endl << description << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto& logger = logger::getLogger(config["log"].as<std::string>());
+
+    transcoder::BatchOptions options;
+    options.inputDir = config["input"].as<std::string>();
+    options.outputDir = config["output"].as<std::string>();
+    options.jobs = config["jobs"].as<unsigned int>();
+    options.encoder.fps = config["fps"].as<int>();
+    options.encoder.bitRate = config["bitRate"].as<int>();
+    options.encoder.preset = config["preset"].as<std::string>();
+    // one encoder thread per worker, the workers already cover the cores
+    options.encoder.threadCount = 1;
+
+    transcoder::BatchTranscoder batchTranscoder(logger, config, options);
+    return batchTranscoder.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <time.h>
+#include <opus/opus.h>
+#include "AudioCodec.hpp"
+#include "CommonFunction.hpp"
+#include "G711Codec.hpp"
+#include "logger/Logger.hpp"
+
+namespace
+{
+    // what ConcreteRTPSession always sent, kept for PCM and G711 so older peers still match
+    constexpr std::uint8_t legacyPayloadType = 97;
+    // PCM and G711 packets stay 320 bytes as before unless a latency profile sets the packet time
+    constexpr std::size_t legacyPacketBytes = 320;
+    // as the sender's payload buffer, one ethernet frame
+    constexpr std::size_t maxPacketBytes = 1400;
+    constexpr unsigned int opusClockRate = 48000;
+    // longest opus packet is 120 ms
+    constexpr unsigned int opusMaxPacketMs = 120;
+    // lowest bitrate opus_encoder_ctl accepts
+    constexpr int opusMinBitrate = 6000;
+    constexpr unsigned int millisecondsPerSecond = 1000;
+    constexpr std::uint64_t nanosecondsPerSecond = 1000000000;
+    constexpr std::uint8_t staticComfortNoisePayloadType = 13;
+    constexpr unsigned int staticComfortNoiseClockRate = 8000;
+    constexpr std::uint8_t dynamicComfortNoisePayloadType = 105;
+
+    class PcmCodec final : public audio::IAudioCodec
+    {
+    public:
+        PcmCodec(unsigned int sampleRate, unsigned int channels, std::size_t frameSamples)
+            : m_sampleRate{ sampleRate }
+            , m_channels{ channels }
+            , m_frameSamples{ 0 == frameSamples ? legacyPacketBytes / (channels * sizeof(std::int16_t)) : frameSamples }
+        {
+        }
+
+        // RFC 3551 L16, 16 bit samples in network byte order
+        std::string getName() const override { return "L16"; }
+        std::string getRtpMap() const override
+        {
+            return getName() + "/" + std::to_string(m_sampleRate) + "/" + std::to_string(m_channels);
+        }
+        std::string getFormatParameters() const override { return ""; }
+        std::uint8_t getPayloadType() const override { return legacyPayloadType; }
+        unsigned int getClockRate() const override { return m_sampleRate; }
+
+        std::size_t getFrameSamples() const override { return m_frameSamples; }
+        unsigned int getPacketTimeMs() const override
+        {
+            return static_cast<unsigned int>(getFrameSamples() * millisecondsPerSecond / m_sampleRate);
+        }
+        std::size_t getMaxDecodedFrames(std::size_t bytes) const override
+        {
+            return bytes / (m_channels * sizeof(std::int16_t));
+        }
+        int getBitrate() const override
+        {
+            return static_cast<int>(m_sampleRate * m_channels * sizeof(std::int16_t) * 8);
+        }
+        bool setBitrate(int) override { return false; }
+
+        int encode(const std::int16_t* pcm, std::size_t frames, std::uint8_t* data, std::size_t maxBytes) override
+        {
+            const std::size_t samples = std::min(frames * m_channels, maxBytes / sizeof(std::int16_t));
+            for (std::size_t i = 0; i < samples; ++i)
+            {
+                const std::uint16_t sample = static_cast<std::uint16_t>(pcm[i]);
+                data[2 * i] = static_cast<std::uint8_t>(sample >> 8);
+                data[2 * i + 1] = static_cast<std::uint8_t>(sample);
+            }
+            return static_cast<int>(samples * sizeof(std::int16_t));
+        }
+        int decode(const std::uint8_t* data, std::size_t bytes, std::int16_t* pcm, std::size_t maxFrames) override
+        {
+            const std::size_t frames = std::min(getMaxDecodedFrames(bytes), maxFrames);
+            for (std::size_t i = 0; i < frames * m_channels; ++i)
+            {
+                pcm[i] = static_cast<std::int16_t>((data[2 * i] << 8) | data[2 * i + 1]);
+            }
+            return static_cast<int>(frames);
+        }
+
+        void reset() override {}
+
+    private:
+        unsigned int m_sampleRate;
+        unsigned int m_channels;
+        std::size_t m_frameSamples;
+    };
+
+    class G711Codec final : public audio::IAudioCodec
+    {
+    public:
+        G711Codec(unsigned int sampleRate, unsigned int channels, std::size_t frameSamples, bool alaw)
+            : m_sampleRate{ sampleRate }
+            , m_channels{ channels }
+            , m_frameSamples{ 0 == frameSamples ? legacyPacketBytes / channels : frameSamples }
+            , m_alaw{ alaw }
+        {
+        }
+
+        std::string getName() const override { return m_alaw ? "PCMA" : "PCMU"; }
+        std::string getRtpMap() const override
+        {
+            std::string rtpMap = getName() + "/" + std::to_string(m_sampleRate);
+            if (1 < m_channels)
+            {
+                rtpMap += "/" + std::to_string(m_channels);
+            }
+            return rtpMap;
+        }
+        std::string getFormatParameters() const override { return ""; }
+        std::uint8_t getPayloadType() const override { return legacyPayloadType; }
+        unsigned int getClockRate() const override { return m_sampleRate; }
+
+        std::size_t getFrameSamples() const override { return m_frameSamples; }
+        unsigned int getPacketTimeMs() const override
+        {
+            return static_cast<unsigned int>(getFrameSamples() * millisecondsPerSecond / m_sampleRate);
+        }
+        std::size_t getMaxDecodedFrames(std::size_t bytes) const override { return bytes / m_channels; }
+        int getBitrate() const override { return static_cast<int>(m_sampleRate * m_channels * 8); }
+        bool setBitrate(int) override { return false; }
+
+        int encode(const std::int16_t* pcm, std::size_t frames, std::uint8_t* data, std::size_t maxBytes) override
+        {
+            const std::size_t samples = std::min(frames * m_channels, maxBytes);
+            return static_cast<int>(m_alaw ? audio::encodeAlaw(pcm, samples, data) : audio::encodeUlaw(pcm, samples, data));
+        }
+        int decode(const std::uint8_t* data, std::size_t bytes, std::int16_t* pcm, std::size_t maxFrames) override
+        {
+            const std::size_t samples = std::min(bytes, maxFrames * m_channels);
+            const std::size_t decoded = m_alaw ? audio::decodeAlaw(data, samples, pcm) : audio::decodeUlaw(data, samples, pcm);
+            return static_cast<int>(decoded / m_channels);
+        }
+
+        void reset() override {}
+
+    private:
+        unsigned int m_sampleRate;
+        unsigned int m_channels;
+        std::size_t m_frameSamples;
+        bool m_alaw;
+    };
+
+    /*
+     * Encoder and decoder are created on first use, a talk sender never allocates a decoder
+     * and the other way round. reset() clears the state between talk sessions without
+     * freeing it.
+     */
+    class OpusCodec final : public audio::IAudioCodec
+    {
+    public:
+        OpusCodec(unsigned int sampleRate, unsigned int channels, int frameMs, int bitrate, int complexity,
+            std::uint8_t payloadType)
+            : m_sampleRate{ sampleRate }
+            , m_channels{ channels }
+            , m_frameSamples{ static_cast<std::size_t>(sampleRate) * frameMs / millisecondsPerSecond }
+            , m_maxBitrate{ bitrate }
+            , m_bitrate{ bitrate }
+            , m_complexity{ complexity }
+            , m_payloadType{ payloadType }
+        {
+        }
+
+        ~OpusCodec()
+        {
+            if (m_encoder)
+            {
+                opus_encoder_destroy(m_encoder);
+            }
+            if (m_decoder)
+            {
+                opus_decoder_destroy(m_decoder);
+            }
+        }
+
+        OpusCodec(const OpusCodec&) = delete;
+        OpusCodec& operator=(const OpusCodec&) = delete;
+
+        std::string getName() const override { return "opus"; }
+        // RFC 7587: always 48000/2 whatever is actually coded
+        std::string getRtpMap() const override { return "opus/48000/2"; }
+        std::string getFormatParameters() const override
+        {
+            std::ostringstream parameters;
+            parameters << "minptime=" << getPacketTimeMs()
+                << ";useinbandfec=0;stereo=" << (2 == m_channels ? 1 : 0)
+                << ";sprop-stereo=" << (2 == m_channels ? 1 : 0)
+                << ";maxplaybackrate=" << m_sampleRate
+                << ";sprop-maxcapturerate=" << m_sampleRate
+                << ";maxaveragebitrate=" << m_maxBitrate;
+            return parameters.str();
+        }
+        std::uint8_t getPayloadType() const override { return m_payloadType; }
+        unsigned int getClockRate() const override { return opusClockRate; }
+
+        std::size_t getFrameSamples() const override { return m_frameSamples; }
+        unsigned int getPacketTimeMs() const override
+        {
+            return static_cast<unsigned int>(m_frameSamples * millisecondsPerSecond / m_sampleRate);
+        }
+        std::size_t getMaxDecodedFrames(std::size_t) const override
+        {
+            return static_cast<std::size_t>(m_sampleRate) * opusMaxPacketMs / millisecondsPerSecond;
+        }
+        int getBitrate() const override { return m_bitrate; }
+        // takes effect from the next packet, the encoder is not created for it
+        bool setBitrate(int bitrate) override
+        {
+            m_bitrate = std::min(std::max(bitrate, opusMinBitrate), m_maxBitrate);
+            if (m_encoder)
+            {
+                opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_bitrate));
+            }
+            return true;
+        }
+
+        int encode(const std::int16_t* pcm, std::size_t frames, std::uint8_t* data, std::size_t maxBytes) override
+        {
+            if (nullptr == m_encoder and not createEncoder())
+            {
+                return OPUS_ALLOC_FAIL;
+            }
+            int bytes = opus_encode(m_encoder, pcm, static_cast<int>(frames), data, static_cast<opus_int32>(maxBytes));
+            if (0 > bytes)
+            {
+                LOG_ERROR_MSG("Opus encode {} frames failed {}.", frames, opus_strerror(bytes));
+            }
+            return bytes;
+        }
+
+        int decode(const std::uint8_t* data, std::size_t bytes, std::int16_t* pcm, std::size_t maxFrames) override
+        {
+            if (nullptr == m_decoder and not createDecoder())
+            {
+                return OPUS_ALLOC_FAIL;
+            }
+            int frames = opus_decode(m_decoder, data, static_cast<opus_int32>(bytes), pcm, static_cast<int>(maxFrames), 0);
+            if (0 > frames)
+            {
+                LOG_ERROR_MSG("Opus decode {} bytes failed {}.", bytes, opus_strerror(frames));
+            }
+            return frames;
+        }
+
+        void reset() override
+        {
+            if (m_encoder)
+            {
+                opus_encoder_ctl(m_encoder, OPUS_RESET_STATE);
+            }
+            if (m_decoder)
+            {
+                opus_decoder_ctl(m_decoder, OPUS_RESET_STATE);
+            }
+        }
+
+    private:
+        bool createEncoder()
+        {
+            int error = OPUS_OK;
+            m_encoder = opus_encoder_create(static_cast<opus_int32>(m_sampleRate), static_cast<int>(m_channels),
+                OPUS_APPLICATION_VOIP, &error);
+            if (OPUS_OK != error or nullptr == m_encoder)
+            {
+                LOG_ERROR_MSG("Create opus encoder {} Hz {} channels failed {}.", m_sampleRate, m_channels, opus_strerror(error));
+                m_encoder = nullptr;
+                return false;
+            }
+            opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_bitrate));
+            opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(m_complexity));
+            opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+            return true;
+        }
+
+        bool createDecoder()
+        {
+            int error = OPUS_OK;
+            m_decoder = opus_decoder_create(static_cast<opus_int32>(m_sampleRate), static_cast<int>(m_channels), &error);
+            if (OPUS_OK != error or nullptr == m_decoder)
+            {
+                LOG_ERROR_MSG("Create opus decoder {} Hz {} channels failed {}.", m_sampleRate, m_channels, opus_strerror(error));
+                m_decoder = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        unsigned int m_sampleRate;
+        unsigned int m_channels;
+        std::size_t m_frameSamples;
+        // the maxaveragebitrate offered to the far end
+        int m_maxBitrate;
+        int m_bitrate;
+        int m_complexity;
+        std::uint8_t m_payloadType;
+        OpusEncoder* m_encoder{ nullptr };
+        OpusDecoder* m_decoder{ nullptr };
+    };
+
+    std::unique_ptr<audio::IAudioCodec> createOpusCodec(const configuration::AppConfiguration& config,
+        unsigned int sampleRate, unsigned int channels)
+    {
+        if (8000 != sampleRate and 12000 != sampleRate and 16000 != sampleRate and
+            24000 != sampleRate and 48000 != sampleRate)
+        {
+            LOG_ERROR_MSG("Opus does not support sample rate {}, use PCM.", sampleRate);
+            return nullptr;
+        }
+
+        // the packet time of a latency profile wins over opusFrameMs
+        const unsigned int packetTimeMs = audio::getLatencyProfile(config).packetTimeMs;
+        int frameMs = 0 == packetTimeMs ? audio::getOpusFrameMs(config) : static_cast<int>(packetTimeMs);
+        if (10 != frameMs and 20 != frameMs and 40 != frameMs and 60 != frameMs)
+        {
+            LOG_WARNING_MSG("Opus frame size {} ms not supported, use 20 ms.", frameMs);
+            frameMs = 20;
+        }
+        int payloadType = audio::getOpusPayloadType(config);
+        if (96 > payloadType or 127 < payloadType)
+        {
+            LOG_WARNING_MSG("Opus payload type {} is not dynamic, use 111.", payloadType);
+            payloadType = 111;
+        }
+        const int bitrate = std::min(std::max(audio::getOpusBitrate(config), 6000), 510000);
+        const int complexity = std::min(std::max(audio::getOpusComplexity(config), 0), 10);
+
+        return std::make_unique<OpusCodec>(sampleRate, channels, frameMs, bitrate, complexity,
+            static_cast<std::uint8_t>(payloadType));
+    }
+} // namespace
+
+namespace audio
+{
+    std::unique_ptr<IAudioCodec> createAudioCodec(const configuration::AppConfiguration& config,
+        unsigned int sampleRate, unsigned int channels)
+    {
+        channels = std::max(channels, 1u);
+        const std::string audioFormat = getAudioFormat(config);
+        const bool g711 = "G711a" == audioFormat or "G711u" == audioFormat;
+        // samples per packet for the packet time of the latency profile, 0 for the legacy 320 bytes
+        std::size_t frameSamples = static_cast<std::size_t>(sampleRate) * getLatencyProfile(config).packetTimeMs / millisecondsPerSecond;
+        const std::size_t maxFrameSamples = maxPacketBytes / (channels * (g711 ? 1 : sizeof(std::int16_t)));
+        if (maxFrameSamples < frameSamples)
+        {
+            LOG_WARNING_MSG("Audio packet of {} frames does not fit {} bytes, send {} frames.", frameSamples, maxPacketBytes, maxFrameSamples);
+            frameSamples = maxFrameSamples;
+        }
+        if (g711)
+        {
+            return std::make_unique<G711Codec>(sampleRate, channels, frameSamples, "G711a" == audioFormat);
+        }
+        if ("Opus" == audioFormat)
+        {
+            std::unique_ptr<IAudioCodec> codec = createOpusCodec(config, sampleRate, channels);
+            if (codec)
+            {
+                return codec;
+            }
+        }
+        else if ("PCM" != audioFormat)
+        {
+            LOG_ERROR_MSG("Unknown audio format {}, use PCM.", audioFormat);
+        }
+        return std::make_unique<PcmCodec>(sampleRate, channels, frameSamples);
+    }
+
+    std::uint8_t selectComfortNoisePayloadType(const configuration::AppConfiguration& config, const IAudioCodec& codec)
+    {
+        int payloadType = getComfortNoisePayloadType(config);
+        if (0 > payloadType or 127 < payloadType or
+            (staticComfortNoisePayloadType == payloadType and staticComfortNoiseClockRate != codec.getClockRate()))
+        {
+            return dynamicComfortNoisePayloadType;
+        }
+        return static_cast<std::uint8_t>(payloadType);
+    }
+
+    std::string createSessionDescription(const IAudioCodec& codec, const std::string& address, int port,
+        std::uint8_t comfortNoisePayloadType, std::uint8_t redPayloadType, std::size_t redundancyDepth, std::uint8_t fecPayloadType)
+    {
+        const unsigned int payloadType = codec.getPayloadType();
+        const unsigned int red = redPayloadType;
+        const unsigned int fec = 0 == red ? 0 : fecPayloadType;
+
+        std::ostringstream sdp;
+        sdp << "v=0\r\n"
+            << "o=- 0 0 IN IP4 " << address << "\r\n"
+            << "s=Kitokei talk\r\n"
+            << "c=IN IP4 " << address << "\r\n"
+            << "t=0 0\r\n"
+            << "m=audio " << port << " RTP/AVP ";
+        // every packet is redundant audio when it is announced, so it comes first
+        if (0 != red)
+        {
+            sdp << red << " ";
+        }
+        sdp << payloadType;
+        if (0 != comfortNoisePayloadType)
+        {
+            sdp << " " << static_cast<unsigned int>(comfortNoisePayloadType);
+        }
+        if (0 != fec)
+        {
+            sdp << " " << fec;
+        }
+        sdp << "\r\n"
+            << "a=rtpmap:" << payloadType << " " << codec.getRtpMap() << "\r\n";
+        const std::string formatParameters = codec.getFormatParameters();
+        if (not formatParameters.empty())
+        {
+            sdp << "a=fmtp:" << payloadType << " " << formatParameters << "\r\n";
+        }
+        if (0 != comfortNoisePayloadType)
+        {
+            sdp << "a=rtpmap:" << static_cast<unsigned int>(comfortNoisePayloadType) << " CN/" << codec.getClockRate() << "\r\n";
+        }
+        if (0 != red)
+        {
+            // RFC 2198 block types, the primary first, then every redundancy level and the parity
+            sdp << "a=rtpmap:" << red << " red/" << codec.getClockRate() << "\r\n"
+                << "a=fmtp:" << red << " " << payloadType;
+            for (std::size_t level = 0; level < redundancyDepth; ++level)
+            {
+                sdp << "/" << payloadType;
+            }
+            if (0 != fec)
+            {
+                sdp << "/" << fec;
+            }
+            sdp << "\r\n";
+        }
+        if (0 != fec)
+        {
+            // single level xor parity of FecRTPSession, not the RFC 5109 ulpfec layout
+            sdp << "a=rtpmap:" << fec << " x-xorparity/" << codec.getClockRate() << "\r\n";
+        }
+        sdp << "a=ptime:" << codec.getPacketTimeMs() << "\r\n"
+            << "a=sendonly\r\n";
+        return sdp.str();
+    }
+
+    std::uint64_t getThreadCpuNanoseconds()
+    {
+        struct timespec now {};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * nanosecondsPerSecond + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+} // namespace audio
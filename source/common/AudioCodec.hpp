@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Configurations/ParseConfigFile.hpp"
+
+/*
+* Talk channel payload codecs (L16, PCMA, PCMU, Opus) behind one interface, so the RTP
+* sender and receiver do not care which one the configuration picked.
+*/
+namespace audio
+{
+    class IAudioCodec
+    {
+    public:
+        virtual ~IAudioCodec() = default;
+
+        // encoding name and a=rtpmap value, e.g. "opus" and "opus/48000/2"
+        virtual std::string getName() const = 0;
+        virtual std::string getRtpMap() const = 0;
+        // a=fmtp value, empty if the codec has none
+        virtual std::string getFormatParameters() const = 0;
+        virtual std::uint8_t getPayloadType() const = 0;
+        // rate of the RTP timestamp, not always the device rate (opus is always 48000)
+        virtual unsigned int getClockRate() const = 0;
+
+        // device rate frames in one packet, encode() takes exactly this many
+        virtual std::size_t getFrameSamples() const = 0;
+        virtual unsigned int getPacketTimeMs() const = 0;
+        // upper bound of decode() output for a payload of this size
+        virtual std::size_t getMaxDecodedFrames(std::size_t bytes) const = 0;
+        // encoder bitrate in bits per second; only opus can change it, within the signalled maximum
+        virtual int getBitrate() const = 0;
+        virtual bool setBitrate(int bitrate) = 0;
+
+        // return the payload bytes / decoded frames, negative on error
+        virtual int encode(const std::int16_t* pcm, std::size_t frames, std::uint8_t* data, std::size_t maxBytes) = 0;
+        virtual int decode(const std::uint8_t* data, std::size_t bytes, std::int16_t* pcm, std::size_t maxFrames) = 0;
+
+        // start a new talk session, the codec state memory is kept
+        virtual void reset() = 0;
+    };
+
+    // codec for audio.audioFormat, falls back to PCM when the format or its settings are not usable
+    std::unique_ptr<IAudioCodec> createAudioCodec(const configuration::AppConfiguration& config,
+        unsigned int sampleRate, unsigned int channels);
+
+    // RFC 3389 comfort noise payload type for the codec clock, 13 is only defined for 8000 Hz
+    std::uint8_t selectComfortNoisePayloadType(const configuration::AppConfiguration& config, const IAudioCodec& codec);
+
+    // session description a receiver (ffplay, vlc, the peer) needs to play our stream sent to address:port,
+    // comfort noise is announced when its payload type is not 0, RFC 2198 redundancy when redPayloadType is not 0
+    // with redundancyDepth earlier payloads per packet and, when fecPayloadType is not 0, the xor parity block
+    std::string createSessionDescription(const IAudioCodec& codec, const std::string& address, int port,
+        std::uint8_t comfortNoisePayloadType = 0, std::uint8_t redPayloadType = 0, std::size_t redundancyDepth = 0,
+        std::uint8_t fecPayloadType = 0);
+
+    // CPU time used by the calling thread, for per frame codec cost
+    std::uint64_t getThreadCpuNanoseconds();
+} // namespace audio
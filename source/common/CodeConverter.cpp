@@ -1,6 +1,7 @@
 //
 // Created by shenjun on 18-10-11.
 //
+#include <cerrno>
 #include <codecvt>
 #include "CodeConverter.hpp"
 #include "logger/Logger.hpp"
@@ -32,6 +33,20 @@ namespace common
         return res;
     }
 
+    size_t CodeConverter::convert(const char* input, size_t inLen, char* output, size_t outLen)
+    {
+        iconv(m_iconv, nullptr, nullptr, nullptr, nullptr);
+        char* in = const_cast<char*>(input);
+        char* out = output;
+        size_t outLeft = outLen;
+        // //IGNORE reports skipped input as an error after converting the rest
+        if (static_cast<size_t>(-1) == iconv(m_iconv, &in, &inLen, &out, &outLeft) and EILSEQ != errno)
+        {
+            LOG_ERROR_MSG("Decode cover failed error : {}", errno);
+        }
+        return outLen - outLeft;
+    }
+
     std::wstring CodeConverter::stringToWstring(const std::string& strData)
     {
         using convert_typeX = std::codecvt_utf8<wchar_t>;
@@ -20,6 +20,8 @@ namespace common
         ~CodeConverter();
 
         int decodeCoverter(char* input, size_t inLen, char* output, size_t outLen);
+        // bytes written to output, every call starts in the initial shift state
+        size_t convert(const char* input, size_t inLen, char* output, size_t outLen);
 
         std::wstring stringToWstring(const std::string& strData);
         std::string wstringToString(const std::wstring& wstrData);
@@ -1,5 +1,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/system/error_code.hpp>
+#include <cstdlib>
+#include <sstream>
 #include "CommonFunction.hpp"
 #include "Configurations/Configurations.hpp"
 
@@ -140,6 +142,96 @@ namespace video
         }
         return "";
     }
+
+    int getVideoDecodeThreads(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::videoDecodeThreads) != config.end())
+        {
+            return config[configuration::videoDecodeThreads].as<int>();
+        }
+        return 0;
+    }
+
+    bool getEnableThumbnails(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::enableThumbnails) != config.end())
+        {
+            return config[configuration::enableThumbnails].as<bool>();
+        }
+        return false;
+    }
+
+    int getThumbnailInterval(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::thumbnailInterval) != config.end())
+        {
+            return config[configuration::thumbnailInterval].as<int>();
+        }
+        return 10;
+    }
+
+    int getThumbnailWidth(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::thumbnailWidth) != config.end())
+        {
+            return config[configuration::thumbnailWidth].as<int>();
+        }
+        return 160;
+    }
+
+    std::string getSnapshotFormat(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::snapshotFormat) != config.end())
+        {
+            return config[configuration::snapshotFormat].as<std::string>();
+        }
+        return "JPG";
+    }
+
+    int getSnapshotQuality(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::snapshotQuality) != config.end())
+        {
+            return config[configuration::snapshotQuality].as<int>();
+        }
+        return 3;
+    }
+
+    int getBurstCount(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::burstCount) != config.end())
+        {
+            return config[configuration::burstCount].as<int>();
+        }
+        return 5;
+    }
+
+    std::string getCaptureMode(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::captureMode) != config.end())
+        {
+            return config[configuration::captureMode].as<std::string>();
+        }
+        return "continuous";
+    }
+
+    int getTimelapseInterval(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::timelapseInterval) != config.end())
+        {
+            return config[configuration::timelapseInterval].as<int>();
+        }
+        return 10;
+    }
+
+    int getVideoTimes(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::videoTimes) != config.end())
+        {
+            return config[configuration::videoTimes].as<int>();
+        }
+        return 30;
+    }
 }// namespace video
 
 namespace audio
@@ -225,6 +317,290 @@ namespace audio
 		return 8;
 	}
 
+    int getJitterMinDelay(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::jitterMinDelay) != config.end())
+        {
+            return config[configuration::jitterMinDelay].as<int>();
+        }
+        return 20;
+    }
+
+    int getJitterMaxDelay(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::jitterMaxDelay) != config.end())
+        {
+            return config[configuration::jitterMaxDelay].as<int>();
+        }
+        return 300;
+    }
+
+    int getOpusBitrate(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::opusBitrate) != config.end())
+        {
+            return config[configuration::opusBitrate].as<int>();
+        }
+        return 24000;
+    }
+
+    int getOpusFrameMs(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::opusFrameMs) != config.end())
+        {
+            return config[configuration::opusFrameMs].as<int>();
+        }
+        return 20;
+    }
+
+    int getOpusComplexity(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::opusComplexity) != config.end())
+        {
+            return config[configuration::opusComplexity].as<int>();
+        }
+        return 5;
+    }
+
+    int getOpusPayloadType(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::opusPayloadType) != config.end())
+        {
+            return config[configuration::opusPayloadType].as<int>();
+        }
+        return 111;
+    }
+
+    bool getAdaptiveBitrate(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::adaptiveBitrate) != config.end())
+        {
+            return config[configuration::adaptiveBitrate].as<bool>();
+        }
+        return true;
+    }
+
+    int getOpusMinBitrate(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::opusMinBitrate) != config.end())
+        {
+            return config[configuration::opusMinBitrate].as<int>();
+        }
+        return 12000;
+    }
+
+    bool getVadEnable(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::vadEnable) != config.end())
+        {
+            return config[configuration::vadEnable].as<bool>();
+        }
+        return false;
+    }
+
+    int getVadThreshold(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::vadThreshold) != config.end())
+        {
+            return config[configuration::vadThreshold].as<int>();
+        }
+        return 9;
+    }
+
+    int getVadHangover(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::vadHangover) != config.end())
+        {
+            return config[configuration::vadHangover].as<int>();
+        }
+        return 300;
+    }
+
+    int getComfortNoisePayloadType(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::comfortNoisePayloadType) != config.end())
+        {
+            return config[configuration::comfortNoisePayloadType].as<int>();
+        }
+        return 13;
+    }
+
+    int getMixerMaxSources(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::mixerMaxSources) != config.end())
+        {
+            return config[configuration::mixerMaxSources].as<int>();
+        }
+        return 4;
+    }
+
+    int getMixerSourceGain(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::mixerSourceGain) != config.end())
+        {
+            return config[configuration::mixerSourceGain].as<int>();
+        }
+        return 100;
+    }
+
+    int getDeviceSampleRate(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::deviceSampleRate) != config.end() and
+            0 < config[configuration::deviceSampleRate].as<int>())
+        {
+            return config[configuration::deviceSampleRate].as<int>();
+        }
+        return getAudioSampleRate(config);
+    }
+
+    int getDeviceChannel(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::deviceChannel) != config.end() and
+            0 < config[configuration::deviceChannel].as<int>())
+        {
+            return config[configuration::deviceChannel].as<int>();
+        }
+        return getAudioChannel(config);
+    }
+
+    int getWavBufferMs(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::wavBufferMs) != config.end())
+        {
+            return config[configuration::wavBufferMs].as<int>();
+        }
+        return 2000;
+    }
+
+    int getWavCheckpointMs(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::wavCheckpointMs) != config.end())
+        {
+            return config[configuration::wavCheckpointMs].as<int>();
+        }
+        return 1000;
+    }
+
+    configuration::LatencyProfile getLatencyProfile(const configuration::AppConfiguration& config)
+    {
+        std::string name;
+        if (config.find(configuration::latencyProfile) != config.end())
+        {
+            name = config[configuration::latencyProfile].as<std::string>();
+        }
+
+        configuration::LatencyProfile profile;
+        if ("lowlatency" == name)
+        {
+            // 15 ms in the device, starts on the first period
+            profile = { name, 5000, 3, 10, 1, 1 };
+        }
+        else if ("balanced" == name)
+        {
+            profile = { name, 10000, 4, 20, 1, 2 };
+        }
+        else if ("powersave" == name)
+        {
+            // wakes up every other period, starts with a full buffer
+            profile = { name, 40000, 4, 40, 2, 0 };
+        }
+        return profile;
+    }
+
+    bool getLatencyProbe(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::latencyProbe) != config.end())
+        {
+            return config[configuration::latencyProbe].as<bool>();
+        }
+        return false;
+    }
+
+    int getLatencyProbeIntervalMs(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::latencyProbeIntervalMs) != config.end())
+        {
+            return config[configuration::latencyProbeIntervalMs].as<int>();
+        }
+        return 1000;
+    }
+
+    int getLatencyProbeMarkers(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::latencyProbeMarkers) != config.end())
+        {
+            return config[configuration::latencyProbeMarkers].as<int>();
+        }
+        return 20;
+    }
+
+    std::vector<unsigned int> getLatencyProbeSweep(const configuration::AppConfiguration& config)
+    {
+        std::string sweep = "40,20,10,5";
+        if (config.find(configuration::latencyProbeSweep) != config.end())
+        {
+            sweep = config[configuration::latencyProbeSweep].as<std::string>();
+        }
+        std::vector<unsigned int> periodTimes;
+        std::istringstream stream(sweep);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            char* end = nullptr;
+            const unsigned long periodMs = std::strtoul(item.c_str(), &end, 10);
+            if (0 < periodMs and end != item.c_str())
+            {
+                periodTimes.push_back(static_cast<unsigned int>(periodMs));
+            }
+        }
+        return periodTimes;
+    }
+
+    std::string getFecMode(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::fecMode) != config.end())
+        {
+            return config[configuration::fecMode].as<std::string>();
+        }
+        return "none";
+    }
+
+    int getFecGroupSize(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::fecGroupSize) != config.end())
+        {
+            return config[configuration::fecGroupSize].as<int>();
+        }
+        return 4;
+    }
+
+    int getRedundancyDepth(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::redundancyDepth) != config.end())
+        {
+            return config[configuration::redundancyDepth].as<int>();
+        }
+        return 1;
+    }
+
+    int getRedPayloadType(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::redPayloadType) != config.end())
+        {
+            return config[configuration::redPayloadType].as<int>();
+        }
+        return 121;
+    }
+
+    int getFecPayloadType(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::fecPayloadType) != config.end())
+        {
+            return config[configuration::fecPayloadType].as<int>();
+        }
+        return 122;
+    }
+
 } // namespace audio
 
 namespace rtp
@@ -264,4 +640,80 @@ namespace rtp
         }
         return 9004;
     }
+
+    std::string getRTPTransport(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::rtpTransport) != config.end())
+        {
+            return config[configuration::rtpTransport].as<std::string>();
+        }
+        return "jrtplib";
+    }
+
+    bool parseRTPAddress(const std::string& address, std::string& ipAddress, int& port)
+    {
+        const std::size_t separator = address.rfind(':');
+        if (std::string::npos == separator or 0 == separator)
+        {
+            return false;
+        }
+        char* end = nullptr;
+        const long value = std::strtol(address.c_str() + separator + 1, &end, 10);
+        if (end == address.c_str() + separator + 1 or '\0' != *end or 0 >= value or 65535 < value)
+        {
+            return false;
+        }
+        ipAddress = address.substr(0, separator);
+        port = static_cast<int>(value);
+        return true;
+    }
+
+    std::vector<std::pair<std::string, int>> getRTPDestinations(const configuration::AppConfiguration& config)
+    {
+        std::string list;
+        if (config.find(configuration::rtpDestinations) != config.end())
+        {
+            list = config[configuration::rtpDestinations].as<std::string>();
+        }
+        std::vector<std::pair<std::string, int>> destinations;
+        std::istringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            std::string ipAddress;
+            int port = 0;
+            if (parseRTPAddress(item, ipAddress, port))
+            {
+                destinations.emplace_back(ipAddress, port);
+            }
+        }
+        return destinations;
+    }
+
+    std::string getMulticastGroup(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::multicastGroup) != config.end())
+        {
+            return config[configuration::multicastGroup].as<std::string>();
+        }
+        return "";
+    }
+
+    int getMulticastTtl(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::multicastTtl) != config.end())
+        {
+            return config[configuration::multicastTtl].as<int>();
+        }
+        return 1;
+    }
+
+    int getDestinationMaxKbps(const configuration::AppConfiguration& config)
+    {
+        if (config.find(configuration::destinationMaxKbps) != config.end())
+        {
+            return config[configuration::destinationMaxKbps].as<int>();
+        }
+        return 0;
+    }
 } // namespace rtp
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <utility>
+#include <vector>
 #include "Configurations/ParseConfigFile.hpp"
 
 namespace common
@@ -33,6 +35,27 @@ namespace video
 
     std::string getFilterDescr(const configuration::AppConfiguration& config);
 
+    int getVideoDecodeThreads(const configuration::AppConfiguration& config);
+
+    bool getEnableThumbnails(const configuration::AppConfiguration& config);
+
+    int getThumbnailInterval(const configuration::AppConfiguration& config);
+
+    int getThumbnailWidth(const configuration::AppConfiguration& config);
+
+    std::string getSnapshotFormat(const configuration::AppConfiguration& config);
+
+    int getSnapshotQuality(const configuration::AppConfiguration& config);
+
+    int getBurstCount(const configuration::AppConfiguration& config);
+
+    std::string getCaptureMode(const configuration::AppConfiguration& config);
+
+    int getTimelapseInterval(const configuration::AppConfiguration& config);
+
+    // minutes of every recorded segment
+    int getVideoTimes(const configuration::AppConfiguration& config);
+
 } // namespace video
 
 namespace audio
@@ -54,6 +77,66 @@ namespace audio
     std::string getAudioFormat(const configuration::AppConfiguration& config);
 
 	int getSampleBit(const configuration::AppConfiguration& config);
+
+    int getJitterMinDelay(const configuration::AppConfiguration& config);
+
+    int getJitterMaxDelay(const configuration::AppConfiguration& config);
+
+    int getOpusBitrate(const configuration::AppConfiguration& config);
+
+    int getOpusFrameMs(const configuration::AppConfiguration& config);
+
+    int getOpusComplexity(const configuration::AppConfiguration& config);
+
+    int getOpusPayloadType(const configuration::AppConfiguration& config);
+
+    bool getAdaptiveBitrate(const configuration::AppConfiguration& config);
+
+    int getOpusMinBitrate(const configuration::AppConfiguration& config);
+
+    bool getVadEnable(const configuration::AppConfiguration& config);
+
+    int getVadThreshold(const configuration::AppConfiguration& config);
+
+    int getVadHangover(const configuration::AppConfiguration& config);
+
+    int getComfortNoisePayloadType(const configuration::AppConfiguration& config);
+
+    int getMixerMaxSources(const configuration::AppConfiguration& config);
+
+    int getMixerSourceGain(const configuration::AppConfiguration& config);
+
+    // falls back to the codec sample rate
+    int getDeviceSampleRate(const configuration::AppConfiguration& config);
+
+    // falls back to the codec channels
+    int getDeviceChannel(const configuration::AppConfiguration& config);
+
+    int getWavBufferMs(const configuration::AppConfiguration& config);
+
+    int getWavCheckpointMs(const configuration::AppConfiguration& config);
+
+    // an unknown or empty name keeps the device defaults
+    configuration::LatencyProfile getLatencyProfile(const configuration::AppConfiguration& config);
+
+    bool getLatencyProbe(const configuration::AppConfiguration& config);
+
+    int getLatencyProbeIntervalMs(const configuration::AppConfiguration& config);
+
+    int getLatencyProbeMarkers(const configuration::AppConfiguration& config);
+
+    // period times in ms in the configured order, invalid entries are skipped
+    std::vector<unsigned int> getLatencyProbeSweep(const configuration::AppConfiguration& config);
+
+    std::string getFecMode(const configuration::AppConfiguration& config);
+
+    int getFecGroupSize(const configuration::AppConfiguration& config);
+
+    int getRedundancyDepth(const configuration::AppConfiguration& config);
+
+    int getRedPayloadType(const configuration::AppConfiguration& config);
+
+    int getFecPayloadType(const configuration::AppConfiguration& config);
 } // namespace audio
 
 namespace rtp
@@ -65,4 +148,17 @@ namespace rtp
     int getRTPLocalSendPort(const configuration::AppConfiguration& config);
 
     int getRTPLocalReceivePort(const configuration::AppConfiguration& config);
+
+    std::string getRTPTransport(const configuration::AppConfiguration& config);
+
+    // "ip:port" into its parts, false when it is not one
+    bool parseRTPAddress(const std::string& address, std::string& ipAddress, int& port);
+
+    std::vector<std::pair<std::string, int>> getRTPDestinations(const configuration::AppConfiguration& config);
+
+    std::string getMulticastGroup(const configuration::AppConfiguration& config);
+
+    int getMulticastTtl(const configuration::AppConfiguration& config);
+
+    int getDestinationMaxKbps(const configuration::AppConfiguration& config);
 }// namespace rtp
\ No newline at end of file
@@ -10,10 +10,15 @@ namespace
     constexpr int NSEGS = 8;            /* Number of A-law segments. */
     constexpr int BIAS = 0x84;          /* Bias for linear code. */
 
-    short seg_end[8] = { 0xFF, 0x1FF, 0x3FF, 0x7FF,
+    /* encode tables are indexed by the 13 high bits, the low 3 bits never reach the code word */
+    constexpr int ENCODE_SHIFT = 3;
+    constexpr int ENCODE_TABLE_SIZE = 1 << (16 - ENCODE_SHIFT);
+    constexpr int DECODE_TABLE_SIZE = 256;
+
+    constexpr short seg_end[8] = { 0xFF, 0x1FF, 0x3FF, 0x7FF,
             0xFFF, 0x1FFF, 0x3FFF, 0x7FFF };
 
-    int search(short val, short* table, short size)
+    constexpr int search(short val, const short* table, short size)
     {
         for (short i = 0; i < size; i++)
         {
@@ -24,11 +29,11 @@ namespace
     }
 
     /* Convert a 16-bit linear PCM value to 8-bit A-law */
-    unsigned char linear2alaw(short pcm_val)
+    constexpr unsigned char linear2alaw(short pcm_val)
     {
-        short		mask;
-        short		seg;
-        unsigned char	aval;
+        short		mask = 0;
+        short		seg = 0;
+        unsigned char	aval = 0;
 
         if (pcm_val >= 0)
         {
@@ -55,7 +60,7 @@ namespace
         }
         else
         {
-            /* the following is processed according to the Thirteen - segment method of the table. 
+            /* the following is processed according to the Thirteen - segment method of the table.
             The low 4 bits are data, the 5~7 bits are exponents, and the highest bits are symbols */
             aval = seg << SEG_SHIFT;
             if (seg < 2)
@@ -70,68 +75,29 @@ namespace
         }
     }
 
-    int g711aEncode(unsigned char* g711Data, const short* pcmData, const int dataLen)
-    {
-        for (int i = 0; i < dataLen; i++)
-        {
-            g711Data[i] = linear2alaw(pcmData[i]);
-        }
-
-        return dataLen;
-    }
-
-    /* Convert a 16-bit linear PCM value to 8-bit u-law */
-    unsigned char linear2ulaw(short pcm_val)
+    /* Segment and quantization bits of an already biased u-law magnitude, see linear2ulaw */
+    constexpr unsigned char biased2ulaw(short pcm_val)
     {
-        int		mask;
-        int		seg;
-        unsigned char	uval;
-
-        /* Get the sign and the magnitude of the value. */
-        if (pcm_val < 0)
-        {
-            pcm_val = BIAS - pcm_val;
-            mask = 0x7F;
-        }
-        else
-        {
-            pcm_val += BIAS;
-            mask = 0xFF;
-        }
+        int		seg = 0;
 
         /* Convert the scaled magnitude to segment number. */
         seg = search(pcm_val, seg_end, NSEGS);
 
-        /*
-         * Combine the sign, segment, quantization bits;
-         * and complement the code word.
-         */
         if (seg >= NSEGS)		/* out of range, return maximum value. */
         {
-            return (0x7F ^ mask);
+            return (0x7F);
         }
         else
         {
-            uval = (seg << 4) | ((pcm_val >> (seg + 3)) & 0xF);
-            return (uval ^ mask);
+            return (seg << 4) | ((pcm_val >> (seg + 3)) & 0xF);
         }
     }
 
-    int g711uEncode(unsigned char* g711Data, const short* pcmData, const int dataLen)
-    {
-        for (int i = 0; i < dataLen; i++)
-        {
-            g711Data[i] = linear2ulaw(pcmData[i]);
-        }
-
-        return dataLen;
-    }
-
     /* Convert an A-law value to 16-bit linear PCM */
-    short alaw2linear(unsigned char a_val)
+    constexpr short alaw2linear(unsigned char a_val)
     {
-        short t;
-        short seg;
+        short t = 0;
+        short seg = 0;
 
         a_val ^= 0x55;
 
@@ -152,15 +118,6 @@ namespace
         return ((a_val & SIGN_BIT) ? t : -t);
     }
 
-    int g711aDecode(short* pcmData, const unsigned char* g711aData, int g711aBytes)
-    {
-        for (int i = 0; i >= g711aBytes; i++)
-        {
-            pcmData[i] = alaw2linear(g711aData[i]);
-        }
-        return g711aBytes * 2;
-    }
-
     /*
     * Convert a u-law value to 16-bit linear PCM
     *
@@ -170,9 +127,9 @@ namespace
     * Note that this function expects to be passed the complement of the
     * original code word. This is in keeping with ISDN conventions.
     */
-    short ulaw2linear(unsigned char u_val)
+    constexpr short ulaw2linear(unsigned char u_val)
     {
-        short t;
+        short t = 0;
 
         /* Complement to obtain normal u-law value. */
         u_val = ~u_val;
@@ -187,17 +144,161 @@ namespace
         return ((u_val & SIGN_BIT) ? (BIAS - t) : (t - BIAS));
     }
 
-    int g711uDecode(short* pcmData, const unsigned char* g711uData, int g711uBytes)
+    /* lookup tables generated at compile time from the reference conversions above */
+    struct AlawEncodeTable
+    {
+        unsigned char values[ENCODE_TABLE_SIZE];
+
+        constexpr AlawEncodeTable()
+            : values{}
+        {
+            for (int i = 0; i < ENCODE_TABLE_SIZE; i++)
+            {
+                values[i] = linear2alaw(static_cast<short>(i << ENCODE_SHIFT));
+            }
+        }
+    };
+
+    struct UlawEncodeTable
+    {
+        unsigned char values[ENCODE_TABLE_SIZE];
+
+        constexpr UlawEncodeTable()
+            : values{}
+        {
+            for (int i = 0; i < ENCODE_TABLE_SIZE; i++)
+            {
+                values[i] = biased2ulaw(static_cast<short>(i << ENCODE_SHIFT));
+            }
+        }
+    };
+
+    struct AlawDecodeTable
     {
-        for (int i = 0; i >= g711uBytes; i++)
+        short values[DECODE_TABLE_SIZE];
+
+        constexpr AlawDecodeTable()
+            : values{}
         {
-            pcmData[i] = ulaw2linear(g711uData[i]);
+            for (int i = 0; i < DECODE_TABLE_SIZE; i++)
+            {
+                values[i] = alaw2linear(static_cast<unsigned char>(i));
+            }
         }
-        return g711uBytes * 2;
+    };
+
+    struct UlawDecodeTable
+    {
+        short values[DECODE_TABLE_SIZE];
+
+        constexpr UlawDecodeTable()
+            : values{}
+        {
+            for (int i = 0; i < DECODE_TABLE_SIZE; i++)
+            {
+                values[i] = ulaw2linear(static_cast<unsigned char>(i));
+            }
+        }
+    };
+
+    constexpr AlawEncodeTable alawEncodeTable{};
+    constexpr UlawEncodeTable ulawEncodeTable{};
+    constexpr AlawDecodeTable alawDecodeTable{};
+    constexpr UlawDecodeTable ulawDecodeTable{};
+
+    struct AlawEncodeSample
+    {
+        std::uint8_t operator()(std::int16_t pcm) const
+        {
+            return alawEncodeTable.values[static_cast<std::uint16_t>(pcm) >> ENCODE_SHIFT];
+        }
+    };
+
+    struct UlawEncodeSample
+    {
+        std::uint8_t operator()(std::int16_t pcm) const
+        {
+            /* bias the magnitude in a short like linear2ulaw, including its wrap at the extremes */
+            const int sign = pcm >> 15;
+            const short biased = static_cast<short>(((pcm ^ sign) - sign) + BIAS);
+            const std::uint8_t mask = 0xFF ^ (sign & 0x80);
+            return ulawEncodeTable.values[static_cast<std::uint16_t>(biased) >> ENCODE_SHIFT] ^ mask;
+        }
+    };
+
+    /*
+     * Four samples per iteration, all loads of a group happen before its stores so the
+     * output may overlap the input at the same or a lower address.
+     */
+    template <typename Encode>
+    std::size_t encodeSamples(const std::int16_t* pcmData, std::size_t samples, std::uint8_t* g711Data, Encode encode)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= samples; i += 4)
+        {
+            const std::int16_t s0 = pcmData[i];
+            const std::int16_t s1 = pcmData[i + 1];
+            const std::int16_t s2 = pcmData[i + 2];
+            const std::int16_t s3 = pcmData[i + 3];
+            g711Data[i] = encode(s0);
+            g711Data[i + 1] = encode(s1);
+            g711Data[i + 2] = encode(s2);
+            g711Data[i + 3] = encode(s3);
+        }
+        for (; i < samples; i++)
+        {
+            g711Data[i] = encode(pcmData[i]);
+        }
+        return samples;
+    }
+
+    /*
+     * Runs from the end so that in place decoding (output starting at the input) never
+     * overwrites code words that are not read yet.
+     */
+    std::size_t decodeSamples(const std::uint8_t* g711Data, std::size_t bytes, std::int16_t* pcmData, const short* table)
+    {
+        std::size_t i = bytes;
+        for (; i >= 4; i -= 4)
+        {
+            const std::uint8_t c3 = g711Data[i - 1];
+            const std::uint8_t c2 = g711Data[i - 2];
+            const std::uint8_t c1 = g711Data[i - 3];
+            const std::uint8_t c0 = g711Data[i - 4];
+            pcmData[i - 1] = table[c3];
+            pcmData[i - 2] = table[c2];
+            pcmData[i - 3] = table[c1];
+            pcmData[i - 4] = table[c0];
+        }
+        for (; i > 0; i--)
+        {
+            pcmData[i - 1] = table[g711Data[i - 1]];
+        }
+        return bytes;
     }
 } // namespace
 namespace audio
 {
+    std::size_t encodeAlaw(const std::int16_t* pcmData, std::size_t samples, std::uint8_t* g711Data)
+    {
+        return encodeSamples(pcmData, samples, g711Data, AlawEncodeSample{});
+    }
+
+    std::size_t encodeUlaw(const std::int16_t* pcmData, std::size_t samples, std::uint8_t* g711Data)
+    {
+        return encodeSamples(pcmData, samples, g711Data, UlawEncodeSample{});
+    }
+
+    std::size_t decodeAlaw(const std::uint8_t* g711Data, std::size_t bytes, std::int16_t* pcmData)
+    {
+        return decodeSamples(g711Data, bytes, pcmData, alawDecodeTable.values);
+    }
+
+    std::size_t decodeUlaw(const std::uint8_t* g711Data, std::size_t bytes, std::int16_t* pcmData)
+    {
+        return decodeSamples(g711Data, bytes, pcmData, ulawDecodeTable.values);
+    }
+
     /*
      * function: convert PCM audio format to g711 alaw/ulaw
      *	 inAudioData:	PCM data prepared to encode
@@ -213,7 +314,7 @@ namespace audio
             return -1;
         }
 
-        return g711aEncode((unsigned char*)outAudioData, (short*)inAudioData, dataLen / 2);
+        return encodeAlaw(reinterpret_cast<const std::int16_t*>(inAudioData), dataLen / 2, outAudioData);
     }
 
     int PCM2G711u(unsigned char *outAudioData, const char *inAudioData, const int dataLen)
@@ -224,7 +325,7 @@ namespace audio
             return -1;
         }
 
-        return g711uEncode((unsigned char *)outAudioData, (short*)inAudioData, dataLen / 2);
+        return encodeUlaw(reinterpret_cast<const std::int16_t*>(inAudioData), dataLen / 2, outAudioData);
     }
 
     /*
@@ -241,8 +342,8 @@ namespace audio
             LOG_ERROR_MSG("Error, empty data or transmit failed, exit !");
             return -1;
         }
-        
-        return g711aDecode((short*)outAudioData, (unsigned char*)inAudioData, dataLen);
+
+        return decodeAlaw(reinterpret_cast<const std::uint8_t*>(inAudioData), dataLen, reinterpret_cast<std::int16_t*>(outAudioData)) * 2;
     }
 
     int G711u2PCM(char* outAudioData, const char* inAudioData, const int dataLen)
@@ -253,7 +354,7 @@ namespace audio
             return -1;
         }
 
-        return g711uDecode(reinterpret_cast<short*>(outAudioData), reinterpret_cast<const unsigned char*>(inAudioData), dataLen);
+        return decodeUlaw(reinterpret_cast<const std::uint8_t*>(inAudioData), dataLen, reinterpret_cast<std::int16_t*>(outAudioData)) * 2;
     }
 
-} // namespace audio
\ No newline at end of file
+} // namespace audio
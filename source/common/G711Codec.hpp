@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 
 /*
 * u-law, A-law and linear PCM conversions.
@@ -10,4 +12,15 @@ namespace audio
 
     int G711a2PCM(char* outAudioData, const char* inAudioData, const int dataLen);
     int G711u2PCM(char *outAudioData, const char *inAudioData, const int dataLen);
-} // namespace common
\ No newline at end of file
+
+    /*
+     * Table driven batch conversions, return the number of samples converted.
+     * Encode may write over its own input (g711Data == pcmData), decode may write its
+     * output starting at the input (pcmData == g711Data, buffer of 2 * bytes).
+     */
+    std::size_t encodeAlaw(const std::int16_t* pcmData, std::size_t samples, std::uint8_t* g711Data);
+    std::size_t encodeUlaw(const std::int16_t* pcmData, std::size_t samples, std::uint8_t* g711Data);
+
+    std::size_t decodeAlaw(const std::uint8_t* g711Data, std::size_t bytes, std::int16_t* pcmData);
+    std::size_t decodeUlaw(const std::uint8_t* g711Data, std::size_t bytes, std::int16_t* pcmData);
+} // namespace common
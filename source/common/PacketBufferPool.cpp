@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "PacketBufferPool.hpp"
+
+namespace common
+{
+    PacketSlice::PacketSlice(PacketBuffer* buffer, std::size_t offset, std::size_t length)
+        : m_buffer{ buffer }
+        , m_data{ buffer->data + offset }
+        , m_size{ length }
+    {
+    }
+
+    PacketSlice::PacketSlice(const PacketSlice& other)
+        : m_buffer{ other.m_buffer }
+        , m_data{ other.m_data }
+        , m_size{ other.m_size }
+    {
+        if (nullptr != m_buffer)
+        {
+            m_buffer->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PacketSlice::PacketSlice(PacketSlice&& other) noexcept
+        : m_buffer{ other.m_buffer }
+        , m_data{ other.m_data }
+        , m_size{ other.m_size }
+    {
+        other.m_buffer = nullptr;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    PacketSlice& PacketSlice::operator=(PacketSlice other) noexcept
+    {
+        std::swap(m_buffer, other.m_buffer);
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    PacketSlice::~PacketSlice()
+    {
+        if (nullptr != m_buffer)
+        {
+            m_buffer->pool->release(m_buffer);
+        }
+    }
+
+    PacketSlice PacketSlice::slice(std::size_t offset, std::size_t length) const
+    {
+        offset = std::min(offset, m_size);
+        length = std::min(length, m_size - offset);
+        if (nullptr == m_buffer or 0 == length)
+        {
+            return PacketSlice();
+        }
+        m_buffer->references.fetch_add(1, std::memory_order_relaxed);
+        return PacketSlice(m_buffer, static_cast<std::size_t>(m_data - m_buffer->data) + offset, length);
+    }
+
+    PacketBufferPool::PacketBufferPool(std::size_t buffers, std::size_t bufferBytes)
+        : m_bufferBytes{ bufferBytes }
+        , m_memory(buffers * bufferBytes)
+        , m_buffers(buffers)
+    {
+        m_free.reserve(buffers);
+        for (std::size_t i = 0; i < buffers; ++i)
+        {
+            m_buffers[i].pool = this;
+            m_buffers[i].data = &m_memory[i * bufferBytes];
+            m_free.push_back(&m_buffers[i]);
+        }
+    }
+
+    PacketBuffer* PacketBufferPool::acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty())
+        {
+            m_exhausted.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        PacketBuffer* buffer = m_free.back();
+        m_free.pop_back();
+        buffer->references.store(1, std::memory_order_relaxed);
+
+        const std::size_t used = m_buffers.size() - m_free.size();
+        if (used > m_highWatermark.load(std::memory_order_relaxed))
+        {
+            m_highWatermark.store(used, std::memory_order_relaxed);
+        }
+        return buffer;
+    }
+
+    void PacketBufferPool::release(PacketBuffer* buffer)
+    {
+        // the last owner sees every write of the others before the buffer is reused
+        if (1 != buffer->references.fetch_sub(1, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(buffer);
+    }
+} // namespace common
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace common
+{
+    class PacketBufferPool;
+
+    // one datagram buffer of a pool, back in the pool when the last reference is dropped
+    struct PacketBuffer
+    {
+        PacketBufferPool* pool{ nullptr };
+        std::uint8_t* data{ nullptr };
+        std::atomic<unsigned int> references{ 0 };
+    };
+
+    /*
+     * Read only view of bytes in a pooled packet buffer. Copies share the buffer through
+     * its reference count, nothing is allocated or copied. A default slice is empty and
+     * holds no buffer.
+     */
+    class PacketSlice final
+    {
+    public:
+        PacketSlice() = default;
+        // takes over one reference of buffer
+        PacketSlice(PacketBuffer* buffer, std::size_t offset, std::size_t length);
+        PacketSlice(const PacketSlice& other);
+        PacketSlice(PacketSlice&& other) noexcept;
+        PacketSlice& operator=(PacketSlice other) noexcept;
+        ~PacketSlice();
+
+        const std::uint8_t* data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+        bool empty() const { return 0 == m_size; }
+        const std::uint8_t& operator[](std::size_t index) const { return m_data[index]; }
+        const std::uint8_t* begin() const { return m_data; }
+        const std::uint8_t* end() const { return m_data + m_size; }
+
+        // part of this slice sharing the same buffer
+        PacketSlice slice(std::size_t offset, std::size_t length) const;
+
+    private:
+        PacketBuffer* m_buffer{ nullptr };
+        const std::uint8_t* m_data{ nullptr };
+        std::size_t m_size{ 0 };
+    };
+
+    /*
+     * Fixed set of equally sized packet buffers allocated once, so the receive path hands
+     * payloads to the decoder without heap allocations. Any thread may drop references,
+     * acquire() is meant for the one receiving thread. Every slice must be gone before
+     * the pool is destroyed.
+     */
+    class PacketBufferPool final
+    {
+    public:
+        PacketBufferPool(std::size_t buffers, std::size_t bufferBytes);
+
+        PacketBufferPool(const PacketBufferPool&) = delete;
+        PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+        // a free buffer with one reference for the caller, nullptr when all are in use
+        PacketBuffer* acquire();
+        // drops one reference, the buffer is free again after the last one
+        void release(PacketBuffer* buffer);
+
+        std::size_t bufferBytes() const { return m_bufferBytes; }
+        std::size_t buffers() const { return m_buffers.size(); }
+        // most buffers ever in use at once
+        std::size_t highWatermark() const { return m_highWatermark.load(std::memory_order_relaxed); }
+        // acquire() calls that found no free buffer
+        std::uint64_t exhausted() const { return m_exhausted.load(std::memory_order_relaxed); }
+
+    private:
+        const std::size_t m_bufferBytes;
+        std::vector<std::uint8_t> m_memory;
+        std::vector<PacketBuffer> m_buffers;
+
+        std::mutex m_mutex;
+        std::vector<PacketBuffer*> m_free;
+        std::atomic<std::size_t> m_highWatermark{ 0 };
+        std::atomic<std::uint64_t> m_exhausted{ 0 };
+    };
+} // namespace common
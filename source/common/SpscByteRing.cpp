@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstring>
+#include "SpscByteRing.hpp"
+
+namespace
+{
+    std::size_t roundUpPowerOfTwo(std::size_t value)
+    {
+        std::size_t power = 1;
+        while (power < value)
+        {
+            power <<= 1;
+        }
+        return power;
+    }
+} // namespace
+
+namespace common
+{
+    SpscByteRing::SpscByteRing(std::size_t capacity)
+        : m_buffer(roundUpPowerOfTwo(std::max<std::size_t>(capacity, 1)))
+        , m_mask{ m_buffer.size() - 1 }
+    {
+    }
+
+    bool SpscByteRing::write(const std::uint8_t* data, std::size_t length)
+    {
+        const std::size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+        const std::size_t readIndex = m_readIndex.load(std::memory_order_acquire);
+        const std::size_t used = writeIndex - readIndex;
+        if (length > m_buffer.size() - used)
+        {
+            m_droppedBytes.fetch_add(length, std::memory_order_relaxed);
+            return false;
+        }
+
+        const std::size_t position = writeIndex & m_mask;
+        const std::size_t firstPart = std::min(length, m_buffer.size() - position);
+        memcpy(&m_buffer[position], data, firstPart);
+        memcpy(&m_buffer[0], data + firstPart, length - firstPart);
+        m_writeIndex.store(writeIndex + length, std::memory_order_release);
+
+        if (used + length > m_highWatermark.load(std::memory_order_relaxed))
+        {
+            m_highWatermark.store(used + length, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    std::size_t SpscByteRing::readable() const
+    {
+        return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_relaxed);
+    }
+
+    const std::uint8_t* SpscByteRing::peek(std::size_t length, std::vector<std::uint8_t>& scratch) const
+    {
+        if (0 == length or readable() < length)
+        {
+            return nullptr;
+        }
+        const std::size_t position = m_readIndex.load(std::memory_order_relaxed) & m_mask;
+        if (position + length <= m_buffer.size())
+        {
+            return &m_buffer[position];
+        }
+
+        // wraps around the end of the buffer
+        scratch.resize(length);
+        const std::size_t firstPart = m_buffer.size() - position;
+        memcpy(&scratch[0], &m_buffer[position], firstPart);
+        memcpy(&scratch[firstPart], &m_buffer[0], length - firstPart);
+        return scratch.data();
+    }
+
+    void SpscByteRing::consume(std::size_t length)
+    {
+        const std::size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+        m_readIndex.store(readIndex + std::min(length, readable()), std::memory_order_release);
+    }
+
+    std::size_t SpscByteRing::skip(std::size_t length)
+    {
+        const std::size_t skipped = std::min(length, readable());
+        consume(skipped);
+        return skipped;
+    }
+} // namespace common
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace common
+{
+    /*
+     * Fixed capacity lock-free byte ring for exactly one producer thread and one consumer
+     * thread. Indices only grow, the position in the buffer is the index masked with the
+     * power of two capacity.
+     * Overflow policy: a write that does not fit is dropped as a whole (so the stream stays
+     * aligned to samples) and counted, the producer never waits. The consumer may drop the
+     * oldest data itself with skip() to bound its latency.
+     */
+    class SpscByteRing final
+    {
+    public:
+        // capacity is rounded up to the next power of two
+        explicit SpscByteRing(std::size_t capacity);
+
+        SpscByteRing(const SpscByteRing&) = delete;
+        SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+        // producer: false if the data was dropped because it does not fit
+        bool write(const std::uint8_t* data, std::size_t length);
+
+        // consumer: bytes ready to read
+        std::size_t readable() const;
+        // consumer: length bytes at the read position, straight from the ring when they are
+        // contiguous, otherwise copied into scratch. nullptr if fewer bytes are readable.
+        const std::uint8_t* peek(std::size_t length, std::vector<std::uint8_t>& scratch) const;
+        // consumer: release bytes after peek
+        void consume(std::size_t length);
+        // consumer: drop up to length of the oldest bytes, returns the dropped count
+        std::size_t skip(std::size_t length);
+
+        std::size_t capacity() const { return m_buffer.size(); }
+        // most bytes ever waiting in the ring
+        std::size_t highWatermark() const { return m_highWatermark.load(std::memory_order_relaxed); }
+        // bytes rejected by write
+        std::uint64_t droppedBytes() const { return m_droppedBytes.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<std::uint8_t> m_buffer;
+        std::size_t m_mask;
+
+        // written by the consumer, read by the producer
+        alignas(64) std::atomic<std::size_t> m_readIndex{ 0 };
+        // written by the producer, read by the consumer
+        alignas(64) std::atomic<std::size_t> m_writeIndex{ 0 };
+        std::atomic<std::size_t> m_highWatermark{ 0 };
+        std::atomic<std::uint64_t> m_droppedBytes{ 0 };
+    };
+} // namespace common
@@ -3,6 +3,8 @@
 //
 
 #pragma once
+#include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -17,6 +19,11 @@
 #include "timer/TimerService.hpp"
 #include "timer/Timer.hpp"
 
+namespace common
+{
+    class CodeConverter;
+}
+
 namespace endpoints
 {
     using IpEndpoint = boost::asio::ip::detail::endpoint;
@@ -51,6 +58,10 @@ namespace endpoints
         void startDataReceiverThread();
         void receiveDataRoutine();
         void receiveDataFromSocket();
+        // hands every complete message in the receive buffer to the listener
+        void parseMessages();
+        void deliverMessage(const char* data, std::size_t bytes);
+        void resetReceiveBuffer();
 		bool prepareConnect();
         bool connectServer();
         void stopConcreteTimer();
@@ -83,6 +94,16 @@ namespace endpoints
         endpoints::IDataListener& m_dataListener;
         timerservice::TimerService& m_timerService;
         std::unique_ptr<timerservice::Timer> m_concreteTimer;
+
+        // allocated once, a message may span reads, [m_receiveBegin, m_receiveEnd) is not parsed yet
+        std::vector<char> m_receiveBuffer;
+        std::size_t m_receiveBegin{ 0 };
+        std::size_t m_receiveEnd{ 0 };
+        // rest of a message too long for the buffer, skipped as it comes in
+        std::size_t m_discardBytes{ 0 };
+        bool m_discardLine{ false };
+        std::unique_ptr<common::CodeConverter> m_codeConverter;
+        std::vector<char> m_messageBuffer;
 		LinkStatus linkStatus;
     };
 } // namespace cp_nb
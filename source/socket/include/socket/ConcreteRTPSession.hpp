@@ -1,10 +1,25 @@
 #pragma once
 #include "IRTPSession.hpp"
+#include "RTCPStatistics.hpp"
 #include "logger/Logger.hpp"
 #include "Configurations/ParseConfigFile.hpp"
 
 namespace endpoints
 {
+    // jrtplib session handing the report blocks of every RTCP packet it gets to the statistics
+    class RTCPReportSession final : public jrtplib::RTPSession
+    {
+    public:
+        explicit RTCPReportSession(RTCPStatistics& statistics);
+
+    protected:
+        void OnRTCPCompoundPacket(RTCPCompoundPacket* packet, const RTPTime& receiveTime,
+            const RTPAddress* senderAddress) override;
+
+    private:
+        RTCPStatistics& m_statistics;
+    };
+
     class ConcreteRTPSession : public IRTPSession
     {
     public:
@@ -17,10 +32,19 @@ namespace endpoints
         int SendPacket(const std::string& data, const int& len,
             const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
         int sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc) override;
+        int sendPacket(const std::uint8_t* data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
+        int incrementTimestamp(const unsigned long& timestampinc) override;
+        int flushPackets() override;
         int receivePacket(configuration::RTPSessionDatas& rtpSessionData) override;
+        void wakeReceiver() override;
+        std::vector<configuration::RTPNetworkStats> getNetworkStats() const override;
+        bool addDestination(const std::string& ipAddress, int port) override;
+        bool removeDestination(const std::string& ipAddress, int port) override;
 
     private:
         bool setSessionDefault();
+        bool joinMulticastGroup();
         bool addRTPDestination(const RTPIPv4Address& rtpAddress);
         bool deleteRTPDestination(const RTPIPv4Address& rtpAddress);
 
@@ -28,8 +52,16 @@ namespace endpoints
         Logger& m_logger;
         const configuration::AppConfiguration& m_config;
 
-        jrtplib::RTPSession m_rtpSendSession;
-        jrtplib::RTPSession m_rtpReceiveSession;
+        // the reports on the own stream may reach either session, the peer sends its
+        // receiver reports to the remote port like everything else
+        RTCPStatistics m_rtcpStatistics;
+        RTCPReportSession m_rtpSendSession;
+        RTCPReportSession m_rtpReceiveSession;
         jrtplib::RTPUDPv4TransmissionParams m_rtpTransmissionParams;
+
+        // receiver thread
+        common::PacketBufferPool m_packetPool;
+        std::uint64_t m_receivedPackets{ 0 };
+        std::uint64_t m_droppedPackets{ 0 };
     };
 } // namespace endpoints
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "IRTPSession.hpp"
+#include "common/PacketBufferPool.hpp"
+#include "logger/Logger.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+
+namespace endpoints
+{
+    /*
+     * Loss protection around the RTP transport, for both directions. Every packet goes out
+     * as RFC 2198 redundant audio: before the primary payload come copies of the last
+     * redundancyDepth payloads ("red") and, in the packet after every fecGroupSize
+     * packets, their XOR parity as one more block ("xor", the single level scheme of
+     * RFC 5109). The parity rides in the next packet so the sequence numbers stay dense.
+     * A block belongs to the packets right before its carrier: redundant block i of n is
+     * sequence number - (n - i), the parity covers the fecGroupSize numbers before it.
+     * Parity block: protected packet count, then the XOR of marker and payload type, of
+     * the timestamp distance to the carrier, of the payload lengths and of the payloads.
+     * The receive side unpacks the primary payloads and puts back lost packets from the
+     * redundant copies or the parity before the jitter buffer sees the batch.
+     * The send calls belong to one thread, receivePacket() to another.
+     */
+    class FecRTPSession final : public IRTPSession
+    {
+    public:
+        FecRTPSession(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<IRTPSession> session);
+        ~FecRTPSession();
+
+        bool createRTPSession(RTPSessionParams& rtpSessionParams) override;
+        bool startRTPPolling() override;
+        int sendPacket(const std::string& data, const int& len) override;
+        int sendPacket(const std::string& data, const int& len, const unsigned long& timestampinc) override;
+        int SendPacket(const std::string& data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
+        int sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc) override;
+        int sendPacket(const std::uint8_t* data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
+        int incrementTimestamp(const unsigned long& timestampinc) override;
+        int flushPackets() override;
+        int receivePacket(configuration::RTPSessionDatas& rtpSessionData) override;
+        void wakeReceiver() override;
+        std::vector<configuration::RTPNetworkStats> getNetworkStats() const override;
+        bool addDestination(const std::string& ipAddress, int port) override;
+        bool removeDestination(const std::string& ipAddress, int port) override;
+
+    private:
+        struct SentPacket
+        {
+            std::vector<std::uint8_t> payload;
+            std::uint8_t payloadType{ 0 };
+            bool marker{ false };
+            // in the own count from 0, only differences matter
+            std::uint32_t timestamp{ 0 };
+        };
+
+        struct ReceivedPacket
+        {
+            bool valid{ false };
+            std::uint16_t sequenceNumber{ 0 };
+            std::uint8_t payloadType{ 0 };
+            bool marker{ false };
+            std::uint32_t timestamp{ 0 };
+            // kept for the parity only, dropped once no parity can cover it
+            common::PacketSlice payload;
+        };
+
+        struct Parity
+        {
+            std::uint16_t sequenceNumber{ 0 };
+            std::uint32_t timestamp{ 0 };
+            common::PacketSlice block;
+        };
+
+        struct Source
+        {
+            bool started{ false };
+            std::uint16_t highestSequence{ 0 };
+            std::vector<ReceivedPacket> history;
+            // parity blocks still missing more than one packet of their group
+            std::vector<Parity> parities;
+            // receive order of the last packet, the source heard longest ago is evicted first
+            std::uint64_t lastSeen{ 0 };
+        };
+
+        int sendRedundant(const std::uint8_t* data, std::size_t len, std::uint8_t payloadType, bool mark,
+            unsigned long timestampinc);
+        // the sent packet k back, 1 is the last one
+        const SentPacket& getSentPacket(std::size_t back) const;
+        void writeParity(std::uint8_t* block, std::size_t bytes, std::uint32_t timestamp) const;
+
+        // false for a malformed RED payload, rtpSessionData then holds the primary block
+        bool unpackRedundant(configuration::RTPSessionData& rtpSessionData, Source& source);
+        bool isReceived(const Source& source, std::uint16_t sequenceNumber) const;
+        void remember(Source& source, const configuration::RTPSessionData& rtpSessionData);
+        // true when the parity is used up, recovered or not
+        bool recoverParity(Source& source, std::uint32_t ssrc, const Parity& parity);
+        void addRecovered(configuration::RTPSessionData&& rtpSessionData, Source& source);
+
+    private:
+        Logger& m_logger;
+        std::shared_ptr<IRTPSession> m_session;
+        const bool m_parity;
+        const std::size_t m_redundancyDepth;
+        const std::size_t m_groupSize;
+        const std::uint8_t m_redPayloadType;
+        const std::uint8_t m_fecPayloadType;
+
+        // sender thread, the last packets in a ring, consecutive sequence numbers only
+        std::vector<SentPacket> m_sent;
+        std::size_t m_sentNext{ 0 };
+        std::size_t m_sentCount{ 0 };
+        std::size_t m_groupPackets{ 0 };
+        std::uint32_t m_timestamp{ 0 };
+        std::vector<std::uint8_t> m_redPayload;
+        std::uint64_t m_parityBlocks{ 0 };
+
+        // receiver thread, the pool of payloads rebuilt from parity outlives the slices below
+        common::PacketBufferPool m_packetPool;
+        std::map<std::uint32_t, Source> m_sources;
+        std::uint64_t m_sourcePackets{ 0 };
+        configuration::RTPSessionDatas m_recovered;
+        std::uint64_t m_invalidPackets{ 0 };
+
+        mutable std::mutex m_statisticsMutex;
+        std::map<std::uint32_t, std::uint64_t> m_recoveredPackets;
+    };
+
+    // audio.fecMode asks for loss protection: red, xor or red+xor
+    bool isLossProtectionEnabled(const configuration::AppConfiguration& config);
+    // audio.redPayloadType when it is dynamic, 121 otherwise
+    std::uint8_t selectRedPayloadType(const configuration::AppConfiguration& config);
+    // earlier payloads repeated in every packet, 0 when fecMode has no red
+    std::size_t selectRedundancyDepth(const configuration::AppConfiguration& config);
+    // payload type of the parity block, 0 when fecMode has no xor
+    std::uint8_t selectFecPayloadType(const configuration::AppConfiguration& config);
+} // namespace endpoints
@@ -3,7 +3,7 @@
 //
 
 #pragma once
-#include <string>
+#include <boost/utility/string_ref.hpp>
 
 namespace endpoints
 {
@@ -11,6 +11,7 @@ namespace endpoints
     {
     public:
         virtual ~IDataListener() = default;
-        virtual void onDataMessage(const std::string& dataMessage) = 0;
+        // one framed message, the bytes are only valid during the call
+        virtual void onDataMessage(boost::string_ref dataMessage) = 0;
     };
 }
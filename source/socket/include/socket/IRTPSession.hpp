@@ -3,7 +3,10 @@
 #include <jrtplib3/rtppacket.h>
 #include <jrtplib3/rtpsessionparams.h>
 #include <jrtplib3/rtpudpv4transmitter.h>
+#include <memory>
 #include "Configurations/Configurations.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+#include "logger/Logger.hpp"
 
 namespace endpoints
 {
@@ -20,8 +23,28 @@ namespace endpoints
         virtual int SendPacket(const std::string& data, const int& len,
             const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) = 0;
         virtual int sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc) = 0;
+        virtual int sendPacket(const std::uint8_t* data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) = 0;
+        // advance the timestamp for suppressed audio without sending
+        virtual int incrementTimestamp(const unsigned long& timestampinc) = 0;
+        // hand queued packets to the network, the sender calls it after each burst
+        virtual int flushPackets() = 0;
         virtual int receivePacket(configuration::RTPSessionDatas& rtpSessionData) = 0;
+        // returns a receivePacket() waiting for data, so the receive thread sees its stop; any thread
+        virtual void wakeReceiver() = 0;
+        // RTCP statistics per SSRC, any thread
+        virtual std::vector<configuration::RTPNetworkStats> getNetworkStats() const = 0;
+        // listeners of the sent stream besides the configured ones, any thread, a multicast group works too
+        virtual bool addDestination(const std::string& ipAddress, int port) = 0;
+        virtual bool removeDestination(const std::string& ipAddress, int port) = 0;
 
         virtual ~IRTPSession() = default;
     };
+
+    /*
+     * The RTP session of rtp.transport: "udp" runs on UdpRTPSession with batched
+     * sendmmsg/recvmmsg, anything else on the jrtplib ConcreteRTPSession. With an
+     * audio.fecMode it is wrapped in a FecRTPSession.
+     */
+    std::shared_ptr<IRTPSession> createRTPTransport(Logger& logger, const configuration::AppConfiguration& config);
 } // namespace endpoints
\ No newline at end of file
@@ -3,6 +3,7 @@
 //
 
 #pragma once
+#include <sys/eventfd.h>
 
 namespace endpoints
 {
@@ -17,10 +18,16 @@ namespace endpoints
         virtual int wrapper_tcp_connect(int, struct sockaddr*, socklen_t) = 0;
         virtual int wrapper_tcp_sendmsg(int sockfd, struct msghdr* msg, int flags) = 0;
         virtual int wrapper_tcp_recvmsg(int sockfd, struct msghdr* msg, int flags) = 0;
+        virtual int wrapper_udp_sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) = 0;
+        virtual int wrapper_udp_recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+            struct timespec* timeout) = 0;
         virtual int wrapper_fcntl(int, int, long) = 0;
         virtual int wrapper_epoll_create(int) = 0;
         virtual int wrapper_epoll_ctl(int, int, int, struct epoll_event*) = 0;
         virtual int wrapper_epoll_wait(int, struct epoll_event*, int, int) = 0;
+        virtual int wrapper_eventfd(unsigned int, int) = 0;
+        virtual int wrapper_eventfd_read(int, eventfd_t*) = 0;
+        virtual int wrapper_eventfd_write(int, eventfd_t) = 0;
 
         virtual ~ISocketSysCall() = default;
     };
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Configurations/Configurations.hpp"
+
+namespace endpoints
+{
+    /*
+     * RTCP statistics of a session, RFC 3550 6.4 and A.1-A.8, without a thread of its own.
+     * The receive path hands in every RTP packet (sequence tracking, cumulative and
+     * interval loss, interarrival jitter) and every sender report (LSR for the own
+     * receiver reports); report blocks on the own sender SSRC give the far end view of
+     * the own stream and the round trip time from LSR/DLSR.
+     * onPacket(), onSenderReport(), update() and getReportBlocks() belong to the receive
+     * thread, onReportBlock() and getNetworkStats() may be called from any thread.
+     */
+    class RTCPStatistics final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct ReportBlock
+        {
+            std::uint32_t ssrc{ 0 };
+            // fixed point, lost / expected * 256
+            std::uint8_t fractionLost{ 0 };
+            std::int32_t cumulativeLost{ 0 };
+            std::uint32_t extendedHighestSequence{ 0 };
+            // timestamp units
+            std::uint32_t jitter{ 0 };
+            // middle 32 bits of the NTP time of the last sender report, and 1/65536 s since
+            std::uint32_t lastSenderReport{ 0 };
+            std::uint32_t delaySinceLastSenderReport{ 0 };
+        };
+
+        RTCPStatistics();
+
+        // the sender SSRC the far end reports on
+        void setOwnSSRC(std::uint32_t ssrc) { m_ownSsrc = ssrc; }
+        // seconds per RTP timestamp unit, before packets arrive
+        void setTimestampUnit(double timestampUnit) { m_timestampUnit = timestampUnit; }
+
+        // arrivalSeconds from any fixed epoch
+        void onPacket(std::uint32_t ssrc, std::uint16_t sequenceNumber, std::uint32_t timestamp, double arrivalSeconds);
+        void onSenderReport(std::uint32_t ssrc, std::uint32_t ntpMiddle, Clock::time_point arrival);
+        // a block of the sender or receiver report of reporterSsrc, arrival as NTP middle 32 bits
+        void onReportBlock(std::uint32_t reporterSsrc, const ReportBlock& block, std::uint32_t arrivalNtpMiddle);
+
+        // closes the report interval when it is due, true then
+        bool update(Clock::time_point now);
+        // report blocks on the sources of the last interval, at most maxBlocks
+        std::size_t getReportBlocks(ReportBlock* blocks, std::size_t maxBlocks, Clock::time_point now) const;
+        // as of the last update and the last report of every SSRC
+        std::vector<configuration::RTPNetworkStats> getNetworkStats() const;
+
+        // NTP seconds and fraction of time, and the middle 32 bits of that
+        static std::uint64_t getNtpTime(std::chrono::system_clock::time_point time);
+        static std::uint32_t getNtpMiddle(std::chrono::system_clock::time_point time);
+
+    private:
+        struct Source
+        {
+            std::uint16_t maxSequence{ 0 };
+            std::uint32_t cycles{ 0 };
+            std::uint32_t baseSequence{ 0 };
+            std::uint32_t badSequence{ 0 };
+            std::uint64_t received{ 0 };
+            std::uint64_t expectedPrior{ 0 };
+            std::uint64_t receivedPrior{ 0 };
+            std::uint8_t fractionLost{ 0 };
+            bool haveTransit{ false };
+            double transit{ 0.0 };
+            // timestamp units
+            double jitter{ 0.0 };
+            std::uint32_t lastSenderReport{ 0 };
+            Clock::time_point senderReportArrival{};
+            Clock::time_point lastPacket{};
+        };
+
+        struct Report
+        {
+            std::uint64_t count{ 0 };
+            ReportBlock block;
+            double roundTripMs{ 0.0 };
+        };
+
+        static void initSequence(Source& source, std::uint16_t sequenceNumber);
+        static std::uint32_t getExtendedSequence(const Source& source);
+        static std::int64_t getLost(const Source& source);
+
+    private:
+        std::atomic<std::uint32_t> m_ownSsrc{ 0 };
+        double m_timestampUnit{ 0.0 };
+
+        // receive thread
+        std::map<std::uint32_t, Source> m_sources;
+        Clock::time_point m_nextUpdate;
+
+        mutable std::mutex m_mutex;
+        std::vector<configuration::RTPNetworkStats> m_published;
+        std::map<std::uint32_t, Report> m_reports;
+    };
+} // namespace endpoints
@@ -4,6 +4,7 @@
 
 #pragma once
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -31,9 +32,15 @@ namespace endpoints
         int wrapper_tcp_connect(int, struct sockaddr*, socklen_t) override;
         int wrapper_tcp_sendmsg(int sockfd, struct msghdr* msg, int flags) override;
         int wrapper_tcp_recvmsg(int sockfd, struct msghdr* msg, int flags) override;
+        int wrapper_udp_sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) override;
+        int wrapper_udp_recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+            struct timespec* timeout) override;
         int wrapper_fcntl(int, int, long) override;
         int wrapper_epoll_create(int) override;
         int wrapper_epoll_ctl(int, int, int, struct epoll_event*) override;
         int wrapper_epoll_wait(int, struct epoll_event*, int, int) override;
+        int wrapper_eventfd(unsigned int, int) override;
+        int wrapper_eventfd_read(int, eventfd_t*) override;
+        int wrapper_eventfd_write(int, eventfd_t) override;
     };
 }
@@ -0,0 +1,142 @@
+#pragma once
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "IRTPSession.hpp"
+#include "ISocketSysCall.hpp"
+#include "RTCPStatistics.hpp"
+#include "logger/Logger.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+
+namespace endpoints
+{
+    /*
+     * IRTPSession on plain non-blocking UDP sockets, without the per packet polling of
+     * jrtplib. The ports are those of the jrtplib session: the sender on localSendRTPPort,
+     * the receiver on localReceiveRTPPort, packets go to remoteRTPPort, RTCP one port up.
+     * sendPacket() only queues, the queue leaves with one sendmmsg() on flushPackets() or
+     * when it is full. Every packet is built once and goes to all destinations in that
+     * sendmmsg(), the configured ones, a multicast group or listeners added at runtime;
+     * each destination may have a rate cap, packets over it are not sent there. receivePacket() takes every waiting datagram with recvmmsg() straight
+     * into pooled buffers, parses the RTP header in place and hands the payload on as a
+     * slice of the buffer; it sleeps in epoll until the next datagram or wakeReceiver().
+     * RTCP: a sender report with CNAME every few seconds from the sender; the receiver
+     * keeps RTCPStatistics and sends its receiver reports back to where the sender
+     * reports of the remote come from.
+     * The send calls belong to one thread, receivePacket() to another.
+     */
+    class UdpRTPSession final : public IRTPSession
+    {
+    public:
+        UdpRTPSession(Logger& logger, const configuration::AppConfiguration& config,
+            std::unique_ptr<ISocketSysCall> socketSysCall);
+        ~UdpRTPSession();
+
+        bool createRTPSession(RTPSessionParams& rtpSessionParams) override;
+        bool startRTPPolling() override;
+        int sendPacket(const std::string& data, const int& len) override;
+        int sendPacket(const std::string& data, const int& len, const unsigned long& timestampinc) override;
+        int SendPacket(const std::string& data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
+        int sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc) override;
+        int sendPacket(const std::uint8_t* data, const int& len,
+            const unsigned char& pt, const bool& mark, const unsigned long& timestampinc) override;
+        int incrementTimestamp(const unsigned long& timestampinc) override;
+        int flushPackets() override;
+        int receivePacket(configuration::RTPSessionDatas& rtpSessionData) override;
+        void wakeReceiver() override;
+        std::vector<configuration::RTPNetworkStats> getNetworkStats() const override;
+        bool addDestination(const std::string& ipAddress, int port) override;
+        bool removeDestination(const std::string& ipAddress, int port) override;
+
+    private:
+        struct Destination
+        {
+            sockaddr_in address{};
+            sockaddr_in controlAddress{};
+            // token bucket of the rate cap in bytes
+            double credit{ 0.0 };
+            std::chrono::steady_clock::time_point refillTime{};
+        };
+
+        int openSocket(int port);
+        bool watchSocket(int socket);
+        void closeSockets();
+        bool setMulticastOptions();
+
+        int queuePacket(const std::uint8_t* data, std::size_t len, std::uint8_t payloadType, bool mark,
+            unsigned long timestampinc);
+        // both with m_destinationMutex held
+        std::size_t addPacketMessages(Destination& destination, std::size_t messages,
+            std::chrono::steady_clock::time_point now);
+        void sendSenderReport();
+        // datagrams read from socket, parsed into rtpSessionDatas when given
+        int receiveBatch(int socket, configuration::RTPSessionDatas* rtpSessionDatas);
+        // receive slots with a buffer in front, refilled from the pool
+        std::size_t refillReceiveSlots();
+        // the payload slice takes over the reference of buffer on success
+        bool parsePacket(common::PacketBuffer* buffer, std::size_t bytes, configuration::RTPSessionData& rtpSessionData) const;
+        // RTCP compound packet from source
+        void parseControlPacket(const std::uint8_t* packet, std::size_t bytes, const sockaddr_in& source);
+        void addReportDestination(const sockaddr_in& source);
+        void sendReceiverReports(std::chrono::steady_clock::time_point now);
+
+    private:
+        Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
+        std::unique_ptr<ISocketSysCall> m_socketSysCall;
+
+        int m_sendSocket{ -1 };
+        int m_sendControlSocket{ -1 };
+        int m_receiveSocket{ -1 };
+        int m_receiveControlSocket{ -1 };
+        int m_epoll{ -1 };
+        // eventfd in the epoll set, written by wakeReceiver()
+        int m_wakeEvent{ -1 };
+
+        // added and removed from any thread, used by the sender
+        std::mutex m_destinationMutex;
+        std::vector<Destination> m_destinations;
+        // rtp.destinationMaxKbps, 0 without a cap
+        double m_maxBytesPerSecond{ 0.0 };
+        std::uint64_t m_pacedPackets{ 0 };
+
+        // sender thread
+        std::uint32_t m_ssrc{ 0 };
+        std::uint16_t m_sequenceNumber{ 0 };
+        std::uint32_t m_timestamp{ 0 };
+        double m_timestampUnit{ 0.0 };
+        std::vector<std::uint8_t> m_sendBuffers;
+        std::vector<iovec> m_sendVectors;
+        // every pending packet once per destination
+        std::vector<mmsghdr> m_sendMessages;
+        std::size_t m_pendingPackets{ 0 };
+        std::uint32_t m_sentPackets{ 0 };
+        std::uint32_t m_sentOctets{ 0 };
+        std::uint32_t m_lastTimestamp{ 0 };
+        std::chrono::steady_clock::time_point m_lastSendTime{};
+        std::chrono::steady_clock::time_point m_nextSenderReport{};
+        std::uint64_t m_sendCalls{ 0 };
+        std::uint64_t m_droppedPackets{ 0 };
+
+        // receiver thread, the pool outlives the slots holding its buffers
+        common::PacketBufferPool m_packetPool;
+        std::vector<common::PacketBuffer*> m_receiveSlots;
+        std::vector<sockaddr_in> m_receiveAddresses;
+        std::uint32_t m_receiverSsrc{ 0 };
+        RTCPStatistics m_rtcpStatistics;
+        std::vector<sockaddr_in> m_reportDestinations;
+        std::vector<iovec> m_receiveVectors;
+        std::vector<mmsghdr> m_receiveMessages;
+        std::uint64_t m_receiveCalls{ 0 };
+        std::uint64_t m_receivedPackets{ 0 };
+        std::uint64_t m_invalidPackets{ 0 };
+        std::uint64_t m_poolExhausted{ 0 };
+        std::uint64_t m_controlPackets{ 0 };
+        std::uint64_t m_wakeups{ 0 };
+    };
+} // namespace endpoints
@@ -1,6 +1,8 @@
 //
 // Created by junshen on 9/29/18.
 //
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <sys/socket.h>
 #include <sys/epoll.h>
@@ -18,7 +20,10 @@ namespace endpoints
 {
     namespace
     {
-        constexpr uint32_t BUFFER_SIZE = 64 * 1024;
+        // length framing header, also room for the \r\n of line framing
+        constexpr std::size_t lengthHeaderBytes = 4;
+        // gb2312 needs up to 3 utf-8 bytes for 2
+        constexpr std::size_t convertedBytesFactor = 2;
         std::atomic_bool keep_connect(true);
     } // namespace
 
@@ -81,6 +86,9 @@ namespace endpoints
     , m_localAddr{createServerAdd(appAddress.kitokeiLocalAddress, appAddress.kitokeiLocalPort)}
     , m_dataListener{dataListener}
     , m_timerService{timerService}
+    , m_receiveBuffer(tcpConfiguration.maxMessageBytes + lengthHeaderBytes)
+    , m_codeConverter{std::make_unique<common::CodeConverter>("gb2312", "utf-8//TRANSLIT//IGNORE")}
+    , m_messageBuffer(tcpConfiguration.maxMessageBytes * convertedBytesFactor)
 	, linkStatus(eLinkStatus::LINK_STATUS_INIT)
     {
         LOG_INFO_MSG(m_logger, "Createing tcp endpoint to {} : {}",
@@ -297,35 +305,23 @@ namespace endpoints
 
     void ClientSocket::receiveDataFromSocket()
     {
-        struct msghdr msg;
-        msg.msg_name = nullptr;
+        struct msghdr msg {};
         struct iovec io; // return data
-        std::vector<uint8_t> receiveDataBuffer(BUFFER_SIZE);
-        io.iov_base = receiveDataBuffer.data();
-        io.iov_len = BUFFER_SIZE;
+        io.iov_base = m_receiveBuffer.data() + m_receiveEnd;
+        io.iov_len = m_receiveBuffer.size() - m_receiveEnd;
         msg.msg_iov = &io;
         msg.msg_iovlen = 1;
-#ifdef RUN_IN_ARM
-        const unsigned int size = m_socketSysCall.wrapper_tcp_recvmsg(m_socketfId, &msg, 0);
-#else
-        const uint64_t size = m_socketSysCall.wrapper_tcp_recvmsg(m_socketfId, &msg, 0);
-#endif
-        if(size >= static_cast<int>(BUFFER_SIZE))
+        const int size = m_socketSysCall.wrapper_tcp_recvmsg(m_socketfId, &msg, 0);
+        if (0 > size and (EAGAIN == errno or EWOULDBLOCK == errno))
         {
-            LOG_ERROR_MSG("Exceed maximum buffer size.");
             return;
         }
         if(size > 0)
         {
             LOG_INFO_MSG(m_logger, "Received {} bytes from {} : {}", size,
                          m_endpointAddress.ipAddress, m_endpointAddress.portNumber);
-
-            common::CodeConverter codeConverter("gb2312", "utf-8//TRANSLIT//IGNORE");
-            std::shared_ptr<char*> dataBuffer = std::make_shared<char*>(new char[size * 2 + 1]);
-            memset(*dataBuffer, 0 , size * 2 + 1);
-
-            codeConverter.decodeCoverter(reinterpret_cast<char*>(receiveDataBuffer.data()), size, *dataBuffer, (size * 2 + 1));
-            m_dataListener.onDataMessage(*dataBuffer);
+            m_receiveEnd += static_cast<std::size_t>(size);
+            parseMessages();
         }
         else
         {
@@ -342,6 +338,111 @@ namespace endpoints
         }
     }
 
+    void ClientSocket::parseMessages()
+    {
+        const char* data = m_receiveBuffer.data();
+        switch (m_tcpConfiguration.messageFraming)
+        {
+        case configuration::MessageFraming::MESSAGE_FRAMING_LINE:
+            while (m_receiveBegin < m_receiveEnd)
+            {
+                const char* lineEnd = static_cast<const char*>(
+                    memchr(data + m_receiveBegin, '\n', m_receiveEnd - m_receiveBegin));
+                if (nullptr == lineEnd)
+                {
+                    break;
+                }
+                std::size_t bytes = static_cast<std::size_t>(lineEnd - data) - m_receiveBegin;
+                if (0 < bytes and '\r' == data[m_receiveBegin + bytes - 1])
+                {
+                    --bytes;
+                }
+                if (not m_discardLine)
+                {
+                    deliverMessage(data + m_receiveBegin, bytes);
+                }
+                m_discardLine = false;
+                m_receiveBegin = static_cast<std::size_t>(lineEnd - data) + 1;
+            }
+            if (0 == m_receiveBegin and m_receiveBuffer.size() == m_receiveEnd)
+            {
+                if (not m_discardLine)
+                {
+                    LOG_WARNING_MSG("Drop tcp message longer than {} bytes.", m_tcpConfiguration.maxMessageBytes);
+                }
+                m_discardLine = true;
+                m_receiveEnd = 0;
+            }
+            break;
+        case configuration::MessageFraming::MESSAGE_FRAMING_LENGTH:
+            while (m_receiveBegin < m_receiveEnd)
+            {
+                if (0 < m_discardBytes)
+                {
+                    const std::size_t skipped = std::min(m_discardBytes, m_receiveEnd - m_receiveBegin);
+                    m_discardBytes -= skipped;
+                    m_receiveBegin += skipped;
+                    continue;
+                }
+                if (lengthHeaderBytes > m_receiveEnd - m_receiveBegin)
+                {
+                    break;
+                }
+                const unsigned char* header = reinterpret_cast<const unsigned char*>(data + m_receiveBegin);
+                const std::size_t bytes = (static_cast<std::size_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+                if (m_tcpConfiguration.maxMessageBytes < bytes)
+                {
+                    LOG_WARNING_MSG("Drop tcp message of {} bytes, longer than {}.", bytes, m_tcpConfiguration.maxMessageBytes);
+                    m_discardBytes = bytes;
+                    m_receiveBegin += lengthHeaderBytes;
+                    continue;
+                }
+                if (lengthHeaderBytes + bytes > m_receiveEnd - m_receiveBegin)
+                {
+                    break;
+                }
+                deliverMessage(data + m_receiveBegin + lengthHeaderBytes, bytes);
+                m_receiveBegin += lengthHeaderBytes + bytes;
+            }
+            break;
+        default:
+            deliverMessage(data, m_receiveEnd);
+            m_receiveBegin = m_receiveEnd;
+            break;
+        }
+
+        // the start of the next message moves to the front, it is shorter than one message
+        if (0 < m_receiveBegin)
+        {
+            memmove(m_receiveBuffer.data(), data + m_receiveBegin, m_receiveEnd - m_receiveBegin);
+            m_receiveEnd -= m_receiveBegin;
+            m_receiveBegin = 0;
+        }
+    }
+
+    void ClientSocket::deliverMessage(const char* data, std::size_t bytes)
+    {
+        if (0 == bytes)
+        {
+            return;
+        }
+        if (m_tcpConfiguration.maxMessageBytes < bytes)
+        {
+            LOG_WARNING_MSG("Drop tcp message of {} bytes, longer than {}.", bytes, m_tcpConfiguration.maxMessageBytes);
+            return;
+        }
+        const std::size_t converted = m_codeConverter->convert(data, bytes, m_messageBuffer.data(), m_messageBuffer.size());
+        m_dataListener.onDataMessage(boost::string_ref(m_messageBuffer.data(), converted));
+    }
+
+    void ClientSocket::resetReceiveBuffer()
+    {
+        m_receiveBegin = 0;
+        m_receiveEnd = 0;
+        m_discardBytes = 0;
+        m_discardLine = false;
+    }
+
     void ClientSocket::processSocketState(const tcp_info& info)
     {
         if(TCP_CLOSE_WAIT == info.tcpi_state)
@@ -349,6 +450,8 @@ namespace endpoints
             m_socketSysCall.wrapper_close(m_socketfId);
             m_socketClosed = true;
             LOG_DEBUG_MSG("Socket {} close.", m_socketfId);
+            // a new connection does not continue the old stream
+            resetReceiveBuffer();
 
             createTcpSocket(m_localAddr);
             setTcpSocketOptions(m_socketfId, m_tcpConfiguration);
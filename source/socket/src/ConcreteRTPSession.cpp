@@ -1,23 +1,107 @@
+#include <netinet/in.h>
+#include <algorithm>
+#include <jrtplib3/rtcpcompoundpacket.h>
+#include <jrtplib3/rtcpsrpacket.h>
+#include <jrtplib3/rtcprrpacket.h>
 #include "socket/ConcreteRTPSession.hpp"
+#include "socket/UdpRTPSession.hpp"
+#include "socket/FecRTPSession.hpp"
+#include "socket/SocketSysCall.hpp"
 #include "common/CommonFunction.hpp"
 
 namespace
 {
     constexpr int AudioPayloadType = 97;
+    constexpr long ReceiveWaitMicroseconds = 2000;
+    // received payloads in flight between the session and the decoder
+    constexpr std::size_t PacketPoolBuffers = 256;
+    constexpr std::size_t PacketPoolBufferBytes = 1500;
+
+    // SR and RR share the accessors of the report blocks
+    template <typename ReportPacket>
+    void readReportBlocks(endpoints::RTCPStatistics& statistics, std::uint32_t reporterSsrc, ReportPacket& packet,
+        std::uint32_t arrivalNtpMiddle)
+    {
+        for (int i = 0; i < packet.GetReceptionReportCount(); ++i)
+        {
+            endpoints::RTCPStatistics::ReportBlock block;
+            block.ssrc = packet.GetSSRC(i);
+            block.fractionLost = packet.GetFractionLost(i);
+            block.cumulativeLost = packet.GetLostPacketCount(i);
+            block.extendedHighestSequence = packet.GetExtendedHighestSequenceNumber(i);
+            block.jitter = packet.GetJitter(i);
+            block.lastSenderReport = packet.GetLSR(i);
+            block.delaySinceLastSenderReport = packet.GetDLSR(i);
+            statistics.onReportBlock(reporterSsrc, block, arrivalNtpMiddle);
+        }
+    }
 } // namespace
 namespace endpoints
 {
     using namespace jrtplib;
 
+    std::shared_ptr<IRTPSession> createRTPTransport(Logger& logger, const configuration::AppConfiguration& config)
+    {
+        std::shared_ptr<IRTPSession> session;
+        if ("udp" == rtp::getRTPTransport(config))
+        {
+            session = std::make_shared<UdpRTPSession>(logger, config, std::make_unique<SocketSysCall>());
+        }
+        else
+        {
+            session = std::make_shared<ConcreteRTPSession>(logger, config);
+        }
+
+        if (isLossProtectionEnabled(config))
+        {
+            return std::make_shared<FecRTPSession>(logger, config, std::move(session));
+        }
+        if ("none" != audio::getFecMode(config))
+        {
+            LOG_WARNING_MSG("Unknown fec mode {}, send without loss protection.", audio::getFecMode(config));
+        }
+        return session;
+    }
+
+    RTCPReportSession::RTCPReportSession(RTCPStatistics& statistics)
+        : m_statistics{ statistics }
+    {
+    }
+
+    void RTCPReportSession::OnRTCPCompoundPacket(RTCPCompoundPacket* packet, const RTPTime&, const RTPAddress*)
+    {
+        // runs in the jrtplib poll, right after the packet arrived
+        const std::uint32_t arrivalNtpMiddle = RTCPStatistics::getNtpMiddle(std::chrono::system_clock::now());
+        packet->GotoFirstPacket();
+        while (RTCPPacket* rtcpPacket = packet->GetNextPacket())
+        {
+            if (RTCPPacket::SR == rtcpPacket->GetPacketType())
+            {
+                RTCPSRPacket* senderReport = static_cast<RTCPSRPacket*>(rtcpPacket);
+                readReportBlocks(m_statistics, senderReport->GetSenderSSRC(), *senderReport, arrivalNtpMiddle);
+            }
+            else if (RTCPPacket::RR == rtcpPacket->GetPacketType())
+            {
+                RTCPRRPacket* receiverReport = static_cast<RTCPRRPacket*>(rtcpPacket);
+                readReportBlocks(m_statistics, receiverReport->GetSSRC(), *receiverReport, arrivalNtpMiddle);
+            }
+        }
+    }
+
     ConcreteRTPSession::ConcreteRTPSession(Logger& logger, const configuration::AppConfiguration& config)
         : m_logger{logger}
         , m_config{config}
+        , m_rtpSendSession{ m_rtcpStatistics }
+        , m_rtpReceiveSession{ m_rtcpStatistics }
+        , m_packetPool{ PacketPoolBuffers, PacketPoolBufferBytes }
     {
 
     }
 
     ConcreteRTPSession::~ConcreteRTPSession()
     {
+        LOG_INFO_MSG(m_logger, "RTP received {} packets, dropped {} without a free buffer, at most {} of {} buffers in use.",
+            m_receivedPackets, m_droppedPackets, m_packetPool.highWatermark(), m_packetPool.buffers());
         m_rtpSendSession.Destroy();
         m_rtpReceiveSession.Destroy();
     }
@@ -44,6 +128,7 @@ namespace endpoints
         /* Now, we'll create a RTP session, set the destination, send some
         * packets and poll for incoming data. */
         m_rtpTransmissionParams.SetPortbase(rtp::getRTPLocalSendPort(m_config));
+        m_rtpTransmissionParams.SetMulticastTTL(static_cast<uint8_t>(std::min(std::max(rtp::getMulticastTtl(m_config), 1), 255)));
         rtpSessionParams.SetCNAME("sender@host");
 
         int errCode = m_rtpSendSession.Create(rtpSessionParams, &m_rtpTransmissionParams);
@@ -62,12 +147,88 @@ namespace endpoints
             LOG_ERROR_MSG("RTP receive session create fail {}", RTPGetErrorString(errCode));
             return false;
         }
-        
+        m_rtcpStatistics.setOwnSSRC(m_rtpSendSession.GetLocalSSRC());
+        m_rtcpStatistics.setTimestampUnit(rtpSessionParams.GetOwnTimestampUnit());
+
         LOG_INFO_MSG(m_logger, "Create RTP session success, sender SSRC is: {}, receiver SSRC is: {}.", 
             m_rtpSendSession.GetLocalSSRC(), m_rtpReceiveSession.GetLocalSSRC());
 
         RTPIPv4Address rtpAddr(destIp, rtp::getRTPRemotePort(m_config));
         addRTPDestination(rtpAddr);
+        for (const auto& destination : rtp::getRTPDestinations(m_config))
+        {
+            addDestination(destination.first, destination.second);
+        }
+        if (0 < rtp::getDestinationMaxKbps(m_config))
+        {
+            LOG_WARNING_MSG("RTP destination rate cap needs rtp.transport udp, jrtplib sends everything.");
+        }
+        return joinMulticastGroup();
+    }
+
+    bool ConcreteRTPSession::joinMulticastGroup()
+    {
+        const std::string group = rtp::getMulticastGroup(m_config);
+        if (group.empty())
+        {
+            return true;
+        }
+        const uint32_t groupIp = inet_addr(group.c_str());
+        if (INADDR_NONE == groupIp or not IN_MULTICAST(ntohl(groupIp)))
+        {
+            LOG_ERROR_MSG("Bad multicast group {}.", group);
+            return false;
+        }
+        if (not m_rtpReceiveSession.SupportsMulticasting())
+        {
+            LOG_ERROR_MSG("RTP receive session can not join multicast group {}, jrtplib built without multicast.", group);
+            return false;
+        }
+        int errCode = m_rtpReceiveSession.JoinMulticastGroup(RTPIPv4Address(ntohl(groupIp), 0));
+        if (errCode < 0)
+        {
+            LOG_ERROR_MSG("Join multicast group {} fail {}", group, RTPGetErrorString(errCode));
+            return false;
+        }
+        LOG_INFO_MSG(m_logger, "RTP receiver joined multicast group {}.", group);
+        return true;
+    }
+
+    bool ConcreteRTPSession::addDestination(const std::string& ipAddress, int port)
+    {
+        const uint32_t destIp = inet_addr(ipAddress.c_str());
+        if (INADDR_NONE == destIp or 0 >= port or 65535 < port)
+        {
+            LOG_ERROR_MSG("Bad RTP destination {}:{}.", ipAddress, port);
+            return false;
+        }
+        // the sender only, the receiver reports stay with the configured remote; jrtplib
+        // builds each packet once and locks its destination table
+        int errCode = m_rtpSendSession.AddDestination(RTPIPv4Address(ntohl(destIp), static_cast<uint16_t>(port)));
+        if (errCode < 0)
+        {
+            LOG_ERROR_MSG("Add RTP destination {}:{} fail {}", ipAddress, port, RTPGetErrorString(errCode));
+            return false;
+        }
+        LOG_INFO_MSG(m_logger, "RTP destination {}:{} added.", ipAddress, port);
+        return true;
+    }
+
+    bool ConcreteRTPSession::removeDestination(const std::string& ipAddress, int port)
+    {
+        const uint32_t destIp = inet_addr(ipAddress.c_str());
+        if (INADDR_NONE == destIp or 0 >= port or 65535 < port)
+        {
+            LOG_ERROR_MSG("Bad RTP destination {}:{}.", ipAddress, port);
+            return false;
+        }
+        int errCode = m_rtpSendSession.DeleteDestination(RTPIPv4Address(ntohl(destIp), static_cast<uint16_t>(port)));
+        if (errCode < 0)
+        {
+            LOG_WARNING_MSG("Remove RTP destination {}:{} fail {}", ipAddress, port, RTPGetErrorString(errCode));
+            return false;
+        }
+        LOG_INFO_MSG(m_logger, "RTP destination {}:{} removed.", ipAddress, port);
         return true;
     }
 
@@ -136,6 +297,17 @@ namespace endpoints
         return errCode;
     }
 
+    int ConcreteRTPSession::sendPacket(const std::uint8_t* data, const int& len,
+        const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
+    {
+        int errCode = m_rtpSendSession.SendPacket(data, len, pt, mark, timestampinc);
+        if (errCode < 0)
+        {
+            LOG_ERROR_MSG("Send RTP packet size {} fail {}", len, RTPGetErrorString(errCode));
+        }
+        return errCode;
+    }
+
     int ConcreteRTPSession::SendPacket(const std::string& data, const int& len, 
         const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
     {
@@ -147,6 +319,27 @@ namespace endpoints
         return errCode;
     }
 
+    int ConcreteRTPSession::incrementTimestamp(const unsigned long& timestampinc)
+    {
+        int errCode = m_rtpSendSession.IncrementTimestamp(timestampinc);
+        if (errCode < 0)
+        {
+            LOG_ERROR_MSG("Increment RTP timestamp {} fail {}", timestampinc, RTPGetErrorString(errCode));
+        }
+        return errCode;
+    }
+
+    std::vector<configuration::RTPNetworkStats> ConcreteRTPSession::getNetworkStats() const
+    {
+        return m_rtcpStatistics.getNetworkStats();
+    }
+
+    int ConcreteRTPSession::flushPackets()
+    {
+        // jrtplib sends every packet at once
+        return 0;
+    }
+
     int ConcreteRTPSession::receivePacket(configuration::RTPSessionDatas& rtpSessionDatas)
     {
         int packetReceived = 0;
@@ -159,14 +352,27 @@ namespace endpoints
                 RTPPacket* packet;
                 while ((packet = m_rtpReceiveSession.GetNextPacket()) != 0)
                 {
-                    LOG_DEBUG_MSG("Got packet {}, payload length {} with extended sequence number {} from SSRC {}.",
-                        packet->GetPacketLength(), packet->GetPayloadLength(), packet->GetExtendedSequenceNumber(), packet->GetSSRC());
-                    configuration::RTPSessionData rtpSessionData;
+                    // jrtplib owns the packet, its payload is copied once into a pooled buffer
+                    const std::size_t payloadLength = packet->GetPayloadLength();
+                    common::PacketBuffer* buffer = payloadLength <= m_packetPool.bufferBytes() ? m_packetPool.acquire() : nullptr;
+                    if (nullptr == buffer)
+                    {
+                        m_rtpReceiveSession.DeletePacket(packet);
+                        m_droppedPackets++;
+                        continue;
+                    }
+                    memcpy(buffer->data, packet->GetPayloadData(), payloadLength);
+
+                    rtpSessionDatas.emplace_back();
+                    configuration::RTPSessionData& rtpSessionData = rtpSessionDatas.back();
+                    rtpSessionData.payloadDatas = common::PacketSlice(buffer, 0, payloadLength);
                     rtpSessionData.timestamp = packet->GetTimestamp();
                     rtpSessionData.sequenceNumber = packet->GetSequenceNumber();
-                    rtpSessionData.payloadDatas.resize(packet->GetPayloadLength());
-                    memcpy(&rtpSessionData.payloadDatas[0], packet->GetPayloadData(), packet->GetPayloadLength());
-                    rtpSessionDatas.push(rtpSessionData);
+                    rtpSessionData.payloadType = packet->GetPayloadType();
+                    rtpSessionData.marker = packet->HasMarker();
+                    rtpSessionData.ssrc = packet->GetSSRC();
+                    m_rtcpStatistics.onPacket(rtpSessionData.ssrc, rtpSessionData.sequenceNumber, rtpSessionData.timestamp,
+                        packet->GetReceiveTime().GetDouble());
 
                     m_rtpReceiveSession.DeletePacket(packet);
                     ++packetReceived;
@@ -175,9 +381,17 @@ namespace endpoints
         }
 
         m_rtpReceiveSession.EndDataAccess();
+        m_receivedPackets += static_cast<std::uint64_t>(packetReceived);
+        // jrtplib builds the receiver reports itself
+        m_rtcpStatistics.update(RTCPStatistics::Clock::now());
         if (packetReceived <= 0)
         {
-            RTPTime::Wait(RTPTime(0, 10));
+#ifndef RTP_SUPPORT_THREAD
+            // sleep in the socket until the next packet instead of spinning
+            m_rtpReceiveSession.WaitForIncomingData(RTPTime(0, ReceiveWaitMicroseconds));
+#else
+            RTPTime::Wait(RTPTime(0, ReceiveWaitMicroseconds));
+#endif // RTP_SUPPORT_THREAD
         }
         return packetReceived;
     }
@@ -211,6 +425,11 @@ namespace endpoints
         return true;
     }
 
+    void ConcreteRTPSession::wakeReceiver()
+    {
+        // receivePacket() only takes what Poll() already received, it never waits
+    }
+
     bool ConcreteRTPSession::startRTPPolling()
     {
 #ifndef RTP_SUPPORT_THREAD
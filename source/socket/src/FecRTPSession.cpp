@@ -0,0 +1,598 @@
+#include <algorithm>
+#include <cstring>
+#include "socket/FecRTPSession.hpp"
+#include "common/CommonFunction.hpp"
+
+namespace
+{
+    // jrtplib packets are at most 1400 bytes with the 12 byte header
+    constexpr std::size_t maxPayloadBytes = 1388;
+    // RFC 2198: F bit and payload type, 14 bit timestamp offset, 10 bit length; the primary only has the first byte
+    constexpr std::size_t redHeaderBytes = 4;
+    constexpr std::size_t redPrimaryHeaderBytes = 1;
+    constexpr std::uint32_t maxTimestampOffset = (1u << 14) - 1;
+    constexpr std::size_t maxBlockBytes = (1u << 10) - 1;
+    // a peer may send more redundancy than we do, anything beyond is malformed
+    constexpr std::size_t maxRedBlocks = 8;
+    // count, marker and payload type, timestamp distance, length
+    constexpr std::size_t parityHeaderBytes = 8;
+    constexpr int minGroupSize = 2;
+    constexpr int maxGroupSize = 16;
+    constexpr int maxRedundancyDepth = 3;
+    // received packets remembered per SSRC, a parity block may arrive this many packets late
+    constexpr std::size_t historyPackets = 32;
+    constexpr std::size_t reorderPackets = 4;
+    constexpr std::size_t maxParities = 4;
+    constexpr std::size_t maxSources = 16;
+    constexpr std::size_t recoveryPoolBuffers = 32;
+    constexpr std::uint8_t defaultRedPayloadType = 121;
+    constexpr std::uint8_t defaultFecPayloadType = 122;
+    // as the jrtplib session defaults
+    constexpr std::uint8_t defaultPayloadType = 97;
+    constexpr unsigned long defaultTimestampIncrement = 10;
+
+    std::uint8_t getDynamicPayloadType(int payloadType, std::uint8_t fallback, const char* name)
+    {
+        if (96 > payloadType or 127 < payloadType)
+        {
+            LOG_WARNING_MSG("{} payload type {} is not dynamic, use {}.", name, payloadType, fallback);
+            return fallback;
+        }
+        return static_cast<std::uint8_t>(payloadType);
+    }
+
+    std::uint8_t* writeBlockHeader(std::uint8_t* header, std::uint8_t payloadType, std::uint32_t timestampOffset, std::size_t bytes)
+    {
+        const std::uint32_t value = (timestampOffset << 10) | static_cast<std::uint32_t>(bytes);
+        header[0] = static_cast<std::uint8_t>(0x80 | (payloadType & 0x7f));
+        header[1] = static_cast<std::uint8_t>(value >> 16);
+        header[2] = static_cast<std::uint8_t>(value >> 8);
+        header[3] = static_cast<std::uint8_t>(value);
+        return header + redHeaderBytes;
+    }
+
+    std::uint8_t getTypeMarker(std::uint8_t payloadType, bool marker)
+    {
+        return static_cast<std::uint8_t>((marker ? 0x80 : 0) | (payloadType & 0x7f));
+    }
+} // namespace
+
+namespace endpoints
+{
+    bool isLossProtectionEnabled(const configuration::AppConfiguration& config)
+    {
+        const std::string fecMode = audio::getFecMode(config);
+        return "red" == fecMode or "xor" == fecMode or "red+xor" == fecMode;
+    }
+
+    std::uint8_t selectRedPayloadType(const configuration::AppConfiguration& config)
+    {
+        return getDynamicPayloadType(audio::getRedPayloadType(config), defaultRedPayloadType, "RED");
+    }
+
+    std::size_t selectRedundancyDepth(const configuration::AppConfiguration& config)
+    {
+        if (std::string::npos == audio::getFecMode(config).find("red"))
+        {
+            return 0;
+        }
+        return static_cast<std::size_t>(std::min(std::max(audio::getRedundancyDepth(config), 1), maxRedundancyDepth));
+    }
+
+    std::uint8_t selectFecPayloadType(const configuration::AppConfiguration& config)
+    {
+        if (std::string::npos == audio::getFecMode(config).find("xor"))
+        {
+            return 0;
+        }
+        return getDynamicPayloadType(audio::getFecPayloadType(config), defaultFecPayloadType, "FEC");
+    }
+
+    FecRTPSession::FecRTPSession(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<IRTPSession> session)
+        : m_logger{ logger }
+        , m_session{ std::move(session) }
+        , m_parity{ std::string::npos != audio::getFecMode(config).find("xor") }
+        , m_redundancyDepth{ selectRedundancyDepth(config) }
+        , m_groupSize{ static_cast<std::size_t>(std::min(std::max(audio::getFecGroupSize(config), minGroupSize), maxGroupSize)) }
+        , m_redPayloadType{ selectRedPayloadType(config) }
+        , m_fecPayloadType{ m_parity ? selectFecPayloadType(config) : defaultFecPayloadType }
+        , m_sent(std::max<std::size_t>({ m_redundancyDepth, m_parity ? m_groupSize : 0, 1 }))
+        , m_redPayload(maxPayloadBytes)
+        , m_packetPool{ recoveryPoolBuffers, maxBlockBytes }
+    {
+        // the ring entries keep their capacity, sending does not allocate
+        for (SentPacket& packet : m_sent)
+        {
+            packet.payload.reserve(maxPayloadBytes);
+        }
+        m_recovered.reserve(historyPackets);
+        LOG_INFO_MSG(m_logger, "RTP loss protection with {} redundant payloads, {}, RED payload type {}.", m_redundancyDepth,
+            m_parity ? "xor parity every " + std::to_string(m_groupSize) + " packets" : std::string("no parity"),
+            static_cast<unsigned int>(m_redPayloadType));
+    }
+
+    FecRTPSession::~FecRTPSession()
+    {
+        std::uint64_t recovered = 0;
+        for (const auto& entry : m_recoveredPackets)
+        {
+            recovered += entry.second;
+        }
+        LOG_INFO_MSG(m_logger, "RTP loss protection sent {} parity blocks, recovered {} packets, {} malformed RED packets.",
+            m_parityBlocks, recovered, m_invalidPackets);
+    }
+
+    bool FecRTPSession::createRTPSession(RTPSessionParams& rtpSessionParams)
+    {
+        return m_session->createRTPSession(rtpSessionParams);
+    }
+
+    bool FecRTPSession::startRTPPolling()
+    {
+        return m_session->startRTPPolling();
+    }
+
+    int FecRTPSession::sendPacket(const std::string& data, const int& len)
+    {
+        return sendRedundant(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            defaultPayloadType, false, defaultTimestampIncrement);
+    }
+
+    int FecRTPSession::sendPacket(const std::string& data, const int& len, const unsigned long& timestampinc)
+    {
+        return sendRedundant(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            defaultPayloadType, false, timestampinc);
+    }
+
+    int FecRTPSession::SendPacket(const std::string& data, const int& len,
+        const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
+    {
+        return sendRedundant(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            pt, mark, timestampinc);
+    }
+
+    int FecRTPSession::sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc)
+    {
+        return sendRedundant(data, static_cast<std::size_t>(len), defaultPayloadType, false, timestampinc);
+    }
+
+    int FecRTPSession::sendPacket(const std::uint8_t* data, const int& len,
+        const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
+    {
+        return sendRedundant(data, static_cast<std::size_t>(len), pt, mark, timestampinc);
+    }
+
+    int FecRTPSession::incrementTimestamp(const unsigned long& timestampinc)
+    {
+        m_timestamp += static_cast<std::uint32_t>(timestampinc);
+        return m_session->incrementTimestamp(timestampinc);
+    }
+
+    int FecRTPSession::flushPackets()
+    {
+        return m_session->flushPackets();
+    }
+
+    bool FecRTPSession::addDestination(const std::string& ipAddress, int port)
+    {
+        return m_session->addDestination(ipAddress, port);
+    }
+
+    bool FecRTPSession::removeDestination(const std::string& ipAddress, int port)
+    {
+        return m_session->removeDestination(ipAddress, port);
+    }
+
+    const FecRTPSession::SentPacket& FecRTPSession::getSentPacket(std::size_t back) const
+    {
+        return m_sent[(m_sentNext + m_sent.size() - back) % m_sent.size()];
+    }
+
+    int FecRTPSession::sendRedundant(const std::uint8_t* data, std::size_t len, std::uint8_t payloadType, bool mark,
+        unsigned long timestampinc)
+    {
+        if (len > maxPayloadBytes - redPrimaryHeaderBytes)
+        {
+            LOG_ERROR_MSG("Send RTP packet size {} fail, too large for redundancy", len);
+            return -1;
+        }
+
+        // the parity of the last group first, then as many earlier payloads as fit, newest first
+        std::size_t bytes = redPrimaryHeaderBytes + len;
+        std::size_t parityBytes = 0;
+        if (m_parity and m_groupSize <= m_groupPackets and m_groupSize <= m_sentCount)
+        {
+            std::size_t longest = 0;
+            for (std::size_t back = 1; back <= m_groupSize; ++back)
+            {
+                longest = std::max(longest, getSentPacket(back).payload.size());
+            }
+            parityBytes = parityHeaderBytes + longest;
+            if (maxBlockBytes < parityBytes or maxPayloadBytes < bytes + redHeaderBytes + parityBytes)
+            {
+                parityBytes = 0;
+            }
+            bytes += 0 == parityBytes ? 0 : redHeaderBytes + parityBytes;
+        }
+        std::size_t redundant = 0;
+        while (redundant < m_redundancyDepth and redundant < m_sentCount)
+        {
+            const SentPacket& packet = getSentPacket(redundant + 1);
+            if (maxTimestampOffset < m_timestamp - packet.timestamp or maxBlockBytes < packet.payload.size() or
+                maxPayloadBytes < bytes + redHeaderBytes + packet.payload.size())
+            {
+                break;
+            }
+            bytes += redHeaderBytes + packet.payload.size();
+            ++redundant;
+        }
+
+        // block headers, then the block data oldest first, the primary last
+        std::uint8_t* header = m_redPayload.data();
+        std::uint8_t* body = header + (redundant + (0 == parityBytes ? 0 : 1)) * redHeaderBytes + redPrimaryHeaderBytes;
+        for (std::size_t back = redundant; back > 0; --back)
+        {
+            const SentPacket& packet = getSentPacket(back);
+            header = writeBlockHeader(header, packet.payloadType, m_timestamp - packet.timestamp, packet.payload.size());
+            memcpy(body, packet.payload.data(), packet.payload.size());
+            body += packet.payload.size();
+        }
+        if (0 != parityBytes)
+        {
+            header = writeBlockHeader(header, m_fecPayloadType, 0, parityBytes);
+            writeParity(body, parityBytes, m_timestamp);
+            body += parityBytes;
+            m_groupPackets = 0;
+            m_parityBlocks++;
+        }
+        *header = static_cast<std::uint8_t>(payloadType & 0x7f);
+        memcpy(body, data, len);
+        body += len;
+
+        const int result = m_session->sendPacket(m_redPayload.data(), static_cast<int>(body - m_redPayload.data()),
+            m_redPayloadType, mark, timestampinc);
+        if (0 > result)
+        {
+            // the sequence number may not have moved, no block can point back safely
+            m_sentCount = 0;
+            m_groupPackets = 0;
+        }
+        else
+        {
+            SentPacket& sent = m_sent[m_sentNext];
+            sent.payload.assign(data, data + len);
+            sent.payloadType = payloadType;
+            sent.marker = mark;
+            sent.timestamp = m_timestamp;
+            m_sentNext = (m_sentNext + 1) % m_sent.size();
+            m_sentCount = std::min(m_sentCount + 1, m_sent.size());
+            m_groupPackets++;
+        }
+        m_timestamp += static_cast<std::uint32_t>(timestampinc);
+        return result;
+    }
+
+    void FecRTPSession::writeParity(std::uint8_t* block, std::size_t bytes, std::uint32_t timestamp) const
+    {
+        memset(block, 0, bytes);
+        block[0] = static_cast<std::uint8_t>(m_groupSize);
+        std::uint32_t timestampOffset = 0;
+        std::uint16_t length = 0;
+        for (std::size_t back = 1; back <= m_groupSize; ++back)
+        {
+            const SentPacket& packet = getSentPacket(back);
+            block[1] ^= getTypeMarker(packet.payloadType, packet.marker);
+            timestampOffset ^= timestamp - packet.timestamp;
+            length ^= static_cast<std::uint16_t>(packet.payload.size());
+            std::uint8_t* parity = block + parityHeaderBytes;
+            for (const std::uint8_t byte : packet.payload)
+            {
+                *parity++ ^= byte;
+            }
+        }
+        block[2] = static_cast<std::uint8_t>(timestampOffset >> 24);
+        block[3] = static_cast<std::uint8_t>(timestampOffset >> 16);
+        block[4] = static_cast<std::uint8_t>(timestampOffset >> 8);
+        block[5] = static_cast<std::uint8_t>(timestampOffset);
+        block[6] = static_cast<std::uint8_t>(length >> 8);
+        block[7] = static_cast<std::uint8_t>(length);
+    }
+
+    void FecRTPSession::wakeReceiver()
+    {
+        m_session->wakeReceiver();
+    }
+
+    int FecRTPSession::receivePacket(configuration::RTPSessionDatas& rtpSessionDatas)
+    {
+        const std::size_t queued = rtpSessionDatas.size();
+        m_session->receivePacket(rtpSessionDatas);
+
+        // unpack in place, malformed packets and duplicates of recovered ones are left out
+        std::size_t kept = queued;
+        for (std::size_t i = queued; i < rtpSessionDatas.size(); ++i)
+        {
+            configuration::RTPSessionData& rtpSessionData = rtpSessionDatas[i];
+            auto found = m_sources.find(rtpSessionData.ssrc);
+            if (m_sources.end() == found)
+            {
+                if (maxSources <= m_sources.size())
+                {
+                    m_sources.erase(std::min_element(m_sources.begin(), m_sources.end(),
+                        [](const std::pair<const std::uint32_t, Source>& left, const std::pair<const std::uint32_t, Source>& right)
+                    {
+                        return left.second.lastSeen < right.second.lastSeen;
+                    }));
+                }
+                found = m_sources.emplace(rtpSessionData.ssrc, Source{}).first;
+                found->second.history.resize(historyPackets);
+            }
+            Source& source = found->second;
+            source.lastSeen = ++m_sourcePackets;
+
+            if (m_redPayloadType == rtpSessionData.payloadType and not unpackRedundant(rtpSessionData, source))
+            {
+                m_invalidPackets++;
+                continue;
+            }
+            if (isReceived(source, rtpSessionData.sequenceNumber))
+            {
+                continue;
+            }
+            remember(source, rtpSessionData);
+            if (kept != i)
+            {
+                rtpSessionDatas[kept] = std::move(rtpSessionData);
+            }
+            ++kept;
+        }
+        rtpSessionDatas.erase(rtpSessionDatas.begin() + kept, rtpSessionDatas.end());
+
+        // the whole batch is known now, a parity still short of more than one packet waits for the next
+        for (auto& entry : m_sources)
+        {
+            std::vector<Parity>& parities = entry.second.parities;
+            for (std::size_t i = 0; i < parities.size();)
+            {
+                if (recoverParity(entry.second, entry.first, parities[i]))
+                {
+                    parities.erase(parities.begin() + i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        // late to the jitter buffer, it orders them by timestamp
+        for (configuration::RTPSessionData& recovered : m_recovered)
+        {
+            rtpSessionDatas.push_back(std::move(recovered));
+        }
+        m_recovered.clear();
+        return static_cast<int>(rtpSessionDatas.size() - queued);
+    }
+
+    bool FecRTPSession::unpackRedundant(configuration::RTPSessionData& rtpSessionData, Source& source)
+    {
+        struct Block
+        {
+            std::uint8_t payloadType;
+            std::uint32_t timestampOffset;
+            std::size_t bytes;
+        };
+        Block blocks[maxRedBlocks];
+        std::size_t count = 0;
+        std::size_t redundant = 0;
+
+        const common::PacketSlice red = rtpSessionData.payloadDatas;
+        std::size_t offset = 0;
+        while (offset < red.size() and 0 != (red[offset] & 0x80))
+        {
+            if (offset + redHeaderBytes > red.size() or maxRedBlocks == count)
+            {
+                return false;
+            }
+            const std::uint32_t value = (static_cast<std::uint32_t>(red[offset + 1]) << 16) | (red[offset + 2] << 8) | red[offset + 3];
+            Block& block = blocks[count++];
+            block.payloadType = red[offset] & 0x7f;
+            block.timestampOffset = value >> 10;
+            block.bytes = value & maxBlockBytes;
+            redundant += m_fecPayloadType == block.payloadType ? 0 : 1;
+            offset += redHeaderBytes;
+        }
+        if (offset >= red.size())
+        {
+            return false;
+        }
+        const std::uint8_t primaryType = red[offset] & 0x7f;
+        offset += redPrimaryHeaderBytes;
+
+        std::size_t dataBytes = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            dataBytes += blocks[i].bytes;
+        }
+        if (offset + dataBytes > red.size())
+        {
+            return false;
+        }
+
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const common::PacketSlice data = red.slice(offset, blocks[i].bytes);
+            offset += blocks[i].bytes;
+            if (m_fecPayloadType == blocks[i].payloadType)
+            {
+                if (m_parity and parityHeaderBytes <= data.size())
+                {
+                    if (maxParities == source.parities.size())
+                    {
+                        source.parities.erase(source.parities.begin());
+                    }
+                    source.parities.push_back(Parity{ rtpSessionData.sequenceNumber, rtpSessionData.timestamp, data });
+                }
+                continue;
+            }
+
+            // copies of the packets right before this one, oldest first
+            const std::uint16_t sequenceNumber = static_cast<std::uint16_t>(rtpSessionData.sequenceNumber - (redundant - index++));
+            if (isReceived(source, sequenceNumber))
+            {
+                continue;
+            }
+            configuration::RTPSessionData recovered;
+            recovered.payloadDatas = data;
+            recovered.timestamp = rtpSessionData.timestamp - blocks[i].timestampOffset;
+            recovered.sequenceNumber = sequenceNumber;
+            recovered.payloadType = blocks[i].payloadType;
+            recovered.marker = false;
+            recovered.ssrc = rtpSessionData.ssrc;
+            addRecovered(std::move(recovered), source);
+        }
+
+        rtpSessionData.payloadType = primaryType;
+        rtpSessionData.payloadDatas = red.slice(offset, red.size() - offset);
+        return true;
+    }
+
+    bool FecRTPSession::isReceived(const Source& source, std::uint16_t sequenceNumber) const
+    {
+        if (not source.started)
+        {
+            return false;
+        }
+        // too old to be of use, as if it was there
+        if (static_cast<std::int16_t>(source.highestSequence - sequenceNumber) >= static_cast<std::int16_t>(historyPackets))
+        {
+            return true;
+        }
+        const ReceivedPacket& packet = source.history[sequenceNumber % historyPackets];
+        return packet.valid and packet.sequenceNumber == sequenceNumber;
+    }
+
+    void FecRTPSession::remember(Source& source, const configuration::RTPSessionData& rtpSessionData)
+    {
+        ReceivedPacket& packet = source.history[rtpSessionData.sequenceNumber % historyPackets];
+        packet.valid = true;
+        packet.sequenceNumber = rtpSessionData.sequenceNumber;
+        packet.payloadType = rtpSessionData.payloadType;
+        packet.marker = rtpSessionData.marker;
+        packet.timestamp = rtpSessionData.timestamp;
+        packet.payload = m_parity ? rtpSessionData.payloadDatas : common::PacketSlice();
+        if (not source.started or 0 < static_cast<std::int16_t>(rtpSessionData.sequenceNumber - source.highestSequence))
+        {
+            source.highestSequence = rtpSessionData.sequenceNumber;
+            source.started = true;
+        }
+
+        // no parity reaches further back, the receive buffer goes back to its pool
+        const std::uint16_t expired = static_cast<std::uint16_t>(rtpSessionData.sequenceNumber - m_groupSize - reorderPackets);
+        ReceivedPacket& old = source.history[expired % historyPackets];
+        if (old.sequenceNumber == expired)
+        {
+            old.payload = common::PacketSlice();
+        }
+    }
+
+    bool FecRTPSession::recoverParity(Source& source, std::uint32_t ssrc, const Parity& parity)
+    {
+        const std::size_t count = parity.block[0];
+        const std::uint16_t first = static_cast<std::uint16_t>(parity.sequenceNumber - count);
+        if (0 == count or m_groupSize < count or m_groupSize + reorderPackets <= static_cast<std::uint16_t>(source.highestSequence - first))
+        {
+            return true;
+        }
+
+        std::uint16_t missing = 0;
+        std::size_t missingCount = 0;
+        for (std::uint16_t sequenceNumber = first; sequenceNumber != parity.sequenceNumber; ++sequenceNumber)
+        {
+            const ReceivedPacket& packet = source.history[sequenceNumber % historyPackets];
+            if (not packet.valid or packet.sequenceNumber != sequenceNumber)
+            {
+                missing = sequenceNumber;
+                if (1 < ++missingCount)
+                {
+                    return false;
+                }
+            }
+        }
+        if (0 == missingCount)
+        {
+            return true;
+        }
+
+        // XOR of the parity with the rest of the group leaves the missing packet
+        const std::uint8_t* block = parity.block.data();
+        std::uint8_t typeMarker = block[1];
+        std::uint32_t timestampOffset = (static_cast<std::uint32_t>(block[2]) << 24) | (block[3] << 16) | (block[4] << 8) | block[5];
+        std::uint16_t length = static_cast<std::uint16_t>((block[6] << 8) | block[7]);
+        for (std::uint16_t sequenceNumber = first; sequenceNumber != parity.sequenceNumber; ++sequenceNumber)
+        {
+            if (missing != sequenceNumber)
+            {
+                const ReceivedPacket& packet = source.history[sequenceNumber % historyPackets];
+                typeMarker ^= getTypeMarker(packet.payloadType, packet.marker);
+                timestampOffset ^= parity.timestamp - packet.timestamp;
+                length ^= static_cast<std::uint16_t>(packet.payload.size());
+            }
+        }
+        common::PacketBuffer* buffer = length <= parity.block.size() - parityHeaderBytes ? m_packetPool.acquire() : nullptr;
+        if (nullptr == buffer)
+        {
+            return true;
+        }
+        memcpy(buffer->data, block + parityHeaderBytes, length);
+        for (std::uint16_t sequenceNumber = first; sequenceNumber != parity.sequenceNumber; ++sequenceNumber)
+        {
+            const ReceivedPacket& packet = source.history[sequenceNumber % historyPackets];
+            const std::size_t bytes = std::min<std::size_t>(packet.payload.size(), length);
+            for (std::size_t i = 0; missing != sequenceNumber and i < bytes; ++i)
+            {
+                buffer->data[i] ^= packet.payload[i];
+            }
+        }
+
+        configuration::RTPSessionData recovered;
+        recovered.payloadDatas = common::PacketSlice(buffer, 0, length);
+        recovered.timestamp = parity.timestamp - timestampOffset;
+        recovered.sequenceNumber = missing;
+        recovered.payloadType = typeMarker & 0x7f;
+        recovered.marker = 0 != (typeMarker & 0x80);
+        recovered.ssrc = ssrc;
+        addRecovered(std::move(recovered), source);
+        return true;
+    }
+
+    void FecRTPSession::addRecovered(configuration::RTPSessionData&& rtpSessionData, Source& source)
+    {
+        remember(source, rtpSessionData);
+        {
+            std::lock_guard<std::mutex> lock(m_statisticsMutex);
+            m_recoveredPackets[rtpSessionData.ssrc]++;
+        }
+        m_recovered.push_back(std::move(rtpSessionData));
+    }
+
+    std::vector<configuration::RTPNetworkStats> FecRTPSession::getNetworkStats() const
+    {
+        std::vector<configuration::RTPNetworkStats> networkStats = m_session->getNetworkStats();
+        std::lock_guard<std::mutex> lock(m_statisticsMutex);
+        for (const auto& recovered : m_recoveredPackets)
+        {
+            auto stats = std::find_if(networkStats.begin(), networkStats.end(),
+                [&recovered](const configuration::RTPNetworkStats& entry) { return entry.ssrc == recovered.first; });
+            if (networkStats.end() == stats)
+            {
+                networkStats.emplace_back();
+                stats = networkStats.end() - 1;
+                stats->ssrc = recovered.first;
+            }
+            stats->recoveredPackets = recovered.second;
+        }
+        return networkStats;
+    }
+} // namespace endpoints
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include "socket/RTCPStatistics.hpp"
+
+namespace
+{
+    // RFC 3550 A.1
+    constexpr std::uint32_t sequenceModulo = 1u << 16;
+    constexpr std::uint16_t maxDropout = 3000;
+    constexpr std::uint16_t maxMisorder = 100;
+    constexpr double timestampModulo = 4294967296.0;
+    // the RTCP interval of jrtplib and of the UDP transport
+    constexpr std::chrono::seconds reportInterval{ 5 };
+    // a source silent this long is gone, RFC 3550 6.3.5
+    constexpr std::chrono::seconds sourceTimeout{ 30 };
+    constexpr std::int32_t maxCumulativeLost = 0x7fffff;
+    constexpr std::int32_t minCumulativeLost = -0x800000;
+    constexpr std::uint64_t ntpEpochOffset = 2208988800ull;
+    constexpr double ntpShortUnitsPerSecond = 65536.0;
+    constexpr double millisecondsPerSecond = 1000.0;
+} // namespace
+
+namespace endpoints
+{
+    RTCPStatistics::RTCPStatistics()
+        : m_nextUpdate{ Clock::now() + reportInterval }
+    {
+    }
+
+    void RTCPStatistics::initSequence(Source& source, std::uint16_t sequenceNumber)
+    {
+        source.baseSequence = sequenceNumber;
+        source.maxSequence = sequenceNumber;
+        source.badSequence = sequenceModulo + 1;
+        source.cycles = 0;
+        source.received = 0;
+        source.expectedPrior = 0;
+        source.receivedPrior = 0;
+    }
+
+    std::uint32_t RTCPStatistics::getExtendedSequence(const Source& source)
+    {
+        return source.cycles + source.maxSequence;
+    }
+
+    std::int64_t RTCPStatistics::getLost(const Source& source)
+    {
+        const std::int64_t expected = static_cast<std::int64_t>(getExtendedSequence(source)) - source.baseSequence + 1;
+        return expected - static_cast<std::int64_t>(source.received);
+    }
+
+    void RTCPStatistics::onPacket(std::uint32_t ssrc, std::uint16_t sequenceNumber, std::uint32_t timestamp, double arrivalSeconds)
+    {
+        auto inserted = m_sources.emplace(ssrc, Source{});
+        Source& source = inserted.first->second;
+        if (inserted.second)
+        {
+            initSequence(source, sequenceNumber);
+        }
+        source.lastPacket = Clock::now();
+
+        const std::uint16_t delta = static_cast<std::uint16_t>(sequenceNumber - source.maxSequence);
+        if (delta < maxDropout)
+        {
+            if (sequenceNumber < source.maxSequence)
+            {
+                source.cycles += sequenceModulo;
+            }
+            source.maxSequence = sequenceNumber;
+        }
+        else if (delta <= sequenceModulo - maxMisorder)
+        {
+            // a big jump is a restarted sender once the next packet follows it
+            if (sequenceNumber != source.badSequence)
+            {
+                source.badSequence = (sequenceNumber + 1u) & (sequenceModulo - 1);
+                return;
+            }
+            initSequence(source, sequenceNumber);
+            source.haveTransit = false;
+        }
+        source.received++;
+
+        if (0.0 >= m_timestampUnit)
+        {
+            return;
+        }
+        // A.8, the timestamp wraps so the transit difference is taken modulo 2^32
+        const double transit = arrivalSeconds / m_timestampUnit - timestamp;
+        if (source.haveTransit)
+        {
+            double difference = std::fmod(transit - source.transit, timestampModulo);
+            if (difference > timestampModulo / 2)
+            {
+                difference -= timestampModulo;
+            }
+            else if (difference < -timestampModulo / 2)
+            {
+                difference += timestampModulo;
+            }
+            source.jitter += (std::fabs(difference) - source.jitter) / 16.0;
+        }
+        source.transit = transit;
+        source.haveTransit = true;
+    }
+
+    void RTCPStatistics::onSenderReport(std::uint32_t ssrc, std::uint32_t ntpMiddle, Clock::time_point arrival)
+    {
+        auto source = m_sources.find(ssrc);
+        if (m_sources.end() == source)
+        {
+            return;
+        }
+        source->second.lastSenderReport = ntpMiddle;
+        source->second.senderReportArrival = arrival;
+    }
+
+    void RTCPStatistics::onReportBlock(std::uint32_t reporterSsrc, const ReportBlock& block, std::uint32_t arrivalNtpMiddle)
+    {
+        if (block.ssrc != m_ownSsrc.load())
+        {
+            return;
+        }
+
+        // A - LSR - DLSR in 1/65536 s, unknown without a sender report or when it comes out negative
+        double roundTripMs = 0.0;
+        if (0 != block.lastSenderReport)
+        {
+            const std::uint32_t roundTrip = arrivalNtpMiddle - block.lastSenderReport - block.delaySinceLastSenderReport;
+            if (roundTrip < 0x80000000u)
+            {
+                roundTripMs = roundTrip / ntpShortUnitsPerSecond * millisecondsPerSecond;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Report& report = m_reports[reporterSsrc];
+        report.count++;
+        report.block = block;
+        if (0.0 < roundTripMs)
+        {
+            report.roundTripMs = roundTripMs;
+        }
+    }
+
+    bool RTCPStatistics::update(Clock::time_point now)
+    {
+        if (now < m_nextUpdate)
+        {
+            return false;
+        }
+        m_nextUpdate = now + reportInterval;
+
+        std::vector<configuration::RTPNetworkStats> published;
+        for (auto it = m_sources.begin(); it != m_sources.end();)
+        {
+            Source& source = it->second;
+            if (now - source.lastPacket > sourceTimeout)
+            {
+                it = m_sources.erase(it);
+                continue;
+            }
+
+            // A.3, the fraction of the interval
+            const std::uint64_t expected = static_cast<std::uint64_t>(getExtendedSequence(source)) - source.baseSequence + 1;
+            const std::int64_t expectedInterval = static_cast<std::int64_t>(expected - source.expectedPrior);
+            const std::int64_t lostInterval = expectedInterval - static_cast<std::int64_t>(source.received - source.receivedPrior);
+            source.expectedPrior = expected;
+            source.receivedPrior = source.received;
+            source.fractionLost = (0 >= expectedInterval or 0 >= lostInterval) ? 0 :
+                static_cast<std::uint8_t>(std::min<std::int64_t>((lostInterval << 8) / expectedInterval, 255));
+
+            configuration::RTPNetworkStats stats;
+            stats.ssrc = it->first;
+            stats.receivedPackets = source.received;
+            stats.lostPackets = getLost(source);
+            stats.fractionLost = source.fractionLost / 256.0;
+            stats.jitterMs = source.jitter * m_timestampUnit * millisecondsPerSecond;
+            published.push_back(stats);
+            ++it;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_published.swap(published);
+        return true;
+    }
+
+    std::size_t RTCPStatistics::getReportBlocks(ReportBlock* blocks, std::size_t maxBlocks, Clock::time_point now) const
+    {
+        std::size_t count = 0;
+        for (auto it = m_sources.begin(); it != m_sources.end() and count < maxBlocks; ++it)
+        {
+            const Source& source = it->second;
+            ReportBlock& block = blocks[count++];
+            block.ssrc = it->first;
+            block.fractionLost = source.fractionLost;
+            block.cumulativeLost = static_cast<std::int32_t>(std::min<std::int64_t>(std::max<std::int64_t>(getLost(source),
+                minCumulativeLost), maxCumulativeLost));
+            block.extendedHighestSequence = getExtendedSequence(source);
+            block.jitter = static_cast<std::uint32_t>(source.jitter);
+            block.lastSenderReport = source.lastSenderReport;
+            block.delaySinceLastSenderReport = 0 == source.lastSenderReport ? 0 : static_cast<std::uint32_t>(
+                std::chrono::duration<double>(now - source.senderReportArrival).count() * ntpShortUnitsPerSecond);
+        }
+        return count;
+    }
+
+    std::vector<configuration::RTPNetworkStats> RTCPStatistics::getNetworkStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<configuration::RTPNetworkStats> networkStats = m_published;
+        for (const auto& report : m_reports)
+        {
+            auto stats = std::find_if(networkStats.begin(), networkStats.end(),
+                [&report](const configuration::RTPNetworkStats& entry) { return entry.ssrc == report.first; });
+            if (networkStats.end() == stats)
+            {
+                networkStats.emplace_back();
+                stats = networkStats.end() - 1;
+                stats->ssrc = report.first;
+            }
+            stats->reports = report.second.count;
+            stats->reportedFractionLost = report.second.block.fractionLost / 256.0;
+            stats->reportedLostPackets = report.second.block.cumulativeLost;
+            stats->reportedJitterMs = report.second.block.jitter * m_timestampUnit * millisecondsPerSecond;
+            stats->roundTripMs = report.second.roundTripMs;
+        }
+        return networkStats;
+    }
+
+    std::uint64_t RTCPStatistics::getNtpTime(std::chrono::system_clock::time_point time)
+    {
+        const std::chrono::nanoseconds sinceEpoch = time.time_since_epoch();
+        const std::uint64_t seconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count());
+        const std::uint64_t nanoseconds = static_cast<std::uint64_t>(sinceEpoch.count()) % 1000000000ull;
+        return ((seconds + ntpEpochOffset) << 32) | ((nanoseconds << 32) / 1000000000ull);
+    }
+
+    std::uint32_t RTCPStatistics::getNtpMiddle(std::chrono::system_clock::time_point time)
+    {
+        return static_cast<std::uint32_t>(getNtpTime(time) >> 16);
+    }
+} // namespace endpoints
@@ -60,6 +60,21 @@ namespace endpoints
         return epoll_wait(epfd, events, maxevents, timeout);
     };
 
+    int SocketSysCall::wrapper_eventfd(unsigned int initval, int flags)
+    {
+        return eventfd(initval, flags);
+    };
+
+    int SocketSysCall::wrapper_eventfd_read(int fd, eventfd_t* value)
+    {
+        return eventfd_read(fd, value);
+    };
+
+    int SocketSysCall::wrapper_eventfd_write(int fd, eventfd_t value)
+    {
+        return eventfd_write(fd, value);
+    };
+
     // receive msg
     int SocketSysCall::wrapper_tcp_recvmsg(int sockfd, struct msghdr* msg, int flags)
     {
@@ -71,4 +86,17 @@ namespace endpoints
     {
         return sendmsg(sockfd, msg, flags);
     }
+
+    // send a batch of datagrams
+    int SocketSysCall::wrapper_udp_sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags)
+    {
+        return sendmmsg(sockfd, msgvec, vlen, flags);
+    }
+
+    // receive a batch of datagrams
+    int SocketSysCall::wrapper_udp_recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+        struct timespec* timeout)
+    {
+        return recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+    }
 }
@@ -0,0 +1,815 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include "socket/UdpRTPSession.hpp"
+#include "common/CommonFunction.hpp"
+
+namespace
+{
+    constexpr std::uint8_t rtpVersion = 2;
+    constexpr std::size_t rtpHeaderBytes = 12;
+    constexpr std::size_t maxDatagramBytes = 1500;
+    // packets per sendmmsg and per recvmmsg
+    constexpr std::size_t sendBatchPackets = 16;
+    constexpr std::size_t receiveBatchPackets = 32;
+    // received payloads in flight between the session and the decoder
+    constexpr std::size_t packetPoolBuffers = 256;
+    constexpr int socketBufferBytes = 256 * 1024;
+    constexpr int maxEpollEvents = 4;
+    constexpr std::chrono::seconds senderReportInterval{ 5 };
+    constexpr std::uint8_t rtcpSenderReport = 200;
+    constexpr std::uint8_t rtcpReceiverReport = 201;
+    constexpr std::uint8_t rtcpSourceDescription = 202;
+    constexpr std::uint8_t rtcpCname = 1;
+    // RTCP packet types 200-204 share the second byte with RTP marker and payload type
+    constexpr std::uint8_t rtcpFirstType = 200;
+    constexpr std::uint8_t rtcpLastType = 204;
+    const std::string senderCname = "sender@host";
+    const std::string receiverCname = "receiver@host";
+    constexpr std::size_t senderReportBytes = 28;
+    constexpr std::size_t receiverReportBytes = 8;
+    constexpr std::size_t reportBlockBytes = 24;
+    // the report count field has 5 bits
+    constexpr std::size_t maxReportBlocks = 31;
+    // remote senders the receiver reports go back to
+    constexpr std::size_t maxReportDestinations = 8;
+    // listeners of the sent stream, every packet goes out once per destination
+    constexpr std::size_t maxDestinations = 16;
+    // a rate capped destination may take this much of its rate at once
+    constexpr double rateBurstSeconds = 0.1;
+    constexpr double bitsPerByte = 8.0;
+    constexpr double bitsPerKilobit = 1000.0;
+    // as the jrtplib session defaults
+    constexpr std::uint8_t defaultPayloadType = 97;
+    constexpr unsigned long defaultTimestampIncrement = 10;
+
+    bool isSameAddress(const sockaddr_in& first, const sockaddr_in& second)
+    {
+        return first.sin_addr.s_addr == second.sin_addr.s_addr and first.sin_port == second.sin_port;
+    }
+
+    // at least one whole datagram, a small cap would never send anything otherwise
+    double getBurstBytes(double bytesPerSecond)
+    {
+        return std::max(bytesPerSecond * rateBurstSeconds, static_cast<double>(maxDatagramBytes));
+    }
+
+    void writeBigEndian16(std::uint8_t* data, std::uint16_t value)
+    {
+        data[0] = static_cast<std::uint8_t>(value >> 8);
+        data[1] = static_cast<std::uint8_t>(value);
+    }
+
+    void writeBigEndian32(std::uint8_t* data, std::uint32_t value)
+    {
+        data[0] = static_cast<std::uint8_t>(value >> 24);
+        data[1] = static_cast<std::uint8_t>(value >> 16);
+        data[2] = static_cast<std::uint8_t>(value >> 8);
+        data[3] = static_cast<std::uint8_t>(value);
+    }
+
+    std::uint16_t readBigEndian16(const std::uint8_t* data)
+    {
+        return static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    std::uint32_t readBigEndian32(const std::uint8_t* data)
+    {
+        return (static_cast<std::uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    }
+
+    // SDES with the CNAME only, RFC 3550 6.5, returns the padded size
+    std::size_t writeSourceDescription(std::uint8_t* data, std::uint32_t ssrc, const std::string& cname)
+    {
+        const std::size_t bytes = (4 + 4 + 2 + cname.size() + 1 + 3) / 4 * 4;
+        memset(data, 0, bytes);
+        data[0] = (rtpVersion << 6) | 1;
+        data[1] = rtcpSourceDescription;
+        writeBigEndian16(data + 2, static_cast<std::uint16_t>(bytes / 4 - 1));
+        writeBigEndian32(data + 4, ssrc);
+        data[8] = rtcpCname;
+        data[9] = static_cast<std::uint8_t>(cname.size());
+        memcpy(data + 10, cname.data(), cname.size());
+        return bytes;
+    }
+
+    void writeReportBlock(std::uint8_t* data, const endpoints::RTCPStatistics::ReportBlock& block)
+    {
+        writeBigEndian32(data, block.ssrc);
+        writeBigEndian32(data + 4, (static_cast<std::uint32_t>(block.fractionLost) << 24) |
+            (static_cast<std::uint32_t>(block.cumulativeLost) & 0xffffff));
+        writeBigEndian32(data + 8, block.extendedHighestSequence);
+        writeBigEndian32(data + 12, block.jitter);
+        writeBigEndian32(data + 16, block.lastSenderReport);
+        writeBigEndian32(data + 20, block.delaySinceLastSenderReport);
+    }
+
+    endpoints::RTCPStatistics::ReportBlock readReportBlock(const std::uint8_t* data)
+    {
+        endpoints::RTCPStatistics::ReportBlock block;
+        block.ssrc = readBigEndian32(data);
+        block.fractionLost = data[4];
+        // 24 bit signed
+        block.cumulativeLost = static_cast<std::int32_t>(readBigEndian32(data + 4) << 8) >> 8;
+        block.extendedHighestSequence = readBigEndian32(data + 8);
+        block.jitter = readBigEndian32(data + 12);
+        block.lastSenderReport = readBigEndian32(data + 16);
+        block.delaySinceLastSenderReport = readBigEndian32(data + 20);
+        return block;
+    }
+} // namespace
+
+namespace endpoints
+{
+    UdpRTPSession::UdpRTPSession(Logger& logger, const configuration::AppConfiguration& config,
+        std::unique_ptr<ISocketSysCall> socketSysCall)
+        : m_logger{ logger }
+        , m_config{ config }
+        , m_socketSysCall{ std::move(socketSysCall) }
+        , m_maxBytesPerSecond{ std::max(rtp::getDestinationMaxKbps(config), 0) * bitsPerKilobit / bitsPerByte }
+        , m_sendBuffers(sendBatchPackets * maxDatagramBytes)
+        , m_sendVectors(sendBatchPackets)
+        , m_sendMessages(sendBatchPackets * maxDestinations)
+        , m_packetPool{ packetPoolBuffers, maxDatagramBytes }
+        , m_receiveSlots(receiveBatchPackets, nullptr)
+        , m_receiveAddresses(receiveBatchPackets)
+        , m_receiveVectors(receiveBatchPackets)
+        , m_receiveMessages(receiveBatchPackets)
+    {
+        // random start values, RFC 3550 5.1
+        std::random_device random;
+        m_ssrc = random();
+        m_receiverSsrc = random();
+        m_sequenceNumber = static_cast<std::uint16_t>(random());
+        m_timestamp = random();
+
+        // the vectors point at their buffers for the lifetime of the session, the messages
+        // pair them with a destination on every flush
+        for (std::size_t i = 0; i < sendBatchPackets; ++i)
+        {
+            m_sendVectors[i].iov_base = &m_sendBuffers[i * maxDatagramBytes];
+            m_sendVectors[i].iov_len = 0;
+        }
+        for (std::size_t i = 0; i < receiveBatchPackets; ++i)
+        {
+            m_receiveVectors[i].iov_len = maxDatagramBytes;
+            m_receiveMessages[i] = mmsghdr{};
+            m_receiveMessages[i].msg_hdr.msg_iov = &m_receiveVectors[i];
+            m_receiveMessages[i].msg_hdr.msg_iovlen = 1;
+        }
+        refillReceiveSlots();
+    }
+
+    UdpRTPSession::~UdpRTPSession()
+    {
+        flushPackets();
+        LOG_INFO_MSG(m_logger, "UDP RTP sent {} packets in {} sendmmsg calls, dropped {}, {} over a rate cap; received {} packets in {} recvmmsg calls, {} epoll wakeups, {} invalid, {} RTCP.",
+            m_sentPackets, m_sendCalls, m_droppedPackets, m_pacedPackets, m_receivedPackets, m_receiveCalls, m_wakeups,
+            m_invalidPackets, m_controlPackets);
+        LOG_INFO_MSG(m_logger, "UDP RTP receive pool at most {} of {} buffers in use, {} times exhausted.",
+            m_packetPool.highWatermark(), m_packetPool.buffers(), m_poolExhausted);
+        closeSockets();
+        for (common::PacketBuffer* buffer : m_receiveSlots)
+        {
+            if (nullptr != buffer)
+            {
+                m_packetPool.release(buffer);
+            }
+        }
+    }
+
+    bool UdpRTPSession::createRTPSession(RTPSessionParams& rtpSessionParams)
+    {
+        std::string remoteIpAddress = rtp::getRTPRemoteIpAddress(m_config);
+        if (remoteIpAddress.empty())
+        {
+            LOG_ERROR_MSG("Empty IP address for rtp.");
+            return false;
+        }
+        const int remotePort = rtp::getRTPRemotePort(m_config);
+        if (not addDestination(remoteIpAddress, remotePort))
+        {
+            return false;
+        }
+        for (const auto& destination : rtp::getRTPDestinations(m_config))
+        {
+            addDestination(destination.first, destination.second);
+        }
+        m_timestampUnit = rtpSessionParams.GetOwnTimestampUnit();
+        m_rtcpStatistics.setOwnSSRC(m_ssrc);
+        m_rtcpStatistics.setTimestampUnit(m_timestampUnit);
+
+        const int sendPort = rtp::getRTPLocalSendPort(m_config);
+        const int receivePort = rtp::getRTPLocalReceivePort(m_config);
+        m_sendSocket = openSocket(sendPort);
+        m_sendControlSocket = openSocket(sendPort + 1);
+        m_receiveSocket = openSocket(receivePort);
+        m_receiveControlSocket = openSocket(receivePort + 1);
+        m_epoll = m_socketSysCall->wrapper_epoll_create(maxEpollEvents);
+        m_wakeEvent = m_socketSysCall->wrapper_eventfd(0, EFD_NONBLOCK);
+        if (0 > m_sendSocket or 0 > m_sendControlSocket or 0 > m_receiveSocket or 0 > m_receiveControlSocket or 0 > m_epoll or
+            0 > m_wakeEvent or not watchSocket(m_receiveSocket) or not watchSocket(m_receiveControlSocket) or
+            not watchSocket(m_sendControlSocket) or not watchSocket(m_wakeEvent) or not setMulticastOptions())
+        {
+            LOG_ERROR_MSG("UDP RTP session create fail {}", std::strerror(errno));
+            closeSockets();
+            return false;
+        }
+
+        m_nextSenderReport = std::chrono::steady_clock::now() + senderReportInterval;
+        LOG_INFO_MSG(m_logger, "Create UDP RTP session success, SSRC is: {}, sending from port {} to {}:{} and {} more, receiving on port {}.",
+            m_ssrc, sendPort, remoteIpAddress, remotePort, m_destinations.size() - 1, receivePort);
+        return true;
+    }
+
+    int UdpRTPSession::openSocket(int port)
+    {
+        int socket = m_socketSysCall->wrapper_socket(AF_INET, SOCK_DGRAM, 0);
+        if (0 > socket)
+        {
+            LOG_ERROR_MSG("Create UDP socket for port {} fail {}", port, std::strerror(errno));
+            return -1;
+        }
+
+        // room for bursts while the receive thread is descheduled
+        m_socketSysCall->wrapper_setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &socketBufferBytes, sizeof(socketBufferBytes));
+        const int flags = m_socketSysCall->wrapper_fcntl(socket, F_GETFL, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        if (0 > flags or 0 > m_socketSysCall->wrapper_fcntl(socket, F_SETFL, flags | O_NONBLOCK) or
+            0 > m_socketSysCall->wrapper_tcp_bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+        {
+            LOG_ERROR_MSG("Bind UDP socket to port {} fail {}", port, std::strerror(errno));
+            m_socketSysCall->wrapper_close(socket);
+            return -1;
+        }
+        return socket;
+    }
+
+    bool UdpRTPSession::watchSocket(int socket)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        return 0 == m_socketSysCall->wrapper_epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event);
+    }
+
+    bool UdpRTPSession::setMulticastOptions()
+    {
+        // only used when a destination is a group, unicast ignores it
+        const unsigned char ttl = static_cast<unsigned char>(std::min(std::max(rtp::getMulticastTtl(m_config), 1), 255));
+        for (int socket : { m_sendSocket, m_sendControlSocket })
+        {
+            if (0 > m_socketSysCall->wrapper_setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)))
+            {
+                return false;
+            }
+        }
+
+        const std::string group = rtp::getMulticastGroup(m_config);
+        if (group.empty())
+        {
+            return true;
+        }
+        ip_mreq request{};
+        if (0 == inet_aton(group.c_str(), &request.imr_multiaddr) or not IN_MULTICAST(ntohl(request.imr_multiaddr.s_addr)))
+        {
+            LOG_ERROR_MSG("Bad multicast group {}.", group);
+            return false;
+        }
+        // the sockets are bound to any address, unicast keeps arriving as well
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        for (int socket : { m_receiveSocket, m_receiveControlSocket })
+        {
+            if (0 > m_socketSysCall->wrapper_setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)))
+            {
+                LOG_ERROR_MSG("Join multicast group {} fail {}", group, std::strerror(errno));
+                return false;
+            }
+        }
+        LOG_INFO_MSG(m_logger, "UDP RTP receiver joined multicast group {}.", group);
+        return true;
+    }
+
+    bool UdpRTPSession::addDestination(const std::string& ipAddress, int port)
+    {
+        // the RTCP port is one up
+        in_addr address{};
+        if (0 == inet_aton(ipAddress.c_str(), &address) or 0 >= port or 65535 < port)
+        {
+            LOG_ERROR_MSG("Bad RTP destination {}:{}.", ipAddress, port);
+            return false;
+        }
+        Destination destination;
+        destination.address.sin_family = AF_INET;
+        destination.address.sin_addr = address;
+        destination.address.sin_port = htons(static_cast<std::uint16_t>(port));
+        destination.controlAddress = destination.address;
+        destination.controlAddress.sin_port = htons(static_cast<std::uint16_t>(port + 1));
+        destination.credit = getBurstBytes(m_maxBytesPerSecond);
+        destination.refillTime = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(m_destinationMutex);
+        auto known = std::find_if(m_destinations.begin(), m_destinations.end(), [&destination](const Destination& entry)
+        {
+            return isSameAddress(entry.address, destination.address);
+        });
+        if (m_destinations.end() != known)
+        {
+            return true;
+        }
+        if (maxDestinations <= m_destinations.size())
+        {
+            LOG_ERROR_MSG("Add RTP destination {}:{} fail, already {} destinations.", ipAddress, port, m_destinations.size());
+            return false;
+        }
+        m_destinations.push_back(destination);
+        LOG_INFO_MSG(m_logger, "UDP RTP destination {}:{} added, {} destinations.", ipAddress, port, m_destinations.size());
+        return true;
+    }
+
+    bool UdpRTPSession::removeDestination(const std::string& ipAddress, int port)
+    {
+        sockaddr_in address{};
+        if (0 == inet_aton(ipAddress.c_str(), &address.sin_addr) or 0 >= port or 65535 < port)
+        {
+            LOG_ERROR_MSG("Bad RTP destination {}:{}.", ipAddress, port);
+            return false;
+        }
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+
+        std::lock_guard<std::mutex> lock(m_destinationMutex);
+        auto known = std::find_if(m_destinations.begin(), m_destinations.end(), [&address](const Destination& entry)
+        {
+            return isSameAddress(entry.address, address);
+        });
+        if (m_destinations.end() == known)
+        {
+            LOG_WARNING_MSG("Remove RTP destination {}:{} fail, not a destination.", ipAddress, port);
+            return false;
+        }
+        m_destinations.erase(known);
+        LOG_INFO_MSG(m_logger, "UDP RTP destination {}:{} removed, {} destinations.", ipAddress, port, m_destinations.size());
+        return true;
+    }
+
+    void UdpRTPSession::closeSockets()
+    {
+        for (int* socket : { &m_sendSocket, &m_sendControlSocket, &m_receiveSocket, &m_receiveControlSocket, &m_epoll, &m_wakeEvent })
+        {
+            if (0 <= *socket)
+            {
+                m_socketSysCall->wrapper_close(*socket);
+                *socket = -1;
+            }
+        }
+    }
+
+    int UdpRTPSession::sendPacket(const std::string& data, const int& len)
+    {
+        return queuePacket(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            defaultPayloadType, false, defaultTimestampIncrement);
+    }
+
+    int UdpRTPSession::sendPacket(const std::string& data, const int& len, const unsigned long& timestampinc)
+    {
+        return queuePacket(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            defaultPayloadType, false, timestampinc);
+    }
+
+    int UdpRTPSession::SendPacket(const std::string& data, const int& len,
+        const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
+    {
+        return queuePacket(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<std::size_t>(len),
+            pt, mark, timestampinc);
+    }
+
+    int UdpRTPSession::sendPacket(const std::uint8_t* data, const int& len, const unsigned long& timestampinc)
+    {
+        return queuePacket(data, static_cast<std::size_t>(len), defaultPayloadType, false, timestampinc);
+    }
+
+    int UdpRTPSession::sendPacket(const std::uint8_t* data, const int& len,
+        const unsigned char& pt, const bool& mark, const unsigned long& timestampinc)
+    {
+        return queuePacket(data, static_cast<std::size_t>(len), pt, mark, timestampinc);
+    }
+
+    int UdpRTPSession::incrementTimestamp(const unsigned long& timestampinc)
+    {
+        m_timestamp += static_cast<std::uint32_t>(timestampinc);
+        return 0;
+    }
+
+    int UdpRTPSession::queuePacket(const std::uint8_t* data, std::size_t len, std::uint8_t payloadType, bool mark,
+        unsigned long timestampinc)
+    {
+        if (0 > m_sendSocket or len > maxDatagramBytes - rtpHeaderBytes)
+        {
+            LOG_ERROR_MSG("Send RTP packet size {} fail, {}", len, 0 > m_sendSocket ? "no session" : "too large");
+            return -1;
+        }
+
+        // the header goes straight into the batch buffer in front of the payload
+        std::uint8_t* packet = &m_sendBuffers[m_pendingPackets * maxDatagramBytes];
+        packet[0] = rtpVersion << 6;
+        packet[1] = static_cast<std::uint8_t>((mark ? 0x80 : 0) | (payloadType & 0x7f));
+        writeBigEndian16(packet + 2, m_sequenceNumber++);
+        writeBigEndian32(packet + 4, m_timestamp);
+        writeBigEndian32(packet + 8, m_ssrc);
+        memcpy(packet + rtpHeaderBytes, data, len);
+        m_sendVectors[m_pendingPackets].iov_len = rtpHeaderBytes + len;
+
+        // like jrtplib the packet carries the timestamp before the increment
+        m_lastTimestamp = m_timestamp;
+        m_timestamp += static_cast<std::uint32_t>(timestampinc);
+        m_lastSendTime = std::chrono::steady_clock::now();
+        m_sentPackets++;
+        m_sentOctets += static_cast<std::uint32_t>(len);
+        if (sendBatchPackets == ++m_pendingPackets)
+        {
+            flushPackets();
+        }
+        return 0;
+    }
+
+    int UdpRTPSession::flushPackets()
+    {
+        std::lock_guard<std::mutex> lock(m_destinationMutex);
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::size_t messages = 0;
+        for (Destination& destination : m_destinations)
+        {
+            messages = addPacketMessages(destination, messages, now);
+        }
+
+        std::size_t sent = 0;
+        while (sent < messages)
+        {
+            const int count = m_socketSysCall->wrapper_udp_sendmmsg(m_sendSocket, &m_sendMessages[sent],
+                static_cast<unsigned int>(messages - sent), 0);
+            m_sendCalls++;
+            if (0 > count and EINTR == errno)
+            {
+                continue;
+            }
+            if (0 >= count)
+            {
+                // socket buffer full or no route, the audio is late by now anyway
+                LOG_WARNING_MSG("Send {} RTP packets fail {}", messages - sent, std::strerror(errno));
+                m_droppedPackets += messages - sent;
+                break;
+            }
+            sent += static_cast<std::size_t>(count);
+        }
+        m_pendingPackets = 0;
+
+        if (0 < m_sentPackets and now >= m_nextSenderReport)
+        {
+            sendSenderReport();
+        }
+        return static_cast<int>(sent);
+    }
+
+    std::size_t UdpRTPSession::addPacketMessages(Destination& destination, std::size_t messages,
+        std::chrono::steady_clock::time_point now)
+    {
+        if (0.0 < m_maxBytesPerSecond)
+        {
+            destination.credit = std::min(destination.credit + m_maxBytesPerSecond *
+                std::chrono::duration<double>(now - destination.refillTime).count(), getBurstBytes(m_maxBytesPerSecond));
+            destination.refillTime = now;
+        }
+        for (std::size_t i = 0; i < m_pendingPackets; ++i)
+        {
+            if (0.0 < m_maxBytesPerSecond)
+            {
+                // over the cap the packet is skipped for this destination, late audio is no use
+                if (destination.credit < m_sendVectors[i].iov_len)
+                {
+                    m_pacedPackets++;
+                    continue;
+                }
+                destination.credit -= m_sendVectors[i].iov_len;
+            }
+            msghdr& header = m_sendMessages[messages++].msg_hdr;
+            header.msg_name = &destination.address;
+            header.msg_namelen = sizeof(destination.address);
+            header.msg_iov = &m_sendVectors[i];
+            header.msg_iovlen = 1;
+        }
+        return messages;
+    }
+
+    void UdpRTPSession::sendSenderReport()
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        m_nextSenderReport = now + senderReportInterval;
+
+        // SR without report blocks (the receiver reports on its own SSRC) followed by SDES, RFC 3550 6.4.1
+        std::uint8_t report[64]{};
+        report[0] = rtpVersion << 6;
+        report[1] = rtcpSenderReport;
+        writeBigEndian16(report + 2, senderReportBytes / 4 - 1);
+        writeBigEndian32(report + 4, m_ssrc);
+        const std::uint64_t ntpTime = RTCPStatistics::getNtpTime(std::chrono::system_clock::now());
+        writeBigEndian32(report + 8, static_cast<std::uint32_t>(ntpTime >> 32));
+        writeBigEndian32(report + 12, static_cast<std::uint32_t>(ntpTime));
+        // the media time now, extrapolated from the last packet
+        const double elapsed = std::chrono::duration<double>(now - m_lastSendTime).count();
+        const std::uint32_t timestamp = m_lastTimestamp + (0.0 < m_timestampUnit ? static_cast<std::uint32_t>(elapsed / m_timestampUnit) : 0);
+        writeBigEndian32(report + 16, timestamp);
+        writeBigEndian32(report + 20, m_sentPackets);
+        writeBigEndian32(report + 24, m_sentOctets);
+
+        const std::size_t sdesBytes = writeSourceDescription(report + senderReportBytes, m_ssrc, senderCname);
+
+        // to the RTCP port of every destination at once
+        iovec vector{ report, senderReportBytes + sdesBytes };
+        mmsghdr messages[maxDestinations]{};
+        for (std::size_t i = 0; i < m_destinations.size(); ++i)
+        {
+            messages[i].msg_hdr.msg_name = &m_destinations[i].controlAddress;
+            messages[i].msg_hdr.msg_namelen = sizeof(m_destinations[i].controlAddress);
+            messages[i].msg_hdr.msg_iov = &vector;
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        if (not m_destinations.empty() and static_cast<int>(m_destinations.size()) !=
+            m_socketSysCall->wrapper_udp_sendmmsg(m_sendControlSocket, messages, static_cast<unsigned int>(m_destinations.size()), 0))
+        {
+            LOG_DEBUG_MSG("Send RTCP sender report fail {}", std::strerror(errno));
+        }
+    }
+
+    int UdpRTPSession::receivePacket(configuration::RTPSessionDatas& rtpSessionDatas)
+    {
+        if (0 > m_epoll)
+        {
+            return 0;
+        }
+
+        // level triggered, returns at once while a socket has data, sleeps until a datagram or wakeReceiver()
+        epoll_event events[maxEpollEvents];
+        const int ready = m_socketSysCall->wrapper_epoll_wait(m_epoll, events, maxEpollEvents, -1);
+        m_wakeups++;
+        const std::size_t queued = rtpSessionDatas.size();
+        for (int i = 0; i < ready; ++i)
+        {
+            if (m_receiveSocket == events[i].data.fd)
+            {
+                receiveBatch(m_receiveSocket, &rtpSessionDatas);
+            }
+            else if (m_wakeEvent == events[i].data.fd)
+            {
+                eventfd_t wakes = 0;
+                m_socketSysCall->wrapper_eventfd_read(m_wakeEvent, &wakes);
+            }
+            else
+            {
+                m_controlPackets += static_cast<std::uint64_t>(receiveBatch(events[i].data.fd, nullptr));
+            }
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (m_rtcpStatistics.update(now))
+        {
+            sendReceiverReports(now);
+        }
+        return static_cast<int>(rtpSessionDatas.size() - queued);
+    }
+
+    void UdpRTPSession::wakeReceiver()
+    {
+        if (0 <= m_wakeEvent)
+        {
+            m_socketSysCall->wrapper_eventfd_write(m_wakeEvent, 1);
+        }
+    }
+
+    void UdpRTPSession::sendReceiverReports(std::chrono::steady_clock::time_point now)
+    {
+        RTCPStatistics::ReportBlock blocks[maxReportBlocks];
+        const std::size_t count = m_rtcpStatistics.getReportBlocks(blocks, maxReportBlocks, now);
+        if (0 == count or m_reportDestinations.empty())
+        {
+            return;
+        }
+
+        // RR on every source heard, then SDES, to the RTCP port of each remote sender
+        std::uint8_t report[receiverReportBytes + maxReportBlocks * reportBlockBytes + 64];
+        const std::size_t reportBytes = receiverReportBytes + count * reportBlockBytes;
+        report[0] = static_cast<std::uint8_t>((rtpVersion << 6) | count);
+        report[1] = rtcpReceiverReport;
+        writeBigEndian16(report + 2, static_cast<std::uint16_t>(reportBytes / 4 - 1));
+        writeBigEndian32(report + 4, m_receiverSsrc);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            writeReportBlock(report + receiverReportBytes + i * reportBlockBytes, blocks[i]);
+        }
+        const std::size_t sdesBytes = writeSourceDescription(report + reportBytes, m_receiverSsrc, receiverCname);
+
+        for (sockaddr_in& destination : m_reportDestinations)
+        {
+            iovec vector{ report, reportBytes + sdesBytes };
+            mmsghdr message{};
+            message.msg_hdr.msg_name = &destination;
+            message.msg_hdr.msg_namelen = sizeof(destination);
+            message.msg_hdr.msg_iov = &vector;
+            message.msg_hdr.msg_iovlen = 1;
+            if (1 != m_socketSysCall->wrapper_udp_sendmmsg(m_receiveControlSocket, &message, 1, 0))
+            {
+                LOG_DEBUG_MSG("Send RTCP receiver report fail {}", std::strerror(errno));
+            }
+        }
+    }
+
+    void UdpRTPSession::parseControlPacket(const std::uint8_t* packet, std::size_t bytes, const sockaddr_in& source)
+    {
+        const std::uint32_t arrivalNtpMiddle = RTCPStatistics::getNtpMiddle(std::chrono::system_clock::now());
+        // compound packet, RFC 3550 6.1
+        std::size_t offset = 0;
+        while (offset + 4 <= bytes and rtpVersion == (packet[offset] >> 6))
+        {
+            const std::uint8_t* header = packet + offset;
+            const std::size_t length = (static_cast<std::size_t>(readBigEndian16(header + 2)) + 1) * 4;
+            if (offset + length > bytes)
+            {
+                break;
+            }
+            offset += length;
+
+            std::size_t blocksOffset = 0;
+            if (rtcpSenderReport == header[1] and senderReportBytes <= length)
+            {
+                // NTP middle 32 bits for the LSR of the own receiver report
+                const std::uint32_t senderSsrc = readBigEndian32(header + 4);
+                m_rtcpStatistics.onSenderReport(senderSsrc, readBigEndian32(header + 10), std::chrono::steady_clock::now());
+                addReportDestination(source);
+                blocksOffset = senderReportBytes;
+            }
+            else if (rtcpReceiverReport == header[1] and receiverReportBytes <= length)
+            {
+                blocksOffset = receiverReportBytes;
+            }
+            else
+            {
+                continue;
+            }
+
+            const std::uint32_t reporterSsrc = readBigEndian32(header + 4);
+            const std::size_t blocks = header[0] & 0x1f;
+            for (std::size_t i = 0; i < blocks and blocksOffset + (i + 1) * reportBlockBytes <= length; ++i)
+            {
+                m_rtcpStatistics.onReportBlock(reporterSsrc, readReportBlock(header + blocksOffset + i * reportBlockBytes),
+                    arrivalNtpMiddle);
+            }
+        }
+    }
+
+    void UdpRTPSession::addReportDestination(const sockaddr_in& source)
+    {
+        // receiver reports go back to the address the sender reports come from
+        auto known = std::find_if(m_reportDestinations.begin(), m_reportDestinations.end(), [&source](const sockaddr_in& destination)
+        {
+            return isSameAddress(destination, source);
+        });
+        if (m_reportDestinations.end() == known and maxReportDestinations > m_reportDestinations.size())
+        {
+            m_reportDestinations.push_back(source);
+        }
+    }
+
+    std::vector<configuration::RTPNetworkStats> UdpRTPSession::getNetworkStats() const
+    {
+        return m_rtcpStatistics.getNetworkStats();
+    }
+
+    int UdpRTPSession::receiveBatch(int socket, configuration::RTPSessionDatas* rtpSessionDatas)
+    {
+        int datagrams = 0;
+        while (true)
+        {
+            const std::size_t slots = refillReceiveSlots();
+            if (0 == slots)
+            {
+                // the decoder still holds every buffer, the datagrams wait in the socket
+                m_poolExhausted++;
+                break;
+            }
+            for (std::size_t i = 0; i < slots; ++i)
+            {
+                m_receiveMessages[i].msg_hdr.msg_name = &m_receiveAddresses[i];
+                m_receiveMessages[i].msg_hdr.msg_namelen = sizeof(m_receiveAddresses[i]);
+            }
+            const int count = m_socketSysCall->wrapper_udp_recvmmsg(socket, m_receiveMessages.data(),
+                static_cast<unsigned int>(slots), MSG_DONTWAIT, nullptr);
+            m_receiveCalls++;
+            if (0 >= count)
+            {
+                if (0 > count and EAGAIN != errno and EWOULDBLOCK != errno and EINTR != errno)
+                {
+                    LOG_WARNING_MSG("Receive RTP fail {}", std::strerror(errno));
+                }
+                break;
+            }
+
+            const double arrivalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            for (int i = 0; i < count and nullptr == rtpSessionDatas; ++i)
+            {
+                parseControlPacket(m_receiveSlots[i]->data, m_receiveMessages[i].msg_len, m_receiveAddresses[i]);
+            }
+            for (int i = 0; i < count and nullptr != rtpSessionDatas; ++i)
+            {
+                const mmsghdr& message = m_receiveMessages[i];
+                if (0 != (message.msg_hdr.msg_flags & MSG_TRUNC))
+                {
+                    m_invalidPackets++;
+                    continue;
+                }
+                rtpSessionDatas->emplace_back();
+                if (not parsePacket(m_receiveSlots[i], message.msg_len, rtpSessionDatas->back()))
+                {
+                    rtpSessionDatas->pop_back();
+                    m_invalidPackets++;
+                    continue;
+                }
+                // the payload keeps the buffer, the slot gets a new one
+                m_receiveSlots[i] = nullptr;
+                m_receivedPackets++;
+                const configuration::RTPSessionData& rtpSessionData = rtpSessionDatas->back();
+                m_rtcpStatistics.onPacket(rtpSessionData.ssrc, rtpSessionData.sequenceNumber, rtpSessionData.timestamp,
+                    arrivalSeconds);
+            }
+            datagrams += count;
+            if (slots > static_cast<std::size_t>(count))
+            {
+                break;
+            }
+        }
+        return datagrams;
+    }
+
+    std::size_t UdpRTPSession::refillReceiveSlots()
+    {
+        std::size_t slots = 0;
+        for (; slots < receiveBatchPackets; ++slots)
+        {
+            if (nullptr == m_receiveSlots[slots])
+            {
+                m_receiveSlots[slots] = m_packetPool.acquire();
+                if (nullptr == m_receiveSlots[slots])
+                {
+                    break;
+                }
+                m_receiveVectors[slots].iov_base = m_receiveSlots[slots]->data;
+            }
+        }
+        return slots;
+    }
+
+    bool UdpRTPSession::parsePacket(common::PacketBuffer* buffer, std::size_t bytes, configuration::RTPSessionData& rtpSessionData) const
+    {
+        const std::uint8_t* packet = buffer->data;
+        if (rtpHeaderBytes > bytes or rtpVersion != (packet[0] >> 6) or
+            (rtcpFirstType <= packet[1] and rtcpLastType >= packet[1]))
+        {
+            return false;
+        }
+
+        // fixed header, contributing sources, extension, padding at the end
+        std::size_t offset = rtpHeaderBytes + 4 * (packet[0] & 0x0f);
+        if (0 != (packet[0] & 0x10))
+        {
+            if (offset + 4 > bytes)
+            {
+                return false;
+            }
+            offset += 4 + 4 * static_cast<std::size_t>(readBigEndian16(packet + offset + 2));
+        }
+        const std::size_t padding = 0 != (packet[0] & 0x20) ? packet[bytes - 1] : 0;
+        if (offset + padding > bytes)
+        {
+            return false;
+        }
+
+        rtpSessionData.marker = 0 != (packet[1] & 0x80);
+        rtpSessionData.payloadType = packet[1] & 0x7f;
+        rtpSessionData.sequenceNumber = readBigEndian16(packet + 2);
+        rtpSessionData.timestamp = readBigEndian32(packet + 4);
+        rtpSessionData.ssrc = readBigEndian32(packet + 8);
+        rtpSessionData.payloadDatas = common::PacketSlice(buffer, offset, bytes - padding - offset);
+        return true;
+    }
+
+    bool UdpRTPSession::startRTPPolling()
+    {
+        // nothing to poll, receivePacket() waits in epoll and RTCP goes out with the packets
+        return true;
+    }
+} // namespace endpoints
@@ -0,0 +1,251 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "common/G711Codec.hpp"
+
+/*
+* Bit exactness of the table driven G.711 conversions against the per sample
+* reference they replaced, over every 16 bit input and every code word.
+*/
+namespace
+{
+    constexpr int SEG_SHIFT = 4;        /* Left shift for segment number. */
+    constexpr int QUANT_MASK = 0xf;	    /* Quantization field mask. */
+    constexpr int SEG_MASK = 0x70;      /* Segment field mask. */
+    constexpr int SIGN_BIT = 0x80;      /* Sign bit for a A-law byte. */
+    constexpr int NSEGS = 8;            /* Number of A-law segments. */
+    constexpr int BIAS = 0x84;          /* Bias for linear code. */
+    constexpr int PCM_VALUES = 65536;
+    constexpr int G711_CODES = 256;
+    // odd so the unrolled loops also run their tail
+    constexpr std::size_t BATCH_OFFSET = 3;
+
+    short seg_end[8] = { 0xFF, 0x1FF, 0x3FF, 0x7FF,
+            0xFFF, 0x1FFF, 0x3FFF, 0x7FFF };
+
+    int search(short val, short* table, short size)
+    {
+        for (short i = 0; i < size; i++)
+        {
+            if (val <= table[i])
+                return (i);
+        }
+        return (size);
+    }
+
+    /* reference: convert a 16-bit linear PCM value to 8-bit A-law */
+    unsigned char linear2alaw(short pcm_val)
+    {
+        short		mask;
+        short		seg;
+        unsigned char	aval;
+
+        if (pcm_val >= 0)
+        {
+            mask = 0xD5;		/* sign (7th) bit = 1 */
+        }
+        else
+        {
+            mask = 0x55;		/* sign bit = 0 */
+            pcm_val = -pcm_val - 1;
+            if (pcm_val < 0)
+            {
+                pcm_val = 32767;
+            }
+        }
+
+        seg = search(pcm_val, seg_end, NSEGS);
+        if (seg >= NSEGS)		/* out of range, return maximum value. */
+        {
+            return (0x7F ^ mask);
+        }
+        aval = seg << SEG_SHIFT;
+        if (seg < 2)
+        {
+            aval |= (pcm_val >> 4) & QUANT_MASK;
+        }
+        else
+        {
+            aval |= (pcm_val >> (seg + 3)) & QUANT_MASK;
+        }
+        return (aval ^ mask);
+    }
+
+    /* reference: convert a 16-bit linear PCM value to 8-bit u-law */
+    unsigned char linear2ulaw(short pcm_val)
+    {
+        int		mask;
+        int		seg;
+        unsigned char	uval;
+
+        if (pcm_val < 0)
+        {
+            pcm_val = BIAS - pcm_val;
+            mask = 0x7F;
+        }
+        else
+        {
+            pcm_val += BIAS;
+            mask = 0xFF;
+        }
+
+        seg = search(pcm_val, seg_end, NSEGS);
+        if (seg >= NSEGS)		/* out of range, return maximum value. */
+        {
+            return (0x7F ^ mask);
+        }
+        uval = (seg << 4) | ((pcm_val >> (seg + 3)) & 0xF);
+        return (uval ^ mask);
+    }
+
+    /* reference: convert an A-law value to 16-bit linear PCM */
+    short alaw2linear(unsigned char a_val)
+    {
+        short t;
+        short seg;
+
+        a_val ^= 0x55;
+
+        t = static_cast<short>((a_val & QUANT_MASK) << 4);
+        seg = static_cast<short>((a_val & SEG_MASK) >> SEG_SHIFT);
+        switch (seg)
+        {
+        case 0:
+            t += 8;
+            break;
+        case 1:
+            t += 0x108;
+            break;
+        default:
+            t += 0x108;
+            t <<= seg - 1;
+        }
+        return ((a_val & SIGN_BIT) ? t : -t);
+    }
+
+    /* reference: convert a u-law value to 16-bit linear PCM */
+    short ulaw2linear(unsigned char u_val)
+    {
+        short t;
+
+        u_val = ~u_val;
+        t = static_cast<short>(((u_val & QUANT_MASK) << 3) + BIAS);
+        t <<= (u_val & SEG_MASK) >> SEG_SHIFT;
+
+        return ((u_val & SIGN_BIT) ? (BIAS - t) : (t - BIAS));
+    }
+
+    int failures = 0;
+
+    void expect(bool condition, const char* what, int value)
+    {
+        if (not condition)
+        {
+            if (failures < 20)
+            {
+                printf("FAIL %s at %d\n", what, value);
+            }
+            failures++;
+        }
+    }
+
+    std::vector<std::int16_t> allPcmValues()
+    {
+        std::vector<std::int16_t> pcm(PCM_VALUES);
+        for (int i = 0; i < PCM_VALUES; i++)
+        {
+            pcm[i] = static_cast<std::int16_t>(i - 32768);
+        }
+        return pcm;
+    }
+
+    void testEncode(const char* name, std::size_t (*encode)(const std::int16_t*, std::size_t, std::uint8_t*),
+        unsigned char (*reference)(short))
+    {
+        const std::vector<std::int16_t> pcm = allPcmValues();
+
+        std::vector<std::uint8_t> g711(PCM_VALUES);
+        expect(PCM_VALUES == encode(pcm.data(), pcm.size(), g711.data()), name, -1);
+        for (int i = 0; i < PCM_VALUES; i++)
+        {
+            expect(reference(pcm[i]) == g711[i], name, pcm[i]);
+        }
+
+        // in place, the code words overwrite the samples they came from
+        std::vector<std::int16_t> buffer(pcm);
+        std::uint8_t* inPlace = reinterpret_cast<std::uint8_t*>(buffer.data());
+        encode(buffer.data(), buffer.size(), inPlace);
+        expect(0 == memcmp(inPlace, g711.data(), PCM_VALUES), name, -2);
+
+        // a batch length that is not a multiple of the unrolling
+        std::vector<std::uint8_t> tail(PCM_VALUES, 0);
+        encode(pcm.data() + BATCH_OFFSET, PCM_VALUES - BATCH_OFFSET, tail.data());
+        expect(0 == memcmp(tail.data(), g711.data() + BATCH_OFFSET, PCM_VALUES - BATCH_OFFSET), name, -3);
+    }
+
+    void testDecode(const char* name, std::size_t (*decode)(const std::uint8_t*, std::size_t, std::int16_t*),
+        short (*reference)(unsigned char))
+    {
+        std::vector<std::uint8_t> g711(G711_CODES);
+        for (int i = 0; i < G711_CODES; i++)
+        {
+            g711[i] = static_cast<std::uint8_t>(i);
+        }
+
+        std::vector<std::int16_t> pcm(G711_CODES);
+        expect(G711_CODES == decode(g711.data(), g711.size(), pcm.data()), name, -1);
+        for (int i = 0; i < G711_CODES; i++)
+        {
+            expect(reference(static_cast<unsigned char>(i)) == pcm[i], name, i);
+        }
+
+        // in place, the samples start at the code words and take twice the room
+        std::vector<std::int16_t> buffer(G711_CODES);
+        memcpy(buffer.data(), g711.data(), G711_CODES);
+        decode(reinterpret_cast<std::uint8_t*>(buffer.data()), G711_CODES - BATCH_OFFSET, buffer.data());
+        expect(0 == memcmp(buffer.data(), pcm.data(), (G711_CODES - BATCH_OFFSET) * sizeof(std::int16_t)), name, -2);
+    }
+
+    void testLegacyApi()
+    {
+        const std::vector<std::int16_t> pcm = allPcmValues();
+        const char* pcmBytes = reinterpret_cast<const char*>(pcm.data());
+        const int pcmLen = static_cast<int>(pcm.size() * sizeof(std::int16_t));
+
+        std::vector<unsigned char> alaw(PCM_VALUES);
+        std::vector<unsigned char> ulaw(PCM_VALUES);
+        expect(PCM_VALUES == audio::PCM2G711a(alaw.data(), pcmBytes, pcmLen), "PCM2G711a", -1);
+        expect(PCM_VALUES == audio::PCM2G711u(ulaw.data(), pcmBytes, pcmLen), "PCM2G711u", -1);
+
+        std::vector<std::int16_t> decoded(PCM_VALUES);
+        char* decodedBytes = reinterpret_cast<char*>(decoded.data());
+        expect(pcmLen == audio::G711a2PCM(decodedBytes, reinterpret_cast<const char*>(alaw.data()), PCM_VALUES), "G711a2PCM", -1);
+        for (int i = 0; i < PCM_VALUES; i++)
+        {
+            expect(alaw2linear(linear2alaw(pcm[i])) == decoded[i], "G711a2PCM", pcm[i]);
+        }
+        expect(pcmLen == audio::G711u2PCM(decodedBytes, reinterpret_cast<const char*>(ulaw.data()), PCM_VALUES), "G711u2PCM", -1);
+        for (int i = 0; i < PCM_VALUES; i++)
+        {
+            expect(ulaw2linear(linear2ulaw(pcm[i])) == decoded[i], "G711u2PCM", pcm[i]);
+        }
+    }
+} // namespace
+
+int main()
+{
+    testEncode("encodeAlaw", audio::encodeAlaw, linear2alaw);
+    testEncode("encodeUlaw", audio::encodeUlaw, linear2ulaw);
+    testDecode("decodeAlaw", audio::decodeAlaw, alaw2linear);
+    testDecode("decodeUlaw", audio::decodeUlaw, ulaw2linear);
+    testLegacyApi();
+
+    if (0 != failures)
+    {
+        printf("G711CodecTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("G711CodecTest: passed\n");
+    return 0;
+}
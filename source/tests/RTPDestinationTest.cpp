@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <memory>
+#include "logger/Logger.hpp"
+#include "socket/SocketSysCall.hpp"
+#include "socket/UdpRTPSession.hpp"
+
+/*
+* The destination port bounds of the UDP RTP session, both edges of the
+* valid range are accepted and the values just outside are refused.
+*/
+namespace
+{
+    constexpr int MIN_PORT = 1;
+    constexpr int MAX_PORT = 65535;
+
+    int failures = 0;
+
+    void expect(bool condition, const char* what, int value)
+    {
+        if (not condition)
+        {
+            printf("FAIL %s at %d\n", what, value);
+            failures++;
+        }
+    }
+} // namespace
+
+int main()
+{
+    configuration::AppConfiguration config;
+    endpoints::UdpRTPSession session(logger::getLogger(), config, std::make_unique<endpoints::SocketSysCall>());
+
+    for (int port : { MIN_PORT, MAX_PORT })
+    {
+        expect(session.addDestination("127.0.0.1", port), "addDestination", port);
+        expect(session.removeDestination("127.0.0.1", port), "removeDestination", port);
+    }
+    for (int port : { MIN_PORT - 1, MAX_PORT + 1 })
+    {
+        expect(not session.addDestination("127.0.0.1", port), "addDestination", port);
+        expect(not session.removeDestination("127.0.0.1", port), "removeDestination", port);
+    }
+
+    if (0 != failures)
+    {
+        printf("RTPDestinationTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("RTPDestinationTest: passed\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <poll.h>
+
+extern "C"
+{
+#include <alsa/asoundlib.h>
+}
+
+namespace usbAudio
+{
+    /*
+     * One thread waiting in poll() on the descriptors of every started PCM, capture and
+     * playback alike, plus an eventfd to pick up registration changes. A PCM handler runs
+     * on the loop thread when ALSA reports the stream ready (period available, xrun), so an
+     * idle stream costs no wakeups. Handlers must not block.
+     * All LinuxAlsa instances share the loop, it lives as long as one of them holds it.
+     */
+    class AlsaEventLoop final
+    {
+    public:
+        using Handler = std::function<void(unsigned short revents)>;
+
+        static std::shared_ptr<AlsaEventLoop> getInstance();
+
+        AlsaEventLoop();
+        ~AlsaEventLoop();
+
+        AlsaEventLoop(const AlsaEventLoop&) = delete;
+        AlsaEventLoop& operator=(const AlsaEventLoop&) = delete;
+
+        bool addPCM(snd_pcm_t* pcmHandle, Handler handler);
+        // the handler is not running and will not run again once this returns
+        void removePCM(snd_pcm_t* pcmHandle);
+
+    private:
+        struct Registration
+        {
+            Handler handler;
+            unsigned int descriptorCount;
+        };
+
+        void run();
+        void wakeUp();
+        void rebuildPollDescriptors();
+
+    private:
+        int m_eventFd{ -1 };
+        bool m_running{ true };
+        std::thread m_thread;
+
+        // registrations, guarded by m_mutex
+        std::mutex m_mutex;
+        std::map<snd_pcm_t*, Registration> m_registrations;
+        bool m_changed{ true };
+
+        // held by the loop thread while handlers run
+        std::mutex m_dispatchMutex;
+
+        // loop thread only
+        std::vector<struct pollfd> m_pollDescriptors;
+        std::vector<std::pair<snd_pcm_t*, unsigned int>> m_pollOwners;
+    };
+} // namespace usbAudio
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usbAudio
+{
+    /*
+     * Streaming sample rate and channel conversion of 16 bit interleaved PCM, so ALSA can
+     * run the device at its native format instead of the plug layer converting in the
+     * kernel. The rate goes through a polyphase windowed sinc (Kaiser) FIR for the reduced
+     * ratio L/M, Q15 coefficients with NEON / SSE2 dot products. Stereo to mono averages
+     * before filtering, mono to stereo duplicates after, so only the needed channels are
+     * filtered.
+     * Input is taken in fixed chunks, all memory is allocated by the constructor.
+     */
+    class AudioConverter final
+    {
+    public:
+        AudioConverter(unsigned int inputRate, unsigned int inputChannels, unsigned int outputRate, unsigned int outputChannels);
+
+        // output may be up to this many frames for inputFrames
+        std::size_t getMaxOutputFrames(std::size_t inputFrames) const;
+        // returns the output frames written
+        std::size_t process(const std::int16_t* input, std::size_t inputFrames, std::int16_t* output);
+        void reset();
+
+        unsigned int getInputRate() const { return m_inputRate; }
+        unsigned int getOutputRate() const { return m_outputRate; }
+        unsigned int getInputChannels() const { return m_inputChannels; }
+        unsigned int getOutputChannels() const { return m_outputChannels; }
+        // filter delay in output frames
+        double getLatencyFrames() const;
+
+    private:
+        void designFilter();
+        void loadChunk(const std::int16_t* input, std::size_t frames);
+        std::size_t convertChannels(const std::int16_t* input, std::size_t frames, std::int16_t* output) const;
+
+    private:
+        const unsigned int m_inputRate;
+        const unsigned int m_inputChannels;
+        const unsigned int m_outputRate;
+        const unsigned int m_outputChannels;
+        // channels that go through the filter
+        const unsigned int m_channels;
+        // output time steps m_decimation in units of 1 / m_interpolation input samples
+        unsigned int m_interpolation{ 1 };
+        unsigned int m_decimation{ 1 };
+        std::size_t m_taps{ 0 };
+
+        // m_interpolation phases of m_taps, each reversed to run along the history
+        std::vector<std::int16_t> m_coefficients;
+        // per channel m_taps - 1 previous samples followed by the current chunk
+        std::vector<std::vector<std::int16_t>> m_history;
+        // newest input sample of the next output and its phase
+        std::size_t m_nextInput{ 0 };
+        unsigned int m_phase{ 0 };
+    };
+} // namespace usbAudio
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "JitterBuffer.hpp"
+
+namespace usbAudio
+{
+    /*
+     * Mixes the talkers of the RTP playback path. Every SSRC gets its own jitter buffer,
+     * mix() pops one period from each, scales it by the source gain and sums with
+     * saturation (NEON or SSE2, scalar elsewhere). The maxSources slots and their buffers
+     * are allocated up front, a period costs one pop and one vector pass per talker and
+     * never allocates. A new SSRC takes a free slot or one idle for a while, otherwise its
+     * packets are dropped.
+     * push() runs on the RTP receive thread, mix() on the ALSA event loop.
+     */
+    class AudioMixer final
+    {
+    public:
+        AudioMixer(unsigned int sampleRate, unsigned int rtpClockRate, unsigned int channels,
+            unsigned int minDelayMs, unsigned int maxDelayMs, unsigned int maxSources, unsigned int gainPercent);
+
+        // false if there is no slot for the SSRC
+        bool push(std::uint32_t ssrc, std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+            const std::int16_t* pcm, std::size_t frames, JitterBuffer::Clock::time_point arrivalTime, bool marker);
+        bool pushComfortNoise(std::uint32_t ssrc, std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+            std::uint8_t noiseLevel, JitterBuffer::Clock::time_point arrivalTime);
+        // frames of interleaved pcm, the sum of all sources
+        void mix(std::int16_t* pcm, std::size_t frames);
+
+        // gain of one talker in percent (0-199), new sources start at the default
+        void setSourceGain(std::uint32_t ssrc, unsigned int gainPercent);
+        // RTCP jitter of a talker for its jitter buffer
+        void setNetworkJitter(std::uint32_t ssrc, double jitterMs);
+        bool hasSource(std::uint32_t ssrc) const;
+        void reset();
+
+        std::vector<std::pair<std::uint32_t, JitterBufferStatistics>> getStatistics() const;
+        std::uint64_t getDroppedPackets() const;
+        unsigned int getChannels() const { return m_channels; }
+
+    private:
+        struct Source
+        {
+            bool active{ false };
+            std::uint32_t ssrc{ 0 };
+            std::int16_t gain{ 0 };  // Q14
+            JitterBuffer::Clock::time_point lastArrival{};
+            std::unique_ptr<JitterBuffer> jitterBuffer;
+        };
+
+        Source* findSource(std::uint32_t ssrc, JitterBuffer::Clock::time_point arrivalTime);
+
+    private:
+        const unsigned int m_channels;
+        const std::int16_t m_defaultGain;
+
+        mutable std::mutex m_mutex;
+        std::vector<Source> m_sources;
+        std::vector<std::int16_t> m_scratch;
+        std::uint64_t m_droppedPackets{ 0 };
+    };
+} // namespace usbAudio
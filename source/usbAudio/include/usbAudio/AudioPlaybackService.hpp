@@ -1,9 +1,14 @@
 #pragma once
+#include <map>
 #include "Configurations/Configurations.hpp"
 #include "Configurations/ParseConfigFile.hpp"
 #include "logger/Logger.hpp"
 #include "IAudioPlaybackService.hpp"
-#include "LinuxAlsa.hpp"
+#include "ISysAlsa.hpp"
+#include "AudioMixer.hpp"
+#include "AudioConverter.hpp"
+#include "LatencyProbe.hpp"
+#include "common/AudioCodec.hpp"
 
 namespace endpoints
 {
@@ -15,7 +20,8 @@ namespace usbAudio
     class AudioPlaybackService final : public IAudioPlaybackService
     {
     public:
-        AudioPlaybackService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession);
+        AudioPlaybackService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession,
+            std::shared_ptr<LatencyProbe> latencyProbe);
         ~AudioPlaybackService();
 
         bool initAudioPlayback() override;
@@ -23,6 +29,7 @@ namespace usbAudio
 
         int audioStartPlaying() override;
         int audioStopPlaying() override;
+        bool setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs) override;
 
     private:
         bool startAnalysisSpeech();
@@ -34,7 +41,9 @@ namespace usbAudio
         void speechStartFromFile();
         void speechStartFromRTP();
         int readFileAudioData();
-        int readRTPAudioData(configuration::RTPSessionDatas& rtpSessionDatas);
+        std::size_t decodeRTPPayload(const configuration::RTPSessionData& rtpSessionData, std::vector<std::int16_t>& pcm);
+        audio::IAudioCodec& getDecoder(std::uint32_t ssrc);
+        void mixPeriod(std::int16_t* pcm, std::size_t frames);
 
         void endPlaybackWithReason(const int& errorCode);
 
@@ -42,16 +51,42 @@ namespace usbAudio
         void waitForPlaybackStop(configuration::ALSAAudioContext& playback, unsigned int timeout_ms = -1);
 
         void printWavHdr(size_t& size);
+        void logPlaybackLatency();
 
     private:
         Logger& m_logger;
         const configuration::AppConfiguration& m_config;
         std::unique_ptr<ISysAlsa> m_sysPlayback{};
         configuration::SpeechRecord m_speechRec;
+        configuration::LatencyProfile m_latencyProfile;
 
         //std::function<void(const std::string&, const bool&)> registerNotify{};
         FILE* m_fp;
         configuration::wavePCMHeader m_waveHeader;
         std::shared_ptr<endpoints::IRTPSession> m_rtpSession;
+        // null without audio.latencyProbe, finds the capture marks after decoding and in the played periods
+        std::shared_ptr<LatencyProbe> m_latencyProbe;
+
+        // rtp receive thread fills a jitter buffer per talker, the ALSA event loop mixes them per period
+        std::unique_ptr<AudioMixer> m_mixer;
+        // codec to device rate and channels, null when the device runs the codec format
+        std::unique_ptr<AudioConverter> m_playbackConverter;
+        // mixed codec frames and the converted frames not yet played, ALSA event loop only
+        std::vector<std::int16_t> m_mixBuffer;
+        std::vector<std::int16_t> m_convertedBuffer;
+        std::size_t m_convertedFrames{ 0 };
+        // configured format, payload type and clock of every talker
+        std::unique_ptr<audio::IAudioCodec> m_codec;
+        // one decoder per talker, the state is kept across talk sessions, receive thread only
+        std::map<std::uint32_t, std::unique_ptr<audio::IAudioCodec>> m_decoders;
+        unsigned int m_sampleRate{ 0 };
+        std::uint8_t m_comfortNoisePayloadType{ 0 };
+        // decode cost and foreign payload types of the current session, receive thread only
+        std::uint64_t m_decodedPackets{ 0 };
+        std::uint64_t m_decodeCpuNanoseconds{ 0 };
+        std::uint64_t m_unexpectedPayloads{ 0 };
+        // RTP receive cost without the waits, compares the transports, receive thread only
+        std::uint64_t m_receivedPackets{ 0 };
+        std::uint64_t m_receiveCpuNanoseconds{ 0 };
     };
 } // namespace usbAudio
\ No newline at end of file
@@ -4,8 +4,14 @@
 #include "Configurations/Configurations.hpp"
 #include "Configurations/ParseConfigFile.hpp"
 #include "logger/Logger.hpp"
+#include "common/SpscByteRing.hpp"
+#include "common/AudioCodec.hpp"
 #include "IAudioRecordService.hpp"
-#include "LinuxAlsa.hpp"
+#include "ISysAlsa.hpp"
+#include "AudioConverter.hpp"
+#include "VoiceActivityDetector.hpp"
+#include "WavFileWriter.hpp"
+#include "LatencyProbe.hpp"
 
 namespace endpoints
 {
@@ -17,7 +23,8 @@ namespace usbAudio
     class AudioRecordService final : public IAudioRecordService
     {
     public:
-        AudioRecordService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession);
+        AudioRecordService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession,
+            std::shared_ptr<LatencyProbe> latencyProbe);
         ~AudioRecordService();
         struct TimeStamp
         {
@@ -34,25 +41,27 @@ namespace usbAudio
         int audioStopListening() override;
 
         void setRegisterNotify(std::function<void(const std::string&, const bool&)> registerNotify);
+        bool setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs) override;
 
     private:
         bool startAnalysisMic();
         void UninitAudioRecord();
-        bool openOutputAudioFile(const std::string& fileName);
-        bool createFilePath(const std::string& fileName);
 
         void speechBegin();
         void speechEnd(const configuration::SpeechEndReason& reason);
 
         void recordCallback(std::string& data);
-        int writeAudioData(const std::string& data);
+        std::string& convertCapture(std::string& data);
         int sendAudioData(const std::string& data);
+        void adaptBitrate();
 
         void endRecordOnError(const int& errorCode);
 
         void destroyRecorder();
         void waitForRecStop(configuration::ALSAAudioContext& recorder, unsigned int timeout_ms = -1);
         bool audioDataConversion(std::string& data);
+        void writeSessionDescription();
+        void logCaptureLatency();
 
     private:
         Logger& m_logger;
@@ -63,11 +72,42 @@ namespace usbAudio
 
         std::function<void(const std::string&, const bool&)> registerNotify{};
         std::unique_ptr<TimeStamp> m_timeStamp;
-        FILE* m_fp;
+        // format of the recorded wav files
         configuration::wavePCMHeader m_waveHeader;
         std::shared_ptr<endpoints::IRTPSession> m_rtpSession;
+        // device to codec rate and channels, null when the device runs the codec format
+        std::unique_ptr<AudioConverter> m_captureConverter;
+        // converted period, ALSA callback only
+        std::string m_convertedData;
+        // lives as long as the service, used by the sender thread only
+        std::unique_ptr<audio::IAudioCodec> m_codec;
+        // null without audio.vadEnable, used by the sender thread only
+        std::unique_ptr<VoiceActivityDetector> m_vad;
+        // audio.adaptiveBitrate with a codec that can change its bitrate, sender thread only
+        bool m_adaptiveBitrate{ false };
+        int m_maxBitrate{ 0 };
+        int m_minBitrate{ 0 };
+        std::uint64_t m_lossReports{ 0 };
+        std::chrono::steady_clock::time_point m_nextBitrateCheck{};
+        // null without audio.enableWriteAudioToFile
+        std::unique_ptr<WavFileWriter> m_fileWriter;
+        // null without audio.latencyProbe, marks the capture and finds the marks before encoding
+        std::shared_ptr<LatencyProbe> m_latencyProbe;
+        configuration::LatencyProfile m_latencyProfile;
+        unsigned short m_deviceChannel{ 1 };
+        unsigned int m_deviceSampleRate{ 0 };
+        // set by speechBegin, the sender resets the encoder before the next packet
+        std::atomic_bool m_resetEncoder{ true };
+        // encode cost of the current talk session, reported by speechEnd
+        std::atomic<std::uint64_t> m_encodedFrames{ 0 };
+        std::atomic<std::uint64_t> m_encodeCpuNanoseconds{ 0 };
+        std::atomic<std::uint64_t> m_suppressedPackets{ 0 };
+        // RTP send and flush cost, compares the transports
+        std::atomic<std::uint64_t> m_sentPackets{ 0 };
+        std::atomic<std::uint64_t> m_sendCpuNanoseconds{ 0 };
+        // ALSA callback to RTP sender handoff of captured PCM, the mutex only serves the sender's wait
+        common::SpscByteRing m_sendRing;
         std::mutex dataMutex;
-        std::vector<std::uint8_t> m_recordDatas;
         std::condition_variable cv;
         std::thread m_rtpSendThread;
     };
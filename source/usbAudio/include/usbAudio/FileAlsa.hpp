@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "ISysAlsa.hpp"
+#include "Configurations/Configurations.hpp"
+#include "logger/Logger.hpp"
+
+namespace usbAudio
+{
+    /*
+     * ISysAlsa without a sound card, for load tests and benchmarks on build servers.
+     * The device name is "file:<path>[,option...]": capture reads 16 bit PCM from a WAV
+     * file in the requested format and starts over at its end, playback writes to a WAV
+     * file (.wav), any other file or /dev/null. Periods are paced on the monotonic clock
+     * like a device. Options:
+     *   fast       no pacing, periods follow each other as fast as the callbacks return
+     *   period=ms  period length, 100 by default, a period time set in the context wins
+     *   xrun=ms    every ms of audio capture loses a period (overrun) or playback plays
+     *              a period of silence (underrun)
+     *   jitter=ms  each period comes up to ms late, the average rate stays exact
+     * The callbacks run on a thread of this object instead of the ALSA event loop.
+     */
+    class FileAlsa final : public ISysAlsa
+    {
+    public:
+        FileAlsa(Logger& logger, std::unique_ptr<configuration::WAVEFORMATEX> waveFormat);
+        ~FileAlsa();
+
+        static bool isFileDevice(const std::string& deviceName);
+
+        configuration::audioDevInfo getDefaultDev() override;
+
+        configuration::audioDevInfo setAudioDev(const std::string& dev) override;
+
+        unsigned int getAudioDevNum(const snd_pcm_stream_t& stream) override;
+
+        int createALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+            std::function<void(std::string& data)> on_data_ind, void* user_cb_para) override;
+        void destroyALSAAudio(configuration::ALSAAudioContext& alsaAudioContext) override;
+
+        int openALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+            const configuration::audioDevInfo& devInfo, const snd_pcm_stream_t& stream) override;
+        void closeALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+            const snd_pcm_stream_t& stream) override;
+
+        int startALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+            const snd_pcm_stream_t& stream) override;
+        int stopALSAAudio(configuration::ALSAAudioContext& alsaAudioContext, const snd_pcm_stream_t& stream) override;
+
+        int isALSAAudioStopped(configuration::ALSAAudioContext& alsaAudioContext) override;
+
+        int readAudioDataToPCM(configuration::ALSAAudioContext& alsaAudioContext) override;
+
+    private:
+        struct Options
+        {
+            std::string path;
+            bool fast{ false };
+            unsigned int periodMs{ 100 };
+            unsigned int xrunMs{ 0 };
+            unsigned int jitterMs{ 0 };
+        };
+
+        bool parseDeviceName(const std::string& deviceName);
+        bool openSource();
+        bool openSink();
+        void closeFile();
+
+        void run(configuration::ALSAAudioContext& alsaAudioContext);
+        // false once the stream thread is asked to stop
+        bool waitForPeriod(bool streamThread);
+        bool isXrunPeriod();
+        bool readPeriod(std::uint8_t* data, std::size_t bytes);
+        void writePeriod(const std::uint8_t* data, std::size_t bytes);
+        void stopThread();
+
+    private:
+        std::shared_ptr<configuration::WAVEFORMATEX> m_waveFormat{};
+        Logger& m_logger;
+        Options m_options;
+        snd_pcm_stream_t m_stream{ SND_PCM_STREAM_CAPTURE };
+
+        FILE* m_file{ nullptr };
+        // capture: the data chunk of the source
+        long m_dataOffset{ 0 };
+        std::size_t m_dataBytes{ 0 };
+        std::size_t m_dataPosition{ 0 };
+        // playback: sizes patched into the header on close, when the sink is a WAV file
+        bool m_wavSink{ false };
+        configuration::wavePCMHeader m_sinkHeader;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_running{ false };
+        std::thread m_thread;
+
+        // pacing, the stream thread or the readAudioDataToPCM caller
+        std::chrono::steady_clock::duration m_periodDuration{};
+        std::chrono::steady_clock::time_point m_nextPeriod{};
+        std::uint64_t m_periodsPerXrun{ 0 };
+        std::mt19937 m_random;
+        // statistics of the current start, logged by stop
+        std::chrono::steady_clock::time_point m_startTime{};
+        std::uint64_t m_periods{ 0 };
+        std::uint64_t m_xruns{ 0 };
+        std::uint64_t m_sourceLoops{ 0 };
+        double m_slowestCallbackMs{ 0.0 };
+    };
+} // namespace usbAudio
@@ -12,6 +12,8 @@ namespace usbAudio
 
         virtual int audioStartPlaying() = 0;
         virtual int audioStopPlaying() = 0;
+        // reopens the stopped device with new period and buffer times in us, 0 for those of the latency profile
+        virtual bool setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs) = 0;
         //virtual void setRegisterNotify(std::function<void(const std::string& result, const bool& isLast)>) = 0;
     };
 } // namespace usbAudio
\ No newline at end of file
@@ -13,5 +13,7 @@ namespace usbAudio
         virtual int audioStartListening() = 0;
         virtual int audioStopListening() = 0;
         virtual void setRegisterNotify(std::function<void(const std::string& result, const bool& isLast)>) = 0;
+        // reopens the stopped device with new period and buffer times in us, 0 for those of the latency profile
+        virtual bool setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs) = 0;
     };
 } // namespace usbAudio
\ No newline at end of file
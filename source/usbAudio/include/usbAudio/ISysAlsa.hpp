@@ -1,5 +1,7 @@
 #pragma once
+#include <memory>
 #include "Configurations/Configurations.hpp"
+#include "logger/LoggerFwd.hpp"
 
 extern "C"
 {
@@ -90,4 +92,14 @@ namespace usbAudio
         */
         virtual int readAudioDataToPCM(configuration::ALSAAudioContext& alsaAudioContext) = 0;
     };
+
+    /*
+     * The sound card for deviceName: a "file:" device runs on FileAlsa without hardware,
+     * any other name on LinuxAlsa.
+     */
+    std::unique_ptr<ISysAlsa> createSysAlsa(Logger& logger, std::unique_ptr<configuration::WAVEFORMATEX> waveFormat,
+        const std::string& deviceName);
+
+    // period, buffer and wakeup geometry of the profile for the next openALSAAudio
+    void applyLatencyProfile(configuration::ALSAAudioContext& alsaAudioContext, const configuration::LatencyProfile& profile);
 } // namespace usbAudio
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace usbAudio
+{
+    struct JitterBufferStatistics
+    {
+        std::uint64_t receivedPackets{ 0 };
+        // from sequence number gaps, negative with duplicates
+        std::int64_t lostPackets{ 0 };
+        std::uint64_t latePackets{ 0 };
+        std::uint64_t duplicatePackets{ 0 };
+        // frames filled by concealment and frames skipped to shrink the delay
+        std::uint64_t concealedFrames{ 0 };
+        std::uint64_t skippedFrames{ 0 };
+        std::uint64_t comfortNoisePackets{ 0 };
+        double jitterMs{ 0.0 };
+        double targetDelayMs{ 0.0 };
+        double bufferedMs{ 0.0 };
+    };
+
+    /*
+     * Adaptive playout buffer for the RTP receive path. Packets are stored as decoded PCM
+     * ordered by their (unwrapped) RTP timestamp, so reordered packets fall into place and
+     * duplicates or packets behind the playout position are dropped. The target depth
+     * follows the RFC 3550 interarrival jitter between minDelayMs and maxDelayMs.
+     * Playout pulls fixed sized chunks; holes are concealed by repeating the last played
+     * audio with a fade out, a long underrun goes back to buffering.
+     * A sender with voice activity detection stops during silence: a comfort noise packet
+     * sets the background level played until speech is back, and a marker (talkspurt
+     * start) found with an empty buffer builds the delay up again from that packet.
+     * RTP timestamps count at rtpClockRate (opus is always 48000), the buffer works in
+     * frames at the device sampleRate.
+     * The RTCP jitter of the session (taken on every packet at the socket, late ones too)
+     * is a floor for the own estimate.
+     * push() and pop() may run on different threads.
+     */
+    class JitterBuffer final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        JitterBuffer(unsigned int sampleRate, unsigned int rtpClockRate, unsigned int channels,
+            unsigned int minDelayMs, unsigned int maxDelayMs);
+
+        // frames of interleaved pcm starting at rtpTimestamp
+        void push(std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+            const std::int16_t* pcm, std::size_t frames, Clock::time_point arrivalTime, bool marker = false);
+        // RFC 3389 comfort noise, noiseLevel in -dBov
+        void pushComfortNoise(std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber, std::uint8_t noiseLevel);
+        // RTCP interarrival jitter of the source, kept until reset
+        void setNetworkJitter(double jitterMs);
+        // always fills frames of interleaved pcm, false while buffering (silence)
+        bool pop(std::int16_t* pcm, std::size_t frames);
+        void reset();
+
+        JitterBufferStatistics getStatistics() const;
+        unsigned int getChannels() const { return m_channels; }
+
+    private:
+        std::int64_t unwrapTimestamp(std::uint32_t rtpTimestamp);
+        void updateJitter(std::int64_t timestamp, Clock::time_point arrivalTime);
+        void updateSequence(std::uint16_t sequenceNumber);
+        std::size_t getTargetFrames() const;
+        std::int64_t getBufferedEnd() const;
+        void playFrames(const std::int16_t* source, std::size_t frames, std::int16_t* pcm);
+        void concealFrames(std::size_t frames, std::int16_t* pcm);
+        float nextNoise();
+
+    private:
+        const unsigned int m_sampleRate;
+        const unsigned int m_rtpClockRate;
+        const unsigned int m_channels;
+        const std::size_t m_minDelayFrames;
+        const std::size_t m_maxDelayFrames;
+
+        mutable std::mutex m_mutex;
+        // interleaved pcm by unwrapped timestamp
+        std::map<std::int64_t, std::vector<std::int16_t>> m_packets;
+        bool m_haveTimestamp{ false };
+        std::uint32_t m_lastTimestamp{ 0 };
+        std::int64_t m_lastExtendedTimestamp{ 0 };
+        std::size_t m_packetFrames{ 0 };
+
+        bool m_playing{ false };
+        std::int64_t m_playoutTimestamp{ 0 };
+
+        // RFC 3550 A.8, in timestamp units
+        bool m_haveTransit{ false };
+        double m_lastTransit{ 0.0 };
+        double m_jitter{ 0.0 };
+        Clock::time_point m_epoch;
+        // frames, from RTCP
+        double m_networkJitter{ 0.0 };
+
+        bool m_haveSequence{ false };
+        std::int64_t m_maxSequence{ 0 };
+
+        // last played audio for concealment
+        std::vector<std::int16_t> m_history;
+        std::size_t m_historyPosition{ 0 };
+        std::size_t m_concealOffset{ 0 };
+        float m_concealGain{ 1.0f };
+        std::size_t m_concealedRun{ 0 };
+
+        // uniform noise peak for the signalled comfort noise level, 0 while speech plays
+        float m_comfortNoiseAmplitude{ 0.0f };
+        std::uint32_t m_noiseState{ 0x9E3779B9u };
+
+        JitterBufferStatistics m_statistics;
+    };
+} // namespace usbAudio
@@ -0,0 +1,138 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "logger/Logger.hpp"
+
+namespace usbAudio
+{
+    /*
+     * Measures the talk path latency in a loopback (rtp remote address and port set to
+     * the own receive port). Every intervalMs the capture callback replaces the start of
+     * a period with a short 1 kHz marker tone; a Goertzel detector finds its onset again
+     * after the send ring, after the RTP receive and decode, and in the playback period.
+     * The stages of one marker:
+     *   capture   sample captured to capture callback, the capture period
+     *   send      callback to encode, send ring batching and the sender thread wakeup
+     *   network   encode to decode, socket and RTP receive polling
+     *   jitter    decode to mixed into a playback period, jitter buffer and conversion
+     *   playback  mixed to played, the periods queued in the device (estimated)
+     * The interval must be longer than the total latency, a detection belongs to the
+     * newest marker that passed the previous stage.
+     * Each on...() hook is called by one thread only: capture callback, sender, RTP
+     * receiver and playback event loop.
+     */
+    class LatencyProbe final
+    {
+    public:
+        enum Stage
+        {
+            STAGE_CAPTURE,
+            STAGE_SEND,
+            STAGE_NETWORK,
+            STAGE_JITTER,
+            STAGE_PLAYBACK,
+            STAGE_TOTAL,
+            STAGE_COUNT,
+        };
+
+        struct Summary
+        {
+            std::size_t markers{ 0 };
+            std::size_t lostMarkers{ 0 };
+            std::array<double, STAGE_COUNT> p50Ms{};
+            std::array<double, STAGE_COUNT> p99Ms{};
+        };
+
+        using Clock = std::chrono::steady_clock;
+
+        LatencyProbe(Logger& logger, unsigned int intervalMs);
+
+        // interleaved 16 bit pcm of one capture period, the marker is written into it
+        void onCapture(std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate);
+        // pcm as taken from the send ring, before voice detection and encoding
+        void onSend(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate);
+        // decoded pcm of one received packet
+        void onReceive(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate);
+        // one playback period, queuedFrames are in the device ahead of it
+        void onPlayback(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate,
+            std::size_t queuedFrames);
+
+        // forgets markers and results, the hooks pick the reset up with their next call
+        void reset();
+        // false if fewer markers completed before the timeout
+        bool waitForMarkers(std::size_t markers, std::chrono::milliseconds timeout);
+        // logs p50/p99 of every stage since the last reset
+        Summary report(const std::string& label);
+
+    private:
+        // marker tone detector of one stage, used by the thread of that stage only
+        struct Detector
+        {
+            unsigned int generation{ 0 };
+            unsigned int sampleRate{ 0 };
+            std::size_t blockFrames{ 0 };
+            double coefficient{ 0.0 };
+            double s1{ 0.0 };
+            double s2{ 0.0 };
+            double energy{ 0.0 };
+            std::size_t count{ 0 };
+            double previousAmplitude{ 0.0 };
+            bool armed{ true };
+            unsigned int quietBlocks{ 0 };
+        };
+
+        // the points between the stages: captured, callback, sent, received, mixed, played
+        enum Point
+        {
+            POINT_CAPTURED,
+            POINT_CALLBACK,
+            POINT_SENT,
+            POINT_RECEIVED,
+            POINT_MIXED,
+            POINT_PLAYED,
+            POINT_COUNT,
+        };
+
+        struct Marker
+        {
+            std::uint32_t id{ 0 };
+            std::array<Clock::time_point, POINT_COUNT> times{};
+            // points set so far, in order
+            unsigned int passed{ 0 };
+        };
+
+        void prepare(Detector& detector, unsigned int sampleRate);
+        // onset offset in frames from the start of pcm, negative if it began before
+        bool detect(Detector& detector, const std::int16_t* pcm, std::size_t frames, unsigned int channels, double& onset);
+        void passPoint(unsigned int point, Clock::time_point time);
+
+    private:
+        Logger& m_logger;
+        const Clock::duration m_interval;
+        std::atomic<unsigned int> m_generation{ 0 };
+
+        // capture callback only
+        unsigned int m_captureGeneration{ 0 };
+        Clock::time_point m_nextMarker{};
+        std::size_t m_toneFramesLeft{ 0 };
+        double m_tonePhase{ 0.0 };
+
+        Detector m_sendDetector;
+        Detector m_receiveDetector;
+        Detector m_playbackDetector;
+
+        std::mutex m_mutex;
+        std::condition_variable m_completed;
+        std::uint32_t m_nextId{ 0 };
+        std::deque<Marker> m_markers;
+        std::array<std::vector<double>, STAGE_COUNT> m_stageMs;
+        std::size_t m_lostMarkers{ 0 };
+    };
+} // namespace usbAudio
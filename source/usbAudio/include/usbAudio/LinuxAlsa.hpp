@@ -1,5 +1,6 @@
 #pragma once
 #include "ISysAlsa.hpp"
+#include "AlsaEventLoop.hpp"
 #include "Configurations/Configurations.hpp"
 #include "logger/Logger.hpp"
 
@@ -55,9 +56,14 @@ namespace usbAudio
         bool setHWParams(configuration::ALSAAudioContext& alsaAudioContext);
         bool setSWParams(configuration::ALSAAudioContext& alsaAudioContext);
 
-        void createCallbackThread(configuration::ALSAAudioContext& alsaAudioContext);
-        int pcmRead(configuration::ALSAAudioContext & alsaAudioContext, const size_t& frameSize);
+        void onCaptureReady(configuration::ALSAAudioContext& alsaAudioContext);
+        void onPlaybackReady(configuration::ALSAAudioContext& alsaAudioContext);
+        int pcmRead(configuration::ALSAAudioContext & alsaAudioContext, const size_t& frameSize, std::uint8_t* audioBuffer);
         int pcmWrite(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize);
+        int pcmMmapTransfer(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize,
+            std::uint8_t* audioData, const snd_pcm_stream_t& stream);
+        // mmap playback is not started by the start threshold, a prepared stream is started here once enough is queued
+        void startMmapPlayback(configuration::ALSAAudioContext& alsaAudioContext);
         int xRunRecovery(configuration::ALSAAudioContext& alsaAudioContext, const snd_pcm_sframes_t& data);
 
         std::string coverToDescription(const snd_pcm_state_t& state);
@@ -65,5 +71,6 @@ namespace usbAudio
     private:
         std::shared_ptr<configuration::WAVEFORMATEX> m_waveFormat{};
         Logger& m_logger;
+        std::shared_ptr<AlsaEventLoop> m_eventLoop;
     };
 } // namespace usbAudio
\ No newline at end of file
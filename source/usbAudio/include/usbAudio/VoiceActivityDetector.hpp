@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace usbAudio
+{
+    /*
+     * Energy and zero crossing voice activity detector for the talk sender, runs on the
+     * captured PCM before it is encoded. A frame is speech when its energy is thresholdDb
+     * over the tracked background noise floor, or half of that with a zero crossing rate
+     * of unvoiced speech (fricatives are quiet but busy). After speech the decision holds
+     * for hangoverMs so word endings are not clipped.
+     * Not thread safe, the sender thread owns it.
+     */
+    class VoiceActivityDetector final
+    {
+    public:
+        VoiceActivityDetector(unsigned int sampleRate, unsigned int channels, unsigned int thresholdDb, unsigned int hangoverMs);
+
+        // frames of interleaved pcm, true while speech or in the hangover after it
+        bool process(const std::int16_t* pcm, std::size_t frames);
+        // new talk session, the noise floor is kept
+        void reset();
+
+        // background noise for an RFC 3389 comfort noise payload, in -dBov (0-127)
+        std::uint8_t getNoiseLevel() const;
+
+    private:
+        void updateNoiseFloor(double energyDb, std::size_t frames);
+
+    private:
+        const unsigned int m_sampleRate;
+        const unsigned int m_channels;
+        const double m_thresholdDb;
+        const std::size_t m_hangoverFrames;
+
+        bool m_haveNoiseFloor{ false };
+        double m_noiseFloorDb{ 0.0 };
+        std::size_t m_hangoverRemaining{ 0 };
+    };
+} // namespace usbAudio
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Configurations/Configurations.hpp"
+#include "logger/Logger.hpp"
+#include "common/SpscByteRing.hpp"
+
+namespace usbAudio
+{
+    /*
+     * Writes the captured audio to WAV files on its own thread, so a slow SD card never
+     * blocks the ALSA callback. write() only copies into a lock-free ring sized for
+     * bufferBytes; the writer drains it in large blocks. Every checkpoint the RIFF sizes
+     * are patched and the file synced, a crash keeps a valid WAV up to the last
+     * checkpoint. A new file is started every rotateSeconds of audio, in step with the
+     * video segments.
+     * start() and stop() are called while capture is stopped, write() from the capture
+     * thread only.
+     */
+    class WavFileWriter final
+    {
+    public:
+        using FileNameGenerator = std::function<std::string()>;
+
+        WavFileWriter(Logger& logger, std::size_t bufferBytes, unsigned int checkpointMs, unsigned int rotateSeconds);
+        ~WavFileWriter();
+
+        // the header gives the format, the sizes are kept by the writer
+        void start(const configuration::wavePCMHeader& header, FileNameGenerator nextFileName);
+        // false if the data was dropped because the writer fell behind
+        bool write(const std::uint8_t* data, std::size_t length);
+        // writes what is buffered, finalizes and closes the file
+        void stop();
+
+    private:
+        enum class Request
+        {
+            NONE,
+            START,
+            STOP,
+        };
+
+        void run();
+        void drain(bool all);
+        bool openFile();
+        void writeHeader();
+        void closeFile();
+
+    private:
+        Logger& m_logger;
+        const unsigned int m_checkpointMs;
+        const unsigned int m_rotateSeconds;
+        common::SpscByteRing m_ring;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_requestDone;
+        bool m_running{ true };
+        Request m_request{ Request::NONE };
+        configuration::wavePCMHeader m_pendingHeader;
+        FileNameGenerator m_pendingFileName;
+
+        // writer thread only
+        FILE* m_fp{ nullptr };
+        configuration::wavePCMHeader m_header;
+        FileNameGenerator m_nextFileName;
+        std::size_t m_blockBytes{ 0 };
+        std::size_t m_checkpointBytes{ 0 };
+        std::size_t m_rotateBytes{ 0 };
+        std::size_t m_uncheckpointedBytes{ 0 };
+        std::vector<std::uint8_t> m_scratch;
+        // session statistics, logged by stop
+        std::uint64_t m_writtenBytes{ 0 };
+        std::uint64_t m_files{ 0 };
+        double m_slowestWriteMs{ 0.0 };
+
+        std::thread m_thread;
+    };
+} // namespace usbAudio
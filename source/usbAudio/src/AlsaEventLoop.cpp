@@ -0,0 +1,192 @@
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "usbAudio/AlsaEventLoop.hpp"
+#include "logger/Logger.hpp"
+
+namespace usbAudio
+{
+    std::shared_ptr<AlsaEventLoop> AlsaEventLoop::getInstance()
+    {
+        static std::mutex instanceMutex;
+        static std::weak_ptr<AlsaEventLoop> instance;
+
+        std::lock_guard<std::mutex> lock(instanceMutex);
+        std::shared_ptr<AlsaEventLoop> eventLoop = instance.lock();
+        if (not eventLoop)
+        {
+            eventLoop = std::make_shared<AlsaEventLoop>();
+            instance = eventLoop;
+        }
+        return eventLoop;
+    }
+
+    AlsaEventLoop::AlsaEventLoop()
+        : m_eventFd{ eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }
+    {
+        if (0 > m_eventFd)
+        {
+            LOG_ERROR_MSG("Create ALSA event loop eventfd failed {}.", std::strerror(errno));
+            return;
+        }
+        m_thread = std::thread([this]()
+        {
+            this->run();
+        });
+    }
+
+    AlsaEventLoop::~AlsaEventLoop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        wakeUp();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        if (0 <= m_eventFd)
+        {
+            close(m_eventFd);
+        }
+    }
+
+    bool AlsaEventLoop::addPCM(snd_pcm_t* pcmHandle, Handler handler)
+    {
+        if (nullptr == pcmHandle or 0 > m_eventFd)
+        {
+            return false;
+        }
+        int count = snd_pcm_poll_descriptors_count(pcmHandle);
+        if (0 >= count)
+        {
+            LOG_ERROR_MSG("PCM poll descriptors not available {}.", count);
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_registrations[pcmHandle] = Registration{ std::move(handler), static_cast<unsigned int>(count) };
+            m_changed = true;
+        }
+        wakeUp();
+        return true;
+    }
+
+    void AlsaEventLoop::removePCM(snd_pcm_t* pcmHandle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (0 == m_registrations.erase(pcmHandle))
+            {
+                return;
+            }
+            m_changed = true;
+        }
+        wakeUp();
+
+        // let a handler that is running right now finish, the loop looks the
+        // registration up again before every call
+        if (std::this_thread::get_id() != m_thread.get_id())
+        {
+            std::lock_guard<std::mutex> dispatch(m_dispatchMutex);
+        }
+    }
+
+    void AlsaEventLoop::wakeUp()
+    {
+        const uint64_t value = 1;
+        if (0 <= m_eventFd and sizeof(value) != write(m_eventFd, &value, sizeof(value)))
+        {
+            LOG_WARNING_MSG("Wake up ALSA event loop failed {}.", std::strerror(errno));
+        }
+    }
+
+    void AlsaEventLoop::rebuildPollDescriptors()
+    {
+        m_pollDescriptors.clear();
+        m_pollOwners.clear();
+        m_pollDescriptors.push_back(pollfd{ m_eventFd, POLLIN, 0 });
+        for (const auto& registration : m_registrations)
+        {
+            const std::size_t offset = m_pollDescriptors.size();
+            m_pollDescriptors.resize(offset + registration.second.descriptorCount);
+            int count = snd_pcm_poll_descriptors(registration.first, &m_pollDescriptors[offset], registration.second.descriptorCount);
+            if (0 > count)
+            {
+                LOG_ERROR_MSG("Get PCM poll descriptors failed {}.", snd_strerror(count));
+                count = 0;
+            }
+            m_pollDescriptors.resize(offset + count);
+            m_pollOwners.emplace_back(registration.first, static_cast<unsigned int>(count));
+        }
+        m_changed = false;
+    }
+
+    void AlsaEventLoop::run()
+    {
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (not m_running)
+                {
+                    break;
+                }
+                if (m_changed)
+                {
+                    rebuildPollDescriptors();
+                }
+            }
+
+            // no timeout, only ALSA or a registration change wakes the loop
+            int ret = poll(m_pollDescriptors.data(), m_pollDescriptors.size(), -1);
+            if (0 > ret)
+            {
+                if (EINTR != errno)
+                {
+                    LOG_ERROR_MSG("ALSA event loop poll failed {}.", std::strerror(errno));
+                }
+                continue;
+            }
+            if (m_pollDescriptors[0].revents & POLLIN)
+            {
+                uint64_t value = 0;
+                while (sizeof(value) == read(m_eventFd, &value, sizeof(value)))
+                {
+                }
+            }
+
+            std::lock_guard<std::mutex> dispatch(m_dispatchMutex);
+            std::size_t offset = 1;
+            for (const auto& owner : m_pollOwners)
+            {
+                struct pollfd* descriptors = &m_pollDescriptors[offset];
+                offset += owner.second;
+
+                // a removed PCM may be closed already, never touch it
+                Handler handler;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto registration = m_registrations.find(owner.first);
+                    if (m_registrations.end() == registration)
+                    {
+                        continue;
+                    }
+                    handler = registration->second.handler;
+                }
+
+                unsigned short revents = 0;
+                if (0 == owner.second or
+                    0 > snd_pcm_poll_descriptors_revents(owner.first, descriptors, owner.second, &revents) or
+                    0 == revents)
+                {
+                    continue;
+                }
+                handler(revents);
+            }
+        }
+    }
+} // namespace usbAudio
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_CONVERTER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_CONVERTER_SSE2
+#endif
+#include "usbAudio/AudioConverter.hpp"
+
+namespace
+{
+    // input frames per filter pass, bounds the history buffers
+    constexpr std::size_t chunkFrames = 256;
+    // sinc zero crossings each side at the lower of the two rates, and its window
+    constexpr unsigned int zeroCrossings = 8;
+    constexpr double kaiserBeta = 8.0;
+    // cutoff as a fraction of the lower nyquist rate
+    constexpr double passband = 0.9;
+    // taps are padded to a whole number of vectors
+    constexpr std::size_t tapAlignment = 8;
+    constexpr int coefficientShift = 15;
+    constexpr double coefficientScale = 1 << coefficientShift;
+    constexpr double pi = 3.14159265358979323846;
+
+    unsigned int greatestCommonDivisor(unsigned int a, unsigned int b)
+    {
+        while (0 != b)
+        {
+            const unsigned int rest = a % b;
+            a = b;
+            b = rest;
+        }
+        return a;
+    }
+
+    // modified Bessel function of the first kind, order 0, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 and term > 1e-12 * sum; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    std::int16_t saturate(std::int32_t value)
+    {
+        return static_cast<std::int16_t>(std::min(std::max(value, -32768), 32767));
+    }
+
+    // taps is a multiple of tapAlignment
+    std::int32_t dotProduct(const std::int16_t* samples, const std::int16_t* coefficients, std::size_t taps)
+    {
+#if defined(AUDIO_CONVERTER_NEON)
+        int32x4_t sum = vdupq_n_s32(0);
+        for (std::size_t i = 0; i < taps; i += 8)
+        {
+            const int16x8_t x = vld1q_s16(samples + i);
+            const int16x8_t h = vld1q_s16(coefficients + i);
+            sum = vmlal_s16(sum, vget_low_s16(x), vget_low_s16(h));
+            sum = vmlal_s16(sum, vget_high_s16(x), vget_high_s16(h));
+        }
+        const int32x2_t pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+        return vget_lane_s32(vpadd_s32(pair, pair), 0);
+#elif defined(AUDIO_CONVERTER_SSE2)
+        __m128i sum = _mm_setzero_si128();
+        for (std::size_t i = 0; i < taps; i += 8)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(x, h));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+#else
+        std::int32_t sum = 0;
+        for (std::size_t i = 0; i < taps; i++)
+        {
+            sum += static_cast<std::int32_t>(samples[i]) * coefficients[i];
+        }
+        return sum;
+#endif
+    }
+} // namespace
+
+namespace usbAudio
+{
+    AudioConverter::AudioConverter(unsigned int inputRate, unsigned int inputChannels, unsigned int outputRate, unsigned int outputChannels)
+        : m_inputRate{ std::max(inputRate, 1u) }
+        , m_inputChannels{ std::max(inputChannels, 1u) }
+        , m_outputRate{ std::max(outputRate, 1u) }
+        , m_outputChannels{ std::max(outputChannels, 1u) }
+        , m_channels{ std::min(m_inputChannels, m_outputChannels) }
+    {
+        const unsigned int divisor = greatestCommonDivisor(m_inputRate, m_outputRate);
+        m_interpolation = m_outputRate / divisor;
+        m_decimation = m_inputRate / divisor;
+        if (m_inputRate != m_outputRate)
+        {
+            designFilter();
+            m_history.assign(m_channels, std::vector<std::int16_t>(m_taps - 1 + chunkFrames, 0));
+        }
+        reset();
+    }
+
+    void AudioConverter::designFilter()
+    {
+        // cutoff relative to the input rate, narrower when decimating
+        const double ratio = std::min(1.0, static_cast<double>(m_interpolation) / m_decimation);
+        m_taps = static_cast<std::size_t>(std::ceil(2.0 * zeroCrossings / ratio));
+        m_taps = (m_taps + tapAlignment - 1) / tapAlignment * tapAlignment;
+
+        // prototype at the upsampled rate, cutoff in cycles per upsampled sample
+        const std::size_t length = m_taps * m_interpolation;
+        const double cutoff = passband * ratio / (2.0 * m_interpolation);
+        const double center = (length - 1) / 2.0;
+        const double windowScale = 1.0 / besselI0(kaiserBeta);
+        std::vector<double> prototype(length);
+        for (std::size_t n = 0; n < length; n++)
+        {
+            const double t = n - center;
+            const double sinc = 0.0 == t ? 1.0 : std::sin(2.0 * pi * cutoff * t) / (2.0 * pi * cutoff * t);
+            const double position = t / (length / 2.0);
+            const double window = besselI0(kaiserBeta * std::sqrt(std::max(0.0, 1.0 - position * position))) * windowScale;
+            prototype[n] = sinc * window;
+        }
+
+        // phase p uses prototype[p + k * L] on input i - k; every phase is normalised to
+        // unity gain so there is no DC ripple between phases
+        m_coefficients.assign(m_interpolation * m_taps, 0);
+        for (unsigned int phase = 0; phase < m_interpolation; phase++)
+        {
+            double sum = 0.0;
+            for (std::size_t k = 0; k < m_taps; k++)
+            {
+                sum += prototype[phase + k * m_interpolation];
+            }
+            for (std::size_t k = 0; k < m_taps; k++)
+            {
+                const double coefficient = prototype[phase + k * m_interpolation] / sum;
+                m_coefficients[phase * m_taps + (m_taps - 1 - k)] =
+                    saturate(static_cast<std::int32_t>(std::lround(coefficient * coefficientScale)));
+            }
+        }
+    }
+
+    std::size_t AudioConverter::getMaxOutputFrames(std::size_t inputFrames) const
+    {
+        return (inputFrames * m_interpolation + m_decimation - 1) / m_decimation + 1;
+    }
+
+    double AudioConverter::getLatencyFrames() const
+    {
+        return m_taps / 2.0 * m_outputRate / m_inputRate;
+    }
+
+    void AudioConverter::reset()
+    {
+        for (auto& history : m_history)
+        {
+            std::fill(history.begin(), history.end(), 0);
+        }
+        m_nextInput = 0 < m_taps ? m_taps - 1 : 0;
+        m_phase = 0;
+    }
+
+    std::size_t AudioConverter::process(const std::int16_t* input, std::size_t inputFrames, std::int16_t* output)
+    {
+        if (m_inputRate == m_outputRate)
+        {
+            return convertChannels(input, inputFrames, output);
+        }
+
+        const std::int32_t rounding = 1 << (coefficientShift - 1);
+        std::size_t produced = 0;
+        while (0 < inputFrames)
+        {
+            const std::size_t frames = std::min(inputFrames, chunkFrames);
+            loadChunk(input, frames);
+
+            const std::size_t end = m_taps - 1 + frames;
+            while (m_nextInput < end)
+            {
+                const std::int16_t* coefficients = &m_coefficients[m_phase * m_taps];
+                std::int16_t* target = output + produced * m_outputChannels;
+                for (unsigned int channel = 0; channel < m_channels; channel++)
+                {
+                    const std::int16_t* samples = &m_history[channel][m_nextInput + 1 - m_taps];
+                    target[channel] = saturate((dotProduct(samples, coefficients, m_taps) + rounding) >> coefficientShift);
+                }
+                // mono to more channels
+                for (unsigned int channel = m_channels; channel < m_outputChannels; channel++)
+                {
+                    target[channel] = target[0];
+                }
+                produced++;
+
+                m_phase += m_decimation;
+                m_nextInput += m_phase / m_interpolation;
+                m_phase %= m_interpolation;
+            }
+
+            // keep the newest taps - 1 samples as history of the next chunk
+            for (auto& history : m_history)
+            {
+                memmove(history.data(), history.data() + frames, (m_taps - 1) * sizeof(std::int16_t));
+            }
+            m_nextInput -= frames;
+            input += frames * m_inputChannels;
+            inputFrames -= frames;
+        }
+        return produced;
+    }
+
+    void AudioConverter::loadChunk(const std::int16_t* input, std::size_t frames)
+    {
+        const std::size_t offset = m_taps - 1;
+        if (m_inputChannels == m_channels)
+        {
+            for (unsigned int channel = 0; channel < m_channels; channel++)
+            {
+                std::int16_t* history = &m_history[channel][offset];
+                for (std::size_t frame = 0; frame < frames; frame++)
+                {
+                    history[frame] = input[frame * m_inputChannels + channel];
+                }
+            }
+            return;
+        }
+
+        // more input than output channels, average down to mono
+        std::int16_t* history = &m_history[0][offset];
+        for (std::size_t frame = 0; frame < frames; frame++)
+        {
+            std::int32_t sum = 0;
+            for (unsigned int channel = 0; channel < m_inputChannels; channel++)
+            {
+                sum += input[frame * m_inputChannels + channel];
+            }
+            history[frame] = static_cast<std::int16_t>(sum / static_cast<std::int32_t>(m_inputChannels));
+        }
+    }
+
+    std::size_t AudioConverter::convertChannels(const std::int16_t* input, std::size_t frames, std::int16_t* output) const
+    {
+        if (m_inputChannels == m_outputChannels)
+        {
+            memmove(output, input, frames * m_inputChannels * sizeof(std::int16_t));
+            return frames;
+        }
+        for (std::size_t frame = 0; frame < frames; frame++)
+        {
+            std::int32_t sum = 0;
+            for (unsigned int channel = 0; channel < m_inputChannels; channel++)
+            {
+                sum += input[frame * m_inputChannels + channel];
+            }
+            const std::int16_t mixed = m_outputChannels < m_inputChannels ?
+                static_cast<std::int16_t>(sum / static_cast<std::int32_t>(m_inputChannels)) : input[frame * m_inputChannels];
+            for (unsigned int channel = 0; channel < m_outputChannels; channel++)
+            {
+                output[frame * m_outputChannels + channel] = mixed;
+            }
+        }
+        return frames;
+    }
+} // namespace usbAudio
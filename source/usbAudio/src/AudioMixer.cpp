@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cstring>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_MIXER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2
+#endif
+#include "usbAudio/AudioMixer.hpp"
+
+namespace
+{
+    // gains are Q14, unity is 1 << 14 and the largest just under 2
+    constexpr int gainShift = 14;
+    constexpr std::int16_t unityGain = 1 << gainShift;
+    constexpr unsigned int maxGainPercent = 199;
+    constexpr unsigned int percent = 100;
+    // a slot without packets for this long is given to a new talker
+    constexpr auto sourceIdleTimeout = std::chrono::seconds(3);
+
+    std::int16_t toGain(unsigned int gainPercent)
+    {
+        return static_cast<std::int16_t>(std::min(gainPercent, maxGainPercent) * unityGain / percent);
+    }
+
+    std::int16_t saturate(std::int32_t value)
+    {
+        return static_cast<std::int16_t>(std::min(std::max(value, -32768), 32767));
+    }
+
+    // out = sat(out + sat(in * gain)), samples of any channel layout
+    void mixSamples(std::int16_t* out, const std::int16_t* in, std::size_t samples, std::int16_t gain)
+    {
+        std::size_t i = 0;
+#if defined(AUDIO_MIXER_NEON)
+        if (unityGain == gain)
+        {
+            for (; i + 8 <= samples; i += 8)
+            {
+                vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), vld1q_s16(in + i)));
+            }
+        }
+        else
+        {
+            const int16x4_t gains = vdup_n_s16(gain);
+            for (; i + 8 <= samples; i += 8)
+            {
+                const int16x8_t samples8 = vld1q_s16(in + i);
+                const int16x8_t scaled = vcombine_s16(
+                    vqrshrn_n_s32(vmull_s16(vget_low_s16(samples8), gains), gainShift),
+                    vqrshrn_n_s32(vmull_s16(vget_high_s16(samples8), gains), gainShift));
+                vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), scaled));
+            }
+        }
+#elif defined(AUDIO_MIXER_SSE2)
+        if (unityGain == gain)
+        {
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i* target = reinterpret_cast<__m128i*>(out + i);
+                const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                _mm_storeu_si128(target, _mm_adds_epi16(_mm_loadu_si128(target), source));
+            }
+        }
+        else
+        {
+            const __m128i gains = _mm_set1_epi16(gain);
+            const __m128i rounding = _mm_set1_epi32(1 << (gainShift - 1));
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i* target = reinterpret_cast<__m128i*>(out + i);
+                const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                // 32 bit products from the low and high halves
+                const __m128i productLow = _mm_mullo_epi16(source, gains);
+                const __m128i productHigh = _mm_mulhi_epi16(source, gains);
+                const __m128i low = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(productLow, productHigh), rounding), gainShift);
+                const __m128i high = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(productLow, productHigh), rounding), gainShift);
+                _mm_storeu_si128(target, _mm_adds_epi16(_mm_loadu_si128(target), _mm_packs_epi32(low, high)));
+            }
+        }
+#endif
+        for (; i < samples; i++)
+        {
+            const std::int16_t scaled = saturate((static_cast<std::int32_t>(in[i]) * gain + (1 << (gainShift - 1))) >> gainShift);
+            out[i] = saturate(static_cast<std::int32_t>(out[i]) + scaled);
+        }
+    }
+} // namespace
+
+namespace usbAudio
+{
+    AudioMixer::AudioMixer(unsigned int sampleRate, unsigned int rtpClockRate, unsigned int channels,
+        unsigned int minDelayMs, unsigned int maxDelayMs, unsigned int maxSources, unsigned int gainPercent)
+        : m_channels{ std::max(channels, 1u) }
+        , m_defaultGain{ toGain(gainPercent) }
+        , m_sources(std::max(maxSources, 1u))
+    {
+        for (auto& source : m_sources)
+        {
+            source.jitterBuffer = std::make_unique<JitterBuffer>(sampleRate, rtpClockRate, channels, minDelayMs, maxDelayMs);
+        }
+    }
+
+    bool AudioMixer::push(std::uint32_t ssrc, std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+        const std::int16_t* pcm, std::size_t frames, JitterBuffer::Clock::time_point arrivalTime, bool marker)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Source* source = findSource(ssrc, arrivalTime);
+        if (nullptr == source)
+        {
+            return false;
+        }
+        source->jitterBuffer->push(rtpTimestamp, sequenceNumber, pcm, frames, arrivalTime, marker);
+        return true;
+    }
+
+    bool AudioMixer::pushComfortNoise(std::uint32_t ssrc, std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+        std::uint8_t noiseLevel, JitterBuffer::Clock::time_point arrivalTime)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Source* source = findSource(ssrc, arrivalTime);
+        if (nullptr == source)
+        {
+            return false;
+        }
+        source->jitterBuffer->pushComfortNoise(rtpTimestamp, sequenceNumber, noiseLevel);
+        return true;
+    }
+
+    void AudioMixer::mix(std::int16_t* pcm, std::size_t frames)
+    {
+        const std::size_t samples = frames * m_channels;
+        memset(pcm, 0, samples * sizeof(std::int16_t));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_scratch.size() < samples)
+        {
+            // first period only, the period size does not change while playing
+            m_scratch.resize(samples);
+        }
+        for (auto& source : m_sources)
+        {
+            if (not source.active)
+            {
+                continue;
+            }
+            source.jitterBuffer->pop(m_scratch.data(), frames);
+            mixSamples(pcm, m_scratch.data(), samples, source.gain);
+        }
+    }
+
+    void AudioMixer::setSourceGain(std::uint32_t ssrc, unsigned int gainPercent)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& source : m_sources)
+        {
+            if (source.active and ssrc == source.ssrc)
+            {
+                source.gain = toGain(gainPercent);
+            }
+        }
+    }
+
+    void AudioMixer::setNetworkJitter(std::uint32_t ssrc, double jitterMs)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& source : m_sources)
+        {
+            if (source.active and ssrc == source.ssrc)
+            {
+                source.jitterBuffer->setNetworkJitter(jitterMs);
+            }
+        }
+    }
+
+    bool AudioMixer::hasSource(std::uint32_t ssrc) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sources.end() != std::find_if(m_sources.begin(), m_sources.end(), [ssrc](const Source& source)
+        {
+            return source.active and ssrc == source.ssrc;
+        });
+    }
+
+    void AudioMixer::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& source : m_sources)
+        {
+            source.active = false;
+            source.jitterBuffer->reset();
+        }
+        m_droppedPackets = 0;
+    }
+
+    std::vector<std::pair<std::uint32_t, JitterBufferStatistics>> AudioMixer::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::pair<std::uint32_t, JitterBufferStatistics>> statistics;
+        for (const auto& source : m_sources)
+        {
+            if (source.active)
+            {
+                statistics.emplace_back(source.ssrc, source.jitterBuffer->getStatistics());
+            }
+        }
+        return statistics;
+    }
+
+    std::uint64_t AudioMixer::getDroppedPackets() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_droppedPackets;
+    }
+
+    AudioMixer::Source* AudioMixer::findSource(std::uint32_t ssrc, JitterBuffer::Clock::time_point arrivalTime)
+    {
+        // a free slot, else the one that has been quiet the longest
+        Source* idlest = nullptr;
+        for (auto& source : m_sources)
+        {
+            if (source.active and ssrc == source.ssrc)
+            {
+                source.lastArrival = arrivalTime;
+                return &source;
+            }
+            if (nullptr == idlest or
+                (idlest->active and (not source.active or source.lastArrival < idlest->lastArrival)))
+            {
+                idlest = &source;
+            }
+        }
+
+        if (idlest->active and arrivalTime - idlest->lastArrival < sourceIdleTimeout)
+        {
+            m_droppedPackets++;
+            return nullptr;
+        }
+        idlest->active = true;
+        idlest->ssrc = ssrc;
+        idlest->gain = m_defaultGain;
+        idlest->lastArrival = arrivalTime;
+        idlest->jitterBuffer->reset();
+        return idlest;
+    }
+} // namespace usbAudio
@@ -1,14 +1,23 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include "usbAudio/AudioPlaybackService.hpp"
 #include "common/CommonFunction.hpp"
 #include "socket/ConcreteRTPSession.hpp"
 
 namespace
 {
-    const int waitForTimeout = 2;
+    const int waitForTimeout = 100; // ms
     const int MAX_WRITE_DATA = 2048;
     const unsigned short SAMPLE_BIT_SIZE = 16;
+    constexpr unsigned int minSampleRate = 8000; // rate must more than 8000
     constexpr unsigned short BitsByte = 8;
+    constexpr double nanosecondsPerMicrosecond = 1000.0;
+    // packets of one receive poll, more only grows the queue once
+    constexpr std::size_t receiveQueueReserve = 64;
+    // the session closes an RTCP interval every few seconds, the jitter floor follows it this often
+    constexpr std::chrono::seconds networkJitterInterval{ 1 };
     std::atomic_bool keep_running{true};
 } // namespace
 
@@ -16,11 +25,13 @@ namespace usbAudio
 {
 
 
-    AudioPlaybackService::AudioPlaybackService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession)
+    AudioPlaybackService::AudioPlaybackService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession,
+        std::shared_ptr<LatencyProbe> latencyProbe)
         : m_logger{ logger }
         , m_config{ config }
         , m_fp{ nullptr }
         , m_rtpSession{std::move(rtpSession)}
+        , m_latencyProbe{ std::move(latencyProbe) }
     {
 
     }
@@ -61,6 +72,8 @@ namespace usbAudio
         {
             sampleRate = audio::getAudioSampleRate(m_config);
         }
+        const unsigned short deviceChannel = 2 == audio::getDeviceChannel(m_config) ? 2 : 1;
+        const unsigned int deviceSampleRate = std::max(static_cast<unsigned int>(audio::getDeviceSampleRate(m_config)), minSampleRate);
         configuration::WaveFormatTag waveFormatTag = configuration::WaveFormatTag::WAVE_FORMAT_PCM;
         std::string audioFormat = audio::getAudioFormat(m_config);
         if ("G711a" == audioFormat)
@@ -81,7 +94,28 @@ namespace usbAudio
             SAMPLE_BIT_SIZE,
             0 };
             //static_cast<unsigned short>(sizeof(configuration::WAVEFORMATEX)) };
-        m_sysPlayback = std::make_unique<LinuxAlsa>(m_logger, std::make_unique<configuration::WAVEFORMATEX>(wavfmt));
+        // the device plays its native format, the mixer runs the codec format
+        configuration::WAVEFORMATEX deviceFormat = wavfmt;
+        if (deviceSampleRate != sampleRate or deviceChannel != audioChannel)
+        {
+            deviceFormat.nChannels = deviceChannel;
+            deviceFormat.nSamplesPerSec = deviceSampleRate;
+            deviceFormat.nBlockAlign = static_cast<unsigned short>(deviceChannel * SAMPLE_BIT_SIZE / BitsByte);
+            deviceFormat.nAvgBytesPerSec = deviceSampleRate * deviceFormat.nBlockAlign;
+            m_playbackConverter = std::make_unique<AudioConverter>(sampleRate, audioChannel, deviceSampleRate, deviceChannel);
+            LOG_INFO_MSG(m_logger, "Audio playback converts {} Hz {} channels to {} Hz {} channels, {:.1f} ms filter delay.",
+                sampleRate, audioChannel, deviceSampleRate, deviceChannel,
+                m_playbackConverter->getLatencyFrames() * 1000.0 / deviceSampleRate);
+        }
+        m_sysPlayback = createSysAlsa(m_logger, std::make_unique<configuration::WAVEFORMATEX>(deviceFormat), audio::getPlaybackDevice(m_config));
+        // payloads are decoded before the jitter buffer, the device always plays 16 bit pcm
+        m_codec = audio::createAudioCodec(m_config, sampleRate, audioChannel);
+        m_comfortNoisePayloadType = audio::selectComfortNoisePayloadType(m_config, *m_codec);
+        m_sampleRate = sampleRate;
+        m_mixer = std::make_unique<AudioMixer>(sampleRate, m_codec->getClockRate(), audioChannel,
+            audio::getJitterMinDelay(m_config), audio::getJitterMaxDelay(m_config),
+            static_cast<unsigned int>(std::max(audio::getMixerMaxSources(m_config), 1)),
+            static_cast<unsigned int>(std::max(audio::getMixerSourceGain(m_config), 0)));
         // wav fmt chuck head
         m_waveHeader.bits_per_sample = wavfmt.wBitsPerSample;
         m_waveHeader.block_align = wavfmt.nBlockAlign;
@@ -111,8 +145,23 @@ namespace usbAudio
                 return false;
             }
 
+            // the ALSA event loop pulls every free period from the mixer
+            m_speechRec.alsaAudioContext.onDataReq = [this, deviceChannel, deviceSampleRate](std::uint8_t* data, size_t frames)
+            {
+                mixPeriod(reinterpret_cast<std::int16_t*>(data), frames);
+                if (m_latencyProbe)
+                {
+                    // the rest of the device buffer is queued ahead of this period
+                    const configuration::ALSAAudioContext& context = m_speechRec.alsaAudioContext;
+                    m_latencyProbe->onPlayback(reinterpret_cast<const std::int16_t*>(data), frames, deviceChannel, deviceSampleRate,
+                        context.bufferFrames > frames ? context.bufferFrames - frames : 0);
+                }
+            };
+
             configuration::audioDevInfo devInfo = m_sysPlayback->getDefaultDev();
             devInfo = m_sysPlayback->setAudioDev(audio::getPlaybackDevice(m_config));
+            m_latencyProfile = audio::getLatencyProfile(m_config);
+            applyLatencyProfile(m_speechRec.alsaAudioContext, m_latencyProfile);
 
             errcode = m_sysPlayback->openALSAAudio(m_speechRec.alsaAudioContext, devInfo, SND_PCM_STREAM_PLAYBACK);
             if (0 != errcode)
@@ -122,6 +171,7 @@ namespace usbAudio
                 destroyPlayback();
                 return false;
             }
+            logPlaybackLatency();
         }
         return true;
     }
@@ -161,6 +211,21 @@ namespace usbAudio
         }
         speechBegin();
 
+        m_mixer->reset();
+        if (m_playbackConverter)
+        {
+            m_playbackConverter->reset();
+            m_convertedFrames = 0;
+        }
+        for (auto& decoder : m_decoders)
+        {
+            decoder.second->reset();
+        }
+        m_decodedPackets = 0;
+        m_decodeCpuNanoseconds = 0;
+        m_unexpectedPayloads = 0;
+        m_receivedPackets = 0;
+        m_receiveCpuNanoseconds = 0;
         if (nullptr != m_sysPlayback)
         {
             int ret = m_sysPlayback->startALSAAudio(m_speechRec.alsaAudioContext, SND_PCM_STREAM_PLAYBACK);
@@ -172,6 +237,7 @@ namespace usbAudio
         }
         m_speechRec.speechState = configuration::SpeechState::SPEECH_STATE_STARTED;
 
+        keep_running = true;
         m_speechRec.alsaAudioContext.audioThread = std::thread([this, &alsaAudioContext = m_speechRec.alsaAudioContext]()
         {
             //this->speechStartFromFile();
@@ -189,11 +255,39 @@ namespace usbAudio
             return 0;
         }
         keep_running = false;
+        if (m_rtpSession)
+        {
+            m_rtpSession->wakeReceiver();
+        }
         if (m_speechRec.alsaAudioContext.audioThread.joinable())
         {
             m_speechRec.alsaAudioContext.audioThread.join();
         }
 
+        for (const auto& source : m_mixer->getStatistics())
+        {
+            const JitterBufferStatistics& statistics = source.second;
+            LOG_INFO_MSG(m_logger, "RTP playback SSRC {:08x} received {} packets, lost {}, late {}, duplicate {}, comfort noise {}, concealed {} frames, skipped {} frames, jitter {:.1f} ms, delay {:.1f} ms.",
+                source.first, statistics.receivedPackets, statistics.lostPackets, statistics.latePackets, statistics.duplicatePackets,
+                statistics.comfortNoisePackets, statistics.concealedFrames, statistics.skippedFrames,
+                statistics.jitterMs, statistics.targetDelayMs);
+        }
+        if (0 < m_mixer->getDroppedPackets())
+        {
+            LOG_WARNING_MSG("RTP playback dropped {} packets of talkers over the mixer limit.", m_mixer->getDroppedPackets());
+        }
+        if (0 < m_decodedPackets)
+        {
+            LOG_INFO_MSG(m_logger, "Audio decode {} {} packets, {:.1f} us CPU per packet, {} packets with other payload types dropped.",
+                m_codec->getName(), m_decodedPackets, m_decodeCpuNanoseconds / nanosecondsPerMicrosecond / m_decodedPackets,
+                m_unexpectedPayloads);
+        }
+        if (0 < m_receivedPackets)
+        {
+            LOG_INFO_MSG(m_logger, "RTP {} received {} packets, {:.1f} us CPU per packet.", rtp::getRTPTransport(m_config),
+                m_receivedPackets, m_receiveCpuNanoseconds / nanosecondsPerMicrosecond / m_receivedPackets);
+        }
+
         if ( nullptr != m_sysPlayback)
         {
             int ret = m_sysPlayback->stopALSAAudio(m_speechRec.alsaAudioContext, SND_PCM_STREAM_PLAYBACK);
@@ -211,6 +305,44 @@ namespace usbAudio
         return 0;
     }
 
+    bool AudioPlaybackService::setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs)
+    {
+        if (nullptr == m_sysPlayback or m_speechRec.speechState >= configuration::SpeechState::SPEECH_STATE_STARTED)
+        {
+            LOG_WARNING_MSG("Audio playback period time can be changed while stopped only.");
+            return false;
+        }
+
+        // the device logs the period and buffer it negotiated, the mix buffers grow on the first period
+        m_sysPlayback->closeALSAAudio(m_speechRec.alsaAudioContext, SND_PCM_STREAM_PLAYBACK);
+        applyLatencyProfile(m_speechRec.alsaAudioContext, m_latencyProfile);
+        if (0 != periodTimeUs and 0 != bufferTimeUs)
+        {
+            m_speechRec.alsaAudioContext.periodTime = periodTimeUs;
+            m_speechRec.alsaAudioContext.bufferTime = bufferTimeUs;
+        }
+        const int errcode = m_sysPlayback->openALSAAudio(m_speechRec.alsaAudioContext,
+            m_sysPlayback->setAudioDev(audio::getPlaybackDevice(m_config)), SND_PCM_STREAM_PLAYBACK);
+        if (0 != errcode)
+        {
+            LOG_ERROR_MSG("Reopen audio playback with period time {} us failed: {}", periodTimeUs, errcode);
+            return false;
+        }
+        logPlaybackLatency();
+        return true;
+    }
+
+    void AudioPlaybackService::logPlaybackLatency()
+    {
+        // a packet waits at least the jitter buffer delay, then behind the whole device buffer
+        const configuration::ALSAAudioContext& context = m_speechRec.alsaAudioContext;
+        const unsigned int deviceSampleRate = m_playbackConverter ? m_playbackConverter->getOutputRate() : m_sampleRate;
+        const double deviceMs = context.bufferFrames * 1000.0 / deviceSampleRate;
+        LOG_INFO_MSG(m_logger, "Audio latency profile {}: playback period {} frames, {} periods buffered, theoretical receive latency {:.1f} ms.",
+            m_latencyProfile.name, context.periodFrames, 0 == context.periodFrames ? 0 : context.bufferFrames / context.periodFrames,
+            std::max(audio::getJitterMinDelay(m_config), 0) + deviceMs);
+    }
+
     /* after stop playback, there are still some data callbacks */
     void AudioPlaybackService::waitForPlaybackStop(configuration::ALSAAudioContext& playback, unsigned int timeout_ms /*= -1*/)
     {
@@ -218,16 +350,9 @@ namespace usbAudio
         {
             return;
         }
-        while (!m_sysPlayback->isALSAAudioStopped(playback))
+        for (unsigned int waited = 0; !m_sysPlayback->isALSAAudioStopped(playback) and waited < timeout_ms; waited++)
         {
-            sleep(1);
-            if (timeout_ms != (unsigned int)-1)
-            {
-                if (0 == timeout_ms--)
-                {
-                    break;
-                }
-            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 
@@ -344,41 +469,127 @@ namespace usbAudio
             LOG_ERROR_MSG("Speech state issue.");
             return;
         }
+
+        // only receives, the ALSA event loop drains the jitter buffer at the device pace
+        std::vector<std::int16_t> pcm;
+        // reused across polls, the payloads go back to the session pool on clear()
+        configuration::RTPSessionDatas rtpSessionDatas;
+        rtpSessionDatas.reserve(receiveQueueReserve);
+        JitterBuffer::Clock::time_point nextNetworkJitter = JitterBuffer::Clock::now();
         while (keep_running)
         {
-            configuration::RTPSessionDatas rtpSessionDatas;
+            const std::uint64_t cpuStart = audio::getThreadCpuNanoseconds();
             m_rtpSession->receivePacket(rtpSessionDatas);
-			readRTPAudioData(rtpSessionDatas);
+            m_receiveCpuNanoseconds += audio::getThreadCpuNanoseconds() - cpuStart;
+            m_receivedPackets += rtpSessionDatas.size();
+            const JitterBuffer::Clock::time_point arrivalTime = JitterBuffer::Clock::now();
+            for (const configuration::RTPSessionData& rtpSessionData : rtpSessionDatas)
+            {
+                if (m_comfortNoisePayloadType == rtpSessionData.payloadType)
+                {
+                    // the first byte is the noise level, spectral coefficients are not used
+                    const std::uint8_t noiseLevel = rtpSessionData.payloadDatas.empty() ? 127 : rtpSessionData.payloadDatas[0];
+                    m_mixer->pushComfortNoise(rtpSessionData.ssrc, rtpSessionData.timestamp, rtpSessionData.sequenceNumber,
+                        noiseLevel, arrivalTime);
+                    continue;
+                }
+                const std::size_t frames = decodeRTPPayload(rtpSessionData, pcm);
+                if (m_latencyProbe and 0 < frames)
+                {
+                    m_latencyProbe->onReceive(pcm.data(), frames, m_mixer->getChannels(), m_sampleRate);
+                }
+                m_mixer->push(rtpSessionData.ssrc, rtpSessionData.timestamp, rtpSessionData.sequenceNumber,
+                    pcm.data(), frames, arrivalTime, rtpSessionData.marker);
+            }
+            rtpSessionDatas.clear();
+            if (arrivalTime >= nextNetworkJitter)
+            {
+                nextNetworkJitter = arrivalTime + networkJitterInterval;
+                for (const auto& stats : m_rtpSession->getNetworkStats())
+                {
+                    if (0 < stats.receivedPackets)
+                    {
+                        m_mixer->setNetworkJitter(stats.ssrc, stats.jitterMs);
+                    }
+                }
+            }
+            const std::uint64_t pollStart = audio::getThreadCpuNanoseconds();
             m_rtpSession->startRTPPolling();
+            m_receiveCpuNanoseconds += audio::getThreadCpuNanoseconds() - pollStart;
         }
+    }
 
-		endPlaybackWithReason(static_cast<int>(configuration::SpeechEndReason::END_REASON_VAD_DETECT));
+    std::size_t AudioPlaybackService::decodeRTPPayload(const configuration::RTPSessionData& rtpSessionData, std::vector<std::int16_t>& pcm)
+    {
+        const common::PacketSlice& payload = rtpSessionData.payloadDatas;
+        if (m_codec->getPayloadType() != rtpSessionData.payloadType)
+        {
+            m_unexpectedPayloads++;
+            return 0;
+        }
+
+        audio::IAudioCodec& decoder = getDecoder(rtpSessionData.ssrc);
+        const std::size_t maxFrames = decoder.getMaxDecodedFrames(payload.size());
+        pcm.resize(maxFrames * m_mixer->getChannels());
+        const std::uint64_t cpuStart = audio::getThreadCpuNanoseconds();
+        int frames = decoder.decode(payload.data(), payload.size(), pcm.data(), maxFrames);
+        m_decodeCpuNanoseconds += audio::getThreadCpuNanoseconds() - cpuStart;
+        m_decodedPackets++;
+        return 0 < frames ? static_cast<std::size_t>(frames) : 0;
     }
 
-} // namespace usbAudio
+    audio::IAudioCodec& AudioPlaybackService::getDecoder(std::uint32_t ssrc)
+    {
+        auto decoder = m_decoders.find(ssrc);
+        if (m_decoders.end() != decoder)
+        {
+            return *decoder->second;
+        }
 
-int usbAudio::AudioPlaybackService::readRTPAudioData(configuration::RTPSessionDatas& rtpSessionDatas)
-{
-    size_t frames = m_speechRec.alsaAudioContext.periodFrames;
-    size_t size = (frames * m_speechRec.alsaAudioContext.bitsPerFrame / BitsByte);
-	while (rtpSessionDatas.size())
-	{
-		const configuration::RTPSessionData& rtpSessionData = rtpSessionDatas.front();
-		m_speechRec.alsaAudioContext.audioBuffer.resize(rtpSessionDatas.size());
-		std::copy(rtpSessionData.payloadDatas.cbegin(), rtpSessionData.payloadDatas.cend(), m_speechRec.alsaAudioContext.audioBuffer.begin());
-
-		// write to PCM device
-		if (m_sysPlayback)
-		{
-			int errCode = m_sysPlayback->readAudioDataToPCM(m_speechRec.alsaAudioContext);
-			if (0 > errCode)
-			{
-				endPlaybackWithReason(errCode);
-				return errCode;
-			}
-		}
-		rtpSessionDatas.pop();
-	}
+        // drop the decoders of talkers the mixer has let go
+        if (m_decoders.size() >= static_cast<std::size_t>(std::max(audio::getMixerMaxSources(m_config), 1)))
+        {
+            for (auto it = m_decoders.begin(); it != m_decoders.end();)
+            {
+                it = m_mixer->hasSource(it->first) ? std::next(it) : m_decoders.erase(it);
+            }
+        }
+        auto inserted = m_decoders.emplace(ssrc, audio::createAudioCodec(m_config, m_sampleRate, m_mixer->getChannels()));
+        return *inserted.first->second;
+    }
+
+    void AudioPlaybackService::mixPeriod(std::int16_t* pcm, std::size_t frames)
+    {
+        if (not m_playbackConverter)
+        {
+            m_mixer->mix(pcm, frames);
+            return;
+        }
+
+        // mix about the codec frames the period still lacks, the filter keeps its own
+        // fraction so the remainder carries over to the next period
+        const std::size_t deviceChannels = m_playbackConverter->getOutputChannels();
+        const std::size_t inputRate = m_playbackConverter->getInputRate();
+        const std::size_t outputRate = m_playbackConverter->getOutputRate();
+        const std::size_t maxMixFrames = (frames * inputRate + outputRate - 1) / outputRate;
+        if (m_mixBuffer.size() < maxMixFrames * m_mixer->getChannels())
+        {
+            // first period only, the period size does not change while playing
+            m_mixBuffer.resize(maxMixFrames * m_mixer->getChannels());
+            m_convertedBuffer.resize((frames + m_playbackConverter->getMaxOutputFrames(maxMixFrames)) * deviceChannels);
+        }
+        while (m_convertedFrames < frames)
+        {
+            const std::size_t mixFrames = ((frames - m_convertedFrames) * inputRate + outputRate - 1) / outputRate;
+            m_mixer->mix(m_mixBuffer.data(), mixFrames);
+            m_convertedFrames += m_playbackConverter->process(m_mixBuffer.data(), mixFrames,
+                m_convertedBuffer.data() + m_convertedFrames * deviceChannels);
+        }
 
-    return 0;
-}
+        memcpy(pcm, m_convertedBuffer.data(), frames * deviceChannels * sizeof(std::int16_t));
+        m_convertedFrames -= frames;
+        memmove(m_convertedBuffer.data(), m_convertedBuffer.data() + frames * deviceChannels,
+            m_convertedFrames * deviceChannels * sizeof(std::int16_t));
+    }
+
+} // namespace usbAudio
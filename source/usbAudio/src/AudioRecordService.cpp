@@ -1,15 +1,36 @@
+#include <algorithm>
 #include <fstream>
 #include "usbAudio/AudioRecordService.hpp"
 #include "common/CommonFunction.hpp"
 #include "common/G711Codec.hpp"
 #include "socket/ConcreteRTPSession.hpp"
+#include "socket/FecRTPSession.hpp"
 
 namespace
 {
-    const int waitForTimeout = 2;
-    const int MAX_WRITE_DATA = 2048;
+    const int waitForTimeout = 100; // ms
     const int MAX_SOCKET_DATA = 1046;
+    // largest payload a codec may produce for one packet, fits one ethernet frame
+    constexpr std::size_t maxPayloadBytes = 1400;
+    constexpr unsigned int minSampleRate = 8000; // rate must more than 8000
+    constexpr double nanosecondsPerMicrosecond = 1000.0;
+    constexpr unsigned int millisecondsPerSecond = 1000;
+    constexpr unsigned int secondsPerMinute = 60;
+    // comfort noise goes out when silence starts and is refreshed this often
+    constexpr unsigned int comfortNoiseIntervalMs = 500;
     constexpr unsigned short BitsByte = 8;
+    // one second of PCM in the send ring, at most this many packets queued before the oldest are dropped
+    constexpr int sendRingSeconds = 1;
+    constexpr std::size_t maxBacklogPackets = 5;
+    // the far end reports every few seconds, looking once a second is enough
+    constexpr std::chrono::seconds bitrateCheckInterval{ 1 };
+    // reported loss over highLoss lowers the bitrate by a quarter, under lowLoss with a
+    // short round trip it climbs back in tenths of the configured bitrate
+    constexpr double highLoss = 0.10;
+    constexpr double lowLoss = 0.02;
+    constexpr double maxIncreaseRoundTripMs = 400.0;
+    constexpr double bitrateDecrease = 0.75;
+    constexpr int bitrateIncreaseSteps = 10;
     std::atomic_bool keep_running{ true };
 } // namespace
 
@@ -23,18 +44,35 @@ namespace usbAudio
         return string;
     }
 
-    AudioRecordService::AudioRecordService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession)
+    AudioRecordService::AudioRecordService(Logger& logger, const configuration::AppConfiguration& config, std::shared_ptr<endpoints::IRTPSession> rtpSession,
+        std::shared_ptr<LatencyProbe> latencyProbe)
         : m_logger{ logger }
         , m_config { config }
         , m_timeStamp{ std::make_unique<TimeStamp>() }
-        , m_fp{nullptr}
         , m_rtpSession{ std::move(rtpSession) }
-        , m_rtpSendThread{ std::thread([this]() {this->sendAudioData(""); }) }
+        , m_codec{ audio::createAudioCodec(config, std::max(static_cast<unsigned int>(audio::getAudioSampleRate(config)), minSampleRate),
+            2 == audio::getAudioChannel(config) ? 2 : 1) }
+        , m_vad{ audio::getVadEnable(config) ? std::make_unique<VoiceActivityDetector>(
+            std::max(static_cast<unsigned int>(audio::getAudioSampleRate(config)), minSampleRate),
+            2 == audio::getAudioChannel(config) ? 2 : 1,
+            static_cast<unsigned int>(std::max(audio::getVadThreshold(config), 0)),
+            static_cast<unsigned int>(std::max(audio::getVadHangover(config), 0))) : nullptr }
+        , m_adaptiveBitrate{ audio::getAdaptiveBitrate(config) and "opus" == m_codec->getName() }
+        , m_maxBitrate{ m_codec->getBitrate() }
+        , m_minBitrate{ std::min(audio::getOpusMinBitrate(config), m_maxBitrate) }
+        , m_fileWriter{ audio::enableAudioWriteToFile(config) ? std::make_unique<WavFileWriter>(logger,
+            static_cast<std::size_t>(std::max(audio::getWavBufferMs(config), 0)) * audio::getAudioSampleRate(config) *
+            audio::getAudioChannel(config) * sizeof(std::int16_t) / millisecondsPerSecond,
+            static_cast<unsigned int>(std::max(audio::getWavCheckpointMs(config), 1)),
+            static_cast<unsigned int>(std::max(video::getVideoTimes(config), 0)) * secondsPerMinute) : nullptr }
+        , m_latencyProbe{ std::move(latencyProbe) }
+        , m_sendRing{ static_cast<std::size_t>(sendRingSeconds * audio::getAudioSampleRate(config) *
+            audio::getAudioChannel(config) * sizeof(std::int16_t)) }
     {
         if (m_rtpSession)
         {
             jrtplib::RTPSessionParams rtpSessionParams;
-            rtpSessionParams.SetOwnTimestampUnit(1.0 / audio::getAudioSampleRate(m_config));
+            rtpSessionParams.SetOwnTimestampUnit(1.0 / m_codec->getClockRate());
             rtpSessionParams.SetAcceptOwnPackets(true);
             // IMPORTANT: The local timestamp unit MUST be set, otherwise
             // RTCP Sender Report info will be calculated wrong
@@ -43,15 +81,23 @@ namespace usbAudio
 
             m_rtpSession->createRTPSession(rtpSessionParams);
         }
+        // the sender starts on a created session
+        m_rtpSendThread = std::thread([this]() {this->sendAudioData(""); });
     }
 
     AudioRecordService::~AudioRecordService()
     {
-        if (m_fp)
         {
-            fclose(m_fp);
-            m_fp = nullptr;
+            std::lock_guard<std::mutex> guard(dataMutex);
+            keep_running = false;
+            cv.notify_one();
         }
+        if (m_rtpSendThread.joinable())
+        {
+            m_rtpSendThread.join();
+        }
+        LOG_INFO_MSG(m_logger, "Audio send ring {} bytes, high watermark {} bytes, dropped {} bytes.",
+            m_sendRing.capacity(), m_sendRing.highWatermark(), m_sendRing.droppedBytes());
     }
 
     bool AudioRecordService::initAudioRecord()
@@ -81,7 +127,10 @@ namespace usbAudio
         {
             sampleRate = audio::getAudioSampleRate(m_config);
         }
+        const unsigned short deviceChannel = 2 == audio::getDeviceChannel(m_config) ? 2 : 1;
+        const unsigned int deviceSampleRate = std::max(static_cast<unsigned int>(audio::getDeviceSampleRate(m_config)), minSampleRate);
         configuration::WaveFormatTag waveFormatTag = configuration::WaveFormatTag::WAVE_FORMAT_PCM;
+        // opus talk sessions keep a PCM wav file
         std::string audioFormat = audio::getAudioFormat(m_config);
         if ("G711a" == audioFormat)
         {
@@ -103,12 +152,27 @@ namespace usbAudio
             static_cast<unsigned short>(audio::getSampleBit(m_config)),
             0 };
             //static_cast<unsigned short>(sizeof(configuration::WAVEFORMATEX)) };
-        m_sysRec = std::make_unique<LinuxAlsa>(m_logger, std::make_unique<configuration::WAVEFORMATEX>(wavfmt));
+        // the device captures its native format, everything after the callback runs the codec format
+        configuration::WAVEFORMATEX deviceFormat = wavfmt;
+        if (deviceSampleRate != sampleRate or deviceChannel != audioChannel)
+        {
+            deviceFormat.nChannels = deviceChannel;
+            deviceFormat.nSamplesPerSec = deviceSampleRate;
+            deviceFormat.nBlockAlign = static_cast<unsigned short>(deviceChannel * audio::getSampleBit(m_config) / BitsByte);
+            deviceFormat.nAvgBytesPerSec = deviceSampleRate * deviceFormat.nBlockAlign;
+            m_captureConverter = std::make_unique<AudioConverter>(deviceSampleRate, deviceChannel, sampleRate, audioChannel);
+            LOG_INFO_MSG(m_logger, "Audio capture converts {} Hz {} channels to {} Hz {} channels, {:.1f} ms filter delay.",
+                deviceSampleRate, deviceChannel, sampleRate, audioChannel,
+                m_captureConverter->getLatencyFrames() * 1000.0 / sampleRate);
+        }
+        m_deviceChannel = deviceFormat.nChannels;
+        m_deviceSampleRate = deviceFormat.nSamplesPerSec;
+        m_sysRec = createSysAlsa(m_logger, std::make_unique<configuration::WAVEFORMATEX>(deviceFormat), audio::getAudioDevice(m_config));
         // wav fmt chuck head
         m_waveHeader.bits_per_sample   = wavfmt.wBitsPerSample;
         m_waveHeader.block_align       = wavfmt.nBlockAlign;
         m_waveHeader.avg_bytes_per_sec = wavfmt.nAvgBytesPerSec;
-		if ("PCM" != audioFormat)
+		if ("G711a" == audioFormat or "G711u" == audioFormat)
 		{
 			m_waveHeader.bits_per_sample /= 2;
 			m_waveHeader.block_align /= 2;
@@ -124,6 +188,8 @@ namespace usbAudio
             return false;
         }
 
+        writeSessionDescription();
+
         m_speechRec.speechState = configuration::SpeechState::SPEECH_STATE_INIT;
         m_speechRec.audioSource = configuration::SpeechAudioSource::SPEECH_MIC;
         m_speechRec.notif = std::move(recNotifier);
@@ -143,6 +209,8 @@ namespace usbAudio
 
             configuration::audioDevInfo devInfo = m_sysRec->getDefaultDev();
             devInfo = m_sysRec->setAudioDev(audio::getAudioDevice(m_config));
+            m_latencyProfile = audio::getLatencyProfile(m_config);
+            applyLatencyProfile(m_speechRec.alsaAudioContext, m_latencyProfile);
             errcode = m_sysRec->openALSAAudio(m_speechRec.alsaAudioContext, devInfo, SND_PCM_STREAM_CAPTURE);
             if (0 != errcode)
             {
@@ -151,6 +219,7 @@ namespace usbAudio
                 destroyRecorder();
                 return errcode;
             }
+            logCaptureLatency();
         }
         return false;
     }
@@ -232,14 +301,19 @@ namespace usbAudio
     void AudioRecordService::speechBegin()
     {
         m_result = "";
-        if (audio::enableAudioWriteToFile(m_config))
+        if (m_fileWriter)
         {
-            std::string outputFile = common::getCaptureOutputDir(m_config) + audio::getAudioName(m_config) + "_" + m_timeStamp->now() + ".wav";
-            if (openOutputAudioFile(outputFile))
+            // called again by the writer thread for every rotated file
+            m_fileWriter->start(m_waveHeader, [this]()
             {
-                m_waveHeader.chunkClear();
-                fwrite(&m_waveHeader, sizeof(m_waveHeader), 1, m_fp);
-            }
+                return common::getCaptureOutputDir(m_config) + audio::getAudioName(m_config) + "_" + m_timeStamp->now() + ".wav";
+            });
+        }
+        m_resetEncoder = true;
+        if (m_captureConverter)
+        {
+            // capture is stopped, no callback uses the filter history
+            m_captureConverter->reset();
         }
         m_rtpSession->startRTPPolling();
         LOG_INFO_MSG(m_logger, "....Start Record Listening....");
@@ -255,27 +329,30 @@ namespace usbAudio
         {
             LOG_INFO_MSG(m_logger, "Recognizer error: {}", static_cast<int>(reason));
         }
-        if (m_fp)
-        {
-            m_waveHeader.dwSampleLength = m_waveHeader.data_chunk_size / (audio::getSampleBit(m_config) / BitsByte);
-            /* fixed size of wav file header data */
-            m_waveHeader.chunk_size += m_waveHeader.data_chunk_size + (sizeof(m_waveHeader) - 8);
-            /* write the corrected data back to the file header.
-            The audio file is in wav format.*/
-            fseek(m_fp, sizeof(m_waveHeader.riff), SEEK_SET);
-            fwrite(&m_waveHeader.chunk_size, sizeof(m_waveHeader.chunk_size), 1, m_fp);
-            // point move to dwSampleLength position
-            int offsetPosition = sizeof(m_waveHeader.data_chunk_size) + sizeof(m_waveHeader.data) + sizeof(m_waveHeader.dwSampleLength);
-            fseek(m_fp, (sizeof(m_waveHeader) - offsetPosition), SEEK_SET);
-            fwrite(&m_waveHeader.dwSampleLength, sizeof(m_waveHeader.dwSampleLength), 1, m_fp);
-            // point move to data_size position
-            fseek(m_fp, (sizeof(m_waveHeader) - sizeof(m_waveHeader.data_chunk_size)), SEEK_SET); 
-            fwrite(&m_waveHeader.data_chunk_size, sizeof(m_waveHeader.data_chunk_size), 1, m_fp);
-            fseek(m_fp, 0, SEEK_END);
-
-            fclose(m_fp);
-            LOG_DEBUG_MSG("........................Wirte {} pure data to wav file.....................", m_waveHeader.data_chunk_size);
-            m_fp = nullptr;
+        const std::uint64_t encodedFrames = m_encodedFrames.exchange(0);
+        const std::uint64_t encodeCpuNanoseconds = m_encodeCpuNanoseconds.exchange(0);
+        if (0 < encodedFrames)
+        {
+            LOG_INFO_MSG(m_logger, "Audio encode {} {} ms frames, {:.1f} us CPU per frame.", m_codec->getName(),
+                m_codec->getPacketTimeMs(), encodeCpuNanoseconds / nanosecondsPerMicrosecond / encodedFrames);
+        }
+        const std::uint64_t suppressedPackets = m_suppressedPackets.exchange(0);
+        if (m_vad)
+        {
+            LOG_INFO_MSG(m_logger, "Voice activity suppressed {} of {} talk packets.",
+                suppressedPackets, suppressedPackets + encodedFrames);
+        }
+        const std::uint64_t sentPackets = m_sentPackets.exchange(0);
+        const std::uint64_t sendCpuNanoseconds = m_sendCpuNanoseconds.exchange(0);
+        if (0 < sentPackets)
+        {
+            LOG_INFO_MSG(m_logger, "RTP {} sent {} packets, {:.1f} us CPU per packet.", rtp::getRTPTransport(m_config),
+                sentPackets, sendCpuNanoseconds / nanosecondsPerMicrosecond / sentPackets);
+        }
+        if (m_fileWriter)
+        {
+            // capture is stopped, the writer flushes the rest and finalizes the header
+            m_fileWriter->stop();
         }
     }
 
@@ -291,52 +368,48 @@ namespace usbAudio
             return;
         }
 
-        if (not audioDataConversion(data))
+        if (m_latencyProbe)
         {
-            LOG_ERROR_MSG("Audio data convert failure, will use original data to save.");
+            // device format, the marker passes the converter like the voice
+            m_latencyProbe->onCapture(reinterpret_cast<std::int16_t*>(&data[0]),
+                data.size() / (m_deviceChannel * sizeof(std::int16_t)), m_deviceChannel, m_deviceSampleRate);
         }
-        int errcode = writeAudioData(data);
-        if (errcode < 0)
+        std::string& pcm = convertCapture(data);
+        // the sender encodes from PCM, the file gets the configured format
+        m_sendRing.write(reinterpret_cast<const std::uint8_t*>(pcm.data()), pcm.size());
         {
-            endRecordOnError(errcode);
-            return;
+            // under the mutex the sender is either before its check or waiting, the wakeup is never lost
+            std::lock_guard<std::mutex> guard(dataMutex);
+            cv.notify_one();
         }
 
-        dataMutex.lock();
-        std::copy(data.begin(), data.end(), std::back_inserter(m_recordDatas));
-        dataMutex.unlock();
-        cv.notify_one();
-        //sendAudioData(data);
-    }
-
-    int AudioRecordService::writeAudioData(const std::string& data)
-    {
-        if (data.empty())
+        if (not audioDataConversion(pcm))
         {
-            LOG_ERROR_MSG("audio data is empty.");
-            return 0;
+            LOG_ERROR_MSG("Audio data convert failure, will use original data to save.");
         }
-        int dataSize = data.size();
-        int index = 0;
-        size_t writeData = 0;
-        while (dataSize > 0)
+        // only queued, the writer thread does the disk io
+        if (m_fileWriter)
         {
-            if (dataSize > MAX_WRITE_DATA)
-            {
-                writeData = fwrite(&data[0 + index * MAX_WRITE_DATA], MAX_WRITE_DATA, 1, m_fp);
-            }
-            else
-            {
-                writeData = fwrite(&data[0 + index * MAX_WRITE_DATA], dataSize, 1, m_fp);
-            }
-            dataSize -= MAX_WRITE_DATA;
-            ++index;
+            m_fileWriter->write(reinterpret_cast<const std::uint8_t*>(pcm.data()), pcm.size());
         }
+        //sendAudioData(data);
+    }
 
-        //size_t writeData = fwrite(data.c_str(), data.size(), 1, m_fp);
-        m_waveHeader.data_chunk_size += data.size();
-
-        return 0;
+    std::string& AudioRecordService::convertCapture(std::string& data)
+    {
+        if (not m_captureConverter)
+        {
+            return data;
+        }
+        const std::size_t inputFrameBytes = m_captureConverter->getInputChannels() * sizeof(std::int16_t);
+        const std::size_t outputFrameBytes = m_captureConverter->getOutputChannels() * sizeof(std::int16_t);
+        const std::size_t inputFrames = data.size() / inputFrameBytes;
+        // grows on the first period only, the period size does not change while capturing
+        m_convertedData.resize(m_captureConverter->getMaxOutputFrames(inputFrames) * outputFrameBytes);
+        const std::size_t frames = m_captureConverter->process(reinterpret_cast<const std::int16_t*>(data.data()), inputFrames,
+            reinterpret_cast<std::int16_t*>(&m_convertedData[0]));
+        m_convertedData.resize(frames * outputFrameBytes);
+        return m_convertedData;
     }
 
     void AudioRecordService::endRecordOnError(const int& errorCode)
@@ -356,6 +429,43 @@ namespace usbAudio
         this->registerNotify = registerNotify;
     }
 
+    bool AudioRecordService::setPeriodTime(unsigned int periodTimeUs, unsigned int bufferTimeUs)
+    {
+        if (nullptr == m_sysRec or m_speechRec.speechState >= configuration::SpeechState::SPEECH_STATE_STARTED)
+        {
+            LOG_WARNING_MSG("Audio capture period time can be changed while stopped only.");
+            return false;
+        }
+
+        // the device logs the period and buffer it negotiated
+        m_sysRec->closeALSAAudio(m_speechRec.alsaAudioContext, SND_PCM_STREAM_CAPTURE);
+        applyLatencyProfile(m_speechRec.alsaAudioContext, m_latencyProfile);
+        if (0 != periodTimeUs and 0 != bufferTimeUs)
+        {
+            m_speechRec.alsaAudioContext.periodTime = periodTimeUs;
+            m_speechRec.alsaAudioContext.bufferTime = bufferTimeUs;
+        }
+        const int errcode = m_sysRec->openALSAAudio(m_speechRec.alsaAudioContext,
+            m_sysRec->setAudioDev(audio::getAudioDevice(m_config)), SND_PCM_STREAM_CAPTURE);
+        if (0 != errcode)
+        {
+            LOG_ERROR_MSG("Reopen audio capture with period time {} us failed: {}", periodTimeUs, errcode);
+            return false;
+        }
+        logCaptureLatency();
+        return true;
+    }
+
+    void AudioRecordService::logCaptureLatency()
+    {
+        // a period waits for avail min in the device, then for the rest of its packet in the send ring
+        const configuration::ALSAAudioContext& context = m_speechRec.alsaAudioContext;
+        const double captureMs = context.periodFrames * std::max(context.availMinPeriods, 1u) * 1000.0 / m_deviceSampleRate;
+        LOG_INFO_MSG(m_logger, "Audio latency profile {}: capture period {} frames, {} periods buffered, {} ms packets, theoretical send latency {:.1f} ms.",
+            m_latencyProfile.name, context.periodFrames, 0 == context.periodFrames ? 0 : context.bufferFrames / context.periodFrames,
+            m_codec->getPacketTimeMs(), captureMs + m_codec->getPacketTimeMs());
+    }
+
     /* after stop_record, there are still some data callbacks */
     void AudioRecordService::waitForRecStop(configuration::ALSAAudioContext& recorder, unsigned int timeout_ms /*= -1*/)
     {
@@ -363,126 +473,216 @@ namespace usbAudio
         {
             return;
         }
-        while (!m_sysRec->isALSAAudioStopped(recorder))
+        for (unsigned int waited = 0; !m_sysRec->isALSAAudioStopped(recorder) and waited < timeout_ms; waited++)
         {
-            sleep(1);
-            if (timeout_ms != (unsigned int)-1)
-            {
-                if (0 == timeout_ms--)
-                {
-                    break;
-                }
-            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 
-    bool AudioRecordService::openOutputAudioFile(const std::string& fileName)
+    bool AudioRecordService::audioDataConversion(std::string& data)
     {
-        m_fp = fopen(fileName.c_str(), "wb");
-        if (nullptr == m_fp)
+        std::string audioFormat = audio::getAudioFormat(m_config);
+        if ("PCM" == audioFormat or "Opus" == audioFormat)
         {
-            if (errno != ENOENT)
-            {
-                return false;
-            }
-            if (createFilePath(fileName))
-            {
-                m_fp = fopen(fileName.c_str(), "wb");
-            }
+            return true;
         }
-        if (m_fp)
+
+        // encode in place, the G711 bytes overwrite the front of the PCM samples
+        const std::size_t samples = data.size() / 2;
+        std::int16_t* pcmData = reinterpret_cast<std::int16_t*>(&data[0]);
+        std::uint8_t* g711Data = reinterpret_cast<std::uint8_t*>(&data[0]);
+        if ("G711a" == audioFormat)
+        {
+            data.resize(audio::encodeAlaw(pcmData, samples, g711Data));
+            return true;
+        }
+        else if ("G711u" == audioFormat)
         {
+            data.resize(audio::encodeUlaw(pcmData, samples, g711Data));
             return true;
         }
+
         return false;
     }
 
-    bool AudioRecordService::createFilePath(const std::string& fileName)
+    void AudioRecordService::adaptBitrate()
     {
-        const char* start;
-        mode_t mode = S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
-        const char* path = fileName.c_str();
-
-        if (path[0] == '/')
-            start = strchr(path + 1, '/');
-        else
-            start = strchr(path, '/');
-
-        while (start) 
+        const auto now = std::chrono::steady_clock::now();
+        if (now < m_nextBitrateCheck)
         {
-            char* buffer = strdup(path);
-            buffer[start - path] = 0x00;
+            return;
+        }
+        m_nextBitrateCheck = now + bitrateCheckInterval;
 
-            if (mkdir(buffer, mode) == -1 && errno != EEXIST) 
+        // only a new receiver report says something about the current bitrate
+        std::uint64_t reports = 0;
+        double fractionLost = 0.0;
+        double roundTripMs = 0.0;
+        for (const auto& stats : m_rtpSession->getNetworkStats())
+        {
+            if (0 == stats.reports)
             {
-                LOG_ERROR_MSG("creating directory {} fail.", buffer);
-                free(buffer);
-                return -1;
+                continue;
             }
-            free(buffer);
-            start = strchr(start + 1, '/');
+            reports += stats.reports;
+            fractionLost = std::max(fractionLost, stats.reportedFractionLost);
+            roundTripMs = std::max(roundTripMs, stats.roundTripMs);
         }
-        return true;
-    }
-
-    bool AudioRecordService::audioDataConversion(std::string& data)
-    {
-        std::string audioFormat = audio::getAudioFormat(m_config);
-        if ("PCM" == audioFormat)
+        if (reports == m_lossReports)
         {
-            return true;
+            return;
         }
+        m_lossReports = reports;
 
-        std::vector<unsigned char> converData;
-        int dataSize = data.size();
-        converData.resize(dataSize);
-        if ("G711a" == audioFormat)
+        const int bitrate = m_codec->getBitrate();
+        int target = bitrate;
+        if (fractionLost > highLoss)
         {
-            dataSize = audio::PCM2G711a(&converData[0], data.c_str(), data.size());
-            if (dataSize > 0)
-            {
-                converData.resize(dataSize);
-                data.clear();
-                std::copy(converData.begin(), converData.end(), std::back_inserter(data));
-                return true;
-            }
+            target = std::max(static_cast<int>(bitrate * bitrateDecrease), m_minBitrate);
         }
-        else if ("G711u" == audioFormat)
+        else if (fractionLost < lowLoss and roundTripMs <= maxIncreaseRoundTripMs)
         {
-            dataSize = audio::PCM2G711u(&converData[0], data.c_str(), data.size());
-            if (dataSize > 0)
-            {
-                converData.resize(dataSize);
-                data.clear();
-                std::copy(converData.begin(), converData.end(), std::back_inserter(data));
-                return true;
-            }
+            target = std::min(bitrate + m_maxBitrate / bitrateIncreaseSteps, m_maxBitrate);
+        }
+        if (target != bitrate and m_codec->setBitrate(target))
+        {
+            LOG_INFO_MSG(m_logger, "Audio bitrate {} -> {} bit/s, reported loss {:.1f}% round trip {:.0f} ms.",
+                bitrate, m_codec->getBitrate(), fractionLost * 100.0, roundTripMs);
         }
-
-        return false;
     }
 
     int AudioRecordService::sendAudioData(const std::string&)
     {
-        const unsigned long timestampinc = 320;
-        const unsigned int sendDataSize = 320;
+        // one codec frame of captured PCM per packet
+        const std::size_t frameSamples = m_codec->getFrameSamples();
+        const unsigned int channels = 2 == audio::getAudioChannel(m_config) ? 2 : 1;
+        const std::size_t sendDataSize = frameSamples * channels * sizeof(std::int16_t);
+        const unsigned int sampleRate = std::max(static_cast<unsigned int>(audio::getAudioSampleRate(m_config)), minSampleRate);
+        const unsigned long timestampinc = static_cast<unsigned long>(frameSamples * m_codec->getClockRate() / sampleRate);
+        const unsigned char payloadType = m_codec->getPayloadType();
+        const unsigned char comfortNoisePayloadType = audio::selectComfortNoisePayloadType(m_config, *m_codec);
+        const std::size_t comfortNoiseIntervalPackets = std::max<std::size_t>(
+            comfortNoiseIntervalMs / std::max(m_codec->getPacketTimeMs(), 1u), 1);
+        // marker on the first packet of every talkspurt
+        bool talkspurtStart = true;
+        std::size_t silentPackets = 0;
+
+        const std::size_t maxBacklog = sendDataSize * maxBacklogPackets;
+        std::vector<std::uint8_t> wrapScratch(sendDataSize);
+        std::vector<std::uint8_t> payload(maxPayloadBytes);
+        std::size_t trimmedBytes = 0;
 
         while (keep_running)
         {
-            std::unique_lock<std::mutex> guard(dataMutex);
-            cv.wait(guard, [&recordDatas = this->m_recordDatas]()
             {
-                return recordDatas.size() > sendDataSize;  // 8000/25=320
-            });
+                std::unique_lock<std::mutex> guard(dataMutex);
+                cv.wait(guard, [this, sendDataSize]()
+                {
+                    return not keep_running or m_sendRing.readable() >= sendDataSize;
+                });
+            }
 
-            m_rtpSession->sendPacket(&m_recordDatas[0], sendDataSize, timestampinc);
-            auto it = m_recordDatas.begin();
-            for (int index = 0; index < sendDataSize; index++)
+            // fell behind, drop the oldest whole packets instead of adding latency
+            std::size_t readable = m_sendRing.readable();
+            if (readable > maxBacklog)
             {
-                it = m_recordDatas.erase(it);
+                std::size_t excessPackets = (readable - maxBacklog + sendDataSize - 1) / sendDataSize;
+                trimmedBytes += m_sendRing.skip(excessPackets * sendDataSize);
             }
+
+            bool queued = false;
+            while (const std::uint8_t* packet = m_sendRing.peek(sendDataSize, wrapScratch))
+            {
+                if (m_resetEncoder.exchange(false))
+                {
+                    m_codec->reset();
+                    if (m_vad)
+                    {
+                        m_vad->reset();
+                    }
+                    talkspurtStart = true;
+                    silentPackets = 0;
+                }
+
+                const std::int16_t* pcm = reinterpret_cast<const std::int16_t*>(packet);
+                if (m_latencyProbe)
+                {
+                    m_latencyProbe->onSend(pcm, frameSamples, channels, sampleRate);
+                }
+                if (m_vad and not m_vad->process(pcm, frameSamples))
+                {
+                    m_sendRing.consume(sendDataSize);
+                    m_suppressedPackets++;
+                    // RFC 3389 comfort noise with the level only, the timestamp keeps running
+                    if (0 == silentPackets++ % comfortNoiseIntervalPackets)
+                    {
+                        const std::uint8_t noiseLevel = m_vad->getNoiseLevel();
+                        m_rtpSession->sendPacket(&noiseLevel, sizeof(noiseLevel), comfortNoisePayloadType, false, timestampinc);
+                        queued = true;
+                    }
+                    else
+                    {
+                        m_rtpSession->incrementTimestamp(timestampinc);
+                    }
+                    talkspurtStart = true;
+                    continue;
+                }
+                silentPackets = 0;
+
+                const std::uint64_t cpuStart = audio::getThreadCpuNanoseconds();
+                int payloadSize = m_codec->encode(pcm, frameSamples, payload.data(), payload.size());
+                m_encodeCpuNanoseconds += audio::getThreadCpuNanoseconds() - cpuStart;
+                m_encodedFrames++;
+                m_sendRing.consume(sendDataSize);
+
+                if (0 < payloadSize)
+                {
+                    const std::uint64_t sendStart = audio::getThreadCpuNanoseconds();
+                    m_rtpSession->sendPacket(payload.data(), payloadSize, payloadType, talkspurtStart, timestampinc);
+                    m_sendCpuNanoseconds += audio::getThreadCpuNanoseconds() - sendStart;
+                    m_sentPackets++;
+                    talkspurtStart = false;
+                    queued = true;
+                }
+            }
+            if (not queued)
+            {
+                continue;
+            }
+            if (m_adaptiveBitrate)
+            {
+                adaptBitrate();
+            }
+            // one syscall for everything the wakeup found in the ring
+            const std::uint64_t flushStart = audio::getThreadCpuNanoseconds();
+            m_rtpSession->flushPackets();
+            m_sendCpuNanoseconds += audio::getThreadCpuNanoseconds() - flushStart;
+        }
+        if (0 < trimmedBytes)
+        {
+            LOG_WARNING_MSG("Audio sender dropped {} backlog bytes.", trimmedBytes);
         }
         return 0;
     }
 
+    void AudioRecordService::writeSessionDescription()
+    {
+        const std::string sdp = audio::createSessionDescription(*m_codec,
+            rtp::getRTPRemoteIpAddress(m_config), rtp::getRTPRemotePort(m_config),
+            m_vad ? audio::selectComfortNoisePayloadType(m_config, *m_codec) : 0,
+            endpoints::isLossProtectionEnabled(m_config) ? endpoints::selectRedPayloadType(m_config) : 0,
+            endpoints::selectRedundancyDepth(m_config), endpoints::selectFecPayloadType(m_config));
+        LOG_INFO_MSG(m_logger, "Talk channel {} payload type {}, session description:\n{}",
+            m_codec->getRtpMap(), static_cast<unsigned int>(m_codec->getPayloadType()), sdp);
+
+        const std::string sdpFile = common::getCaptureOutputDir(m_config) + "talk.sdp";
+        std::ofstream sdpStream(sdpFile, std::ios::out | std::ios::trunc);
+        if (not sdpStream)
+        {
+            LOG_WARNING_MSG("Write session description {} failed.", sdpFile);
+            return;
+        }
+        sdpStream << sdp;
+    }
+
 } // namespace usbAudio
\ No newline at end of file
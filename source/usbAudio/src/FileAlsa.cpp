@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "usbAudio/FileAlsa.hpp"
+
+namespace
+{
+    const std::string fileDevicePrefix = "file:";
+    constexpr char optionSeparator = ',';
+    constexpr int BitsByte = 8;
+    constexpr int supportedSampleBit = 16;
+    constexpr unsigned short waveFormatExtensible = 0xFFFE;
+    // periods the simulated device buffer holds, reported as the buffer size
+    constexpr std::size_t bufferPeriods = 4;
+    constexpr unsigned int microsecondsPerMillisecond = 1000;
+    constexpr std::size_t microsecondsPerSecond = 1000000;
+    // fixed seed, a jitter run can be repeated
+    constexpr std::uint32_t jitterSeed = 5489u;
+
+    std::uint32_t readLittleEndian32(const std::uint8_t* data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+
+    std::uint16_t readLittleEndian16(const std::uint8_t* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    bool endsWith(const std::string& value, const std::string& suffix)
+    {
+        return value.size() >= suffix.size() and 0 == value.compare(value.size() - suffix.size(), suffix.size(), suffix);
+    }
+} // namespace
+
+using namespace configuration;
+namespace usbAudio
+{
+    FileAlsa::FileAlsa(Logger& logger, std::unique_ptr<configuration::WAVEFORMATEX> waveFormat)
+        : m_waveFormat{ std::move(waveFormat) }
+        , m_logger{ logger }
+        , m_random{ jitterSeed }
+    {
+    }
+
+    FileAlsa::~FileAlsa()
+    {
+        stopThread();
+        closeFile();
+    }
+
+    bool FileAlsa::isFileDevice(const std::string& deviceName)
+    {
+        return 0 == deviceName.compare(0, fileDevicePrefix.size(), fileDevicePrefix);
+    }
+
+    configuration::audioDevInfo FileAlsa::getDefaultDev()
+    {
+        configuration::audioDevInfo recordDev;
+        recordDev.devName = fileDevicePrefix + "/dev/null";
+        return recordDev;
+    }
+
+    configuration::audioDevInfo FileAlsa::setAudioDev(const std::string& dev)
+    {
+        configuration::audioDevInfo recordDev;
+        recordDev.devName = dev;
+        return recordDev;
+    }
+
+    unsigned int FileAlsa::getAudioDevNum(const snd_pcm_stream_t&)
+    {
+        // the file is only checked on open
+        return 1;
+    }
+
+    int FileAlsa::createALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+        std::function<void(std::string& data)> onDataInd, void* userCallbackPara)
+    {
+        alsaAudioContext.onDataInd = onDataInd;
+        alsaAudioContext.userCallbackPara = userCallbackPara;
+        alsaAudioContext.alsaState = ALSAState::ALSA_STATE_CREATED;
+
+        return 0;
+    }
+
+    void FileAlsa::destroyALSAAudio(configuration::ALSAAudioContext&)
+    {
+        LOG_DEBUG_MSG("File audio destroy.");
+    }
+
+    int FileAlsa::openALSAAudio(configuration::ALSAAudioContext& alsaAudioContext,
+        const configuration::audioDevInfo& devInfo, const snd_pcm_stream_t& stream)
+    {
+        if (alsaAudioContext.alsaState >= ALSAState::ALSA_STATE_READY)
+        {
+            return 0;
+        }
+        if (not m_waveFormat or supportedSampleBit != m_waveFormat->wBitsPerSample or 0 == m_waveFormat->nSamplesPerSec)
+        {
+            LOG_ERROR_MSG("File audio supports 16 bit PCM only.");
+            return static_cast<int>(ALSAErrorCode::ALSA_ERR_INVAL);
+        }
+        m_stream = stream;
+        if (not parseDeviceName(devInfo.devName) or
+            not (SND_PCM_STREAM_CAPTURE == stream ? openSource() : openSink()))
+        {
+            closeFile();
+            return static_cast<int>(ALSAErrorCode::ALSA_ERR_INVAL);
+        }
+
+        const unsigned int rate = m_waveFormat->nSamplesPerSec;
+        // period and buffer time requested by the service win over the period option, as on a device
+        const unsigned int periodTime = 0 != alsaAudioContext.periodTime ?
+            alsaAudioContext.periodTime : m_options.periodMs * microsecondsPerMillisecond;
+        const std::size_t periods = 0 != alsaAudioContext.periodTime and alsaAudioContext.bufferTime > alsaAudioContext.periodTime ?
+            alsaAudioContext.bufferTime / alsaAudioContext.periodTime : bufferPeriods;
+        alsaAudioContext.periodFrames = std::max<std::size_t>(static_cast<std::size_t>(rate) * periodTime / microsecondsPerSecond, 1);
+        alsaAudioContext.bufferFrames = alsaAudioContext.periodFrames * periods;
+        alsaAudioContext.periodTime = periodTime;
+        alsaAudioContext.bufferTime = static_cast<unsigned int>(periodTime * periods);
+        alsaAudioContext.bitsPerFrame = m_waveFormat->wBitsPerSample * m_waveFormat->nChannels;
+        alsaAudioContext.mmapAccess = false;
+        alsaAudioContext.audioBuffer.assign(alsaAudioContext.periodFrames * alsaAudioContext.bitsPerFrame / BitsByte, 0);
+        // exact for the frame count, not the rounded period time
+        m_periodDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(alsaAudioContext.periodFrames) / rate));
+        m_periodsPerXrun = 0 == m_options.xrunMs ? 0 : std::max(m_options.xrunMs * microsecondsPerMillisecond / periodTime, 1u);
+
+        LOG_INFO_MSG(m_logger, "File audio {} {}, period frames: {}, buffer frames: {}, {}, xrun every {} ms, jitter {} ms",
+            SND_PCM_STREAM_CAPTURE == stream ? "capture from" : "playback to", m_options.path,
+            alsaAudioContext.periodFrames, alsaAudioContext.bufferFrames,
+            m_options.fast ? "as fast as possible" : "real time", m_options.xrunMs, m_options.jitterMs);
+        alsaAudioContext.alsaState = ALSAState::ALSA_STATE_READY;
+        return 0;
+    }
+
+    bool FileAlsa::parseDeviceName(const std::string& deviceName)
+    {
+        if (not isFileDevice(deviceName))
+        {
+            LOG_ERROR_MSG("File audio device {} has no {} prefix.", deviceName, fileDevicePrefix);
+            return false;
+        }
+
+        m_options = Options{};
+        std::istringstream fields(deviceName.substr(fileDevicePrefix.size()));
+        std::string field;
+        std::getline(fields, m_options.path, optionSeparator);
+        while (std::getline(fields, field, optionSeparator))
+        {
+            const std::size_t equal = field.find('=');
+            const std::string name = field.substr(0, equal);
+            const unsigned int value = std::string::npos == equal ? 0 :
+                static_cast<unsigned int>(std::strtoul(field.c_str() + equal + 1, nullptr, 10));
+            if ("fast" == name)
+            {
+                m_options.fast = true;
+            }
+            else if ("period" == name and 0 < value)
+            {
+                m_options.periodMs = value;
+            }
+            else if ("xrun" == name)
+            {
+                m_options.xrunMs = value;
+            }
+            else if ("jitter" == name)
+            {
+                m_options.jitterMs = value;
+            }
+            else
+            {
+                LOG_WARNING_MSG("File audio ignores option {}.", field);
+            }
+        }
+        if (m_options.path.empty())
+        {
+            LOG_ERROR_MSG("File audio device {} has no path.", deviceName);
+            return false;
+        }
+        return true;
+    }
+
+    bool FileAlsa::openSource()
+    {
+        m_file = fopen(m_options.path.c_str(), "rb");
+        if (nullptr == m_file)
+        {
+            LOG_ERROR_MSG("Open audio source {} failed {}.", m_options.path, strerror(errno));
+            return false;
+        }
+
+        // walk the RIFF chunks, the recorder's files carry a fact chunk before the data
+        std::uint8_t riff[12];
+        if (1 != fread(riff, sizeof(riff), 1, m_file) or 0 != memcmp(riff, "RIFF", 4) or 0 != memcmp(riff + 8, "WAVE", 4))
+        {
+            LOG_ERROR_MSG("Audio source {} is not a WAV file.", m_options.path);
+            return false;
+        }
+        bool haveFormat = false;
+        std::uint8_t chunk[8];
+        while (1 == fread(chunk, sizeof(chunk), 1, m_file))
+        {
+            const std::uint32_t chunkSize = readLittleEndian32(chunk + 4);
+            if (0 == memcmp(chunk, "fmt ", 4))
+            {
+                std::uint8_t format[16];
+                if (chunkSize < sizeof(format) or 1 != fread(format, sizeof(format), 1, m_file))
+                {
+                    break;
+                }
+                const std::uint16_t formatTag = readLittleEndian16(format);
+                const std::uint16_t channels = readLittleEndian16(format + 2);
+                const std::uint32_t rate = readLittleEndian32(format + 4);
+                const std::uint16_t bits = readLittleEndian16(format + 14);
+                if ((static_cast<std::uint16_t>(WaveFormatTag::WAVE_FORMAT_PCM) != formatTag and waveFormatExtensible != formatTag) or
+                    channels != m_waveFormat->nChannels or rate != m_waveFormat->nSamplesPerSec or bits != m_waveFormat->wBitsPerSample)
+                {
+                    LOG_ERROR_MSG("Audio source {} is format {} {} Hz {} channels {} bit, the device is opened as PCM {} Hz {} channels {} bit.",
+                        m_options.path, formatTag, rate, channels, bits,
+                        m_waveFormat->nSamplesPerSec, m_waveFormat->nChannels, m_waveFormat->wBitsPerSample);
+                    return false;
+                }
+                haveFormat = true;
+                fseek(m_file, static_cast<long>(chunkSize - sizeof(format) + (chunkSize & 1)), SEEK_CUR);
+            }
+            else if (0 == memcmp(chunk, "data", 4))
+            {
+                m_dataOffset = ftell(m_file);
+                fseek(m_file, 0, SEEK_END);
+                // a recording cut short by a crash may claim more than it has
+                const std::size_t available = static_cast<std::size_t>(ftell(m_file) - m_dataOffset);
+                m_dataBytes = 0 == chunkSize ? available : std::min<std::size_t>(chunkSize, available);
+                m_dataBytes -= m_dataBytes % m_waveFormat->nBlockAlign;
+                break;
+            }
+            else
+            {
+                fseek(m_file, static_cast<long>(chunkSize + (chunkSize & 1)), SEEK_CUR);
+            }
+        }
+        if (not haveFormat or 0 == m_dataBytes)
+        {
+            LOG_ERROR_MSG("Audio source {} has no PCM data.", m_options.path);
+            return false;
+        }
+        m_dataPosition = 0;
+        fseek(m_file, m_dataOffset, SEEK_SET);
+        return true;
+    }
+
+    bool FileAlsa::openSink()
+    {
+        m_file = fopen(m_options.path.c_str(), "wb");
+        if (nullptr == m_file)
+        {
+            LOG_ERROR_MSG("Open audio sink {} failed {}.", m_options.path, strerror(errno));
+            return false;
+        }
+        m_wavSink = endsWith(m_options.path, ".wav");
+        if (m_wavSink)
+        {
+            m_sinkHeader = configuration::wavePCMHeader{};
+            m_sinkHeader.format_tag = static_cast<short>(WaveFormatTag::WAVE_FORMAT_PCM);
+            m_sinkHeader.channels = static_cast<short>(m_waveFormat->nChannels);
+            m_sinkHeader.samples_per_sec = static_cast<int>(m_waveFormat->nSamplesPerSec);
+            m_sinkHeader.bits_per_sample = static_cast<short>(m_waveFormat->wBitsPerSample);
+            m_sinkHeader.block_align = static_cast<short>(m_waveFormat->nBlockAlign);
+            m_sinkHeader.avg_bytes_per_sec = static_cast<int>(m_waveFormat->nSamplesPerSec * m_waveFormat->nBlockAlign);
+            m_sinkHeader.chunkClear();
+            fwrite(&m_sinkHeader, sizeof(m_sinkHeader), 1, m_file);
+        }
+        return true;
+    }
+
+    void FileAlsa::closeFile()
+    {
+        if (nullptr == m_file)
+        {
+            return;
+        }
+        if (SND_PCM_STREAM_PLAYBACK == m_stream and m_wavSink)
+        {
+            m_sinkHeader.dwSampleLength = m_sinkHeader.data_chunk_size / (m_sinkHeader.bits_per_sample / BitsByte);
+            m_sinkHeader.chunk_size = m_sinkHeader.data_chunk_size + static_cast<int>(sizeof(m_sinkHeader) - 8);
+            fseek(m_file, 0, SEEK_SET);
+            fwrite(&m_sinkHeader, sizeof(m_sinkHeader), 1, m_file);
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+    int FileAlsa::startALSAAudio(configuration::ALSAAudioContext& alsaAudioContext, const snd_pcm_stream_t& stream)
+    {
+        if (alsaAudioContext.alsaState < ALSAState::ALSA_STATE_READY)
+        {
+            return static_cast<int>(ALSAErrorCode::ALSA_ERR_NOT_READY);
+        }
+        if (alsaAudioContext.alsaState == ALSAState::ALSA_STATE_STARTING)
+        {
+            return static_cast<int>(ALSAErrorCode::ALSA_ERR_ALREADY);
+        }
+
+        stopThread();
+        m_startTime = std::chrono::steady_clock::now();
+        m_nextPeriod = m_startTime;
+        m_periods = 0;
+        m_xruns = 0;
+        m_sourceLoops = 0;
+        m_slowestCallbackMs = 0.0;
+        alsaAudioContext.alsaState = ALSAState::ALSA_STATE_STARTING;
+        // like the event loop: capture always, playback when it pulls, otherwise the owner
+        // pushes with readAudioDataToPCM
+        if (SND_PCM_STREAM_CAPTURE == stream or alsaAudioContext.onDataReq)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = true;
+            }
+            m_thread = std::thread([this, &alsaAudioContext]() { this->run(alsaAudioContext); });
+        }
+        return 0;
+    }
+
+    int FileAlsa::stopALSAAudio(configuration::ALSAAudioContext& alsaAudioContext, const snd_pcm_stream_t&)
+    {
+        if (alsaAudioContext.alsaState < ALSAState::ALSA_STATE_STARTING)
+        {
+            LOG_DEBUG_MSG("stop failed, file audio status not starting.");
+            return -1;
+        }
+
+        stopThread();
+        alsaAudioContext.alsaState = ALSAState::ALSA_STATE_STOPPING;
+
+        const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+        const double audioSeconds = std::chrono::duration<double>(m_periodDuration * m_periods).count();
+        LOG_INFO_MSG(m_logger, "File audio {} periods ({:.1f} s audio in {:.1f} s, {:.1f}x real time), {} injected xruns, {} source loops, slowest callback {:.1f} ms.",
+            m_periods, audioSeconds, elapsedSeconds, 0.0 < elapsedSeconds ? audioSeconds / elapsedSeconds : 0.0,
+            m_xruns, m_sourceLoops, m_slowestCallbackMs);
+        return 0;
+    }
+
+    void FileAlsa::stopThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cv.notify_all();
+        // a callback that stops its own stream leaves the join to close
+        if (m_thread.joinable() and std::this_thread::get_id() != m_thread.get_id())
+        {
+            m_thread.join();
+        }
+    }
+
+    void FileAlsa::closeALSAAudio(configuration::ALSAAudioContext& alsaAudioContext, const snd_pcm_stream_t& stream)
+    {
+        if (alsaAudioContext.alsaState < ALSAState::ALSA_STATE_READY)
+        {
+            LOG_DEBUG_MSG("close failed, file audio status not ready.");
+            return;
+        }
+        if (alsaAudioContext.alsaState == ALSAState::ALSA_STATE_STARTING)
+        {
+            stopALSAAudio(alsaAudioContext, stream);
+        }
+        closeFile();
+        alsaAudioContext.audioBuffer.clear();
+        alsaAudioContext.alsaState = ALSAState::ALSA_STATE_CLOSING;
+    }
+
+    int FileAlsa::isALSAAudioStopped(configuration::ALSAAudioContext& alsaAudioContext)
+    {
+        if (alsaAudioContext.alsaState == ALSAState::ALSA_STATE_STARTING)
+        {
+            LOG_DEBUG_MSG("stop failed, file audio status is starting.");
+            return 0;
+        }
+        return 1;
+    }
+
+    int FileAlsa::readAudioDataToPCM(configuration::ALSAAudioContext& alsaAudioContext)
+    {
+        /* closing, exit the thread */
+        if (ALSAState::ALSA_STATE_STOPPING == alsaAudioContext.alsaState
+            || ALSAState::ALSA_STATE_CLOSING == alsaAudioContext.alsaState)
+        {
+            return 0;
+        }
+        if (ALSAState::ALSA_STATE_STARTING > alsaAudioContext.alsaState)
+        {
+            return static_cast<int>(ALSAErrorCode::ALSA_ERR_NOT_READY);
+        }
+
+        // the push caller blocks like a full device buffer would block it
+        waitForPeriod(false);
+        writePeriod(alsaAudioContext.audioBuffer.data(), alsaAudioContext.audioBuffer.size());
+        m_periods++;
+        return 0;
+    }
+
+    void FileAlsa::run(configuration::ALSAAudioContext& alsaAudioContext)
+    {
+        const std::size_t bytes = alsaAudioContext.periodFrames * alsaAudioContext.bitsPerFrame / BitsByte;
+        while (waitForPeriod(true))
+        {
+            m_periods++;
+            const auto callbackStart = std::chrono::steady_clock::now();
+            if (SND_PCM_STREAM_CAPTURE == m_stream)
+            {
+                std::string& recordData = alsaAudioContext.recordData;
+                recordData.resize(bytes);
+                if (not readPeriod(reinterpret_cast<std::uint8_t*>(&recordData[0]), bytes))
+                {
+                    LOG_ERROR_MSG("Audio source {} read failed, stop reading.", m_options.path);
+                    return;
+                }
+                if (isXrunPeriod())
+                {
+                    // the application was too slow, the device overwrote this period
+                    LOG_WARNING_MSG("Audio overrun happend!");
+                    continue;
+                }
+                if (alsaAudioContext.onDataInd)
+                {
+                    alsaAudioContext.onDataInd(recordData);
+                }
+            }
+            else
+            {
+                std::uint8_t* audioBuffer = alsaAudioContext.audioBuffer.data();
+                if (isXrunPeriod())
+                {
+                    // the device ran dry and played silence, no data is lost
+                    LOG_WARNING_MSG("Audio underrun happend!");
+                    std::fill(audioBuffer, audioBuffer + bytes, 0);
+                }
+                else
+                {
+                    alsaAudioContext.onDataReq(audioBuffer, alsaAudioContext.periodFrames);
+                }
+                writePeriod(audioBuffer, bytes);
+            }
+            m_slowestCallbackMs = std::max(m_slowestCallbackMs,
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - callbackStart).count());
+        }
+    }
+
+    bool FileAlsa::waitForPeriod(bool streamThread)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_options.fast)
+        {
+            return not streamThread or m_running;
+        }
+
+        // deadlines stay on the period grid, a late period does not delay the next
+        m_nextPeriod += m_periodDuration;
+        auto due = m_nextPeriod;
+        if (0 < m_options.jitterMs)
+        {
+            std::uniform_int_distribution<unsigned int> jitter(0, m_options.jitterMs * microsecondsPerMillisecond);
+            due += std::chrono::microseconds(jitter(m_random));
+        }
+        if (not streamThread)
+        {
+            // readAudioDataToPCM on the owner's thread
+            lock.unlock();
+            std::this_thread::sleep_until(due);
+            return true;
+        }
+        return not m_cv.wait_until(lock, due, [this]() { return not m_running; });
+    }
+
+    bool FileAlsa::isXrunPeriod()
+    {
+        if (0 == m_periodsPerXrun or 0 != m_periods % m_periodsPerXrun)
+        {
+            return false;
+        }
+        m_xruns++;
+        return true;
+    }
+
+    bool FileAlsa::readPeriod(std::uint8_t* data, std::size_t bytes)
+    {
+        while (0 < bytes)
+        {
+            if (m_dataPosition == m_dataBytes)
+            {
+                // start over, a short file feeds a long benchmark
+                fseek(m_file, m_dataOffset, SEEK_SET);
+                m_dataPosition = 0;
+                m_sourceLoops++;
+            }
+            const std::size_t length = std::min(bytes, m_dataBytes - m_dataPosition);
+            if (1 != fread(data, length, 1, m_file))
+            {
+                return false;
+            }
+            m_dataPosition += length;
+            data += length;
+            bytes -= length;
+        }
+        return true;
+    }
+
+    void FileAlsa::writePeriod(const std::uint8_t* data, std::size_t bytes)
+    {
+        if (nullptr == m_file)
+        {
+            return;
+        }
+        if (1 != fwrite(data, bytes, 1, m_file))
+        {
+            LOG_ERROR_MSG("Audio sink {} write failed {}.", m_options.path, strerror(errno));
+            return;
+        }
+        m_sinkHeader.data_chunk_size += static_cast<int>(bytes);
+    }
+} // namespace usbAudio
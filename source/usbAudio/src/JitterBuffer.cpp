@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include "usbAudio/JitterBuffer.hpp"
+
+namespace
+{
+    // repeated period for concealment and how long it takes to fade out
+    constexpr unsigned int concealPeriodMs = 10;
+    constexpr unsigned int concealFadeMs = 50;
+    // the depth follows this many times the jitter on top of one packet
+    constexpr double jitterDepthFactor = 3.0;
+    constexpr unsigned int millisecondsPerSecond = 1000;
+    // peak of uniform noise with rms 1, times full scale
+    constexpr float noisePeakPerRms = 1.7320508f * 32767.0f;
+} // namespace
+
+namespace usbAudio
+{
+    JitterBuffer::JitterBuffer(unsigned int sampleRate, unsigned int rtpClockRate, unsigned int channels,
+        unsigned int minDelayMs, unsigned int maxDelayMs)
+        : m_sampleRate{ sampleRate }
+        , m_rtpClockRate{ 0 == rtpClockRate ? sampleRate : rtpClockRate }
+        , m_channels{ std::max(channels, 1u) }
+        , m_minDelayFrames{ static_cast<std::size_t>(sampleRate) * minDelayMs / millisecondsPerSecond }
+        , m_maxDelayFrames{ static_cast<std::size_t>(sampleRate) * std::max(minDelayMs, maxDelayMs) / millisecondsPerSecond }
+        , m_epoch{ Clock::now() }
+        , m_history(std::max<std::size_t>(sampleRate * concealPeriodMs / millisecondsPerSecond, 1) * m_channels, 0)
+    {
+    }
+
+    void JitterBuffer::push(std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber,
+        const std::int16_t* pcm, std::size_t frames, Clock::time_point arrivalTime, bool marker)
+    {
+        if (nullptr == pcm or 0 == frames)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::int64_t timestamp = unwrapTimestamp(rtpTimestamp) * m_sampleRate / m_rtpClockRate;
+        updateSequence(sequenceNumber);
+        updateJitter(timestamp, arrivalTime);
+        m_packetFrames = frames;
+
+        if (m_playing and timestamp + static_cast<std::int64_t>(frames) <= m_playoutTimestamp)
+        {
+            if (timestamp + static_cast<std::int64_t>(frames + 2 * m_maxDelayFrames) > m_playoutTimestamp)
+            {
+                m_statistics.latePackets++;
+                return;
+            }
+            // far behind the playout position, the sender restarted its timeline
+            m_packets.clear();
+            m_playing = false;
+        }
+        else if (marker and m_playing and m_packets.empty())
+        {
+            // talkspurt after suppressed silence, anchor the playout on it
+            m_playing = false;
+        }
+
+        auto inserted = m_packets.emplace(timestamp, std::vector<std::int16_t>{});
+        if (not inserted.second)
+        {
+            m_statistics.duplicatePackets++;
+            return;
+        }
+        inserted.first->second.assign(pcm, pcm + frames * m_channels);
+    }
+
+    void JitterBuffer::pushComfortNoise(std::uint32_t rtpTimestamp, std::uint16_t sequenceNumber, std::uint8_t noiseLevel)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        unwrapTimestamp(rtpTimestamp);
+        updateSequence(sequenceNumber);
+        m_comfortNoiseAmplitude = noisePeakPerRms * std::pow(10.0f, -static_cast<float>(noiseLevel) / 20.0f);
+        m_statistics.comfortNoisePackets++;
+    }
+
+    bool JitterBuffer::pop(std::int16_t* pcm, std::size_t frames)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (not m_playing)
+        {
+            if (m_packets.empty() or
+                getBufferedEnd() - m_packets.begin()->first < static_cast<std::int64_t>(getTargetFrames()))
+            {
+                for (std::size_t i = 0; i < frames * m_channels; i++)
+                {
+                    pcm[i] = static_cast<std::int16_t>(nextNoise());
+                }
+                return false;
+            }
+            m_playing = true;
+            m_playoutTimestamp = m_packets.begin()->first;
+            m_concealedRun = 0;
+        }
+
+        // the network calmed down, give the extra delay back
+        const std::int64_t target = static_cast<std::int64_t>(getTargetFrames());
+        const std::int64_t bufferedEnd = getBufferedEnd();
+        if (bufferedEnd - m_playoutTimestamp > target + static_cast<std::int64_t>(frames + m_packetFrames))
+        {
+            m_statistics.skippedFrames += static_cast<std::uint64_t>(bufferedEnd - target - m_playoutTimestamp);
+            m_playoutTimestamp = bufferedEnd - target;
+        }
+
+        std::size_t written = 0;
+        while (written < frames)
+        {
+            while (not m_packets.empty() and
+                m_packets.begin()->first + static_cast<std::int64_t>(m_packets.begin()->second.size() / m_channels) <= m_playoutTimestamp)
+            {
+                m_packets.erase(m_packets.begin());
+            }
+
+            std::size_t count = frames - written;
+            auto next = m_packets.upper_bound(m_playoutTimestamp);
+            if (next != m_packets.begin() and std::prev(next)->first <= m_playoutTimestamp)
+            {
+                const auto& packet = *std::prev(next);
+                const std::size_t offset = static_cast<std::size_t>(m_playoutTimestamp - packet.first);
+                count = std::min(count, packet.second.size() / m_channels - offset);
+                playFrames(&packet.second[offset * m_channels], count, pcm + written * m_channels);
+                m_playoutTimestamp += static_cast<std::int64_t>(count);
+            }
+            else if (next != m_packets.end())
+            {
+                // a later packet is here, this one is lost: conceal the hole and move on
+                count = std::min(count, static_cast<std::size_t>(next->first - m_playoutTimestamp));
+                concealFrames(count, pcm + written * m_channels);
+                m_playoutTimestamp += static_cast<std::int64_t>(count);
+            }
+            else
+            {
+                // underrun, the packet is late rather than lost: hold the playout position so
+                // the delay grows by the concealed time
+                concealFrames(count, pcm + written * m_channels);
+            }
+            written += count;
+        }
+
+        if (m_packets.empty() and m_concealedRun >= m_maxDelayFrames)
+        {
+            // the stream stopped, build up the delay again when it comes back
+            m_playing = false;
+        }
+        return true;
+    }
+
+    void JitterBuffer::setNetworkJitter(double jitterMs)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_networkJitter = jitterMs * m_sampleRate / millisecondsPerSecond;
+    }
+
+    void JitterBuffer::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_packets.clear();
+        m_haveTimestamp = false;
+        m_playing = false;
+        m_haveTransit = false;
+        m_jitter = 0.0;
+        m_networkJitter = 0.0;
+        m_haveSequence = false;
+        std::fill(m_history.begin(), m_history.end(), 0);
+        m_historyPosition = 0;
+        m_concealOffset = 0;
+        m_concealGain = 1.0f;
+        m_concealedRun = 0;
+        m_comfortNoiseAmplitude = 0.0f;
+        m_statistics = JitterBufferStatistics{};
+    }
+
+    JitterBufferStatistics JitterBuffer::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        JitterBufferStatistics statistics = m_statistics;
+        const double msPerFrame = static_cast<double>(millisecondsPerSecond) / m_sampleRate;
+        statistics.jitterMs = m_jitter * msPerFrame;
+        statistics.targetDelayMs = getTargetFrames() * msPerFrame;
+        if (not m_packets.empty())
+        {
+            const std::int64_t start = m_playing ? m_playoutTimestamp : m_packets.begin()->first;
+            statistics.bufferedMs = std::max<std::int64_t>(getBufferedEnd() - start, 0) * msPerFrame;
+        }
+        return statistics;
+    }
+
+    std::int64_t JitterBuffer::unwrapTimestamp(std::uint32_t rtpTimestamp)
+    {
+        if (not m_haveTimestamp)
+        {
+            m_haveTimestamp = true;
+            m_lastTimestamp = rtpTimestamp;
+            m_lastExtendedTimestamp = rtpTimestamp;
+            return m_lastExtendedTimestamp;
+        }
+
+        // signed distance to the newest timestamp handles the 32 bit wrap and reordering
+        const std::int64_t timestamp = m_lastExtendedTimestamp + static_cast<std::int32_t>(rtpTimestamp - m_lastTimestamp);
+        if (timestamp > m_lastExtendedTimestamp)
+        {
+            m_lastTimestamp = rtpTimestamp;
+            m_lastExtendedTimestamp = timestamp;
+        }
+        return timestamp;
+    }
+
+    void JitterBuffer::updateJitter(std::int64_t timestamp, Clock::time_point arrivalTime)
+    {
+        const double arrival = std::chrono::duration<double>(arrivalTime - m_epoch).count() * m_sampleRate;
+        const double transit = arrival - static_cast<double>(timestamp);
+        if (m_haveTransit)
+        {
+            m_jitter += (std::fabs(transit - m_lastTransit) - m_jitter) / 16.0;
+        }
+        m_haveTransit = true;
+        m_lastTransit = transit;
+    }
+
+    void JitterBuffer::updateSequence(std::uint16_t sequenceNumber)
+    {
+        m_statistics.receivedPackets++;
+        if (not m_haveSequence)
+        {
+            m_haveSequence = true;
+            m_maxSequence = sequenceNumber;
+            return;
+        }
+
+        const std::int64_t sequence = m_maxSequence + static_cast<std::int16_t>(sequenceNumber - static_cast<std::uint16_t>(m_maxSequence));
+        if (sequence > m_maxSequence)
+        {
+            m_statistics.lostPackets += sequence - m_maxSequence - 1;
+            m_maxSequence = sequence;
+        }
+        else
+        {
+            // a reordered packet fills a hole counted before
+            m_statistics.lostPackets--;
+        }
+    }
+
+    std::size_t JitterBuffer::getTargetFrames() const
+    {
+        const std::size_t target = m_packetFrames + static_cast<std::size_t>(jitterDepthFactor * std::max(m_jitter, m_networkJitter));
+        return std::min(std::max(target, m_minDelayFrames), m_maxDelayFrames);
+    }
+
+    std::int64_t JitterBuffer::getBufferedEnd() const
+    {
+        if (m_packets.empty())
+        {
+            return m_playoutTimestamp;
+        }
+        const auto& last = *m_packets.rbegin();
+        return last.first + static_cast<std::int64_t>(last.second.size() / m_channels);
+    }
+
+    void JitterBuffer::playFrames(const std::int16_t* source, std::size_t frames, std::int16_t* pcm)
+    {
+        const std::size_t samples = frames * m_channels;
+        memcpy(pcm, source, samples * sizeof(std::int16_t));
+        for (std::size_t i = 0; i < samples; i++)
+        {
+            m_history[m_historyPosition] = source[i];
+            m_historyPosition = (m_historyPosition + 1) % m_history.size();
+        }
+        m_concealOffset = 0;
+        m_concealGain = 1.0f;
+        m_concealedRun = 0;
+        m_comfortNoiseAmplitude = 0.0f;
+    }
+
+    void JitterBuffer::concealFrames(std::size_t frames, std::int16_t* pcm)
+    {
+        // repeat the last played period, fading to silence or the comfort noise
+        const float step = static_cast<float>(millisecondsPerSecond) / (m_sampleRate * concealFadeMs);
+        for (std::size_t frame = 0; frame < frames; frame++)
+        {
+            for (unsigned int channel = 0; channel < m_channels; channel++)
+            {
+                const std::int16_t sample = m_history[(m_historyPosition + m_concealOffset) % m_history.size()];
+                const float value = sample * m_concealGain + nextNoise();
+                *pcm++ = static_cast<std::int16_t>(std::min(std::max(value, -32768.0f), 32767.0f));
+                m_concealOffset++;
+            }
+            m_concealGain = std::max(m_concealGain - step, 0.0f);
+        }
+        m_concealedRun += frames;
+        if (0.0f == m_comfortNoiseAmplitude)
+        {
+            // a silence the sender told about is not a loss
+            m_statistics.concealedFrames += frames;
+        }
+    }
+
+    float JitterBuffer::nextNoise()
+    {
+        if (0.0f == m_comfortNoiseAmplitude)
+        {
+            return 0.0f;
+        }
+        // xorshift32, uniform in [-1, 1)
+        m_noiseState ^= m_noiseState << 13;
+        m_noiseState ^= m_noiseState >> 17;
+        m_noiseState ^= m_noiseState << 5;
+        return (static_cast<float>(m_noiseState) / 2147483648.0f - 1.0f) * m_comfortNoiseAmplitude;
+    }
+} // namespace usbAudio
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cmath>
+#include "usbAudio/LatencyProbe.hpp"
+
+namespace
+{
+    constexpr double markerFrequency = 1000.0;
+    constexpr double markerAmplitude = 8192.0;  // -12 dBFS
+    constexpr unsigned int markerMs = 50;
+    // 4 ms detection blocks, 1 kHz falls on a whole bin
+    constexpr unsigned int blocksPerSecond = 250;
+    constexpr std::size_t minBlockFrames = 8;
+    // share of the block energy in the marker bin, and the lowest marker amplitude
+    constexpr double toneEnergyRatio = 0.7;
+    constexpr double minToneAmplitude = 1000.0;
+    // quiet blocks before the detector looks for the next marker
+    constexpr unsigned int rearmBlocks = 3;
+    // markers in flight, older ones are lost
+    constexpr std::size_t maxPendingMarkers = 8;
+    constexpr double pi = 3.14159265358979323846;
+    constexpr int p50 = 50;
+    constexpr int p99 = 99;
+
+    const char* stageNames[] = { "capture", "send", "network", "jitter", "playback", "total" };
+
+    double percentile(std::vector<double> values, int percent)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        // nearest rank
+        const std::size_t rank = (values.size() * percent + 99) / 100;
+        std::nth_element(values.begin(), values.begin() + (rank - 1), values.end());
+        return values[rank - 1];
+    }
+
+    std::chrono::steady_clock::duration framesToDuration(double frames, unsigned int sampleRate)
+    {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(frames / sampleRate));
+    }
+} // namespace
+
+namespace usbAudio
+{
+    LatencyProbe::LatencyProbe(Logger& logger, unsigned int intervalMs)
+        : m_logger{ logger }
+        , m_interval{ std::chrono::milliseconds(std::max(intervalMs, markerMs * 2)) }
+    {
+        LOG_INFO_MSG(m_logger, "Audio latency probe, a {} ms marker tone every {} ms, needs the talk channel looped back.",
+            markerMs, std::chrono::duration_cast<std::chrono::milliseconds>(m_interval).count());
+    }
+
+    void LatencyProbe::onCapture(std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate)
+    {
+        const Clock::time_point now = Clock::now();
+        const unsigned int generation = m_generation.load();
+        if (m_captureGeneration != generation)
+        {
+            m_captureGeneration = generation;
+            m_nextMarker = now;
+            m_toneFramesLeft = 0;
+        }
+
+        if (0 == m_toneFramesLeft and now >= m_nextMarker)
+        {
+            // the marker starts the period, its first sample is a period old
+            Marker marker;
+            marker.times[POINT_CAPTURED] = now - framesToDuration(static_cast<double>(frames), sampleRate);
+            marker.times[POINT_CALLBACK] = now;
+            marker.passed = POINT_SENT;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                marker.id = m_nextId++;
+                m_markers.push_back(marker);
+                if (m_markers.size() > maxPendingMarkers)
+                {
+                    m_markers.pop_front();
+                    m_lostMarkers++;
+                }
+            }
+            m_nextMarker = now + m_interval;
+            m_toneFramesLeft = static_cast<std::size_t>(sampleRate) * markerMs / 1000;
+            m_tonePhase = 0.0;
+        }
+
+        const std::size_t toneFrames = std::min(frames, m_toneFramesLeft);
+        const double phaseStep = 2.0 * pi * markerFrequency / sampleRate;
+        for (std::size_t i = 0; i < toneFrames; ++i)
+        {
+            const std::int16_t sample = static_cast<std::int16_t>(markerAmplitude * std::sin(m_tonePhase));
+            m_tonePhase += phaseStep;
+            for (unsigned int channel = 0; channel < channels; ++channel)
+            {
+                pcm[i * channels + channel] = sample;
+            }
+        }
+        m_toneFramesLeft -= toneFrames;
+    }
+
+    void LatencyProbe::onSend(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate)
+    {
+        double onset = 0.0;
+        prepare(m_sendDetector, sampleRate);
+        if (detect(m_sendDetector, pcm, frames, channels, onset))
+        {
+            passPoint(POINT_SENT, Clock::now());
+        }
+    }
+
+    void LatencyProbe::onReceive(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate)
+    {
+        double onset = 0.0;
+        prepare(m_receiveDetector, sampleRate);
+        if (detect(m_receiveDetector, pcm, frames, channels, onset))
+        {
+            passPoint(POINT_RECEIVED, Clock::now());
+        }
+    }
+
+    void LatencyProbe::onPlayback(const std::int16_t* pcm, std::size_t frames, unsigned int channels, unsigned int sampleRate,
+        std::size_t queuedFrames)
+    {
+        double onset = 0.0;
+        prepare(m_playbackDetector, sampleRate);
+        if (detect(m_playbackDetector, pcm, frames, channels, onset))
+        {
+            const Clock::time_point now = Clock::now();
+            passPoint(POINT_MIXED, now);
+            // this period plays after the queued ones, the marker at its onset in it
+            passPoint(POINT_PLAYED, now + framesToDuration(static_cast<double>(queuedFrames) + onset, sampleRate));
+        }
+    }
+
+    void LatencyProbe::prepare(Detector& detector, unsigned int sampleRate)
+    {
+        const unsigned int generation = m_generation.load();
+        if (detector.generation == generation and detector.sampleRate == sampleRate)
+        {
+            return;
+        }
+        detector = Detector{};
+        detector.generation = generation;
+        detector.sampleRate = sampleRate;
+        detector.blockFrames = std::max<std::size_t>(sampleRate / blocksPerSecond, minBlockFrames);
+        detector.coefficient = 2.0 * std::cos(2.0 * pi * markerFrequency / sampleRate);
+    }
+
+    bool LatencyProbe::detect(Detector& detector, const std::int16_t* pcm, std::size_t frames, unsigned int channels, double& onset)
+    {
+        bool found = false;
+        const double blockFrames = static_cast<double>(detector.blockFrames);
+        for (std::size_t i = 0; i < frames; ++i)
+        {
+            // the first channel is enough, the marker is written to all
+            const double sample = pcm[i * channels];
+            const double s = sample + detector.coefficient * detector.s1 - detector.s2;
+            detector.s2 = detector.s1;
+            detector.s1 = s;
+            detector.energy += sample * sample;
+            if (++detector.count < detector.blockFrames)
+            {
+                continue;
+            }
+
+            const double power = std::max(detector.s1 * detector.s1 + detector.s2 * detector.s2 -
+                detector.coefficient * detector.s1 * detector.s2, 0.0);
+            const double amplitude = 2.0 * std::sqrt(power) / blockFrames;
+            const bool tone = 0.0 < detector.energy and amplitude >= minToneAmplitude and
+                2.0 * power / (blockFrames * detector.energy) >= toneEnergyRatio;
+            if (tone and detector.armed and not found)
+            {
+                // the previous block holds the start of the tone in proportion to its amplitude
+                const double blockStart = static_cast<double>(i + 1) - blockFrames;
+                onset = blockStart - blockFrames * std::min(detector.previousAmplitude / amplitude, 1.0);
+                detector.armed = false;
+                found = true;
+            }
+            detector.quietBlocks = tone ? 0 : detector.quietBlocks + 1;
+            if (rearmBlocks <= detector.quietBlocks)
+            {
+                detector.armed = true;
+            }
+            detector.previousAmplitude = amplitude;
+            detector.s1 = 0.0;
+            detector.s2 = 0.0;
+            detector.energy = 0.0;
+            detector.count = 0;
+        }
+        return found;
+    }
+
+    void LatencyProbe::passPoint(unsigned int point, Clock::time_point time)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // the newest marker that reached the point before, older ones were lost on the way
+        auto marker = std::find_if(m_markers.rbegin(), m_markers.rend(),
+            [point](const Marker& pending) { return pending.passed == point; });
+        if (m_markers.rend() == marker)
+        {
+            return;
+        }
+        marker->times[point] = time;
+        marker->passed = point + 1;
+        if (POINT_PLAYED != point)
+        {
+            return;
+        }
+
+        for (unsigned int stage = STAGE_CAPTURE; stage < STAGE_TOTAL; ++stage)
+        {
+            m_stageMs[stage].push_back(std::chrono::duration<double, std::milli>(
+                marker->times[stage + 1] - marker->times[stage]).count());
+        }
+        m_stageMs[STAGE_TOTAL].push_back(std::chrono::duration<double, std::milli>(
+            marker->times[POINT_PLAYED] - marker->times[POINT_CAPTURED]).count());
+
+        const auto completed = marker.base() - 1;
+        m_lostMarkers += static_cast<std::size_t>(completed - m_markers.begin());
+        m_markers.erase(m_markers.begin(), completed + 1);
+        m_completed.notify_all();
+    }
+
+    void LatencyProbe::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_markers.clear();
+        for (auto& values : m_stageMs)
+        {
+            values.clear();
+        }
+        m_lostMarkers = 0;
+        m_generation++;
+    }
+
+    bool LatencyProbe::waitForMarkers(std::size_t markers, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_completed.wait_for(lock, timeout, [this, markers]() { return m_stageMs[STAGE_TOTAL].size() >= markers; });
+    }
+
+    LatencyProbe::Summary LatencyProbe::report(const std::string& label)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Summary summary;
+        summary.markers = m_stageMs[STAGE_TOTAL].size();
+        // still pending after a whole interval, they will not arrive
+        const Clock::time_point now = Clock::now();
+        summary.lostMarkers = m_lostMarkers + static_cast<std::size_t>(std::count_if(m_markers.begin(), m_markers.end(),
+            [this, now](const Marker& pending) { return now - pending.times[POINT_CALLBACK] > m_interval; }));
+
+        LOG_INFO_MSG(m_logger, "Audio latency {}: {} markers, {} lost.", label, summary.markers, summary.lostMarkers);
+        for (unsigned int stage = STAGE_CAPTURE; stage < STAGE_COUNT and 0 < summary.markers; ++stage)
+        {
+            const std::vector<double>& values = m_stageMs[stage];
+            summary.p50Ms[stage] = percentile(values, p50);
+            summary.p99Ms[stage] = percentile(values, p99);
+            LOG_INFO_MSG(m_logger, "Audio latency {} {}: p50 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms.", label, stageNames[stage],
+                summary.p50Ms[stage], summary.p99Ms[stage], *std::max_element(values.begin(), values.end()));
+        }
+        return summary;
+    }
+} // namespace usbAudio
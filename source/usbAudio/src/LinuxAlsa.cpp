@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include "usbAudio/LinuxAlsa.hpp"
 extern "C"
 {
@@ -14,7 +16,7 @@ namespace
     constexpr int PeriodTime = 100 * 1000;
     constexpr int PCMTimeWait = 100;
     constexpr int BitsByte = 8;
-    std::atomic_bool keep_running{true};
+    constexpr int SuspendRetryTime = 10 * 1000;
 } // namespace
 
 using namespace configuration;
@@ -23,6 +25,7 @@ namespace usbAudio
     LinuxAlsa::LinuxAlsa(Logger& logger, std::unique_ptr<configuration::WAVEFORMATEX> waveFormat)
         : m_waveFormat{ std::move(waveFormat) }
         , m_logger{logger}
+        , m_eventLoop{ AlsaEventLoop::getInstance() }
     {
 
     }
@@ -107,28 +110,47 @@ namespace usbAudio
         }
 
         int ret = 0;
+        snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
         if (SND_PCM_STREAM_CAPTURE == stream)
         {
-            ret = startALSAAudioInternal(static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle));
+            ret = startALSAAudioInternal(handle);
             if (ret == 0)
             {
                 alsaAudioContext.alsaState = configuration::ALSAState::ALSA_STATE_STARTING;
-                keep_running = true;
-
-                alsaAudioContext.audioThread = std::thread([this, &alsaAudioContext]()
+                // every period is read on the event loop as soon as the device has it
+                if (not m_eventLoop->addPCM(handle, [this, &alsaAudioContext](unsigned short)
+                    {
+                        this->onCaptureReady(alsaAudioContext);
+                    }))
                 {
-                    this->createCallbackThread(alsaAudioContext);
-                });
+                    ret = static_cast<int>(ALSAErrorCode::ALSA_ERR_GENERAL);
+                }
             }
             if (ALSAErrorCode::ALSA_ERR_File_Descriptor_Bad_State == static_cast<ALSAErrorCode>(ret))
             {
-                snd_pcm_state_t state = snd_pcm_state(static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle));
+                snd_pcm_state_t state = snd_pcm_state(handle);
                 LOG_WARNING_MSG("PCM state is {}", coverToDescription(state));
             }
         }
         else if (SND_PCM_STREAM_PLAYBACK == stream)
         {
+            // a stopped (dropped) stream has to be prepared again before it takes data
+            ret = snd_pcm_prepare(handle);
+            if (0 > ret)
+            {
+                LOG_ERROR_MSG("PCM prepare failed {}", snd_strerror(ret));
+                return ret;
+            }
             alsaAudioContext.alsaState = configuration::ALSAState::ALSA_STATE_STARTING;
+            // with a pull callback the event loop refills the device whenever a period is free,
+            // otherwise the owner pushes with readAudioDataToPCM
+            if (alsaAudioContext.onDataReq and not m_eventLoop->addPCM(handle, [this, &alsaAudioContext](unsigned short)
+                {
+                    this->onPlaybackReady(alsaAudioContext);
+                }))
+            {
+                ret = static_cast<int>(ALSAErrorCode::ALSA_ERR_GENERAL);
+            }
         }
 
         return ret;
@@ -158,45 +180,90 @@ namespace usbAudio
         return errCode;
     }
 
-    void LinuxAlsa::createCallbackThread(configuration::ALSAAudioContext& alsaAudioContext)
+    void LinuxAlsa::onCaptureReady(configuration::ALSAAudioContext& alsaAudioContext)
     {
-        while (keep_running)
-        {
-            size_t frames = alsaAudioContext.periodFrames;
-            size_t bytes = frames * alsaAudioContext.bitsPerFrame / BitsByte;
+        snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
+        const size_t frames = alsaAudioContext.periodFrames;
+        const size_t bytes = frames * alsaAudioContext.bitsPerFrame / BitsByte;
 
-            /* closing, exit the thread */
-            if (ALSAState::ALSA_STATE_STOPPING == alsaAudioContext.alsaState
-                || ALSAState::ALSA_STATE_CLOSING == alsaAudioContext.alsaState)
+        while (true)
+        {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0)
             {
+                // prepared again after an overrun, capture needs an explicit start
+                if (xRunRecovery(alsaAudioContext, avail) < 0 or snd_pcm_start(handle) < 0)
+                {
+                    LOG_ERROR_MSG("PCM capture can not recover from {}, stop reading.", snd_strerror(avail));
+                    m_eventLoop->removePCM(handle);
+                }
                 return;
             }
-
-            if (ALSAState::ALSA_STATE_STARTING > alsaAudioContext.alsaState)
+            if (static_cast<size_t>(avail) < frames)
             {
-                usleep(100 * 1000);
+                return;
             }
 
-			const size_t readFrames = pcmRead(alsaAudioContext, frames);
+            /* the period goes straight into the pooled callback buffer, the consumer may
+            * shrink it in place, its capacity stays for the next period */
+            std::string& recordData = alsaAudioContext.recordData;
+            recordData.resize(bytes);
+			const size_t readFrames = pcmRead(alsaAudioContext, frames, reinterpret_cast<std::uint8_t*>(&recordData[0]));
             if (readFrames != frames)
             {
 				LOG_WARNING_MSG("PCM read audio frames {} not match {}.", readFrames, frames);
-                continue;
+                return;
             }
 
             if (alsaAudioContext.onDataInd)
             {
-                std::string recordData(alsaAudioContext.audioBuffer.begin(), alsaAudioContext.audioBuffer.end());
                 alsaAudioContext.onDataInd(recordData);
             }
         }
-        return;
     }
 
-    int LinuxAlsa::pcmRead(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize)
+    void LinuxAlsa::onPlaybackReady(configuration::ALSAAudioContext& alsaAudioContext)
     {
         snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
-        char* audioData = reinterpret_cast<char*>(&alsaAudioContext.audioBuffer[0]);
+        const size_t frames = alsaAudioContext.periodFrames;
+
+        while (true)
+        {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0)
+            {
+                if (xRunRecovery(alsaAudioContext, avail) < 0)
+                {
+                    LOG_ERROR_MSG("PCM playback can not recover from {}, stop writing.", snd_strerror(avail));
+                    m_eventLoop->removePCM(handle);
+                    return;
+                }
+                continue;
+            }
+            if (static_cast<size_t>(avail) < frames)
+            {
+                // the buffer is as full as it gets, also after a recovery prepared the stream again
+                startMmapPlayback(alsaAudioContext);
+                return;
+            }
+
+            alsaAudioContext.onDataReq(&alsaAudioContext.audioBuffer[0], frames);
+            if (pcmWrite(alsaAudioContext, frames) != static_cast<int>(frames))
+            {
+                return;
+            }
+        }
+    }
+
+    int LinuxAlsa::pcmRead(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize, std::uint8_t* audioBuffer)
+    {
+        if (alsaAudioContext.mmapAccess)
+        {
+            return pcmMmapTransfer(alsaAudioContext, frameSize, audioBuffer, SND_PCM_STREAM_CAPTURE);
+        }
+
+        snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
+        char* audioData = reinterpret_cast<char*>(audioBuffer);
         snd_pcm_uframes_t count = frameSize;
 
         while (count > 0)
@@ -214,8 +281,6 @@ namespace usbAudio
                 if (xRunRecovery(alsaAudioContext, rData) < 0)
                 {
                     LOG_ERROR_MSG("PCM is not in the right state(SND_PCM_STATE_PREPARED or SND_PCM_STATE_RUNNING) {}.", rData);
-                    usleep(200 * 1000);
-
                     return -1;
                 }
             }
@@ -252,7 +317,7 @@ namespace usbAudio
             while ((ret = snd_pcm_resume(handle)) == -EAGAIN)
             {
                 LOG_WARNING_MSG("pcm resume wait until the suspend flag is released");
-                usleep(200 * 1000);	/* wait until the suspend flag is released */
+                usleep(SuspendRetryTime);	/* wait until the suspend flag is released */
             }
             if (ret < 0)
             {
@@ -284,7 +349,7 @@ namespace usbAudio
 
             if (ALSAState::ALSA_STATE_STARTING > alsaAudioContext.alsaState)
             {
-                usleep(100 * 1000);
+                return static_cast<int>(ALSAErrorCode::ALSA_ERR_NOT_READY);
             }
 
             if (pcmWrite(alsaAudioContext, frames) != frames)
@@ -297,8 +362,13 @@ namespace usbAudio
 
     int LinuxAlsa::pcmWrite(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize)
     {
+        if (alsaAudioContext.mmapAccess)
+        {
+            return pcmMmapTransfer(alsaAudioContext, frameSize, &alsaAudioContext.audioBuffer[0], SND_PCM_STREAM_PLAYBACK);
+        }
+
         snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
-        char* audioData = reinterpret_cast<char*>(alsaAudioContext.audioBuffer[0]);
+        char* audioData = reinterpret_cast<char*>(&alsaAudioContext.audioBuffer[0]);
         snd_pcm_uframes_t count = frameSize;
 
         while (count > 0)
@@ -328,6 +398,118 @@ namespace usbAudio
         return frameSize;
     }
 
+    /* copy frames between audioData and the DMA ring: mmap_begin exposes the next contiguous
+    * part of the hardware buffer, commit hands it to (playback) or releases it from (capture) the device */
+    int LinuxAlsa::pcmMmapTransfer(configuration::ALSAAudioContext& alsaAudioContext, const size_t& frameSize,
+        std::uint8_t* audioData, const snd_pcm_stream_t& stream)
+    {
+        snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
+        const size_t bytesPerFrame = alsaAudioContext.bitsPerFrame / BitsByte;
+        snd_pcm_uframes_t count = frameSize;
+
+        while (count > 0)
+        {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0)
+            {
+                if (xRunRecovery(alsaAudioContext, avail) < 0)
+                {
+                    LOG_ERROR_MSG("PCM mmap recovery failed {}.", snd_strerror(avail));
+                    return -1;
+                }
+                continue;
+            }
+
+            // readi/writei start a prepared stream on their own, mmap does not
+            if (SND_PCM_STREAM_PLAYBACK == stream)
+            {
+                startMmapPlayback(alsaAudioContext);
+            }
+            else if (SND_PCM_STATE_PREPARED == snd_pcm_state(handle))
+            {
+                snd_pcm_start(handle);
+            }
+            if (0 == avail)
+            {
+                snd_pcm_wait(handle, PCMTimeWait);
+                continue;
+            }
+
+            const snd_pcm_channel_area_t* areas = nullptr;
+            snd_pcm_uframes_t offset = 0;
+            snd_pcm_uframes_t frames = std::min<snd_pcm_uframes_t>(count, avail);
+            int ret = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+            if (ret < 0)
+            {
+                if (xRunRecovery(alsaAudioContext, ret) < 0)
+                {
+                    LOG_ERROR_MSG("PCM mmap begin failed {}.", snd_strerror(ret));
+                    return -1;
+                }
+                continue;
+            }
+
+            // interleaved: every channel shares one area, frames are step bits apart
+            std::uint8_t* dmaData = static_cast<std::uint8_t*>(areas[0].addr) + (areas[0].first + offset * areas[0].step) / BitsByte;
+            if (SND_PCM_STREAM_CAPTURE == stream)
+            {
+                memcpy(audioData, dmaData, frames * bytesPerFrame);
+            }
+            else
+            {
+                memcpy(dmaData, audioData, frames * bytesPerFrame);
+            }
+
+            snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+            if (committed < 0 or static_cast<snd_pcm_uframes_t>(committed) != frames)
+            {
+                if (xRunRecovery(alsaAudioContext, committed >= 0 ? -EPIPE : committed) < 0)
+                {
+                    LOG_ERROR_MSG("PCM mmap commit failed {}.", snd_strerror(committed));
+                    return -1;
+                }
+                continue;
+            }
+            count -= frames;
+            audioData += frames * bytesPerFrame;
+            if (SND_PCM_STREAM_PLAYBACK == stream)
+            {
+                startMmapPlayback(alsaAudioContext);
+            }
+        }
+        return frameSize;
+    }
+
+    void LinuxAlsa::startMmapPlayback(configuration::ALSAAudioContext& alsaAudioContext)
+    {
+        snd_pcm_t* handle = static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle);
+        if (not alsaAudioContext.mmapAccess or SND_PCM_STATE_PREPARED != snd_pcm_state(handle))
+        {
+            return;
+        }
+        const snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail < 0)
+        {
+            return;
+        }
+
+        // whole periods fit in the buffer, a larger threshold would never be reached
+        const size_t bufferFrames = alsaAudioContext.bufferFrames;
+        const size_t periodFrames = std::max<size_t>(alsaAudioContext.periodFrames, 1);
+        const size_t startFrames = std::min(0 == alsaAudioContext.startThresholdFrames ? bufferFrames : alsaAudioContext.startThresholdFrames,
+            bufferFrames / periodFrames * periodFrames);
+        const size_t queuedFrames = bufferFrames - std::min<size_t>(static_cast<size_t>(avail), bufferFrames);
+        if (queuedFrames < startFrames)
+        {
+            return;
+        }
+        const int ret = snd_pcm_start(handle);
+        if (ret < 0)
+        {
+            LOG_WARNING_MSG("PCM mmap playback start failed {}.", snd_strerror(ret));
+        }
+    }
+
  /************************API for clear resource*************************************/
     void LinuxAlsa::destroyALSAAudio(configuration::ALSAAudioContext& alsaAudioContext)
     {
@@ -358,18 +540,10 @@ namespace usbAudio
             return -1;
         }
 
+        /* no callback runs once the event loop let go of the pcm */
+        m_eventLoop->removePCM(static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle));
         int ret = stopALSAAudioInternal(static_cast<snd_pcm_t*>(alsaAudioContext.pcmHandle));
         alsaAudioContext.alsaState = ALSAState::ALSA_STATE_STOPPING;
-        keep_running = false;
-
-        if (SND_PCM_STREAM_CAPTURE == stream)
-        {
-            /* wait for the pcm thread quit first */
-            if (alsaAudioContext.audioThread.joinable())
-            {
-                alsaAudioContext.audioThread.join();
-            }
-        }
         return ret;
     }
 
@@ -542,8 +716,13 @@ namespace usbAudio
         the channel Setting. For example, the sound card wants to play 16-bit PCM stereo data,
         which means that there is 16-bit left channel data in each PCM frame, and then 16-bit right channel data.
         */
+        /* SND_PCM_ACCESS_MMAP_INTERLEAVED
+        Same layout, but the application reads/writes the DMA buffer directly (snd_pcm_mmap_begin/commit)
+        instead of having readi/writei copy through the kernel. Used whenever the device supports it.
+        */
+        alsaAudioContext.mmapAccess = (0 == snd_pcm_hw_params_test_access(handle, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED));
         ret = snd_pcm_hw_params_set_access(handle, hwParams,
-            SND_PCM_ACCESS_RW_INTERLEAVED);
+            alsaAudioContext.mmapAccess ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED);
         if (ret < 0)
         {
             LOG_ERROR_MSG("Access type not available {}.", ret);
@@ -588,6 +767,9 @@ namespace usbAudio
 
         //alsaAudioContext.bufferTime = BufferTime;
         //alsaAudioContext.periodTime = PeriodTime;
+        // asked for by a latency profile or sweep, checked after the negotiation
+        const unsigned int requestedPeriodTime = alsaAudioContext.periodTime;
+        const unsigned int requestedBufferTime = alsaAudioContext.bufferTime;
         if (0 == alsaAudioContext.bufferTime || 0 == alsaAudioContext.periodTime)
         {
             ret = snd_pcm_hw_params_get_buffer_time_max(hwParams,
@@ -647,6 +829,12 @@ namespace usbAudio
             return false;
         }
         alsaAudioContext.bufferFrames = size;
+        if (0 != requestedPeriodTime and 0 != requestedBufferTime and
+            (requestedPeriodTime != alsaAudioContext.periodTime or requestedBufferTime != alsaAudioContext.bufferTime))
+        {
+            LOG_WARNING_MSG("ALSA audio device changed period time {} us to {} us, buffer time {} us to {} us.",
+                requestedPeriodTime, alsaAudioContext.periodTime, requestedBufferTime, alsaAudioContext.bufferTime);
+        }
 
         if (snd_pcm_format_physical_width(pcmFormat) != m_waveFormat->wBitsPerSample)
         {
@@ -661,9 +849,9 @@ namespace usbAudio
             LOG_ERROR_MSG("Unable to install hw params {}.", snd_strerror(ret));
             return false;
         }
-        LOG_INFO_MSG(m_logger, "ALSA audio period time: {}, period frames: {}; buffer time: {}, buffer frames: {}",
+        LOG_INFO_MSG(m_logger, "ALSA audio period time: {}, period frames: {}; buffer time: {}, buffer frames: {}, {} access",
             alsaAudioContext.periodTime, alsaAudioContext.periodFrames, 
-            alsaAudioContext.bufferTime, alsaAudioContext.bufferFrames);
+            alsaAudioContext.bufferTime, alsaAudioContext.bufferFrames, alsaAudioContext.mmapAccess ? "mmap" : "read/write");
 
         return true;
     }
@@ -687,8 +875,12 @@ namespace usbAudio
          * the alsa driver will start AD conversion and capture data. */
 //         ret = snd_pcm_sw_params_set_start_threshold(handle, swParams,
 //             recorder.bufferFrames * 2);
-         ret = snd_pcm_sw_params_set_start_threshold(handle, swParams,
-             (alsaAudioContext.bufferFrames/ alsaAudioContext.periodFrames) * alsaAudioContext.periodFrames);
+        const snd_pcm_uframes_t periods = alsaAudioContext.bufferFrames / alsaAudioContext.periodFrames;
+        const snd_pcm_uframes_t startThreshold = alsaAudioContext.periodFrames * (0 == alsaAudioContext.startThresholdPeriods ?
+            periods : std::min<snd_pcm_uframes_t>(alsaAudioContext.startThresholdPeriods, periods));
+        const snd_pcm_uframes_t availMin = alsaAudioContext.periodFrames *
+            std::min<snd_pcm_uframes_t>(std::max(alsaAudioContext.availMinPeriods, 1u), periods);
+        ret = snd_pcm_sw_params_set_start_threshold(handle, swParams, startThreshold);
         if (ret < 0)
         {
             LOG_ERROR_MSG("set start threshold fail {}.", snd_strerror(ret));
@@ -699,7 +891,7 @@ namespace usbAudio
         * indicating that the user is waiting. 
         * For record, it is waiting for the newly collected data of the sound card below to reach a certain amount.
         * This number is set with snd_pcm_sw_params_set_avail_min.The unit is frame. */
-        ret = snd_pcm_sw_params_set_avail_min(handle, swParams, alsaAudioContext.periodFrames);
+        ret = snd_pcm_sw_params_set_avail_min(handle, swParams, availMin);
         if (ret < 0)
         {
             LOG_ERROR_MSG("set avail min failed {}.", snd_strerror(ret));
@@ -711,6 +903,26 @@ namespace usbAudio
             LOG_ERROR_MSG("unable to install sw params {}.", snd_strerror(ret));
             return false;
         }
+
+        // read back what the device runs with
+        snd_pcm_uframes_t acceptedStartThreshold = startThreshold;
+        snd_pcm_uframes_t acceptedAvailMin = availMin;
+        if (0 == snd_pcm_sw_params_current(handle, swParams))
+        {
+            snd_pcm_sw_params_get_start_threshold(swParams, &acceptedStartThreshold);
+            snd_pcm_sw_params_get_avail_min(swParams, &acceptedAvailMin);
+        }
+        alsaAudioContext.startThresholdFrames = acceptedStartThreshold;
+        if (acceptedStartThreshold != startThreshold or acceptedAvailMin != availMin)
+        {
+            LOG_WARNING_MSG("ALSA audio device changed start threshold {} to {} frames, avail min {} to {} frames.",
+                startThreshold, acceptedStartThreshold, availMin, acceptedAvailMin);
+        }
+        // capture hands a period over once avail min frames are in, playback keeps the whole buffer queued
+        const bool capture = SND_PCM_STREAM_CAPTURE == snd_pcm_stream(handle);
+        LOG_INFO_MSG(m_logger, "ALSA audio start threshold {} frames, avail min {} frames, theoretical {} latency {:.1f} ms.",
+            acceptedStartThreshold, acceptedAvailMin, capture ? "capture" : "playback",
+            (capture ? acceptedAvailMin : alsaAudioContext.bufferFrames) * 1000.0 / m_waveFormat->nSamplesPerSec);
         return true;
     }
 
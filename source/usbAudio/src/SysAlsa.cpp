@@ -0,0 +1,23 @@
+#include "usbAudio/FileAlsa.hpp"
+#include "usbAudio/LinuxAlsa.hpp"
+
+namespace usbAudio
+{
+    std::unique_ptr<ISysAlsa> createSysAlsa(Logger& logger, std::unique_ptr<configuration::WAVEFORMATEX> waveFormat,
+        const std::string& deviceName)
+    {
+        if (FileAlsa::isFileDevice(deviceName))
+        {
+            return std::make_unique<FileAlsa>(logger, std::move(waveFormat));
+        }
+        return std::make_unique<LinuxAlsa>(logger, std::move(waveFormat));
+    }
+
+    void applyLatencyProfile(configuration::ALSAAudioContext& alsaAudioContext, const configuration::LatencyProfile& profile)
+    {
+        alsaAudioContext.periodTime = profile.periodTimeUs;
+        alsaAudioContext.bufferTime = profile.periodTimeUs * profile.bufferPeriods;
+        alsaAudioContext.availMinPeriods = profile.availMinPeriods;
+        alsaAudioContext.startThresholdPeriods = profile.startThresholdPeriods;
+    }
+} // namespace usbAudio
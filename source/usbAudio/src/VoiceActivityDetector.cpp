@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include "usbAudio/VoiceActivityDetector.hpp"
+
+namespace
+{
+    constexpr double fullScale = 32768.0;
+    // digital silence would pull the floor to minus infinity
+    constexpr double minEnergyDb = -100.0;
+    // quieter than this is never speech, however low the floor is
+    constexpr double minSpeechDb = -55.0;
+    // unvoiced speech crosses zero at least this often
+    constexpr double fricativeCrossingsPerSecond = 3000.0;
+    // the floor follows noise quickly, and creeps up during speech so a louder
+    // background (a fan turned on) is not speech forever
+    constexpr double noiseFloorSmoothing = 0.05;
+    constexpr double noiseFloorRiseDbPerSecond = 1.0;
+    constexpr unsigned int millisecondsPerSecond = 1000;
+    constexpr double maxNoiseLevel = 127.0;
+} // namespace
+
+namespace usbAudio
+{
+    VoiceActivityDetector::VoiceActivityDetector(unsigned int sampleRate, unsigned int channels,
+        unsigned int thresholdDb, unsigned int hangoverMs)
+        : m_sampleRate{ std::max(sampleRate, 1u) }
+        , m_channels{ std::max(channels, 1u) }
+        , m_thresholdDb{ static_cast<double>(thresholdDb) }
+        , m_hangoverFrames{ static_cast<std::size_t>(sampleRate) * hangoverMs / millisecondsPerSecond }
+    {
+    }
+
+    bool VoiceActivityDetector::process(const std::int16_t* pcm, std::size_t frames)
+    {
+        if (nullptr == pcm or 0 == frames)
+        {
+            return 0 < m_hangoverRemaining;
+        }
+
+        // energy over all channels, zero crossings on the first
+        std::int64_t sumSquares = 0;
+        for (std::size_t i = 0; i < frames * m_channels; i++)
+        {
+            sumSquares += static_cast<std::int32_t>(pcm[i]) * pcm[i];
+        }
+        std::size_t crossings = 0;
+        for (std::size_t frame = 1; frame < frames; frame++)
+        {
+            crossings += (pcm[(frame - 1) * m_channels] < 0) != (pcm[frame * m_channels] < 0) ? 1 : 0;
+        }
+
+        const double meanSquare = static_cast<double>(sumSquares) / (frames * m_channels);
+        const double energyDb = std::max(10.0 * std::log10(meanSquare / (fullScale * fullScale) + 1e-12), minEnergyDb);
+        const double crossingsPerSecond = static_cast<double>(crossings) * m_sampleRate / frames;
+        if (not m_haveNoiseFloor)
+        {
+            m_haveNoiseFloor = true;
+            m_noiseFloorDb = energyDb;
+        }
+
+        const double overFloorDb = energyDb - m_noiseFloorDb;
+        const bool speech = energyDb > minSpeechDb and
+            (overFloorDb >= m_thresholdDb or
+            (overFloorDb >= m_thresholdDb / 2 and crossingsPerSecond >= fricativeCrossingsPerSecond));
+        updateNoiseFloor(speech ? m_noiseFloorDb : energyDb, frames);
+
+        if (speech)
+        {
+            m_hangoverRemaining = m_hangoverFrames;
+            return true;
+        }
+        if (0 < m_hangoverRemaining)
+        {
+            m_hangoverRemaining -= std::min(m_hangoverRemaining, frames);
+            return true;
+        }
+        return false;
+    }
+
+    void VoiceActivityDetector::reset()
+    {
+        m_hangoverRemaining = 0;
+    }
+
+    std::uint8_t VoiceActivityDetector::getNoiseLevel() const
+    {
+        return static_cast<std::uint8_t>(std::min(std::max(std::round(-m_noiseFloorDb), 0.0), maxNoiseLevel));
+    }
+
+    void VoiceActivityDetector::updateNoiseFloor(double energyDb, std::size_t frames)
+    {
+        if (energyDb < m_noiseFloorDb)
+        {
+            m_noiseFloorDb = energyDb;
+        }
+        else
+        {
+            m_noiseFloorDb += (energyDb - m_noiseFloorDb) * noiseFloorSmoothing;
+        }
+        m_noiseFloorDb += noiseFloorRiseDbPerSecond * frames / m_sampleRate;
+    }
+} // namespace usbAudio
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "usbAudio/WavFileWriter.hpp"
+
+namespace
+{
+    // largest single fwrite, smaller when the checkpoint interval is shorter
+    constexpr std::size_t maxWriteBlockBytes = 64 * 1024;
+    constexpr unsigned short BitsByte = 8;
+    constexpr unsigned int millisecondsPerSecond = 1000;
+
+    bool createFilePath(const std::string& fileName)
+    {
+        const char* start;
+        mode_t mode = S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
+        const char* path = fileName.c_str();
+
+        if (path[0] == '/')
+            start = strchr(path + 1, '/');
+        else
+            start = strchr(path, '/');
+
+        while (start)
+        {
+            std::string directory(path, start - path);
+            if (mkdir(directory.c_str(), mode) == -1 && errno != EEXIST)
+            {
+                LOG_ERROR_MSG("creating directory {} fail.", directory);
+                return false;
+            }
+            start = strchr(start + 1, '/');
+        }
+        return true;
+    }
+
+    // whole sample frames of the format
+    std::size_t alignToBlock(std::size_t bytes, std::size_t blockAlign)
+    {
+        return std::max(bytes / blockAlign, static_cast<std::size_t>(1)) * blockAlign;
+    }
+} // namespace
+
+namespace usbAudio
+{
+    WavFileWriter::WavFileWriter(Logger& logger, std::size_t bufferBytes, unsigned int checkpointMs, unsigned int rotateSeconds)
+        : m_logger{ logger }
+        , m_checkpointMs{ checkpointMs }
+        , m_rotateSeconds{ rotateSeconds }
+        , m_ring{ bufferBytes }
+        , m_thread{ std::thread([this]() { this->run(); }) }
+    {
+    }
+
+    WavFileWriter::~WavFileWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        closeFile();
+    }
+
+    void WavFileWriter::start(const configuration::wavePCMHeader& header, FileNameGenerator nextFileName)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pendingHeader = header;
+        m_pendingFileName = std::move(nextFileName);
+        m_request = Request::START;
+        m_cv.notify_one();
+        m_requestDone.wait(lock, [this]() { return Request::NONE == m_request; });
+    }
+
+    bool WavFileWriter::write(const std::uint8_t* data, std::size_t length)
+    {
+        const bool written = m_ring.write(data, length);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv.notify_one();
+        return written;
+    }
+
+    void WavFileWriter::stop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_request = Request::STOP;
+        m_cv.notify_one();
+        m_requestDone.wait(lock, [this]() { return Request::NONE == m_request; });
+    }
+
+    void WavFileWriter::run()
+    {
+        std::uint64_t droppedAtStart = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running)
+        {
+            // checkpoints follow the written bytes, nothing to do until a block is buffered
+            m_cv.wait(lock, [this]()
+            {
+                return not m_running or Request::NONE != m_request or
+                    (0 < m_blockBytes and m_ring.readable() >= m_blockBytes);
+            });
+            const Request request = m_request;
+            if (Request::START == request)
+            {
+                m_header = m_pendingHeader;
+                m_nextFileName = std::move(m_pendingFileName);
+            }
+            lock.unlock();
+
+            if (Request::START == request)
+            {
+                closeFile();
+                const std::size_t blockAlign = std::max<std::size_t>(m_header.block_align, 1);
+                const std::size_t bytesPerSecond = std::max<std::size_t>(m_header.avg_bytes_per_sec, blockAlign);
+                m_checkpointBytes = alignToBlock(bytesPerSecond * m_checkpointMs / millisecondsPerSecond, blockAlign);
+                m_blockBytes = alignToBlock(std::min({ maxWriteBlockBytes, m_checkpointBytes, m_ring.capacity() / 2 }), blockAlign);
+                m_rotateBytes = bytesPerSecond * m_rotateSeconds;
+                m_writtenBytes = 0;
+                m_files = 0;
+                m_slowestWriteMs = 0.0;
+                droppedAtStart = m_ring.droppedBytes();
+                openFile();
+            }
+            else if (Request::STOP == request)
+            {
+                drain(true);
+                closeFile();
+                LOG_INFO_MSG(m_logger, "Audio file writer wrote {} bytes to {} files, slowest write {:.1f} ms, buffer high watermark {} of {} bytes, dropped {} bytes.",
+                    m_writtenBytes, m_files, m_slowestWriteMs, m_ring.highWatermark(), m_ring.capacity(),
+                    m_ring.droppedBytes() - droppedAtStart);
+            }
+            else
+            {
+                drain(false);
+            }
+
+            lock.lock();
+            if (Request::NONE != request)
+            {
+                m_request = Request::NONE;
+                m_requestDone.notify_all();
+            }
+        }
+    }
+
+    void WavFileWriter::drain(bool all)
+    {
+        std::size_t readable = m_ring.readable();
+        while (0 < readable and 0 < m_blockBytes and (all or readable >= m_blockBytes))
+        {
+            std::size_t length = std::min(readable, m_blockBytes);
+            if (nullptr != m_fp and 0 < m_rotateBytes)
+            {
+                // split on the rotation point so every file is exactly one segment long
+                length = std::min(length, m_rotateBytes - static_cast<std::size_t>(m_header.data_chunk_size));
+            }
+            const std::uint8_t* data = m_ring.peek(length, m_scratch);
+            if (nullptr != m_fp)
+            {
+                const auto begin = std::chrono::steady_clock::now();
+                if (1 != fwrite(data, length, 1, m_fp))
+                {
+                    LOG_ERROR_MSG("Write audio file failed: {}, stop writing this file.", strerror(errno));
+                    closeFile();
+                }
+                else
+                {
+                    m_header.data_chunk_size += static_cast<int>(length);
+                    m_uncheckpointedBytes += length;
+                    m_writtenBytes += length;
+                }
+                m_slowestWriteMs = std::max(m_slowestWriteMs,
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+            }
+            m_ring.consume(length);
+
+            if (nullptr != m_fp and m_uncheckpointedBytes >= m_checkpointBytes)
+            {
+                writeHeader();
+            }
+            if (nullptr != m_fp and 0 < m_rotateBytes and static_cast<std::size_t>(m_header.data_chunk_size) >= m_rotateBytes)
+            {
+                closeFile();
+                openFile();
+            }
+            readable = m_ring.readable();
+        }
+    }
+
+    bool WavFileWriter::openFile()
+    {
+        const std::string fileName = m_nextFileName ? m_nextFileName() : "";
+        if (fileName.empty())
+        {
+            return false;
+        }
+        m_fp = fopen(fileName.c_str(), "wb");
+        if (nullptr == m_fp and ENOENT == errno and createFilePath(fileName))
+        {
+            m_fp = fopen(fileName.c_str(), "wb");
+        }
+        if (nullptr == m_fp)
+        {
+            LOG_ERROR_MSG("open audio file {} error: {}.", fileName, strerror(errno));
+            return false;
+        }
+
+        m_header.chunkClear();
+        writeHeader();
+        m_files++;
+        LOG_INFO_MSG(m_logger, "Write audio to file {}.", fileName);
+        return true;
+    }
+
+    void WavFileWriter::writeHeader()
+    {
+        m_header.dwSampleLength = m_header.data_chunk_size / std::max(m_header.bits_per_sample / BitsByte, 1);
+        m_header.chunk_size = m_header.data_chunk_size + static_cast<int>(sizeof(m_header) - 8);
+        /* the sizes are patched in place, then the data continues at the end */
+        fseek(m_fp, 0, SEEK_SET);
+        fwrite(&m_header, sizeof(m_header), 1, m_fp);
+        fseek(m_fp, 0, SEEK_END);
+        // the header only helps after a crash if it reached the card
+        fflush(m_fp);
+        fdatasync(fileno(m_fp));
+        m_uncheckpointedBytes = 0;
+    }
+
+    void WavFileWriter::closeFile()
+    {
+        if (nullptr == m_fp)
+        {
+            return;
+        }
+        writeHeader();
+        fclose(m_fp);
+        LOG_DEBUG_MSG("........................Wirte {} pure data to wav file.....................", m_header.data_chunk_size);
+        m_fp = nullptr;
+    }
+} // namespace usbAudio
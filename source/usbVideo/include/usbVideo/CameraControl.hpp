@@ -33,6 +33,7 @@ namespace usbVideo
 
         bool getRGBBuffer(std::vector<uint8_t>& rgbBuffer, const struct v4l2_buffer& v4l2Buffer,
             const int& reqWidth, const int& reqHeight);
+        const uint8_t* getImageBuffer(const struct v4l2_buffer& v4l2Buffer, uint32_t& length) override;
 
     private:
         bool queryMapBuffer(const struct v4l2_buffer& buffer);
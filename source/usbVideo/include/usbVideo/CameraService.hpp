@@ -1,5 +1,6 @@
 #pragma once
 #include <linux/videodev2.h>
+#include <chrono>
 #include <thread>
 #include "Configurations/Configurations.hpp"
 #include "Configurations/ParseConfigFile.hpp"
@@ -17,6 +18,7 @@ namespace usbVideo
     using v4l2Requestbuffers = struct v4l2_requestbuffers;
     using v4l2Streamparm = struct v4l2_streamparm;
     class ICameraControl;
+    class SnapshotService;
 
     class CameraService final
     {
@@ -26,6 +28,10 @@ namespace usbVideo
         bool initDevice(configuration::bestFrameSize& frameSize);
         void runDevice();
         static void stopRun();
+        // still picture of the next streamed frame, written by the snapshot worker
+        bool requestSnapshot();
+        // burstCount consecutive frames, stored like snapshots
+        bool requestBurst();
 
     private:
         void outputDeviceInfo();
@@ -38,8 +44,10 @@ namespace usbVideo
 
     private:
         Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
         std::unique_ptr<ICameraControl> m_cameraControl;
         std::unique_ptr<usbAudio::IAudioRecordService> m_audioService;
+        std::unique_ptr<SnapshotService> m_snapshotService;
         v4l2Capability m_v4l2Capability;
         v4l2Format m_v4l2Format;
         v4l2Streamparm m_v4l2Streamparm;
@@ -47,6 +55,9 @@ namespace usbVideo
         std::thread m_captureThread;
 
         bool m_enableCameraStream{true};
+        // timelapse: only one frame per interval goes to the video pipe
+        bool m_timelapse{false};
+        std::chrono::seconds m_timelapseInterval{10};
         bool m_bSharedMem{false};
         std::string m_pipeName{"videoPipe"};
         std::string m_outputDir{"/tmp/videoCapture/"};
@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include "IDecodeCameraStream.hpp"
+#include "logger/Logger.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+namespace usbVideo
+{
+    class DecodeCameraStream final : public IDecodeCameraStream
+    {
+    public:
+        DecodeCameraStream(Logger& logger, const configuration::AppConfiguration& config);
+        ~DecodeCameraStream();
+
+        bool registerAllHandler() override;
+        bool openInputFile(const std::string& fileName) override;
+        bool findStreamInfo() override;
+        bool avDumpFormat() override;
+        bool avCodecFindDecoder() override;
+        bool avCodecOpen() override;
+
+        bool seekToKeyFrame(std::int64_t positionMs) override;
+        void setKeyFramesOnly(bool keyFramesOnly) override;
+        PooledFrame decodeNextFrame() override;
+        bool isEndOfStream() const override { return m_endOfStream; }
+        std::int64_t getFramePositionMs(const AVFrame& frame) const override;
+        DecodeStatistics getStatistics() const override;
+        void closeInputFile() override;
+
+        // open, probe and prepare the decoder in one go
+        bool openDecoder(const std::string& fileName);
+        const AVCodecContext* getCodecContext() const { return m_codecContext; }
+        std::int64_t getDurationMs() const;
+
+    private:
+        bool readPacketToDecoder();
+
+    private:
+        Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
+        std::string m_inputFile;
+
+        AVFormatContext* m_formatContext{ nullptr };
+        AVCodecContext*  m_codecContext{ nullptr };
+        AVCodec*         m_codec{ nullptr };
+        AVPacket*        m_packet{ nullptr };
+        int              m_videoStreamIndex{ -1 };
+        bool             m_keyFramesOnly{ false };
+        bool             m_draining{ false };
+        bool             m_endOfStream{ false };
+
+        FramePool        m_framePool;
+        DecodeStatistics m_statistics;
+    };
+} // namespace usbVideo
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include "IEncodeCameraStream.hpp"
 #include "logger/Logger.hpp"
 #include "Configurations/ParseConfigFile.hpp"
@@ -18,6 +19,8 @@ extern "C"
 
 namespace usbVideo
 {
+    class ThumbnailGenerator;
+
     class EncodeCameraStream final : public IEncodeCameraStream
     {
     public:
@@ -58,7 +61,6 @@ namespace usbVideo
         // Format I/O context.
         AVCodecContext*  m_codecContext{ nullptr };
         AVCodecContext*  m_codecAudioContext{ nullptr };
-        AVDictionary*    m_dictionary{nullptr};
         AVFormatContext* m_formatContext{ nullptr };
         AVStream*        m_stream{ nullptr };
 
@@ -83,6 +85,10 @@ namespace usbVideo
         std::vector<uint8_t> m_numArray;
         std::vector<std::uint8_t> audioBuffer;
         const CloseVideoNotify& closeVideoNotify;
+
+        std::string m_outputFile;
+        std::int64_t m_encodedFrames{ 0 };
+        std::unique_ptr<ThumbnailGenerator> m_thumbnailGenerator;
     };
 
 } // namespace Video
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace usbVideo
+{
+    class FramePool;
+
+    // Gives the frame back to its pool instead of freeing it.
+    struct FrameRecycler
+    {
+        FramePool* pool{ nullptr };
+        void operator()(AVFrame* frame) const;
+    };
+
+    using PooledFrame = std::unique_ptr<AVFrame, FrameRecycler>;
+
+    /*
+     * Keeps AVFrame shells alive across decode calls. A frame handed out by acquire()
+     * only references the decoder's refcounted buffers, so nothing is copied; releasing
+     * it drops those references and parks the shell for the next acquire().
+     * The pool must outlive every frame it handed out.
+     */
+    class FramePool final
+    {
+    public:
+        explicit FramePool(std::size_t capacity);
+        ~FramePool();
+
+        // never empty while memory lasts, an empty pool grows by one frame
+        PooledFrame acquire();
+        void release(AVFrame* frame);
+        // frames allocated beyond the capacity because consumers held all of them
+        std::uint64_t grownFrames() const { return m_grownFrames.load(std::memory_order_relaxed); }
+
+    private:
+        std::mutex m_poolMutex;
+        std::vector<AVFrame*> m_freeFrames;
+        std::atomic<std::uint64_t> m_grownFrames{ 0 };
+    };
+} // namespace usbVideo
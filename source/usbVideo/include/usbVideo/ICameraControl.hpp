@@ -3,7 +3,11 @@
 * use V4L2 framework get USB camera with YUYV
 */
 #include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
 #include <linux/videodev2.h>
+#include "logger/LoggerFwd.hpp"
 
 namespace configuration
 {
@@ -57,5 +61,13 @@ namespace usbVideo
 
         virtual bool getRGBBuffer(std::vector<uint8_t>& rgbBuffer, const struct v4l2_buffer& v4l2Buffer,
             const int& reqWidth, const int& reqHeight) = 0;
+        // mapped data of a dequeued buffer, valid until the buffer is queued again
+        virtual const uint8_t* getImageBuffer(const struct v4l2_buffer& v4l2Buffer, uint32_t& length) = 0;
     };
+
+    /*
+     * The camera for cameraDev: "synthetic:" and "file:" devices run on VirtualCameraControl
+     * without hardware, any other name is a V4L2 device.
+     */
+    std::unique_ptr<ICameraControl> createCameraControl(Logger& logger, const std::string& cameraDev);
 }
\ No newline at end of file
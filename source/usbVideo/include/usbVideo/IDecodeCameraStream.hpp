@@ -2,10 +2,28 @@
 /*
 * use ffmpeg framework get camera stream files
 */
+#include <string>
+#include <cstdint>
+#include "FramePool.hpp"
+
+extern "C"
+{
 #include <libavformat/avformat.h>
+}
 
 namespace usbVideo
 {
+    struct DecodeStatistics
+    {
+        std::uint64_t decodedFrames{ 0 };
+        std::uint64_t demuxedBytes{ 0 };
+        // wall time spent inside decodeNextFrame()
+        double decodeSeconds{ 0.0 };
+        double decodedFPS{ 0.0 };
+        // frames the pool had to allocate past its size, consumers kept too many
+        std::uint64_t poolGrownFrames{ 0 };
+    };
+
     class IDecodeCameraStream
     {
     public:
@@ -14,9 +32,9 @@ namespace usbVideo
         virtual bool registerAllHandler() = 0;
         // Open a file and parse it.Contents that can be parsed include: 
         // video stream, audio stream, video stream parameters, audio stream parameters, video frame index.
-        virtual bool openInputFile(AVFormatContext&, std::string& fileName) = 0;
+        virtual bool openInputFile(const std::string& fileName) = 0;
         // Find formats and indexes.
-        virtual bool findStreamInfo(AVFormatContext&) = 0;
+        virtual bool findStreamInfo() = 0;
         /*
          * Print detailed information about the input or output format, such as
          * duration, bitrate, streams, container, programs, metadata, side data,
@@ -33,7 +51,19 @@ namespace usbVideo
          */
         virtual bool avDumpFormat() = 0;
         // get decoder
-        virtual bool avCodecFindDecoder(enum AVCodecID&) = 0;
-        virtual bool avCodecOpen(AVCodecContext&, AVCodec&) = 0;
+        virtual bool avCodecFindDecoder() = 0;
+        virtual bool avCodecOpen() = 0;
+        // seek to the nearest keyframe at or before positionMs, decoder is flushed
+        virtual bool seekToKeyFrame(std::int64_t positionMs) = 0;
+        // only hand out keyframes, non-key packets are dropped before the decoder
+        virtual void setKeyFramesOnly(bool keyFramesOnly) = 0;
+        // next decoded frame, empty at end of stream or on error
+        virtual PooledFrame decodeNextFrame() = 0;
+        // after an empty decodeNextFrame(): true when the input ended, false when demuxing or decoding failed
+        virtual bool isEndOfStream() const = 0;
+        // presentation time of a decoded frame in milliseconds
+        virtual std::int64_t getFramePositionMs(const AVFrame& frame) const = 0;
+        virtual DecodeStatistics getStatistics() const = 0;
+        virtual void closeInputFile() = 0;
     };
-} // namespace usbVideo
\ No newline at end of file
+} // namespace usbVideo
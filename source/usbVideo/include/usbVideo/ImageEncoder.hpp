@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+namespace usbVideo
+{
+    /*
+     * Still image encoder for thumbnails and snapshots. The codec context is kept
+     * open between images and only reopened when the picture size or format changes.
+     * Not thread safe, use one instance per thread.
+     */
+    class ImageEncoder final
+    {
+    public:
+        // qscale 2 (best) .. 31 (worst)
+        explicit ImageEncoder(int quality = 5);
+        ~ImageEncoder();
+
+        // frame in a full range YUV format, e.g. AV_PIX_FMT_YUVJ420P
+        bool encodeJpeg(const AVFrame& frame, std::vector<std::uint8_t>& image);
+        // frame in AV_PIX_FMT_RGB24, lossless
+        bool encodePng(const AVFrame& frame, std::vector<std::uint8_t>& image);
+
+        static bool writeImageFile(const std::string& fileName, const std::vector<std::uint8_t>& image);
+
+    private:
+        bool openEncoder(AVCodecID codecId, int width, int height, AVPixelFormat format);
+        bool encodeImage(AVCodecID codecId, const AVFrame& frame, std::vector<std::uint8_t>& image);
+        void closeEncoder();
+
+    private:
+        int m_quality;
+        AVCodecContext* m_codecContext{ nullptr };
+        AVPacket*       m_packet{ nullptr };
+    };
+} // namespace usbVideo
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "ImageEncoder.hpp"
+#include "Configurations/Configurations.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+#include "logger/Logger.hpp"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+namespace usbVideo
+{
+    /*
+     * Still pictures taken from the live YUYV capture. A request is served by the next
+     * captured frame: the capture thread only copies the mapped buffer into one of the
+     * preallocated slots, colour conversion, JPEG/PNG encoding and the file write run on
+     * the snapshot worker. When every slot is busy the request waits for a later frame
+     * instead of stalling the capture loop.
+     * A burst queues burstCount requests at once, there are enough slots for all of them
+     * so they are served by consecutive frames.
+     */
+    class SnapshotService final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        SnapshotService(Logger& logger, const configuration::AppConfiguration& config, int width, int height);
+        ~SnapshotService();
+
+        // any thread: take a picture of the next captured frame
+        void requestSnapshot();
+        // any thread: take burstCount consecutive frames
+        void requestBurst();
+        // capture thread: cheap check before touching the frame
+        bool hasPendingRequest() const { return 0 < m_pendingRequests.load(); }
+        // capture thread: copy the frame for the oldest pending request, never waits for the worker
+        void onCaptureFrame(const uint8_t* yuyv, uint32_t length);
+
+    private:
+        struct SnapshotRequest
+        {
+            Clock::time_point triggerTime;
+            // frames left in the burst after this one, 0 for a single snapshot
+            int burstRemaining{ 0 };
+            bool burst{ false };
+        };
+
+        struct SnapshotJob
+        {
+            std::size_t slot{ 0 };
+            SnapshotRequest request;
+            Clock::time_point captureTime;
+        };
+
+        void snapshotWorker();
+        bool encodeSnapshot(const SnapshotJob& job, std::vector<std::uint8_t>& image);
+        std::string makeFileName(const SnapshotRequest& request);
+
+    private:
+        Logger& m_logger;
+        std::string m_outputDir;
+        configuration::captureFormat m_format;
+        int m_width;
+        int m_height;
+        int m_burstCount;
+
+        std::atomic_int m_pendingRequests{ 0 };
+        std::mutex m_requestMutex;
+        std::deque<SnapshotRequest> m_requests;
+
+        // YUYV frame copies, sized once for the capture format
+        std::vector<std::vector<std::uint8_t>> m_slots;
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobCondition;
+        std::vector<std::size_t> m_freeSlots;
+        std::queue<SnapshotJob> m_jobs;
+        bool m_stopWorker{ false };
+        std::thread m_workerThread;
+
+        // worker thread only
+        SwsContext* m_swsContext{ nullptr };
+        AVFrame* m_frame{ nullptr };
+        ImageEncoder m_imageEncoder;
+        unsigned int m_sequence{ 0 };
+    };
+} // namespace usbVideo
@@ -0,0 +1,94 @@
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "ImageEncoder.hpp"
+#include "Configurations/ParseConfigFile.hpp"
+#include "logger/Logger.hpp"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+namespace usbVideo
+{
+    /*
+     * Builds a visual index per recorded segment: one JPEG thumbnail every thumbnailInterval
+     * seconds, a contact sheet of all of them and a JSON file describing the sheet.
+     * Frames come either from the live encoder (its forced IDR frames) or from decoding only
+     * the keyframes of a recorded segment. Scaling happens on the caller thread through one
+     * shared SwsContext, JPEG encoding and file writing on the generator's worker thread.
+     */
+    class ThumbnailGenerator final
+    {
+    public:
+        ThumbnailGenerator(Logger& logger, const configuration::AppConfiguration& config);
+        ~ThumbnailGenerator();
+
+        int getIntervalMs() const { return m_intervalMs; }
+        // live: keyframe of segmentFile at positionMs, ignored until the interval passed
+        void onKeyFrame(const std::string& segmentFile, const AVFrame& frame, std::int64_t positionMs);
+        // write the contact sheet and the index for segmentFile
+        void finishSegment(const std::string& segmentFile);
+        // offline: decode the keyframes of a recorded segment and finish it
+        bool generateFromSegment(const std::string& segmentFile);
+
+    private:
+        struct ThumbnailJob
+        {
+            std::string segmentFile;
+            AVFrame* frame{ nullptr };
+            std::int64_t positionMs{ 0 };
+            // time the caller spent scaling the frame
+            double scaleSeconds{ 0.0 };
+            bool finishSegment{ false };
+        };
+
+        struct Thumbnail
+        {
+            std::string fileName;
+            std::int64_t positionMs{ 0 };
+            AVFrame* frame{ nullptr };
+        };
+
+        struct SegmentThumbnails
+        {
+            std::vector<Thumbnail> thumbnails;
+            double costSeconds{ 0.0 };
+        };
+
+        bool queueThumbnail(const std::string& segmentFile, const AVFrame& frame, std::int64_t positionMs);
+        AVFrame* scaleThumbnail(const AVFrame& frame);
+        void pushJob(ThumbnailJob&& job);
+        void thumbnailWorker();
+        void storeThumbnail(ThumbnailJob& job);
+        void writeContactSheet(const std::string& segmentFile, SegmentThumbnails& segment);
+        std::string getSegmentBaseName(const std::string& segmentFile) const;
+
+    private:
+        Logger& m_logger;
+        const configuration::AppConfiguration& m_config;
+        std::string m_outputDir;
+        int m_intervalMs;
+        int m_thumbnailWidth;
+
+        std::mutex m_scaleMutex;
+        SwsContext* m_swsContext{ nullptr };
+        // position of the last queued thumbnail per segment, guarded by m_scaleMutex
+        std::map<std::string, std::int64_t> m_lastQueuedMs;
+
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobCondition;
+        std::queue<ThumbnailJob> m_jobs;
+        bool m_stopWorker{ false };
+        std::thread m_workerThread;
+
+        // worker thread only
+        ImageEncoder m_imageEncoder;
+        std::map<std::string, SegmentThumbnails> m_segments;
+    };
+} // namespace usbVideo
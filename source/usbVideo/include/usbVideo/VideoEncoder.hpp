@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+namespace usbVideo
+{
+    struct VideoEncoderParameters
+    {
+        int width{ 0 };
+        int height{ 0 };
+        int fps{ 25 };
+        std::int64_t bitRate{ 400000 };
+        int threadCount{ 8 };
+        // empty keeps the libx264 default
+        std::string preset;
+        std::string tune;
+    };
+
+    // H264 encoder context as used for the live recordings, opened and ready to take YUV420P frames.
+    // Returns nullptr on failure, free the result with avcodec_free_context().
+    AVCodecContext* createH264Encoder(const VideoEncoderParameters& parameters);
+} // namespace usbVideo
@@ -0,0 +1,106 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include "ICameraControl.hpp"
+#include "Configurations/Configurations.hpp"
+#include "logger/Logger.hpp"
+
+namespace usbVideo
+{
+    /*
+     * ICameraControl without /dev/video, for pipeline load tests on any Linux box.
+     * The camera device selects the source:
+     *   synthetic:WIDTHxHEIGHT[,fps=N][,fast]
+     *       scrolling color bars, the frame sequence and capture time in milliseconds are
+     *       drawn as two rows of binary blocks in the top left corner
+     *   file:PATH,WIDTHxHEIGHT[,yuyv|nv12][,fps=N][,fast]
+     *       raw frames, played in a loop, NV12 is converted to YUYV on read
+     * Frames are always delivered as YUYV in request/queue/dequeue buffers like the mmap
+     * buffers of a driver. dequeueBuffer() blocks until the next frame is due at fps,
+     * "fast" delivers frames as fast as they are taken. A frame that comes due while no
+     * buffer is queued is dropped and leaves a gap in the sequence, as on a real camera.
+     */
+    class VirtualCameraControl final : public ICameraControl
+    {
+    public:
+        VirtualCameraControl(Logger& logger, const std::string& cameraDev);
+        ~VirtualCameraControl();
+
+        static bool isVirtualDevice(const std::string& cameraDev);
+
+        int openDevice() override;
+        bool closeDevice() override;
+        bool getCameraCapability(struct v4l2_capability& capability) override;
+        bool getCameraFrameFormat(struct v4l2_format& format) override;
+        bool getBestCameraFrameFormat(configuration::bestFrameSize& frameSize) override;
+
+        bool getCaptureParm(struct v4l2_streamparm& streamParm) override;
+        bool setCaptureParm(struct v4l2_streamparm& streamParm) override;
+
+        int requestMmapBuffers(const struct v4l2_requestbuffers& requestBuffers) override;
+        bool startCameraStreaming(const struct v4l2_requestbuffers& requestBuffers) override;
+
+        bool queueBuffer(const struct v4l2_buffer& v4l2Buffer) override;
+        bool dequeueBuffer(struct v4l2_buffer& v4l2Buffer) override;
+        bool queryBuffer(const struct v4l2_buffer& v4l2Buffer) override;
+
+        bool stopCameraStreaming(const int& videoType) override;
+        bool unMapBuffers() override;
+
+        bool getRGBBuffer(std::vector<uint8_t>& rgbBuffer, const struct v4l2_buffer& v4l2Buffer,
+            const int& reqWidth, const int& reqHeight) override;
+        const uint8_t* getImageBuffer(const struct v4l2_buffer& v4l2Buffer, uint32_t& length) override;
+
+    private:
+        enum class Source
+        {
+            SYNTHETIC,
+            FILE_YUYV,
+            FILE_NV12,
+        };
+
+        bool parseDeviceName();
+        bool tryCameraFrameFormat(struct v4l2_format& format) override;
+        bool setCameraPixFormat(uint32_t width, uint32_t height) override;
+        bool setCameraFrameFormat(struct v4l2_format& format) override;
+
+        void fillFormat(struct v4l2_format& format) const;
+        std::uint32_t getFrameBytes() const;
+        bool renderFrame(std::uint8_t* frame, std::uint32_t sequence, std::uint32_t timeMs);
+        bool readFileFrame(std::uint8_t* frame);
+        void renderSynthetic(std::uint8_t* frame, std::uint32_t sequence, std::uint32_t timeMs) const;
+
+    private:
+        Logger& m_logger;
+        std::string m_cameraDev;
+        Source m_source{ Source::SYNTHETIC };
+        std::string m_path;
+        std::uint32_t m_width{ 1280 };
+        std::uint32_t m_height{ 720 };
+        std::uint32_t m_fps{ 30 };
+        bool m_fast{ false };
+        bool m_opened{ false };
+
+        FILE* m_file{ nullptr };
+        std::vector<std::uint8_t> m_fileFrame;
+        // twice the frame width of color bars, every frame starts a little further in
+        std::vector<std::uint8_t> m_barsRow;
+
+        std::vector<std::vector<std::uint8_t>> m_buffers;
+        std::vector<configuration::imageBuffer> m_imageBuffers;
+        std::vector<bool> m_queued;
+        std::deque<std::uint32_t> m_queue;
+        bool m_streaming{ false };
+
+        std::chrono::steady_clock::duration m_frameInterval{};
+        std::chrono::steady_clock::time_point m_nextFrame{};
+        std::chrono::steady_clock::time_point m_startTime{};
+        std::uint32_t m_sequence{ 0 };
+        // statistics of the current stream, logged on stop
+        std::uint64_t m_deliveredFrames{ 0 };
+        std::uint64_t m_droppedFrames{ 0 };
+        std::uint64_t m_sourceLoops{ 0 };
+    };
+} // namespace usbVideo
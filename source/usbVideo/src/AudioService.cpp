@@ -1,5 +1,5 @@
 #include "common/CommonFunction.hpp"
-#include "usbAudio/LinuxAlsa.hpp"
+#include "usbAudio/ISysAlsa.hpp"
 #include "usbVideo/AudioService.hpp"
 
 namespace
@@ -9,7 +9,7 @@ namespace
     constexpr int bitsByte = 8;
     constexpr int sampleBit = 16;
     constexpr int MAX_WRITE_DATA = 2048;
-    constexpr int waitForTimeout = 2;
+    constexpr int waitForTimeout = 100; // ms
 } // namespace
 namespace usbVideo
 {
@@ -38,7 +38,7 @@ namespace usbVideo
             static_cast<unsigned short>(audioChannel* sampleBit / bitsByte),
             sampleBit,
             0 };
-        m_sysRec = std::make_unique<usbAudio::LinuxAlsa>(m_logger, std::make_unique<configuration::WAVEFORMATEX>(wavfmt));
+        m_sysRec = usbAudio::createSysAlsa(m_logger, std::make_unique<configuration::WAVEFORMATEX>(wavfmt), video::getDefaultAudioRecord(m_config));
 
         m_speechRec.speechState = configuration::SpeechState::SPEECH_STATE_INIT;
         m_speechRec.audioSource = configuration::SpeechAudioSource::SPEECH_MIC;
@@ -217,16 +217,9 @@ namespace usbVideo
         {
             return;
         }
-        while (!m_sysRec->isALSAAudioStopped(recorder))
+        for (unsigned int waited = 0; !m_sysRec->isALSAAudioStopped(recorder) and waited < timeout_ms; waited++)
         {
-            sleep(1);
-            if (timeout_ms != (unsigned int)-1)
-            {
-                if (0 == timeout_ms--)
-                {
-                    break;
-                }
-            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 
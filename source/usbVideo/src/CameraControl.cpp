@@ -419,6 +419,18 @@ namespace usbVideo
         return false;
     }
 
+    const uint8_t* CameraControl::getImageBuffer(const struct v4l2_buffer& v4l2Buffer, uint32_t& length)
+    {
+        if (v4l2Buffer.index >= m_imageBuffers.size())
+        {
+            length = 0;
+            return nullptr;
+        }
+        const configuration::imageBuffer& imageBuffer = m_imageBuffers[v4l2Buffer.index];
+        length = (0 < v4l2Buffer.bytesused) ? v4l2Buffer.bytesused : imageBuffer.bufferLength;
+        return static_cast<const uint8_t*>(imageBuffer.startBuffer);
+    }
+
     bool CameraControl::queryBuffer(const struct v4l2_buffer& v4l2Buffer)
     {
         if (ioctl(m_cameraFd, VIDIOC_QUERYBUF, &v4l2Buffer) < 0)
@@ -0,0 +1,14 @@
+#include "usbVideo/CameraControl.hpp"
+#include "usbVideo/VirtualCameraControl.hpp"
+
+namespace usbVideo
+{
+    std::unique_ptr<ICameraControl> createCameraControl(Logger& logger, const std::string& cameraDev)
+    {
+        if (VirtualCameraControl::isVirtualDevice(cameraDev))
+        {
+            return std::make_unique<VirtualCameraControl>(logger, cameraDev);
+        }
+        return std::make_unique<CameraControl>(logger, cameraDev);
+    }
+} // namespace usbVideo
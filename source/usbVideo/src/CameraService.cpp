@@ -1,17 +1,42 @@
+#include <algorithm>
 #include <atomic>
 #include <sys/types.h>
 #include <memory>
 #include <sstream>
 #include "common/CommonFunction.hpp"
 #include "usbVideo/CameraService.hpp"
-#include "usbVideo/CameraControl.hpp"
+#include "usbVideo/ICameraControl.hpp"
 #include "usbVideo/CameraImage.hpp"
 #include "usbVideo/AudioService.hpp"
+#include "usbVideo/SnapshotService.hpp"
 
 namespace
 {
     constexpr int RGBCountSize = 3;
 
+    // time spent per stage of the stream loop, to find the stage that limits the frame rate
+    struct StageTimes
+    {
+        std::chrono::steady_clock::duration dequeue{};
+        std::chrono::steady_clock::duration convert{};
+        std::chrono::steady_clock::duration write{};
+        std::uint64_t frames{ 0 };
+
+        // time since start, start moves on to now
+        std::chrono::steady_clock::duration lap(std::chrono::steady_clock::time_point& start) const
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const auto elapsed = now - start;
+            start = now;
+            return elapsed;
+        }
+
+        double average(std::chrono::steady_clock::duration total) const
+        {
+            return 0 == frames ? 0.0 : std::chrono::duration<double, std::milli>(total).count() / frames;
+        }
+    };
+
     configuration::captureFormat covertV4L2CaptureFormat(const std::string& format)
     {
         if ("BMP" == format)
@@ -29,15 +54,23 @@ namespace usbVideo
 
     CameraService::CameraService(Logger& logger, const configuration::AppConfiguration& config)
         : m_logger{ logger }
+        , m_config{ config }
         , m_enableCameraStream{ video::getEnableCameraStream(config) }
         , m_pipeName{ video::getPipeFileName(config) }
         , m_outputDir{ common::getCaptureOutputDir(config) }
         , m_V4l2RequestBuffersCounter{ video::getV4l2RequestBuffersCounter(config) }
-        , m_cameraControl(std::make_unique<CameraControl>(logger, video::getDefaultCameraDevice(config)))
+        , m_cameraControl(createCameraControl(logger, video::getDefaultCameraDevice(config)))
         //, m_audioService(std::make_unique<AudioService>(logger, config))
     {
         std::string format = video::getV4L2CaptureFormat(config);
         m_captureFormat = covertV4L2CaptureFormat(format);
+
+        if ("timelapse" == video::getCaptureMode(config))
+        {
+            m_timelapse = true;
+            m_timelapseInterval = std::chrono::seconds{ std::max(video::getTimelapseInterval(config), 1) };
+            LOG_INFO_MSG(m_logger, "Timelapse capture, one frame every {} seconds.", m_timelapseInterval.count());
+        }
     }
 
     CameraService::~CameraService()
@@ -82,6 +115,11 @@ namespace usbVideo
                 frameSize.frameHeight = m_v4l2Format.fmt.pix.height;
                 frameSize.bBestFrame = true;
             }
+            if (m_enableCameraStream and V4L2_PIX_FMT_YUYV == checkPixelFormat())
+            {
+                m_snapshotService = std::make_unique<SnapshotService>(m_logger, m_config,
+                    m_v4l2Format.fmt.pix.width, m_v4l2Format.fmt.pix.height);
+            }
             return true;
         }
 
@@ -288,18 +326,49 @@ namespace usbVideo
             m_cameraControl->queueBuffer(v4l2Buffer);
         }
 
+        auto nextTimelapseFrame = std::chrono::steady_clock::now();
+        std::uint64_t keptFrames = 0;
+        std::uint64_t skippedFrames = 0;
+        StageTimes stageTimes;
+        const auto streamStart = std::chrono::steady_clock::now();
         while (keep_running)
         {
             /* get the idx of ready buffer */
             for (int iCount = 0; iCount < m_V4l2RequestBuffersCounter; ++iCount)
             {
+                auto stageStart = std::chrono::steady_clock::now();
                 if (not m_cameraControl->dequeueBuffer(v4l2Buffer))
                 {
                     m_cameraControl->queueBuffer(v4l2Buffer);
                     continue;
                 }
+                stageTimes.dequeue += stageTimes.lap(stageStart);
                 //LOG_DEBUG_MSG("Request dequeue buffer {} ready.", v4l2Buffer.index);
+                if (m_snapshotService and m_snapshotService->hasPendingRequest())
+                {
+                    uint32_t imageLength = 0;
+                    const uint8_t* imageBuffer = m_cameraControl->getImageBuffer(v4l2Buffer, imageLength);
+                    m_snapshotService->onCaptureFrame(imageBuffer, imageLength);
+                }
+                if (m_timelapse)
+                {
+                    // give the frame straight back, no conversion and no pipe write
+                    auto now = std::chrono::steady_clock::now();
+                    if (now < nextTimelapseFrame)
+                    {
+                        ++skippedFrames;
+                        m_cameraControl->queueBuffer(v4l2Buffer);
+                        continue;
+                    }
+                    nextTimelapseFrame += m_timelapseInterval;
+                    if (nextTimelapseFrame < now)
+                    {
+                        nextTimelapseFrame = now + m_timelapseInterval;
+                    }
+                    ++keptFrames;
+                }
 
+                stageStart = std::chrono::steady_clock::now();
                 switch (checkPixelFormat())
                 {
                 case V4L2_PIX_FMT_YUYV:
@@ -310,6 +379,7 @@ namespace usbVideo
                     LOG_ERROR_MSG("Unsupported pixelformat!");
                     return;
                 }
+                stageTimes.convert += stageTimes.lap(stageStart);
 
                 /* write data */
                 int64_t dataSize = rgbBuffer.size();
@@ -344,10 +414,21 @@ namespace usbVideo
                     //fflush(m_fd);
                 }
                // LOG_DEBUG_MSG("Success write the data {} to video pipe.", dataIndex);
+                stageTimes.write += stageTimes.lap(stageStart);
+                stageTimes.frames++;
 
                 m_cameraControl->queueBuffer(v4l2Buffer);
             }
         }
+
+        if (m_timelapse)
+        {
+            LOG_INFO_MSG(m_logger, "Timelapse wrote {} frames, skipped {}.", keptFrames, skippedFrames);
+        }
+        const double streamSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - streamStart).count();
+        LOG_INFO_MSG(m_logger, "Camera stream wrote {} frames in {:.1f} s ({:.1f} fps), per frame: dequeue {:.2f} ms, convert {:.2f} ms, pipe write {:.2f} ms.",
+            stageTimes.frames, streamSeconds, 0.0 < streamSeconds ? stageTimes.frames / streamSeconds : 0.0,
+            stageTimes.average(stageTimes.dequeue), stageTimes.average(stageTimes.convert), stageTimes.average(stageTimes.write));
     }
 
     void CameraService::exitCameraService()
@@ -372,6 +453,28 @@ namespace usbVideo
         LOG_DEBUG_MSG("Exit camera service success.");
     }
 
+    bool CameraService::requestSnapshot()
+    {
+        if (not m_snapshotService)
+        {
+            LOG_WARNING_MSG("Snapshot needs a YUYV camera stream.");
+            return false;
+        }
+        m_snapshotService->requestSnapshot();
+        return true;
+    }
+
+    bool CameraService::requestBurst()
+    {
+        if (not m_snapshotService)
+        {
+            LOG_WARNING_MSG("Burst needs a YUYV camera stream.");
+            return false;
+        }
+        m_snapshotService->requestBurst();
+        return true;
+    }
+
     void CameraService::stopRun()
     {
         keep_running = false;
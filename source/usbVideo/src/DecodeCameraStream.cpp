@@ -0,0 +1,320 @@
+#include "usbVideo/DecodeCameraStream.hpp"
+#include "Configurations/Configurations.hpp"
+#include "common/CommonFunction.hpp"
+
+namespace
+{
+    // frames in flight: decoder threads plus what the consumer holds
+    constexpr std::size_t framePoolSize = 16;
+    constexpr AVRational millisecondTimeBase = { 1, 1000 };
+
+    using Clock = std::chrono::steady_clock;
+}// namespace
+
+namespace usbVideo
+{
+    DecodeCameraStream::DecodeCameraStream(Logger& logger, const configuration::AppConfiguration& config)
+        : m_logger{logger}
+        , m_config{config}
+        , m_framePool{framePoolSize}
+    {
+    }
+
+    DecodeCameraStream::~DecodeCameraStream()
+    {
+        closeInputFile();
+    }
+
+    bool DecodeCameraStream::registerAllHandler()
+    {
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+        av_register_all();
+#endif
+        return true;
+    }
+
+    bool DecodeCameraStream::openDecoder(const std::string& fileName)
+    {
+        if (not registerAllHandler() or not openInputFile(fileName) or not findStreamInfo())
+        {
+            closeInputFile();
+            return false;
+        }
+        if (not avCodecFindDecoder() or not avCodecOpen())
+        {
+            closeInputFile();
+            return false;
+        }
+        return true;
+    }
+
+    bool DecodeCameraStream::openInputFile(const std::string& fileName)
+    {
+        closeInputFile();
+
+        int ret = avformat_open_input(&m_formatContext, fileName.c_str(), NULL, NULL);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Open input file {} failed {}.", fileName, ret);
+            m_formatContext = nullptr;
+            return false;
+        }
+        m_packet = av_packet_alloc();
+        if (nullptr == m_packet)
+        {
+            LOG_ERROR_MSG("Alloc decode packet failed.");
+            return false;
+        }
+        m_inputFile = fileName;
+        m_statistics = DecodeStatistics{};
+        return true;
+    }
+
+    bool DecodeCameraStream::findStreamInfo()
+    {
+        if (nullptr == m_formatContext)
+        {
+            return false;
+        }
+        int ret = avformat_find_stream_info(m_formatContext, NULL);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Find stream info of {} failed {}.", m_inputFile, ret);
+            return false;
+        }
+        m_videoStreamIndex = av_find_best_stream(m_formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &m_codec, 0);
+        if (m_videoStreamIndex < 0)
+        {
+            LOG_ERROR_MSG("No video stream in {}.", m_inputFile);
+            return false;
+        }
+        return true;
+    }
+
+    bool DecodeCameraStream::avDumpFormat()
+    {
+        if (nullptr == m_formatContext)
+        {
+            return false;
+        }
+        av_dump_format(m_formatContext, m_videoStreamIndex, m_inputFile.c_str(), 0);
+        return true;
+    }
+
+    bool DecodeCameraStream::avCodecFindDecoder()
+    {
+        if (nullptr == m_formatContext or m_videoStreamIndex < 0)
+        {
+            return false;
+        }
+        if (nullptr == m_codec)
+        {
+            m_codec = avcodec_find_decoder(m_formatContext->streams[m_videoStreamIndex]->codecpar->codec_id);
+        }
+        if (nullptr == m_codec)
+        {
+            LOG_ERROR_MSG("Find decoder for {} failed.", m_inputFile);
+            return false;
+        }
+        return true;
+    }
+
+    bool DecodeCameraStream::avCodecOpen()
+    {
+        if (nullptr == m_codec)
+        {
+            return false;
+        }
+        m_codecContext = avcodec_alloc_context3(m_codec);
+        if (nullptr == m_codecContext)
+        {
+            LOG_ERROR_MSG("Alloc decoder context failed.");
+            return false;
+        }
+        int ret = avcodec_parameters_to_context(m_codecContext, m_formatContext->streams[m_videoStreamIndex]->codecpar);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Copy stream parameters to decoder failed {}.", ret);
+            return false;
+        }
+        // frame threading gives the throughput on recorded segments, slice threading
+        // covers streams encoded with several slices per picture
+        m_codecContext->thread_count = video::getVideoDecodeThreads(m_config);
+        m_codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        m_codecContext->skip_frame = m_keyFramesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+
+        ret = avcodec_open2(m_codecContext, m_codec, NULL);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Decoder open failed {}.", ret);
+            return false;
+        }
+        LOG_DEBUG_MSG("Decoder {} opened for {}, {} threads, thread type {}.", m_codec->name, m_inputFile,
+            m_codecContext->thread_count, m_codecContext->active_thread_type);
+        return true;
+    }
+
+    void DecodeCameraStream::setKeyFramesOnly(bool keyFramesOnly)
+    {
+        m_keyFramesOnly = keyFramesOnly;
+        if (m_codecContext)
+        {
+            m_codecContext->skip_frame = m_keyFramesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+        }
+    }
+
+    bool DecodeCameraStream::seekToKeyFrame(std::int64_t positionMs)
+    {
+        if (nullptr == m_formatContext or nullptr == m_codecContext)
+        {
+            return false;
+        }
+        AVStream* stream = m_formatContext->streams[m_videoStreamIndex];
+        std::int64_t timestamp = av_rescale_q(positionMs, millisecondTimeBase, stream->time_base);
+        if (AV_NOPTS_VALUE != stream->start_time)
+        {
+            timestamp += stream->start_time;
+        }
+        // BACKWARD lands on the keyframe at or before the target
+        int ret = av_seek_frame(m_formatContext, m_videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Seek {} to {} ms failed {}.", m_inputFile, positionMs, ret);
+            return false;
+        }
+        avcodec_flush_buffers(m_codecContext);
+        m_draining = false;
+        m_endOfStream = false;
+        return true;
+    }
+
+    bool DecodeCameraStream::readPacketToDecoder()
+    {
+        while (true)
+        {
+            int ret = av_read_frame(m_formatContext, m_packet);
+            if (ret < 0 and ret != AVERROR_EOF)
+            {
+                LOG_ERROR_MSG("Read packet of {} failed {}.", m_inputFile, ret);
+                return false;
+            }
+            if (ret < 0)
+            {
+                // end of file, enter draining mode to get the delayed frames
+                m_draining = true;
+                avcodec_send_packet(m_codecContext, nullptr);
+                return true;
+            }
+            if (m_packet->stream_index != m_videoStreamIndex or
+                (m_keyFramesOnly and not (m_packet->flags & AV_PKT_FLAG_KEY)))
+            {
+                av_packet_unref(m_packet);
+                continue;
+            }
+            m_statistics.demuxedBytes += m_packet->size;
+            ret = avcodec_send_packet(m_codecContext, m_packet);
+            av_packet_unref(m_packet);
+            if (ret < 0 and ret != AVERROR(EAGAIN))
+            {
+                LOG_ERROR_MSG("Send packet to decoder failed {}.", ret);
+                return false;
+            }
+            return true;
+        }
+    }
+
+    PooledFrame DecodeCameraStream::decodeNextFrame()
+    {
+        if (nullptr == m_codecContext)
+        {
+            return PooledFrame(nullptr, FrameRecycler{ &m_framePool });
+        }
+        auto startTime = Clock::now();
+        PooledFrame frame = m_framePool.acquire();
+        while (frame)
+        {
+            // decoded straight into the pooled frame, it only references the decoder buffers
+            int ret = avcodec_receive_frame(m_codecContext, frame.get());
+            if (0 == ret)
+            {
+                m_statistics.decodedFrames++;
+                break;
+            }
+            if (AVERROR_EOF == ret)
+            {
+                m_endOfStream = true;
+                frame.reset();
+            }
+            else if (ret != AVERROR(EAGAIN) or m_draining or not readPacketToDecoder())
+            {
+                if (ret != AVERROR(EAGAIN) or m_draining)
+                {
+                    LOG_ERROR_MSG("Decode frame of {} failed {}.", m_inputFile, ret);
+                }
+                frame.reset();
+            }
+        }
+        m_statistics.decodeSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+        if (m_statistics.decodeSeconds > 0)
+        {
+            m_statistics.decodedFPS = m_statistics.decodedFrames / m_statistics.decodeSeconds;
+        }
+        return frame;
+    }
+
+    std::int64_t DecodeCameraStream::getFramePositionMs(const AVFrame& frame) const
+    {
+        if (nullptr == m_formatContext or m_videoStreamIndex < 0 or AV_NOPTS_VALUE == frame.best_effort_timestamp)
+        {
+            return 0;
+        }
+        AVStream* stream = m_formatContext->streams[m_videoStreamIndex];
+        std::int64_t timestamp = frame.best_effort_timestamp;
+        if (AV_NOPTS_VALUE != stream->start_time)
+        {
+            timestamp -= stream->start_time;
+        }
+        return av_rescale_q(timestamp, stream->time_base, millisecondTimeBase);
+    }
+
+    std::int64_t DecodeCameraStream::getDurationMs() const
+    {
+        if (nullptr == m_formatContext or m_formatContext->duration <= 0)
+        {
+            return 0;
+        }
+        return m_formatContext->duration / (AV_TIME_BASE / 1000);
+    }
+
+    DecodeStatistics DecodeCameraStream::getStatistics() const
+    {
+        DecodeStatistics statistics = m_statistics;
+        statistics.poolGrownFrames = m_framePool.grownFrames();
+        return statistics;
+    }
+
+    void DecodeCameraStream::closeInputFile()
+    {
+        if (m_codecContext)
+        {
+            LOG_INFO_MSG(m_logger, "Decoded {} frames of {} in {:.2f} s, {:.1f} fps, frame pool grew by {}.", m_statistics.decodedFrames,
+                m_inputFile, m_statistics.decodeSeconds, m_statistics.decodedFPS, m_framePool.grownFrames());
+            avcodec_free_context(&m_codecContext);
+            m_codecContext = nullptr;
+        }
+        if (m_packet)
+        {
+            av_packet_free(&m_packet);
+            m_packet = nullptr;
+        }
+        if (m_formatContext)
+        {
+            avformat_close_input(&m_formatContext);
+            m_formatContext = nullptr;
+        }
+        m_codec = nullptr;
+        m_videoStreamIndex = -1;
+        m_draining = false;
+        m_endOfStream = false;
+    }
+} // namespace usbVideo
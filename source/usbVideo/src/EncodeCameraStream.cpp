@@ -1,4 +1,6 @@
 #include "usbVideo/EncodeCameraStream.hpp"
+#include "usbVideo/VideoEncoder.hpp"
+#include "usbVideo/ThumbnailGenerator.hpp"
 #include "Configurations/ParseConfigFile.hpp"
 #include "common/CommonFunction.hpp"
 
@@ -35,9 +37,6 @@ namespace
     }
 
     constexpr int threadCounts = 8;
-    constexpr int minQuantizer = 10;
-    constexpr int maxQuantizer = 51;
-    constexpr int maxBframe = 3;
     constexpr int RGBCountSize = 3;
     // If equal to 0, alignment will be chosen automatically for the current CPU.
     constexpr int alignment = 0;
@@ -57,7 +56,10 @@ namespace usbVideo
         , m_config{config}
         , closeVideoNotify{std::move(notify)}
     {
-
+        if (video::getEnableThumbnails(config))
+        {
+            m_thumbnailGenerator = std::make_unique<ThumbnailGenerator>(logger, config);
+        }
     }
 
     EncodeCameraStream::~EncodeCameraStream()
@@ -371,59 +373,15 @@ namespace usbVideo
 
     bool EncodeCameraStream::createVideoEncoder()
     {
-        // Find a registered encoder with a matching codec ID.
-        AVCodec* avCodec = avcodec_find_encoder(AV_CODEC_ID_H264);
-        if (nullptr == avCodec)
-        {
-            LOG_ERROR_MSG("Find encoder H264 failed.");
-            return false;
-        }
-        // Allocate an AVCodecContext and set its fields to default values.
-        m_codecContext = avcodec_alloc_context3(avCodec);
+        VideoEncoderParameters parameters;
+        parameters.width = videoWidth;
+        parameters.height = videoHeight;
+        parameters.fps = getVideoFPS(m_config);
+        parameters.bitRate = video::getVideoBitRate(m_config);
+        parameters.threadCount = threadCounts;
+        m_codecContext = createH264Encoder(parameters);
         if (nullptr == m_codecContext)
         {
-            LOG_ERROR_MSG("alloc codec context failed.");
-            return false;
-        }
-        m_codecContext->width = videoWidth;
-        m_codecContext->height = videoHeight;
-        m_codecContext->time_base = { 1, getVideoFPS(m_config) };
-        m_codecContext->framerate = { getVideoFPS(m_config), 1 };
-        m_codecContext->bit_rate = video::getVideoBitRate(m_config);
-        m_codecContext->gop_size = getVideoFPS(m_config) * 2;
-        m_codecContext->max_b_frames = maxBframe;
-        m_codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
-        m_codecContext->codec_type = AVMEDIA_TYPE_VIDEO;
-        m_codecContext->codec_id = AV_CODEC_ID_H264;
-        m_codecContext->qmin = minQuantizer;
-        m_codecContext->qmax = maxQuantizer;
-        m_codecContext->thread_count = threadCounts;
-        m_codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-        /*
-        Cpreset it mainly adjusts the balance between coding speed and puality
-        ultrafastsuperfastveryfastfasterfastmediumslowslowerveryslowplacebo the 10 options from fast to slow.
-
-        Ctune it mainly cooperate with video type and visual optimization parameters or special cases,
-        like follow list.
-        film: movie, real person type
-        animation:
-        grain: designed for coding at high bit rates
-        stillimage: used when coding static images
-        psnr: parameters were optimized to improve psnr
-        ssimparameters were optimized to improve ssim
-        fastdecode parameters that can be decoded quickly
-        zerolatency: used in situations where very low latency is required, such as coding for teleconference
-        */
-        av_dict_set(&m_dictionary, "preset", "slow", 0);
-        av_dict_set(&m_dictionary, "tune", "zerolatency", 0);
-        LOG_DEBUG_MSG("Video bit rate {} bps.", m_codecContext->bit_rate);
-
-        // Initialize the AVCodecContext to use the given AVCodec.
-        // need libx264
-        int ret = avcodec_open2(m_codecContext, avCodec, NULL);
-        if (ret < 0)
-        {
-            LOG_ERROR_MSG("encoder open failed {}.", ret);
             return false;
         }
         return true;
@@ -470,6 +428,8 @@ namespace usbVideo
 
     bool EncodeCameraStream::initCodecContext(const std::string& outputFile)
     {
+        m_outputFile = outputFile;
+        m_encodedFrames = 0;
         if (not createEncoder())
         {
             LOG_ERROR_MSG("Create encoder failed.");
@@ -724,8 +684,25 @@ namespace usbVideo
                 break;
             }
 
+            // force the GOP start to IDR so the thumbnails are taken from real keyframes
+            if (0 == m_encodedFrames % m_codecContext->gop_size)
+            {
+                filterFrame->pict_type = AV_PICTURE_TYPE_I;
+                if (m_thumbnailGenerator)
+                {
+                    m_thumbnailGenerator->onKeyFrame(m_outputFile, *filterFrame,
+                        m_encodedFrames * 1000 * m_codecContext->time_base.num / m_codecContext->time_base.den);
+                }
+            }
+            else
+            {
+                filterFrame->pict_type = AV_PICTURE_TYPE_NONE;
+            }
+            m_encodedFrames++;
+
             //  Supply a raw video or audio frame to the encoder. Use avcodec_receive_packet() to retrieve buffered output packets.
             ret = avcodec_send_frame(m_codecContext, filterFrame);
+            av_frame_unref(filterFrame);
             if (ret != 0)
             {
                 continue;
@@ -827,6 +804,10 @@ namespace usbVideo
         {
             av_write_trailer(m_formatContext);
         }
+        if (m_thumbnailGenerator)
+        {
+            m_thumbnailGenerator->finishSegment(m_outputFile);
+        }
 
         av_frame_free(&filterFrame);
         av_frame_free(&wateMarkFrame);
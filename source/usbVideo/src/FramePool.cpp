@@ -0,0 +1,72 @@
+#include "usbVideo/FramePool.hpp"
+#include "logger/Logger.hpp"
+
+namespace usbVideo
+{
+    void FrameRecycler::operator()(AVFrame* frame) const
+    {
+        if (pool)
+        {
+            pool->release(frame);
+            return;
+        }
+        av_frame_free(&frame);
+    }
+
+    FramePool::FramePool(std::size_t capacity)
+    {
+        m_freeFrames.reserve(capacity);
+        for (std::size_t i = 0; i < capacity; ++i)
+        {
+            AVFrame* frame = av_frame_alloc();
+            if (nullptr == frame)
+            {
+                LOG_ERROR_MSG("Alloc pooled frame failed, pool holds {} frames.", i);
+                break;
+            }
+            m_freeFrames.push_back(frame);
+        }
+    }
+
+    FramePool::~FramePool()
+    {
+        std::lock_guard<std::mutex> locker(m_poolMutex);
+        for (auto& frame : m_freeFrames)
+        {
+            av_frame_free(&frame);
+        }
+        m_freeFrames.clear();
+    }
+
+    PooledFrame FramePool::acquire()
+    {
+        AVFrame* frame = nullptr;
+        {
+            std::lock_guard<std::mutex> locker(m_poolMutex);
+            if (not m_freeFrames.empty())
+            {
+                frame = m_freeFrames.back();
+                m_freeFrames.pop_back();
+            }
+        }
+        if (nullptr == frame)
+        {
+            // pool drained by consumers holding frames, the extra frame stays in the pool once released
+            frame = av_frame_alloc();
+            m_grownFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        return PooledFrame(frame, FrameRecycler{ this });
+    }
+
+    void FramePool::release(AVFrame* frame)
+    {
+        if (nullptr == frame)
+        {
+            return;
+        }
+        av_frame_unref(frame);
+
+        std::lock_guard<std::mutex> locker(m_poolMutex);
+        m_freeFrames.push_back(frame);
+    }
+} // namespace usbVideo
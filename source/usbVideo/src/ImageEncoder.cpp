@@ -0,0 +1,122 @@
+#include <cstdio>
+#include "usbVideo/ImageEncoder.hpp"
+#include "logger/Logger.hpp"
+
+namespace usbVideo
+{
+    ImageEncoder::ImageEncoder(int quality)
+        : m_quality{quality}
+    {
+    }
+
+    ImageEncoder::~ImageEncoder()
+    {
+        closeEncoder();
+    }
+
+    bool ImageEncoder::openEncoder(AVCodecID codecId, int width, int height, AVPixelFormat format)
+    {
+        if (m_codecContext and m_codecContext->codec_id == codecId and m_codecContext->width == width and
+            m_codecContext->height == height and m_codecContext->pix_fmt == format)
+        {
+            return true;
+        }
+        closeEncoder();
+
+        AVCodec* codec = avcodec_find_encoder(codecId);
+        if (nullptr == codec)
+        {
+            LOG_ERROR_MSG("Find image encoder {} failed.", avcodec_get_name(codecId));
+            return false;
+        }
+        m_codecContext = avcodec_alloc_context3(codec);
+        m_packet = av_packet_alloc();
+        if (nullptr == m_codecContext or nullptr == m_packet)
+        {
+            LOG_ERROR_MSG("Alloc image encoder failed.");
+            closeEncoder();
+            return false;
+        }
+        m_codecContext->width = width;
+        m_codecContext->height = height;
+        m_codecContext->pix_fmt = format;
+        m_codecContext->time_base = { 1, 25 };
+        if (AV_CODEC_ID_MJPEG == codecId)
+        {
+            m_codecContext->flags |= AV_CODEC_FLAG_QSCALE;
+            m_codecContext->global_quality = FF_QP2LAMBDA * m_quality;
+        }
+
+        int ret = avcodec_open2(m_codecContext, codec, NULL);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Image encoder open failed {}.", ret);
+            closeEncoder();
+            return false;
+        }
+        return true;
+    }
+
+    bool ImageEncoder::encodeJpeg(const AVFrame& frame, std::vector<std::uint8_t>& image)
+    {
+        return encodeImage(AV_CODEC_ID_MJPEG, frame, image);
+    }
+
+    bool ImageEncoder::encodePng(const AVFrame& frame, std::vector<std::uint8_t>& image)
+    {
+        return encodeImage(AV_CODEC_ID_PNG, frame, image);
+    }
+
+    bool ImageEncoder::encodeImage(AVCodecID codecId, const AVFrame& frame, std::vector<std::uint8_t>& image)
+    {
+        if (not openEncoder(codecId, frame.width, frame.height, static_cast<AVPixelFormat>(frame.format)))
+        {
+            return false;
+        }
+        AVFrame* input = const_cast<AVFrame*>(&frame);
+        input->quality = m_codecContext->global_quality;
+
+        int ret = avcodec_send_frame(m_codecContext, input);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Send frame to image encoder failed {}.", ret);
+            return false;
+        }
+        ret = avcodec_receive_packet(m_codecContext, m_packet);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("Receive image from encoder failed {}.", ret);
+            return false;
+        }
+        image.assign(m_packet->data, m_packet->data + m_packet->size);
+        av_packet_unref(m_packet);
+        return true;
+    }
+
+    bool ImageEncoder::writeImageFile(const std::string& fileName, const std::vector<std::uint8_t>& image)
+    {
+        FILE* imageFile = fopen(fileName.c_str(), "wb");
+        if (nullptr == imageFile)
+        {
+            LOG_ERROR_MSG("Open image file {} failed.", fileName);
+            return false;
+        }
+        std::size_t written = fwrite(image.data(), 1, image.size(), imageFile);
+        fclose(imageFile);
+        return written == image.size();
+    }
+
+    void ImageEncoder::closeEncoder()
+    {
+        if (m_codecContext)
+        {
+            avcodec_free_context(&m_codecContext);
+            m_codecContext = nullptr;
+        }
+        if (m_packet)
+        {
+            av_packet_free(&m_packet);
+            m_packet = nullptr;
+        }
+    }
+} // namespace usbVideo
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <boost/filesystem.hpp>
+#include "usbVideo/SnapshotService.hpp"
+#include "common/CommonFunction.hpp"
+
+namespace
+{
+    // one frame in flight while the worker encodes the previous one
+    constexpr int snapshotSlots = 2;
+    constexpr int YUYVBytesPerPixel = 2;
+    // If equal to 0, alignment will be chosen automatically for the current CPU.
+    constexpr int alignment = 0;
+
+    configuration::captureFormat convertSnapshotFormat(const std::string& format)
+    {
+        if ("PNG" == format)
+        {
+            return configuration::captureFormat::CAPTURE_FORMAT_PNG;
+        }
+        return configuration::captureFormat::CAPTURE_FORMAT_JPG;
+    }
+
+    double toMilliseconds(usbVideo::SnapshotService::Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}// namespace
+
+namespace usbVideo
+{
+    SnapshotService::SnapshotService(Logger& logger, const configuration::AppConfiguration& config, int width, int height)
+        : m_logger{logger}
+        , m_outputDir{common::getCaptureOutputDir(config) + "snapshots/"}
+        , m_format{convertSnapshotFormat(video::getSnapshotFormat(config))}
+        , m_width{width}
+        , m_height{height}
+        , m_burstCount{std::max(video::getBurstCount(config), 1)}
+        // a whole burst fits next to a snapshot still being encoded
+        , m_slots(std::max(snapshotSlots, m_burstCount + 1), std::vector<std::uint8_t>(width * height * YUYVBytesPerPixel))
+        , m_imageEncoder{video::getSnapshotQuality(config)}
+    {
+        for (std::size_t slot = 0; slot < m_slots.size(); ++slot)
+        {
+            m_freeSlots.push_back(slot);
+        }
+        boost::system::error_code error;
+        boost::filesystem::create_directories(m_outputDir, error);
+        if (error)
+        {
+            LOG_ERROR_MSG("Create snapshot directory {} failed {}.", m_outputDir, error.message());
+        }
+        m_workerThread = std::thread(&SnapshotService::snapshotWorker, this);
+    }
+
+    SnapshotService::~SnapshotService()
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_jobMutex);
+            m_stopWorker = true;
+        }
+        m_jobCondition.notify_one();
+        if (m_workerThread.joinable())
+        {
+            m_workerThread.join();
+        }
+        av_frame_free(&m_frame);
+        if (m_swsContext)
+        {
+            sws_freeContext(m_swsContext);
+            m_swsContext = nullptr;
+        }
+    }
+
+    void SnapshotService::requestSnapshot()
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_requestMutex);
+            SnapshotRequest request;
+            request.triggerTime = Clock::now();
+            m_requests.push_back(request);
+        }
+        ++m_pendingRequests;
+    }
+
+    void SnapshotService::requestBurst()
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_requestMutex);
+            SnapshotRequest request;
+            request.triggerTime = Clock::now();
+            request.burst = true;
+            for (int i = 0; i < m_burstCount; ++i)
+            {
+                request.burstRemaining = m_burstCount - 1 - i;
+                m_requests.push_back(request);
+            }
+        }
+        m_pendingRequests += m_burstCount;
+    }
+
+    void SnapshotService::onCaptureFrame(const uint8_t* yuyv, uint32_t length)
+    {
+        if (nullptr == yuyv or length < m_slots.front().size())
+        {
+            return;
+        }
+
+        SnapshotJob job;
+        {
+            std::lock_guard<std::mutex> locker(m_jobMutex);
+            if (m_freeSlots.empty())
+            {
+                // worker still busy, serve the request with a later frame
+                return;
+            }
+            job.slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        {
+            std::lock_guard<std::mutex> locker(m_requestMutex);
+            job.request = m_requests.front();
+            m_requests.pop_front();
+        }
+        --m_pendingRequests;
+
+        std::vector<std::uint8_t>& slot = m_slots[job.slot];
+        memcpy(slot.data(), yuyv, slot.size());
+        job.captureTime = Clock::now();
+        {
+            std::lock_guard<std::mutex> locker(m_jobMutex);
+            m_jobs.push(job);
+        }
+        m_jobCondition.notify_one();
+    }
+
+    void SnapshotService::snapshotWorker()
+    {
+        std::vector<std::uint8_t> image;
+        while (true)
+        {
+            SnapshotJob job;
+            {
+                std::unique_lock<std::mutex> locker(m_jobMutex);
+                m_jobCondition.wait(locker, [this]() { return m_stopWorker or not m_jobs.empty(); });
+                if (m_jobs.empty())
+                {
+                    return;
+                }
+                job = m_jobs.front();
+                m_jobs.pop();
+            }
+
+            bool encoded = encodeSnapshot(job, image);
+            {
+                std::lock_guard<std::mutex> locker(m_jobMutex);
+                m_freeSlots.push_back(job.slot);
+            }
+            if (not encoded)
+            {
+                continue;
+            }
+
+            std::string fileName = makeFileName(job.request);
+            if (not ImageEncoder::writeImageFile(fileName, image))
+            {
+                continue;
+            }
+            auto doneTime = Clock::now();
+            if (not job.request.burst)
+            {
+                LOG_INFO_MSG(m_logger, "Snapshot {} ({} bytes), latency {:.1f} ms, frame wait {:.1f} ms.",
+                    fileName, image.size(), toMilliseconds(doneTime - job.request.triggerTime),
+                    toMilliseconds(job.captureTime - job.request.triggerTime));
+            }
+            else if (0 == job.request.burstRemaining)
+            {
+                LOG_INFO_MSG(m_logger, "Burst of {} frames written, last {}, latency {:.1f} ms.",
+                    m_burstCount, fileName, toMilliseconds(doneTime - job.request.triggerTime));
+            }
+        }
+    }
+
+    bool SnapshotService::encodeSnapshot(const SnapshotJob& job, std::vector<std::uint8_t>& image)
+    {
+        const AVPixelFormat format = (configuration::captureFormat::CAPTURE_FORMAT_PNG == m_format) ?
+            AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+        if (nullptr == m_frame)
+        {
+            m_frame = av_frame_alloc();
+            if (nullptr == m_frame)
+            {
+                LOG_ERROR_MSG("Alloc snapshot frame failed.");
+                return false;
+            }
+            m_frame->format = format;
+            m_frame->width = m_width;
+            m_frame->height = m_height;
+            if (av_frame_get_buffer(m_frame, alignment) < 0)
+            {
+                LOG_ERROR_MSG("Alloc snapshot frame buffer failed.");
+                av_frame_free(&m_frame);
+                return false;
+            }
+        }
+
+        m_swsContext = sws_getCachedContext(m_swsContext,
+            m_width, m_height, AV_PIX_FMT_YUYV422,
+            m_width, m_height, format,
+            SWS_BILINEAR, NULL, NULL, NULL);
+        if (nullptr == m_swsContext)
+        {
+            LOG_ERROR_MSG("Create snapshot sws context failed.");
+            return false;
+        }
+        const uint8_t* source[] = { m_slots[job.slot].data(), nullptr, nullptr, nullptr };
+        const int sourceLinesize[] = { m_width * YUYVBytesPerPixel, 0, 0, 0 };
+        sws_scale(m_swsContext, source, sourceLinesize, 0, m_height, m_frame->data, m_frame->linesize);
+
+        if (configuration::captureFormat::CAPTURE_FORMAT_PNG == m_format)
+        {
+            return m_imageEncoder.encodePng(*m_frame, image);
+        }
+        return m_imageEncoder.encodeJpeg(*m_frame, image);
+    }
+
+    std::string SnapshotService::makeFileName(const SnapshotRequest& request)
+    {
+        auto time = std::time(nullptr);
+        char string[30]{};
+        std::strftime(string, sizeof(string), "%Y%m%d_%H%M%S", std::localtime(&time));
+        std::string extension = (configuration::captureFormat::CAPTURE_FORMAT_PNG == m_format) ? ".png" : ".jpg";
+        return m_outputDir + (request.burst ? "burst_" : "snapshot_") + string + "_" + std::to_string(m_sequence++) + extension;
+    }
+} // namespace usbVideo
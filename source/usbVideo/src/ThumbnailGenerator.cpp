@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <boost/filesystem.hpp>
+#include "usbVideo/ThumbnailGenerator.hpp"
+#include "usbVideo/DecodeCameraStream.hpp"
+#include "common/CommonFunction.hpp"
+
+namespace
+{
+    constexpr int sheetColumns = 6;
+    constexpr AVPixelFormat thumbnailFormat = AV_PIX_FMT_YUVJ420P;
+    // If equal to 0, alignment will be chosen automatically for the current CPU.
+    constexpr int alignment = 0;
+
+    using Clock = std::chrono::steady_clock;
+
+    AVFrame* allocThumbnailFrame(int width, int height)
+    {
+        AVFrame* frame = av_frame_alloc();
+        if (nullptr == frame)
+        {
+            return nullptr;
+        }
+        frame->format = thumbnailFormat;
+        frame->width = width;
+        frame->height = height;
+        if (av_frame_get_buffer(frame, alignment) < 0)
+        {
+            av_frame_free(&frame);
+            return nullptr;
+        }
+        return frame;
+    }
+
+    void copyPlane(const uint8_t* src, int srcLinesize, uint8_t* dst, int dstLinesize, int width, int height)
+    {
+        for (int i = 0; i < height; ++i)
+        {
+            memcpy(dst + i * dstLinesize, src + i * srcLinesize, width);
+        }
+    }
+}// namespace
+
+namespace usbVideo
+{
+    ThumbnailGenerator::ThumbnailGenerator(Logger& logger, const configuration::AppConfiguration& config)
+        : m_logger{logger}
+        , m_config{config}
+        , m_outputDir{common::getCaptureOutputDir(config) + "thumbnails/"}
+        , m_intervalMs{video::getThumbnailInterval(config) * 1000}
+        , m_thumbnailWidth{video::getThumbnailWidth(config) & ~1}
+    {
+        boost::system::error_code error;
+        boost::filesystem::create_directories(m_outputDir, error);
+        if (error)
+        {
+            LOG_ERROR_MSG("Create thumbnail directory {} failed {}.", m_outputDir, error.message());
+        }
+        m_workerThread = std::thread(&ThumbnailGenerator::thumbnailWorker, this);
+    }
+
+    ThumbnailGenerator::~ThumbnailGenerator()
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_jobMutex);
+            m_stopWorker = true;
+        }
+        m_jobCondition.notify_one();
+        if (m_workerThread.joinable())
+        {
+            m_workerThread.join();
+        }
+        for (auto& segment : m_segments)
+        {
+            for (auto& thumbnail : segment.second.thumbnails)
+            {
+                av_frame_free(&thumbnail.frame);
+            }
+        }
+        if (m_swsContext)
+        {
+            sws_freeContext(m_swsContext);
+            m_swsContext = nullptr;
+        }
+    }
+
+    void ThumbnailGenerator::onKeyFrame(const std::string& segmentFile, const AVFrame& frame, std::int64_t positionMs)
+    {
+        queueThumbnail(segmentFile, frame, positionMs);
+    }
+
+    void ThumbnailGenerator::finishSegment(const std::string& segmentFile)
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_scaleMutex);
+            m_lastQueuedMs.erase(segmentFile);
+        }
+        ThumbnailJob job;
+        job.segmentFile = segmentFile;
+        job.finishSegment = true;
+        pushJob(std::move(job));
+    }
+
+    bool ThumbnailGenerator::generateFromSegment(const std::string& segmentFile)
+    {
+        DecodeCameraStream decoder(m_logger, m_config);
+        decoder.setKeyFramesOnly(true);
+        if (not decoder.openDecoder(segmentFile))
+        {
+            return false;
+        }
+        while (auto frame = decoder.decodeNextFrame())
+        {
+            queueThumbnail(segmentFile, *frame, decoder.getFramePositionMs(*frame));
+        }
+        if (not decoder.isEndOfStream())
+        {
+            LOG_WARNING_MSG("Thumbnails of {} stop at a decode error.", segmentFile);
+        }
+        decoder.closeInputFile();
+        finishSegment(segmentFile);
+        return true;
+    }
+
+    bool ThumbnailGenerator::queueThumbnail(const std::string& segmentFile, const AVFrame& frame, std::int64_t positionMs)
+    {
+        auto startTime = Clock::now();
+        AVFrame* thumbnail = nullptr;
+        {
+            std::lock_guard<std::mutex> locker(m_scaleMutex);
+            auto lastQueued = m_lastQueuedMs.find(segmentFile);
+            if (lastQueued != m_lastQueuedMs.end() and positionMs - lastQueued->second < m_intervalMs)
+            {
+                return false;
+            }
+            thumbnail = scaleThumbnail(frame);
+            if (nullptr == thumbnail)
+            {
+                return false;
+            }
+            m_lastQueuedMs[segmentFile] = positionMs;
+        }
+
+        ThumbnailJob job;
+        job.segmentFile = segmentFile;
+        job.frame = thumbnail;
+        job.positionMs = positionMs;
+        job.scaleSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+        pushJob(std::move(job));
+        return true;
+    }
+
+    AVFrame* ThumbnailGenerator::scaleThumbnail(const AVFrame& frame)
+    {
+        if (frame.width <= 0 or frame.height <= 0)
+        {
+            return nullptr;
+        }
+        int width = std::min(m_thumbnailWidth, frame.width & ~1);
+        int height = (frame.height * width / frame.width) & ~1;
+
+        m_swsContext = sws_getCachedContext(m_swsContext,
+            frame.width, frame.height, static_cast<AVPixelFormat>(frame.format),
+            width, height, thumbnailFormat,
+            SWS_AREA, NULL, NULL, NULL);
+        if (nullptr == m_swsContext)
+        {
+            LOG_ERROR_MSG("Create thumbnail sws context failed.");
+            return nullptr;
+        }
+        AVFrame* thumbnail = allocThumbnailFrame(width, height);
+        if (nullptr == thumbnail)
+        {
+            LOG_ERROR_MSG("Alloc thumbnail frame failed.");
+            return nullptr;
+        }
+        sws_scale(m_swsContext, frame.data, frame.linesize, 0, frame.height,
+            thumbnail->data, thumbnail->linesize);
+        return thumbnail;
+    }
+
+    void ThumbnailGenerator::pushJob(ThumbnailJob&& job)
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_jobMutex);
+            m_jobs.push(std::move(job));
+        }
+        m_jobCondition.notify_one();
+    }
+
+    void ThumbnailGenerator::thumbnailWorker()
+    {
+        while (true)
+        {
+            ThumbnailJob job;
+            {
+                std::unique_lock<std::mutex> locker(m_jobMutex);
+                m_jobCondition.wait(locker, [this]() { return m_stopWorker or not m_jobs.empty(); });
+                if (m_jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+
+            if (job.finishSegment)
+            {
+                auto segment = m_segments.find(job.segmentFile);
+                if (segment != m_segments.end())
+                {
+                    writeContactSheet(job.segmentFile, segment->second);
+                    m_segments.erase(segment);
+                }
+                continue;
+            }
+            storeThumbnail(job);
+        }
+    }
+
+    void ThumbnailGenerator::storeThumbnail(ThumbnailJob& job)
+    {
+        auto startTime = Clock::now();
+        SegmentThumbnails& segment = m_segments[job.segmentFile];
+
+        char index[8] = { 0 };
+        snprintf(index, sizeof(index), "_%03zu", segment.thumbnails.size());
+        Thumbnail thumbnail;
+        thumbnail.fileName = getSegmentBaseName(job.segmentFile) + index + ".jpg";
+        thumbnail.positionMs = job.positionMs;
+        thumbnail.frame = job.frame;
+
+        std::vector<std::uint8_t> image;
+        if (m_imageEncoder.encodeJpeg(*thumbnail.frame, image))
+        {
+            ImageEncoder::writeImageFile(m_outputDir + thumbnail.fileName, image);
+        }
+        segment.thumbnails.push_back(thumbnail);
+        segment.costSeconds += job.scaleSeconds + std::chrono::duration<double>(Clock::now() - startTime).count();
+    }
+
+    void ThumbnailGenerator::writeContactSheet(const std::string& segmentFile, SegmentThumbnails& segment)
+    {
+        if (segment.thumbnails.empty())
+        {
+            return;
+        }
+        auto startTime = Clock::now();
+        const std::string baseName = getSegmentBaseName(segmentFile);
+        const int thumbnailWidth = segment.thumbnails.front().frame->width;
+        const int thumbnailHeight = segment.thumbnails.front().frame->height;
+        const int count = static_cast<int>(segment.thumbnails.size());
+        const int columns = std::min(count, sheetColumns);
+        const int rows = (count + columns - 1) / columns;
+
+        AVFrame* sheet = allocThumbnailFrame(columns * thumbnailWidth, rows * thumbnailHeight);
+        if (nullptr == sheet)
+        {
+            LOG_ERROR_MSG("Alloc contact sheet for {} failed.", baseName);
+            return;
+        }
+        // black background for the empty cells of the last row
+        memset(sheet->data[0], 0, sheet->linesize[0] * sheet->height);
+        memset(sheet->data[1], 128, sheet->linesize[1] * sheet->height / 2);
+        memset(sheet->data[2], 128, sheet->linesize[2] * sheet->height / 2);
+
+        std::string index = "{\n  \"segment\": \"" + boost::filesystem::path(segmentFile).filename().string() + "\",\n" +
+            "  \"sheet\": \"" + baseName + "_sheet.jpg\",\n" +
+            "  \"intervalMs\": " + std::to_string(m_intervalMs) + ",\n" +
+            "  \"thumbnailWidth\": " + std::to_string(thumbnailWidth) + ",\n" +
+            "  \"thumbnailHeight\": " + std::to_string(thumbnailHeight) + ",\n" +
+            "  \"columns\": " + std::to_string(columns) + ",\n" +
+            "  \"thumbnails\": [\n";
+        for (int i = 0; i < count; ++i)
+        {
+            const Thumbnail& thumbnail = segment.thumbnails[i];
+            const int x = (i % columns) * thumbnailWidth;
+            const int y = (i / columns) * thumbnailHeight;
+            // all thumbnails of a segment share the size, skip strays after a resolution change
+            if (thumbnail.frame->width == thumbnailWidth and thumbnail.frame->height == thumbnailHeight)
+            {
+                copyPlane(thumbnail.frame->data[0], thumbnail.frame->linesize[0],
+                    sheet->data[0] + y * sheet->linesize[0] + x, sheet->linesize[0], thumbnailWidth, thumbnailHeight);
+                for (int plane = 1; plane < 3; ++plane)
+                {
+                    copyPlane(thumbnail.frame->data[plane], thumbnail.frame->linesize[plane],
+                        sheet->data[plane] + y / 2 * sheet->linesize[plane] + x / 2, sheet->linesize[plane],
+                        thumbnailWidth / 2, thumbnailHeight / 2);
+                }
+            }
+            index += "    { \"file\": \"" + thumbnail.fileName + "\", \"positionMs\": " + std::to_string(thumbnail.positionMs) +
+                ", \"x\": " + std::to_string(x) + ", \"y\": " + std::to_string(y) + " }" + (i + 1 < count ? ",\n" : "\n");
+        }
+        index += "  ]\n}\n";
+
+        std::vector<std::uint8_t> image;
+        if (m_imageEncoder.encodeJpeg(*sheet, image))
+        {
+            ImageEncoder::writeImageFile(m_outputDir + baseName + "_sheet.jpg", image);
+        }
+        av_frame_free(&sheet);
+        ImageEncoder::writeImageFile(m_outputDir + baseName + ".json", std::vector<std::uint8_t>(index.begin(), index.end()));
+
+        for (auto& thumbnail : segment.thumbnails)
+        {
+            av_frame_free(&thumbnail.frame);
+        }
+        segment.costSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+        LOG_INFO_MSG(m_logger, "Wrote {} thumbnails for {}, cost {:.1f} ms.", count, baseName, segment.costSeconds * 1000);
+        segment.thumbnails.clear();
+    }
+
+    std::string ThumbnailGenerator::getSegmentBaseName(const std::string& segmentFile) const
+    {
+        return boost::filesystem::path(segmentFile).stem().string();
+    }
+} // namespace usbVideo
@@ -0,0 +1,80 @@
+#include "usbVideo/VideoEncoder.hpp"
+#include "logger/Logger.hpp"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+}
+
+namespace
+{
+    constexpr int minQuantizer = 10;
+    constexpr int maxQuantizer = 51;
+    constexpr int maxBframe = 3;
+}// namespace
+
+namespace usbVideo
+{
+    AVCodecContext* createH264Encoder(const VideoEncoderParameters& parameters)
+    {
+        // Find a registered encoder with a matching codec ID.
+        AVCodec* avCodec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        if (nullptr == avCodec)
+        {
+            LOG_ERROR_MSG("Find encoder H264 failed.");
+            return nullptr;
+        }
+        // Allocate an AVCodecContext and set its fields to default values.
+        AVCodecContext* codecContext = avcodec_alloc_context3(avCodec);
+        if (nullptr == codecContext)
+        {
+            LOG_ERROR_MSG("alloc codec context failed.");
+            return nullptr;
+        }
+        codecContext->width = parameters.width;
+        codecContext->height = parameters.height;
+        codecContext->time_base = { 1, parameters.fps };
+        codecContext->framerate = { parameters.fps, 1 };
+        codecContext->bit_rate = parameters.bitRate;
+        codecContext->gop_size = parameters.fps * 2;
+        codecContext->max_b_frames = maxBframe;
+        codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+        codecContext->codec_type = AVMEDIA_TYPE_VIDEO;
+        codecContext->codec_id = AV_CODEC_ID_H264;
+        codecContext->qmin = minQuantizer;
+        codecContext->qmax = maxQuantizer;
+        codecContext->thread_count = parameters.threadCount;
+        codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        /*
+        -preset mainly adjusts the balance between coding speed and quality,
+        ultrafast, superfast, veryfast, faster, fast, medium, slow, slower, veryslow, placebo
+        the 10 options from fast to slow.
+        -tune mainly cooperates with the video type and visual optimization, e.g.
+        stillimage for static images, fastdecode for quick decoding and
+        zerolatency where very low latency is required, such as teleconference.
+        */
+        AVDictionary* dictionary = nullptr;
+        if (not parameters.preset.empty())
+        {
+            av_dict_set(&dictionary, "preset", parameters.preset.c_str(), 0);
+        }
+        if (not parameters.tune.empty())
+        {
+            av_dict_set(&dictionary, "tune", parameters.tune.c_str(), 0);
+        }
+        LOG_DEBUG_MSG("Video bit rate {} bps, preset {}.", codecContext->bit_rate,
+            parameters.preset.empty() ? "default" : parameters.preset);
+
+        // Initialize the AVCodecContext to use the given AVCodec.
+        // need libx264
+        int ret = avcodec_open2(codecContext, avCodec, &dictionary);
+        av_dict_free(&dictionary);
+        if (ret < 0)
+        {
+            LOG_ERROR_MSG("encoder open failed {}.", ret);
+            avcodec_free_context(&codecContext);
+            return nullptr;
+        }
+        return codecContext;
+    }
+} // namespace usbVideo
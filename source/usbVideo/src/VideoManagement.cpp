@@ -3,18 +3,6 @@
 #include "Configurations/ParseConfigFile.hpp"
 #include "common/CommonFunction.hpp"
 
-namespace
-{
-    int getVideoTimes(const configuration::AppConfiguration& config)
-    {
-        if (config.find(configuration::videoTimes) != config.end())
-        {
-            return config[configuration::videoTimes].as<int>();
-        }
-        return 30;
-    }
-} // namespace
-
 namespace usbVideo
 {
     std::string VideoManagement::TimeStamp::now() const
@@ -61,7 +49,7 @@ namespace usbVideo
         }
         m_streamProcess->initRegister(m_bestFrameSize);
 
-        std::chrono::milliseconds period = std::chrono::milliseconds{ getVideoTimes(m_config) * 1000 * 60 };
+        std::chrono::milliseconds period = std::chrono::milliseconds{ video::getVideoTimes(m_config) * 1000 * 60 };
 
         m_timer = m_timerService.schedulePeriodicTimer(period, [this]()
             {
@@ -0,0 +1,524 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include "usbVideo/VirtualCameraControl.hpp"
+#include "usbVideo/CameraImage.hpp"
+
+namespace
+{
+    const std::string syntheticDevicePrefix = "synthetic:";
+    const std::string fileDevicePrefix = "file:";
+    constexpr char optionSeparator = ',';
+    constexpr std::uint32_t YUYVBytesPerPixel = 2;
+    constexpr std::uint32_t maxFps = 1000;
+    // the color bars move this many pixels per frame
+    constexpr std::uint32_t scrollPixels = 4;
+    // 75% color bars, ITU-R BT.601 Y U V
+    constexpr std::uint8_t colorBars[][3] = {
+        { 180, 128, 128 }, { 162, 44, 142 }, { 131, 156, 44 }, { 112, 72, 58 },
+        { 84, 184, 198 }, { 65, 100, 212 }, { 35, 212, 114 }, { 16, 128, 128 },
+    };
+    constexpr std::uint32_t stampBits = 32;
+    constexpr std::uint32_t stampBlockPixels = 16;
+    constexpr std::uint8_t stampOne = 235;
+    constexpr std::uint8_t stampZero = 16;
+    constexpr std::uint8_t neutralChroma = 128;
+
+    bool startsWith(const std::string& value, const std::string& prefix)
+    {
+        return 0 == value.compare(0, prefix.size(), prefix);
+    }
+
+    struct timeval toTimeval(std::chrono::steady_clock::time_point timePoint)
+    {
+        const auto micro = std::chrono::duration_cast<std::chrono::microseconds>(timePoint.time_since_epoch()).count();
+        struct timeval timestamp;
+        timestamp.tv_sec = static_cast<time_t>(micro / 1000000);
+        timestamp.tv_usec = static_cast<suseconds_t>(micro % 1000000);
+        return timestamp;
+    }
+
+    void convertNV12ToYUYV(const std::uint8_t* nv12, std::uint8_t* yuyv, std::uint32_t width, std::uint32_t height)
+    {
+        const std::uint8_t* chroma = nv12 + width * height;
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            const std::uint8_t* luma = nv12 + y * width;
+            const std::uint8_t* uv = chroma + (y / 2) * width;
+            for (std::uint32_t x = 0; x < width; x += 2)
+            {
+                *yuyv++ = luma[x];
+                *yuyv++ = uv[x];
+                *yuyv++ = luma[x + 1];
+                *yuyv++ = uv[x + 1];
+            }
+        }
+    }
+} // namespace
+
+namespace usbVideo
+{
+    VirtualCameraControl::VirtualCameraControl(Logger& logger, const std::string& cameraDev)
+        : m_logger{ logger }
+        , m_cameraDev{ cameraDev }
+    {
+    }
+
+    VirtualCameraControl::~VirtualCameraControl()
+    {
+        closeDevice();
+    }
+
+    bool VirtualCameraControl::isVirtualDevice(const std::string& cameraDev)
+    {
+        return startsWith(cameraDev, syntheticDevicePrefix) or startsWith(cameraDev, fileDevicePrefix);
+    }
+
+    int VirtualCameraControl::openDevice()
+    {
+        if (not parseDeviceName())
+        {
+            return -1;
+        }
+
+        if (Source::SYNTHETIC == m_source)
+        {
+            // one bar is at least one YUYV pixel pair wide
+            const std::uint32_t barCount = sizeof(colorBars) / sizeof(colorBars[0]);
+            const std::uint32_t barPixels = std::max<std::uint32_t>(m_width / barCount / 2 * 2, 2);
+            m_barsRow.resize(2 * m_width * YUYVBytesPerPixel);
+            for (std::uint32_t x = 0; x < 2 * m_width; x += 2)
+            {
+                const std::uint8_t* bar = colorBars[(x % m_width) / barPixels % barCount];
+                std::uint8_t* pixels = &m_barsRow[x * YUYVBytesPerPixel];
+                pixels[0] = bar[0];
+                pixels[1] = bar[1];
+                pixels[2] = bar[0];
+                pixels[3] = bar[2];
+            }
+        }
+        else
+        {
+            m_file = fopen(m_path.c_str(), "rb");
+            if (nullptr == m_file)
+            {
+                LOG_ERROR_MSG("Open camera file {} failed: {}", m_path, std::strerror(errno));
+                return -1;
+            }
+            const std::uint32_t fileFrameBytes = Source::FILE_NV12 == m_source ?
+                m_width * m_height * 3 / 2 : getFrameBytes();
+            m_fileFrame.resize(fileFrameBytes);
+            fseek(m_file, 0, SEEK_END);
+            const long fileBytes = ftell(m_file);
+            fseek(m_file, 0, SEEK_SET);
+            if (fileBytes < static_cast<long>(fileFrameBytes))
+            {
+                LOG_ERROR_MSG("Camera file {} holds no {}x{} frame.", m_path, m_width, m_height);
+                closeDevice();
+                return -1;
+            }
+            LOG_INFO_MSG(m_logger, "Camera file {} holds {} frames.", m_path, fileBytes / fileFrameBytes);
+        }
+
+        m_frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_fps));
+        m_opened = true;
+        LOG_INFO_MSG(m_logger, "Virtual camera {} {}x{} YUYV, {}.", m_cameraDev, m_width, m_height,
+            m_fast ? "as fast as possible" : std::to_string(m_fps) + " fps");
+        return 0;
+    }
+
+    bool VirtualCameraControl::parseDeviceName()
+    {
+        std::string fields;
+        if (startsWith(m_cameraDev, syntheticDevicePrefix))
+        {
+            m_source = Source::SYNTHETIC;
+            fields = m_cameraDev.substr(syntheticDevicePrefix.size());
+        }
+        else if (startsWith(m_cameraDev, fileDevicePrefix))
+        {
+            m_source = Source::FILE_YUYV;
+            fields = m_cameraDev.substr(fileDevicePrefix.size());
+        }
+        else
+        {
+            LOG_ERROR_MSG("Camera {} is no virtual camera.", m_cameraDev);
+            return false;
+        }
+
+        std::istringstream fieldStream(fields);
+        std::string field;
+        if (Source::SYNTHETIC != m_source)
+        {
+            std::getline(fieldStream, m_path, optionSeparator);
+        }
+        while (std::getline(fieldStream, field, optionSeparator))
+        {
+            unsigned int width = 0;
+            unsigned int height = 0;
+            char end = 0;
+            if (2 == sscanf(field.c_str(), "%ux%u%c", &width, &height, &end))
+            {
+                m_width = width;
+                m_height = height;
+            }
+            else if ("fast" == field)
+            {
+                m_fast = true;
+            }
+            else if ("nv12" == field and Source::SYNTHETIC != m_source)
+            {
+                m_source = Source::FILE_NV12;
+            }
+            else if ("yuyv" == field and Source::SYNTHETIC != m_source)
+            {
+                m_source = Source::FILE_YUYV;
+            }
+            else if (0 == field.compare(0, 4, "fps="))
+            {
+                m_fps = static_cast<std::uint32_t>(std::strtoul(field.c_str() + 4, nullptr, 10));
+            }
+            else
+            {
+                LOG_WARNING_MSG("Virtual camera ignores option {}.", field);
+            }
+        }
+
+        // YUYV and NV12 both share chroma between pixel pairs
+        if (0 == m_width or 0 == m_height or 0 != m_width % 2 or 0 != m_height % 2 or
+            0 == m_fps or maxFps < m_fps or (Source::SYNTHETIC != m_source and m_path.empty()))
+        {
+            LOG_ERROR_MSG("Virtual camera {} needs an even frame size, 1 to {} fps and a file path for files.",
+                m_cameraDev, maxFps);
+            return false;
+        }
+        return true;
+    }
+
+    bool VirtualCameraControl::closeDevice()
+    {
+        if (nullptr != m_file)
+        {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+        m_opened = false;
+        return true;
+    }
+
+    bool VirtualCameraControl::getCameraCapability(struct v4l2_capability& capability)
+    {
+        memset(&capability, 0, sizeof(capability));
+        snprintf(reinterpret_cast<char*>(capability.driver), sizeof(capability.driver), "virtual");
+        snprintf(reinterpret_cast<char*>(capability.card), sizeof(capability.card), "%s",
+            Source::SYNTHETIC == m_source ? "synthetic pattern" : m_path.c_str());
+        snprintf(reinterpret_cast<char*>(capability.bus_info), sizeof(capability.bus_info), "platform:virtual");
+        capability.device_caps = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
+        capability.capabilities = capability.device_caps | V4L2_CAP_DEVICE_CAPS;
+        return m_opened;
+    }
+
+    bool VirtualCameraControl::getCameraFrameFormat(struct v4l2_format& format)
+    {
+        fillFormat(format);
+        return m_opened;
+    }
+
+    bool VirtualCameraControl::tryCameraFrameFormat(struct v4l2_format& format)
+    {
+        // the frame size is fixed by the device name, like a camera with one mode
+        fillFormat(format);
+        return true;
+    }
+
+    bool VirtualCameraControl::setCameraPixFormat(uint32_t width, uint32_t height)
+    {
+        return width == m_width and height == m_height;
+    }
+
+    bool VirtualCameraControl::setCameraFrameFormat(struct v4l2_format& format)
+    {
+        const bool sameSize = setCameraPixFormat(format.fmt.pix.width, format.fmt.pix.height);
+        fillFormat(format);
+        return sameSize;
+    }
+
+    bool VirtualCameraControl::getBestCameraFrameFormat(configuration::bestFrameSize& frameSize)
+    {
+        frameSize.frameWidth = m_width;
+        frameSize.frameHeight = m_height;
+        frameSize.bBestFrame = true;
+        return m_opened;
+    }
+
+    void VirtualCameraControl::fillFormat(struct v4l2_format& format) const
+    {
+        memset(&format, 0, sizeof(format));
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        format.fmt.pix.width = m_width;
+        format.fmt.pix.height = m_height;
+        format.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+        format.fmt.pix.field = V4L2_FIELD_NONE;
+        format.fmt.pix.bytesperline = m_width * YUYVBytesPerPixel;
+        format.fmt.pix.sizeimage = getFrameBytes();
+        format.fmt.pix.colorspace = V4L2_COLORSPACE_SMPTE170M;
+    }
+
+    std::uint32_t VirtualCameraControl::getFrameBytes() const
+    {
+        return m_width * m_height * YUYVBytesPerPixel;
+    }
+
+    bool VirtualCameraControl::getCaptureParm(struct v4l2_streamparm& streamParm)
+    {
+        memset(&streamParm, 0, sizeof(streamParm));
+        streamParm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        streamParm.parm.capture.capability = V4L2_CAP_TIMEPERFRAME;
+        streamParm.parm.capture.timeperframe.numerator = 1;
+        streamParm.parm.capture.timeperframe.denominator = m_fps;
+        return m_opened;
+    }
+
+    bool VirtualCameraControl::setCaptureParm(struct v4l2_streamparm& streamParm)
+    {
+        const v4l2_fract& timePerFrame = streamParm.parm.capture.timeperframe;
+        if (0 != timePerFrame.numerator and 0 != timePerFrame.denominator)
+        {
+            m_fps = std::min(std::max(timePerFrame.denominator / timePerFrame.numerator, 1u), maxFps);
+            m_frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_fps));
+        }
+        return getCaptureParm(streamParm);
+    }
+
+    int VirtualCameraControl::requestMmapBuffers(const struct v4l2_requestbuffers& requestBuffers)
+    {
+        /* exit if there is not enough memory for 2 buffers */
+        if (requestBuffers.count < 2)
+        {
+            LOG_ERROR_MSG("Unable to allocate memory for at least 2 image buffers.");
+            return -1;
+        }
+
+        m_buffers.assign(requestBuffers.count, std::vector<std::uint8_t>(getFrameBytes()));
+        m_imageBuffers.resize(requestBuffers.count);
+        for (std::uint32_t i = 0; i < requestBuffers.count; ++i)
+        {
+            m_imageBuffers[i].startBuffer = m_buffers[i].data();
+            m_imageBuffers[i].bufferLength = getFrameBytes();
+        }
+        m_queued.assign(requestBuffers.count, false);
+        m_queue.clear();
+        return static_cast<int>(requestBuffers.count);
+    }
+
+    bool VirtualCameraControl::startCameraStreaming(const struct v4l2_requestbuffers& requestBuffers)
+    {
+        for (std::uint32_t i = 0; i < requestBuffers.count; ++i)
+        {
+            struct v4l2_buffer v4l2Buffer;
+            v4l2Buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            v4l2Buffer.memory = V4L2_MEMORY_MMAP;
+            v4l2Buffer.index = i;
+
+            queueBuffer(v4l2Buffer);
+        }
+
+        m_startTime = std::chrono::steady_clock::now();
+        m_nextFrame = m_startTime;
+        m_sequence = 0;
+        m_deliveredFrames = 0;
+        m_droppedFrames = 0;
+        m_sourceLoops = 0;
+        m_streaming = true;
+        return true;
+    }
+
+    bool VirtualCameraControl::queueBuffer(const struct v4l2_buffer& v4l2Buffer)
+    {
+        // a buffer already queued is refused like VIDIOC_QBUF does
+        if (v4l2Buffer.index >= m_queued.size() or m_queued[v4l2Buffer.index])
+        {
+            return false;
+        }
+        m_queued[v4l2Buffer.index] = true;
+        m_queue.push_back(v4l2Buffer.index);
+        return true;
+    }
+
+    bool VirtualCameraControl::dequeueBuffer(struct v4l2_buffer& v4l2Buffer)
+    {
+        if (not m_streaming or m_queue.empty())
+        {
+            errno = EAGAIN;
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point captureTime = now;
+        if (not m_fast)
+        {
+            // frames due while every queued buffer was already full are lost
+            const auto dueFrames = (now - m_nextFrame) / m_frameInterval;
+            const auto lostFrames = dueFrames - static_cast<std::chrono::steady_clock::rep>(m_queue.size()) + 1;
+            if (0 < lostFrames)
+            {
+                m_nextFrame += m_frameInterval * lostFrames;
+                m_sequence += static_cast<std::uint32_t>(lostFrames);
+                m_droppedFrames += static_cast<std::uint64_t>(lostFrames);
+            }
+            if (now < m_nextFrame)
+            {
+                std::this_thread::sleep_until(m_nextFrame);
+            }
+            // the driver stamps the capture, not the dequeue
+            captureTime = m_nextFrame;
+            m_nextFrame += m_frameInterval;
+        }
+
+        const std::uint32_t index = m_queue.front();
+        const std::uint32_t timeMs = static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(captureTime - m_startTime).count());
+        if (not renderFrame(m_buffers[index].data(), m_sequence, timeMs))
+        {
+            errno = EIO;
+            return false;
+        }
+        m_queue.pop_front();
+        m_queued[index] = false;
+
+        v4l2Buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        v4l2Buffer.memory = V4L2_MEMORY_MMAP;
+        v4l2Buffer.index = index;
+        v4l2Buffer.bytesused = getFrameBytes();
+        v4l2Buffer.length = getFrameBytes();
+        v4l2Buffer.field = V4L2_FIELD_NONE;
+        v4l2Buffer.flags = V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+        v4l2Buffer.timestamp = toTimeval(captureTime);
+        v4l2Buffer.sequence = m_sequence++;
+        m_deliveredFrames++;
+        return true;
+    }
+
+    bool VirtualCameraControl::renderFrame(std::uint8_t* frame, std::uint32_t sequence, std::uint32_t timeMs)
+    {
+        if (Source::SYNTHETIC == m_source)
+        {
+            renderSynthetic(frame, sequence, timeMs);
+            return true;
+        }
+        if (not readFileFrame(Source::FILE_NV12 == m_source ? m_fileFrame.data() : frame))
+        {
+            return false;
+        }
+        if (Source::FILE_NV12 == m_source)
+        {
+            convertNV12ToYUYV(m_fileFrame.data(), frame, m_width, m_height);
+        }
+        return true;
+    }
+
+    bool VirtualCameraControl::readFileFrame(std::uint8_t* frame)
+    {
+        if (1 == fread(frame, m_fileFrame.size(), 1, m_file))
+        {
+            return true;
+        }
+        // start over, a trailing partial frame is skipped
+        fseek(m_file, 0, SEEK_SET);
+        m_sourceLoops++;
+        if (1 != fread(frame, m_fileFrame.size(), 1, m_file))
+        {
+            LOG_ERROR_MSG("Read camera file {} failed: {}", m_path, std::strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void VirtualCameraControl::renderSynthetic(std::uint8_t* frame, std::uint32_t sequence, std::uint32_t timeMs) const
+    {
+        const std::uint32_t lineBytes = m_width * YUYVBytesPerPixel;
+        const std::uint32_t offsetBytes = (sequence * scrollPixels) % m_width * YUYVBytesPerPixel;
+        for (std::uint32_t y = 0; y < m_height; ++y)
+        {
+            memcpy(frame + y * lineBytes, &m_barsRow[offsetBytes], lineBytes);
+        }
+
+        // sequence in the first row of blocks, capture time below, most significant bit left
+        const std::uint32_t blockPixels = std::max<std::uint32_t>(std::min(stampBlockPixels, m_width / stampBits) / 2 * 2, 2);
+        const std::uint32_t stamps[] = { sequence, timeMs };
+        for (std::uint32_t row = 0; row < 2; ++row)
+        {
+            for (std::uint32_t y = row * blockPixels; y < std::min((row + 1) * blockPixels, m_height); ++y)
+            {
+                std::uint8_t* line = frame + y * lineBytes;
+                for (std::uint32_t bit = 0; bit < stampBits and (bit + 1) * blockPixels <= m_width; ++bit)
+                {
+                    const std::uint8_t luma = (stamps[row] >> (stampBits - 1 - bit)) & 1 ? stampOne : stampZero;
+                    for (std::uint32_t x = bit * blockPixels; x < (bit + 1) * blockPixels; x += 2)
+                    {
+                        std::uint8_t* pixels = line + x * YUYVBytesPerPixel;
+                        pixels[0] = luma;
+                        pixels[1] = neutralChroma;
+                        pixels[2] = luma;
+                        pixels[3] = neutralChroma;
+                    }
+                }
+            }
+        }
+    }
+
+    bool VirtualCameraControl::queryBuffer(const struct v4l2_buffer& v4l2Buffer)
+    {
+        return v4l2Buffer.index < m_buffers.size();
+    }
+
+    bool VirtualCameraControl::stopCameraStreaming(const int&)
+    {
+        if (not m_streaming)
+        {
+            return true;
+        }
+        m_streaming = false;
+        m_queue.clear();
+        std::fill(m_queued.begin(), m_queued.end(), false);
+
+        const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+        LOG_INFO_MSG(m_logger, "Virtual camera delivered {} frames in {:.1f} s ({:.1f} fps), dropped {}, {} file loops.",
+            m_deliveredFrames, elapsedSeconds, 0.0 < elapsedSeconds ? m_deliveredFrames / elapsedSeconds : 0.0,
+            m_droppedFrames, m_sourceLoops);
+        return true;
+    }
+
+    bool VirtualCameraControl::unMapBuffers()
+    {
+        m_imageBuffers.clear();
+        m_buffers.clear();
+        m_queued.clear();
+        return true;
+    }
+
+    bool VirtualCameraControl::getRGBBuffer(std::vector<uint8_t>& rgbBuffer, const struct v4l2_buffer& v4l2Buffer,
+        const int& reqWidth, const int& reqHeight)
+    {
+        if (v4l2Buffer.index >= m_buffers.size())
+        {
+            return false;
+        }
+        return 0 == convertYuvToRgbBuffer(m_buffers[v4l2Buffer.index].data(), &rgbBuffer[0], reqWidth, reqHeight);
+    }
+
+    const uint8_t* VirtualCameraControl::getImageBuffer(const struct v4l2_buffer& v4l2Buffer, uint32_t& length)
+    {
+        if (v4l2Buffer.index >= m_imageBuffers.size())
+        {
+            length = 0;
+            return nullptr;
+        }
+        const configuration::imageBuffer& imageBuffer = m_imageBuffers[v4l2Buffer.index];
+        length = (0 < v4l2Buffer.bytesused) ? v4l2Buffer.bytesused : imageBuffer.bufferLength;
+        return static_cast<const uint8_t*>(imageBuffer.startBuffer);
+    }
+} // namespace usbVideo